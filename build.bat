@@ -7,6 +7,7 @@ if not exist ./build (mkdir build)
 pushd build
 
 cl ..\os.cpp -nologo -FC -Zi -Oi -W3 -DINTERNAL_BUILD /LD /link /out:game.dll opengl32.lib
-cl ..\win32_game.cpp -nologo -FC -Zi -W3 -DINTERNAL_BUILD /link user32.lib gdi32.lib opengl32.lib winmm.lib
+cl ..\win32_game.cpp -nologo -FC -Zi -W3 -DINTERNAL_BUILD /link user32.lib gdi32.lib opengl32.lib winmm.lib advapi32.lib psapi.lib
+cl ..\world_builder.cpp -nologo -FC -Zi -O2 -EHsc -W3 /link /out:world_builder.exe
 
 popd
\ No newline at end of file
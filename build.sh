@@ -0,0 +1,13 @@
+#!/bin/sh
+
+# NOTE(alexey): The POSIX host (posix_game.cpp) and the game library it loads, see build.bat for windows.
+
+mkdir -p build
+cd build
+
+g++ ../os.cpp -std=c++17 -g -O2 -fPIC -shared -fvisibility=hidden -DINTERNAL_BUILD=1 -o libgame.so
+g++ ../os.cpp -std=c++17 -g -O2 -fPIC -shared -fvisibility=hidden -DINTERNAL_BUILD=1 -DGAME_BENCHMARKS=1 -o libgame_bench.so
+g++ ../posix_game.cpp -std=c++17 -g -O2 -DINTERNAL_BUILD=1 -o game -ldl -lpthread
+g++ ../world_builder.cpp -std=c++17 -g -O2 -o world_builder
+
+cd ..
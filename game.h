@@ -1,11 +1,23 @@
 /* date = October 8th 2023 0:23 pm */
 #ifndef GAME_H
 
+#include "game_render.h"
+
 // TODO(alexey): Player's position should always be tile relative.
 // Either ralative to top-left corner, or a center of the tile.
 // If we know the tile that the player is currently in, we can easily
 // recompute its position.
 
+enum TileValue
+{
+    TileValue_Empty = 0,
+    TileValue_Wall = 1,
+    TileValue_Door = 2,
+    
+    // NOTE(alexey): Returned for tiles that lie outside of the world.
+    TileValue_Invalid = Uint32Max,
+};
+
 struct TileMap
 {
     U32 *tiles;
@@ -30,9 +42,6 @@ struct GameWorld
               I32 tile_map_count_y, 
               I32 tile_count_x, 
               I32 tile_count_y, 
-              I32 offset_x,
-              I32 offset_y, 
-              F32 tile_dim,
               F32 tile_side_in_pixels, 
               F32 tile_side_in_meters);
     
@@ -42,6 +51,18 @@ struct GameWorld
     TileMap *getWorldTileMap(I32 test_tile_map_x, I32 test_tile_map_y); // NOTE(alexey): Return const?
     WorldPos recomputeWorldPos(WorldPos world_pos);
     Bool32 isTileMapPointEmpty(WorldPos world_pos);
+    
+    // NOTE(alexey): Absolute tile coordinates span the whole world,
+    // abs_tile_x = tile_map_x*m_tile_count_x + tile_x (the same for y).
+    U32 getAbsTileValue(I32 abs_tile_x, I32 abs_tile_y);
+    I32 getAbsTileX(WorldPos world_pos) { return world_pos.tile_map_x*m_tile_count_x + world_pos.tile_x; }
+    I32 getAbsTileY(WorldPos world_pos) { return world_pos.tile_map_y*m_tile_count_y + world_pos.tile_y; }
+    
+    // NOTE(alexey): Returns (a - b) in meters.
+    Vec2 subtractWorldPos(WorldPos a, WorldPos b);
+    
+    // NOTE(alexey): The position t of the way from a to b, t is in [0, 1].
+    WorldPos lerpWorldPos(WorldPos a, WorldPos b, F32 t);
         
     TileMap *m_maps;
     
@@ -51,18 +72,18 @@ struct GameWorld
     I32 m_tile_count_x;
     I32 m_tile_count_y;
     
-    I32 m_offset_x;
-    I32 m_offset_y;
-    
-    F32 m_tile_dim;
-    F32 m_tile_half_dim;
-    
     F32 m_tile_side_in_pixels;
     F32 m_tile_side_in_meters;
     F32 m_half_tile_side_in_meters;
     
+    // NOTE(alexey): Pixels of the output (the window) per meter, it decides how much of the world the camera sees.
+    // The internal render resolution doesn't change that, only how many pixels a meter gets (see get_view_dim).
     F32 m_pixels_per_meter;
     
+    // NOTE(alexey): Amount of tile lookups that hit a tile map which isn't resident (streamed in) yet.
+    // We never wait for those, such tiles are reported as TileValue_Invalid and treated as solid.
+    U64 m_stall_count;
+    
     // NOTE(alexey): The lower 8 bits correspond where in the chunk we are.
     // If chunk for example, 256x256, that will give us the exact tile of where we are in the chunk.
     // The remaining 24 bits corresponds to where we are in our world.
@@ -73,6 +94,75 @@ struct GameWorld
 
 function GameWorld makeGameWorld(TileMap* tile_maps);
 
+#include "game_world_streamer.h"
+
+// NOTE(alexey): Range of absolute tiles, min is inclusive, max is exclusive.
+struct TileRect
+{
+    I32 min_tile_x;
+    I32 min_tile_y;
+    I32 max_tile_x;
+    I32 max_tile_y;
+};
+
+struct Camera
+{
+    // NOTE(alexey): The camera looks at m_pos, which is always mapped to the center of the screen.
+    // view_dim is the size of what the camera sees, in meters.
+    void follow(GameWorld *world, WorldPos target, F32 dt);
+    TileRect getVisibleTiles(GameWorld *world, Vec2 view_dim);
+    
+    WorldPos m_pos;
+    
+    // NOTE(alexey): How fast the camera catches up with the target (1/seconds).
+    // The higher the value, the stiffer the camera.
+    F32 m_follow_rate;
+};
+
+#include "game_pathfinding.h"
+#include "game_path_graph.h"
+#include "game_flow_field.h"
+#include "game_lighting.h"
+#include "game_snapshot.h"
+#include "game_image.h"
+
+// NOTE(alexey): The simulation runs at a fixed rate, whatever the frame rate is, so it's deterministic.
+// A frame runs as many steps as the real time that passed asks for, and renders between the last two states.
+// A frame that took too long (a breakpoint, a window drag) doesn't run more than SIMULATION_MAX_STEPS_PER_FRAME steps,
+// the rest of the time is dropped, otherwise the simulation would never catch up once it's behind.
+#define SIMULATION_STEPS_PER_SECOND 120
+#define SIMULATION_SECONDS_PER_STEP (1.0f / SIMULATION_STEPS_PER_SECOND)
+#define SIMULATION_MAX_STEPS_PER_FRAME 8
+
+// NOTE(alexey): Tile maps on each side of the world generated from Os::world_seed (see init_game_world).
+#define GENERATED_WORLD_TILE_MAP_COUNT 64
+
+// NOTE(alexey): The path the debug overlay draws, the benchmarks leave one there (see game_benchmarks.h).
+#define DEBUG_PATH_MAX_POINT_COUNT 256
+
+// NOTE(alexey): The scene is drawn into a buffer of its own at a fraction of the output resolution (F7 cycles through
+// render_scales), and scaled to the output with ScaleFilter (F8), unless the fraction is 1.
+// The output is cut down to RENDER_MAX_WIDTH x RENDER_MAX_HEIGHT first, a bigger window shows the same part 
+// of the world as the biggest one does, only scaled.
+#define RENDER_MAX_WIDTH 3840
+#define RENDER_MAX_HEIGHT 2160
+
+// NOTE(alexey): Printed every SIMULATION_STATS_FRAME_COUNT frames in the internal builds, then reset.
+// Latency is from sampling the input to the end of rendering the first frame that shows its result.
+#define SIMULATION_STATS_FRAME_COUNT 300
+
+struct SimulationStats
+{
+    U64 start_qpc;
+    U64 start_step_index;
+    U64 start_heap_allocation_count; // heap_allocation_counter of the game module.
+    U64 frame_count;
+    U64 new_snapshot_count;
+    U64 render_counts; // qpc counts spent in render.
+    U64 latency_counts;
+    U64 max_latency_counts;
+};
+
 struct GameState
 {
     GameState(GameWorld* world)
@@ -82,8 +172,15 @@ struct GameState
     
     // TODO(alexey): When we create a game state, we should initialize a game world as well!
     // Allocate memory for the tile maps etc.
+    
+    // NOTE(alexey): A single simulation step, input->dt_for_frame is the step's time.
     void update(Input *input/*...*/);
-    void render(OffscreenBuffer *buffer);
+    void captureSnapshot(RenderSnapshot *snapshot, InputSample *sample);
+    
+    // NOTE(alexey): Draws the snapshot interpolated between its last two steps, alpha is in [0, 1].
+    // view_dim meters of the world around the camera are mapped to the whole buffer.
+    // Only reads the snapshot and the render side of the state.
+    void render(OffscreenBuffer *buffer, Vec2 view_dim, RenderSnapshot *snapshot, F32 alpha);
     
     // TODO(alexey): Make the world be a part of game state since it's really is.
     // Move all the updates inside update() function,
@@ -91,7 +188,58 @@ struct GameState
     // Maybe the input has to be a part of game state as well?
     
     GameWorld *m_world;
+    WorldStreamer m_world_streamer;
     WorldPos m_world_pos;
+    Camera m_camera;
+    
+    // NOTE(alexey): The state before the last simulation step, for the interpolation.
+    WorldPos m_prev_world_pos;
+    WorldPos m_prev_camera_pos;
+    F32 m_simulation_accumulator; // real time that wasn't simulated yet, in seconds.
+    U64 m_simulation_step_count;
+    
+    // NOTE(alexey): Simulation thread, when the platform has a simulation queue, see game_snapshot.h.
+    // The simulation side owns everything above and below, except the snapshot and the input slots it doesn't hold.
+    Bool32 m_simulation_is_threaded;
+    U64 m_last_simulation_qpc;
+    U64 m_simulation_keys_down[4]; // Input::keys_down of the last batch, see simulation_thread_work.
+    InputSample m_input_samples[3];
+    TripleBuffer m_input_buffer;
+    RenderSnapshot m_snapshots[3];
+    TripleBuffer m_snapshot_buffer;
+    U32 m_max_snapshot_tile_count;
+    SimulationStats m_simulation_stats;
+    
+    Pathfinder m_pathfinder;
+    PathGraph m_path_graph;
+    FlowField m_flow_field;
+    Lighting m_lighting;
+    
+    MemoryArena m_permanent_arena;
+    MemoryArena m_frame_arena; // render side.
+    MemoryArena m_simulation_arena; // reset for every simulation batch.
+    
+    Palette m_palette;
+    DebugOverlay m_debug_overlay; // render side.
+    Bool32 m_debug_overlay_is_enabled;
+    Bool32 m_debug_overlay_key_was_down;
+    TilePoint m_debug_path[DEBUG_PATH_MAX_POINT_COUNT];
+    U32 m_debug_path_point_count;
+    
+    Bitmap m_shadow_bitmap;
+    Bitmap m_player_bitmap;
+    
+    // NOTE(alexey): Render side, see RENDER_MAX_WIDTH.
+    // The bitmaps are scaled down with the render resolution, so they keep their size on the screen.
+    OffscreenBuffer m_render_buffer;
+    U32 m_render_scale_index;
+    ScaleFilter m_scale_filter;
+    Bool32 m_render_scale_key_was_down;
+    Bool32 m_scale_filter_key_was_down;
+    F32 m_bitmap_scale;
+    Bitmap m_scaled_shadow_bitmap;
+    Bitmap m_scaled_player_bitmap;
+    
     Vec2 m_player_dim;
     F32 m_player_speed_in_meters;
     
@@ -0,0 +1,976 @@
+#include <unordered_map>
+
+// NOTE(alexey): Tile changes have to go through here, so the pathfinding graph of the chunk gets rebuilt.
+function Bool32 set_world_tile(GameState *state, I32 abs_tile_x, I32 abs_tile_y, U32 value)
+{
+    GameWorld *world = state->m_world;
+    if((abs_tile_x < 0) || (abs_tile_y < 0))
+    {
+        return false;
+    }
+    
+    I32 tile_map_x = abs_tile_x / world->m_tile_count_x;
+    I32 tile_map_y = abs_tile_y / world->m_tile_count_y;
+    I32 tile_x = abs_tile_x % world->m_tile_count_x;
+    I32 tile_y = abs_tile_y % world->m_tile_count_y;
+    
+    U32 *tiles = 0;
+    if(state->m_world_streamer.m_is_open)
+    {
+        tiles = state->m_world_streamer.getWritableTiles(tile_map_x, tile_map_y);
+    }
+    else
+    {
+        TileMap *tile_map = world->getWorldTileMap(tile_map_x, tile_map_y);
+        tiles = tile_map ? tile_map->tiles : 0;
+    }
+    
+    if(!tiles)
+    {
+        return false;
+    }
+    
+    tiles[(world->m_tile_count_y - tile_y - 1)*world->m_tile_count_x + tile_x] = value;
+    state->m_path_graph.invalidateTile(abs_tile_x, abs_tile_y);
+    state->m_flow_field.invalidateTile(abs_tile_x, abs_tile_y);
+    state->m_lighting.invalidateTile(abs_tile_x, abs_tile_y);
+    return true;
+}
+
+// NOTE(alexey): Goes through the pathfinder, so the tiles don't have to be resident.
+function TilePoint pick_free_tile(Pathfinder *pathfinder, RandomSeries *series, I32 center_x, I32 center_y, 
+                                  I32 radius_x, I32 radius_y)
+{
+    TilePoint result = {center_x, center_y};
+    
+    for(U32 attempt = 0; attempt < 64; ++attempt)
+    {
+        I32 x = center_x + random_between(series, -radius_x, radius_x);
+        I32 y = center_y + random_between(series, -radius_y, radius_y);
+        if(pathfinder->isTilePassable(&pathfinder->m_scratches[0], x, y))
+        {
+            result = {x, y};
+            break;
+        }
+    }
+    
+    return result;
+}
+
+// NOTE(alexey): A batch of paths between random free tiles around the player,
+// the tile maps within the streamer's load radius are always resident there.
+function void run_pathfinding_benchmark(GameState *state)
+{
+    GameWorld *world = state->m_world;
+    MemoryArena *arena = &state->m_simulation_arena;
+    
+    I32 center_x = world->getAbsTileX(state->m_world_pos);
+    I32 center_y = world->getAbsTileY(state->m_world_pos);
+    I32 radius_x = 2*world->m_tile_count_x;
+    I32 radius_y = 2*world->m_tile_count_y;
+    
+    RandomSeries series = {os->get_qpc()};
+    PathQuery *queries = push_array(arena, PATHFINDING_BENCHMARK_QUERY_COUNT, PathQuery);
+    for(U32 query_index = 0; query_index < PATHFINDING_BENCHMARK_QUERY_COUNT; ++query_index)
+    {
+        PathQuery *query = &queries[query_index];
+        *query = {};
+        query->start = pick_free_tile(&state->m_pathfinder, &series, center_x, center_y, radius_x, radius_y);
+        query->goal = pick_free_tile(&state->m_pathfinder, &series, center_x, center_y, radius_x, radius_y);
+        if(query_index == 0)
+        {
+            // NOTE(alexey): The first path starts at the player, it's the one the debug overlay shows.
+            query->start = {center_x, center_y};
+        }
+        
+        query->points = push_array(arena, PATHFINDING_BENCHMARK_MAX_POINT_COUNT, TilePoint);
+        query->max_point_count = PATHFINDING_BENCHMARK_MAX_POINT_COUNT;
+    }
+    
+    U64 start_counts = os->get_qpc();
+    state->m_pathfinder.findPaths(queries, PATHFINDING_BENCHMARK_QUERY_COUNT);
+    F64 seconds = (F64)(os->get_qpc() - start_counts) / (F64)os->frequency;
+    
+    U32 found_count = 0;
+    state->m_debug_path_point_count = 0;
+    for(U32 query_index = 0; query_index < PATHFINDING_BENCHMARK_QUERY_COUNT; ++query_index)
+    {
+        PathQuery *query = &queries[query_index];
+        if(query->status == PathStatus_Found)
+        {
+            if(query_index == 0)
+            {
+                memcpy(state->m_debug_path, query->points, query->point_count*sizeof(TilePoint));
+                state->m_debug_path_point_count = query->point_count;
+            }
+            
+            ++found_count;
+        }
+    }
+    
+    DebugOut("Pathfinder: %u paths (%u found) in %.3f ms on %u threads, %.0f paths/s\n",
+             PATHFINDING_BENCHMARK_QUERY_COUNT,
+             found_count,
+             seconds*1000.0,
+             state->m_pathfinder.m_scratch_count,
+             (F64)PATHFINDING_BENCHMARK_QUERY_COUNT / seconds);
+}
+
+// NOTE(alexey): Long paths between random free tiles around the player, found with the flat search,
+// then with the path graph, first with the cold cache and then with the warm one, all on the main thread.
+// The points are close enough for the flat search's window, so both can find them.
+// Then a tile next to the player is changed, to see what rebuilding the graph of a single chunk costs.
+function void run_path_graph_benchmark(GameState *state)
+{
+    GameWorld *world = state->m_world;
+    MemoryArena *arena = &state->m_simulation_arena;
+    Pathfinder *pathfinder = &state->m_pathfinder;
+    PathGraph *graph = &state->m_path_graph;
+    
+    I32 center_x = world->getAbsTileX(state->m_world_pos);
+    I32 center_y = world->getAbsTileY(state->m_world_pos);
+    I32 radius = PATHFINDER_MAX_WINDOW_SIDE / 2 - 1;
+    
+    RandomSeries series = {os->get_qpc()};
+    PathQuery *flat_queries = push_array(arena, PATH_GRAPH_BENCHMARK_QUERY_COUNT, PathQuery);
+    PathQuery *graph_queries = push_array(arena, PATH_GRAPH_BENCHMARK_QUERY_COUNT, PathQuery);
+    for(U32 query_index = 0; query_index < PATH_GRAPH_BENCHMARK_QUERY_COUNT; ++query_index)
+    {
+        PathQuery *query = &flat_queries[query_index];
+        *query = {};
+        query->start = pick_free_tile(pathfinder, &series, center_x, center_y, radius, radius);
+        query->goal = pick_free_tile(pathfinder, &series, center_x, center_y, radius, radius);
+        if(query_index == 0)
+        {
+            query->start = {center_x, center_y};
+        }
+        
+        query->points = push_array(arena, PATHFINDING_BENCHMARK_MAX_POINT_COUNT, TilePoint);
+        query->max_point_count = PATHFINDING_BENCHMARK_MAX_POINT_COUNT;
+        
+        graph_queries[query_index] = *query;
+        graph_queries[query_index].points = push_array(arena, PATHFINDING_BENCHMARK_MAX_POINT_COUNT, TilePoint);
+    }
+    
+    U64 start_counts = os->get_qpc();
+    for(U32 query_index = 0; query_index < PATH_GRAPH_BENCHMARK_QUERY_COUNT; ++query_index)
+    {
+        pathfinder->findPath(&pathfinder->m_scratches[0], &flat_queries[query_index]);
+    }
+    F64 flat_seconds = (F64)(os->get_qpc() - start_counts) / (F64)os->frequency;
+    
+    graph->invalidateAll();
+    U64 built_graph_count = graph->m_built_graph_count;
+    U64 build_counts = graph->m_build_counts;
+    
+    start_counts = os->get_qpc();
+    for(U32 query_index = 0; query_index < PATH_GRAPH_BENCHMARK_QUERY_COUNT; ++query_index)
+    {
+        graph->findPath(&graph_queries[query_index]);
+    }
+    F64 cold_seconds = (F64)(os->get_qpc() - start_counts) / (F64)os->frequency;
+    
+    built_graph_count = graph->m_built_graph_count - built_graph_count;
+    build_counts = graph->m_build_counts - build_counts;
+    
+    start_counts = os->get_qpc();
+    for(U32 query_index = 0; query_index < PATH_GRAPH_BENCHMARK_QUERY_COUNT; ++query_index)
+    {
+        graph->findPath(&graph_queries[query_index]);
+    }
+    F64 warm_seconds = (F64)(os->get_qpc() - start_counts) / (F64)os->frequency;
+    
+    U32 flat_found_count = 0;
+    U32 graph_found_count = 0;
+    F64 flat_length = 0.0;
+    F64 graph_length = 0.0;
+    for(U32 query_index = 0; query_index < PATH_GRAPH_BENCHMARK_QUERY_COUNT; ++query_index)
+    {
+        PathQuery *flat_query = &flat_queries[query_index];
+        PathQuery *graph_query = &graph_queries[query_index];
+        flat_found_count += (flat_query->status == PathStatus_Found);
+        graph_found_count += (graph_query->status == PathStatus_Found);
+        if((flat_query->status == PathStatus_Found) && (graph_query->status == PathStatus_Found))
+        {
+            flat_length += flat_query->length;
+            graph_length += graph_query->length;
+        }
+    }
+    
+    state->m_debug_path_point_count = 0;
+    if(graph_queries[0].status == PathStatus_Found)
+    {
+        memcpy(state->m_debug_path, graph_queries[0].points, graph_queries[0].point_count*sizeof(TilePoint));
+        state->m_debug_path_point_count = graph_queries[0].point_count;
+    }
+    
+    // NOTE(alexey): Wall up a free tile next to the player and put it back, then find the first path again.
+    // Only the chunk of the tile (and its neighbour, if the tile is on the border) is rebuilt.
+    U64 rebuilt_graph_count = graph->m_built_graph_count;
+    F64 rebuild_seconds = 0.0;
+    for(I32 offset_x = -1; offset_x <= 1; offset_x += 2)
+    {
+        I32 tile_x = center_x + offset_x;
+        if(pathfinder->isTilePassable(&pathfinder->m_scratches[0], tile_x, center_y))
+        {
+            U32 tile_value = world->getAbsTileValue(tile_x, center_y);
+            if(set_world_tile(state, tile_x, center_y, TileValue_Wall))
+            {
+                set_world_tile(state, tile_x, center_y, tile_value);
+                
+                start_counts = os->get_qpc();
+                graph->findPath(&graph_queries[0]);
+                rebuild_seconds = (F64)(os->get_qpc() - start_counts) / (F64)os->frequency;
+            }
+            
+            break;
+        }
+    }
+    rebuilt_graph_count = graph->m_built_graph_count - rebuilt_graph_count;
+    
+    U64 slot_size = (graph->m_max_entrance_count*(sizeof(TilePoint) + graph->m_max_entrance_count*sizeof(F32)) + 
+                     world->m_tile_count_x*world->m_tile_count_y);
+    U64 chunk_count = (U64)world->m_tile_map_count_x*world->m_tile_map_count_y;
+    
+    DebugOut("PathGraph: %u paths up to %i tiles apart, flat %u found in %.1f us/path, "
+             "graph %u found in %.1f us/path cold, %.1f us/path warm, %.3fx the flat length\n",
+             PATH_GRAPH_BENCHMARK_QUERY_COUNT,
+             2*radius,
+             flat_found_count,
+             flat_seconds*1000000.0 / PATH_GRAPH_BENCHMARK_QUERY_COUNT,
+             graph_found_count,
+             cold_seconds*1000000.0 / PATH_GRAPH_BENCHMARK_QUERY_COUNT,
+             warm_seconds*1000000.0 / PATH_GRAPH_BENCHMARK_QUERY_COUNT,
+             (flat_length > 0.0) ? graph_length / flat_length : 0.0);
+    DebugOut("PathGraph: %llu chunk graphs built at %.1f us each, %llu evicted, %.2f MB of slots, %.2f MB chunk lookup, "
+             "a tile change rebuilt %llu graphs, the next query took %.1f us\n",
+             (unsigned long long)built_graph_count,
+             built_graph_count ? ((F64)build_counts*1000000.0 / (F64)os->frequency) / (F64)built_graph_count : 0.0,
+             (unsigned long long)graph->m_evicted_graph_count,
+             (F64)(slot_size*graph->m_slot_count) / (1024.0*1024.0),
+             (F64)(chunk_count*sizeof(U32)) / (1024.0*1024.0),
+             (unsigned long long)rebuilt_graph_count,
+             rebuild_seconds*1000000.0);
+}
+
+// NOTE(alexey): A flow field to the player's tile, built with the cold path graph, then again with the warm one,
+// then once more after a tile next to the player changes. A crowd spread over the whole field samples its directions,
+// and some of them walk the field to check that it gets them to the goal.
+function void run_flow_field_benchmark(GameState *state)
+{
+    GameWorld *world = state->m_world;
+    MemoryArena *arena = &state->m_simulation_arena;
+    Pathfinder *pathfinder = &state->m_pathfinder;
+    FlowField *field = &state->m_flow_field;
+    
+    I32 tile_count_x = world->m_tile_count_x;
+    I32 tile_count_y = world->m_tile_count_y;
+    TilePoint goal = {world->getAbsTileX(state->m_world_pos), world->getAbsTileY(state->m_world_pos)};
+    
+    state->m_path_graph.invalidateAll();
+    field->invalidateAll();
+    U64 built_chunk_count = field->m_built_chunk_count;
+    U64 start_counts = os->get_qpc();
+    Bool32 is_built = field->build(goal);
+    F64 cold_seconds = (F64)(os->get_qpc() - start_counts) / (F64)os->frequency;
+    built_chunk_count = field->m_built_chunk_count - built_chunk_count;
+    if(!is_built)
+    {
+        DebugOut("FlowField: the player's tile isn't passable\n");
+        return;
+    }
+    
+    field->invalidateAll();
+    start_counts = os->get_qpc();
+    field->build(goal);
+    F64 warm_seconds = (F64)(os->get_qpc() - start_counts) / (F64)os->frequency;
+    
+    start_counts = os->get_qpc();
+    field->build(goal);
+    F64 cached_seconds = (F64)(os->get_qpc() - start_counts) / (F64)os->frequency;
+    
+    // NOTE(alexey): Wall up a free tile next to the player and put it back, only the chunks around it are built again.
+    U64 rebuilt_chunk_count = field->m_built_chunk_count;
+    F64 rebuild_seconds = 0.0;
+    for(I32 offset_x = -1; offset_x <= 1; offset_x += 2)
+    {
+        I32 tile_x = goal.x + offset_x;
+        if(pathfinder->isTilePassable(&pathfinder->m_scratches[0], tile_x, goal.y))
+        {
+            U32 tile_value = world->getAbsTileValue(tile_x, goal.y);
+            if(set_world_tile(state, tile_x, goal.y, TileValue_Wall))
+            {
+                set_world_tile(state, tile_x, goal.y, tile_value);
+                
+                start_counts = os->get_qpc();
+                field->build(goal);
+                rebuild_seconds = (F64)(os->get_qpc() - start_counts) / (F64)os->frequency;
+            }
+            
+            break;
+        }
+    }
+    rebuilt_chunk_count = field->m_built_chunk_count - rebuilt_chunk_count;
+    
+    ChunkRect region = field->m_region;
+    RandomSeries series = {os->get_qpc()};
+    WorldPos *agents = push_array(arena, FLOW_FIELD_BENCHMARK_AGENT_COUNT, WorldPos);
+    for(U32 agent_index = 0; agent_index < FLOW_FIELD_BENCHMARK_AGENT_COUNT; ++agent_index)
+    {
+        WorldPos *agent = &agents[agent_index];
+        *agent = {};
+        agent->tile_map_x = random_between(&series, region.min_tile_map_x, region.max_tile_map_x);
+        agent->tile_map_y = random_between(&series, region.min_tile_map_y, region.max_tile_map_y);
+        agent->tile_x = random_between(&series, 0, tile_count_x - 1);
+        agent->tile_y = random_between(&series, 0, tile_count_y - 1);
+    }
+    
+    // NOTE(alexey): The sum keeps the compiler from throwing the samples away.
+    Vec2 direction_sum = {};
+    start_counts = os->get_qpc();
+    for(U32 agent_index = 0; agent_index < FLOW_FIELD_BENCHMARK_AGENT_COUNT; ++agent_index)
+    {
+        direction_sum += field->sample(agents[agent_index]);
+    }
+    F64 sample_seconds = (F64)(os->get_qpc() - start_counts) / (F64)os->frequency;
+    
+    // NOTE(alexey): Every step goes to a tile that is closer to the goal, the limit is only there in case it doesn't.
+    U32 walked_count = 0;
+    U32 reached_count = 0;
+    U32 max_step_count = field->m_chunk_count*tile_count_x*tile_count_y;
+    state->m_debug_path_point_count = 0;
+    for(U32 agent_index = 0; agent_index < FLOW_FIELD_BENCHMARK_WALK_COUNT; ++agent_index)
+    {
+        WorldPos pos = agents[agent_index];
+        Vec2 direction = field->sample(pos);
+        if((direction.x == 0.0f) && (direction.y == 0.0f))
+        {
+            continue;
+        }
+        
+        Bool32 is_debug_path = (walked_count == 0);
+        ++walked_count;
+        
+        for(U32 step_index = 0; step_index < max_step_count; ++step_index)
+        {
+            I32 x = world->getAbsTileX(pos);
+            I32 y = world->getAbsTileY(pos);
+            if(is_debug_path && (state->m_debug_path_point_count < DEBUG_PATH_MAX_POINT_COUNT))
+            {
+                state->m_debug_path[state->m_debug_path_point_count++] = {x, y};
+            }
+            
+            if((x == goal.x) && (y == goal.y))
+            {
+                ++reached_count;
+                break;
+            }
+            
+            direction = field->sample(pos);
+            if((direction.x == 0.0f) && (direction.y == 0.0f))
+            {
+                break;
+            }
+            
+            x += (direction.x > 0.0f) - (direction.x < 0.0f);
+            y += (direction.y > 0.0f) - (direction.y < 0.0f);
+            pos.tile_map_x = x / tile_count_x;
+            pos.tile_map_y = y / tile_count_y;
+            pos.tile_x = x % tile_count_x;
+            pos.tile_y = y % tile_count_y;
+        }
+    }
+    
+    DebugOut("FlowField: %ix%i tile maps built in %.3f ms cold (%llu chunks on %u threads), %.3f ms warm, "
+             "%.1f us cached, %.3f ms after a tile change (%llu chunks)\n",
+             region.max_tile_map_x - region.min_tile_map_x + 1,
+             region.max_tile_map_y - region.min_tile_map_y + 1,
+             cold_seconds*1000.0,
+             (unsigned long long)built_chunk_count,
+             pathfinder->m_scratch_count,
+             warm_seconds*1000.0,
+             cached_seconds*1000000.0,
+             rebuild_seconds*1000.0,
+             (unsigned long long)rebuilt_chunk_count);
+    DebugOut("FlowField: %u agents sampled in %.3f ms, %.2f ns/agent, %u/%u walked to the goal (%.1f)\n",
+             FLOW_FIELD_BENCHMARK_AGENT_COUNT,
+             sample_seconds*1000.0,
+             sample_seconds*1000000000.0 / FLOW_FIELD_BENCHMARK_AGENT_COUNT,
+             reached_count,
+             walked_count,
+             direction_sum.x + direction_sum.y);
+}
+
+// NOTE(alexey): Replaces the lights with random ones around the player and times the recomputation of the window,
+// first with the player's light only, then with all the lights. The lights are left in the world.
+function void run_lighting_benchmark(GameState *state)
+{
+    Lighting *lighting = &state->m_lighting;
+    TilePoint center = {state->m_world->getAbsTileX(state->m_world_pos), state->m_world->getAbsTileY(state->m_world_pos)};
+    
+    lighting->clearLights();
+    lighting->update(center);
+    
+    U64 start_counts = os->get_qpc();
+    for(U32 iteration = 0; iteration < LIGHTING_BENCHMARK_ITERATION_COUNT; ++iteration)
+    {
+        lighting->recompute();
+    }
+    F64 base_seconds = (F64)(os->get_qpc() - start_counts) / (F64)os->frequency / LIGHTING_BENCHMARK_ITERATION_COUNT;
+    
+    // NOTE(alexey): Lights only go on the tiles that don't block the light.
+    RandomSeries series = {os->get_qpc()};
+    I32 spread = LIGHTING_WINDOW_SIDE / 2 - 1;
+    for(U32 attempt = 0; (attempt < 16*LIGHTING_BENCHMARK_LIGHT_COUNT) && (lighting->m_light_count < LIGHTING_BENCHMARK_LIGHT_COUNT); ++attempt)
+    {
+        Light light;
+        light.tile = {center.x + random_between(&series, -spread, spread), center.y + random_between(&series, -spread, spread)};
+        light.radius = random_between(&series, 4, 12);
+        light.intensity = 0.5f;
+        
+        I32 x = light.tile.x - lighting->m_window_min_x;
+        I32 y = light.tile.y - lighting->m_window_min_y;
+        if(!((lighting->m_opaque[y] >> x) & 1))
+        {
+            lighting->addLight(light);
+        }
+    }
+    
+    start_counts = os->get_qpc();
+    for(U32 iteration = 0; iteration < LIGHTING_BENCHMARK_ITERATION_COUNT; ++iteration)
+    {
+        lighting->recompute();
+    }
+    F64 lights_seconds = (F64)(os->get_qpc() - start_counts) / (F64)os->frequency / LIGHTING_BENCHMARK_ITERATION_COUNT;
+    
+    DebugOut("Lighting: %ix%i tiles, %.1f us with the player's light, %.1f us with %u lights (%.2f us/light), "
+             "%llu recomputes so far\n",
+             LIGHTING_WINDOW_SIDE,
+             LIGHTING_WINDOW_SIDE,
+             base_seconds*1000000.0,
+             lights_seconds*1000000.0,
+             lighting->m_last_light_count,
+             lighting->m_last_light_count ? (lights_seconds - base_seconds)*1000000.0 / lighting->m_last_light_count : 0.0,
+             (unsigned long long)lighting->m_recompute_count);
+}
+
+// NOTE(alexey): Clear and present conversion of a frame at a few resolutions.
+// The frame gets PRESENT_BENCHMARK_DRAW_COUNT rectangles, so the conversion doesn't see a single color.
+function void run_present_benchmark(GameState *state)
+{
+    MemoryArena *arena = &state->m_simulation_arena;
+    
+    I32 resolutions[][2] = {{640, 360}, {1280, 720}, {1920, 1080}, {2560, 1440}, {3840, 2160}};
+    I32 max_width = resolutions[ArrayCount(resolutions) - 1][0];
+    I32 max_height = resolutions[ArrayCount(resolutions) - 1][1];
+    U32 *pixels = push_array(arena, max_width*max_height, U32, 32);
+    U8 *rgba = push_array(arena, max_width*max_height*4, U8, 32);
+    F64 seconds_per_count = 1.0 / (F64)os->frequency;
+    
+    for(U32 resolution_index = 0; resolution_index < ArrayCount(resolutions); ++resolution_index)
+    {
+        OffscreenBuffer buffer = {};
+        buffer.width = resolutions[resolution_index][0];
+        buffer.height = resolutions[resolution_index][1];
+        buffer.bpp = 4;
+        buffer.pitch = buffer.width*buffer.bpp;
+        buffer.data = pixels;
+        
+        F64 pixel_count = (F64)buffer.width*buffer.height;
+        F64 clear_seconds[2];
+        for(U32 streaming = 0; streaming < 2; ++streaming)
+        {
+            U64 start_counts = os->get_qpc();
+            for(U32 iteration = 0; iteration < PRESENT_BENCHMARK_ITERATION_COUNT; ++iteration)
+            {
+                clear_buffer(&buffer, state->m_palette.colors[PaletteColor_Background], streaming);
+            }
+            clear_seconds[streaming] = (os->get_qpc() - start_counts)*seconds_per_count / PRESENT_BENCHMARK_ITERATION_COUNT;
+        }
+        
+        RandomSeries series = {1234};
+        for(U32 draw_index = 0; draw_index < PRESENT_BENCHMARK_DRAW_COUNT; ++draw_index)
+        {
+            I32 x = random_between(&series, 0, buffer.width);
+            I32 y = random_between(&series, 0, buffer.height);
+            PackedColor color = state->m_palette.colors[draw_index % PaletteColor_Count];
+            draw_pixel_rectangle(&buffer, RectangleStyle_Filled, x, y, x + 60, y + 60, color);
+        }
+        
+        U64 start_counts = os->get_qpc();
+        for(U32 iteration = 0; iteration < PRESENT_BENCHMARK_ITERATION_COUNT; ++iteration)
+        {
+            convert_buffer_to_rgba(&buffer, rgba, buffer.width*4);
+        }
+        F64 convert_seconds = (os->get_qpc() - start_counts)*seconds_per_count / PRESENT_BENCHMARK_ITERATION_COUNT;
+        
+        // NOTE(alexey): The images of a resolution are dropped before the next one.
+        size_t used_before_images = arena->used;
+        start_counts = os->get_qpc();
+        ImageFile ppm = encode_ppm(arena, rgba, buffer.width, buffer.height, buffer.width*4);
+        F64 ppm_seconds = (os->get_qpc() - start_counts)*seconds_per_count;
+        
+        start_counts = os->get_qpc();
+        ImageFile png = encode_png(arena, rgba, buffer.width, buffer.height, buffer.width*4);
+        F64 png_seconds = (os->get_qpc() - start_counts)*seconds_per_count;
+        arena->used = used_before_images;
+        
+        DebugOut("Present %dx%d: clear %.3f ms (%.2f GB/s), streaming clear %.3f ms (%.2f GB/s), "
+                 "rgba %.3f ms (%.2f Gpixels/s), ppm %.2f ms (%llu bytes), png %.2f ms (%llu bytes)\n",
+                 buffer.width, buffer.height,
+                 clear_seconds[0]*1000.0, pixel_count*4.0 / clear_seconds[0] / 1e9,
+                 clear_seconds[1]*1000.0, pixel_count*4.0 / clear_seconds[1] / 1e9,
+                 convert_seconds*1000.0, pixel_count / convert_seconds / 1e9,
+                 ppm_seconds*1000.0, (unsigned long long)ppm.size,
+                 png_seconds*1000.0, (unsigned long long)png.size);
+    }
+}
+
+template<class Container>
+function F64 time_event_push_backs(Container *events, U32 count)
+{
+    Event event = {};
+    event.type = EventType_KeyPressed;
+    
+    U64 start_counts = os->get_qpc();
+    for(U32 index = 0; index < count; ++index)
+    {
+        event.key = (I32)(index & 0xFF);
+        events->push_back(event);
+    }
+    F64 result = (F64)(os->get_qpc() - start_counts) / (F64)os->frequency;
+    return result;
+}
+
+template<class Container>
+function F64 time_event_capture(Container *events)
+{
+    Event event = {};
+    event.type = EventType_KeyPressed;
+    
+    U64 start_counts = os->get_qpc();
+    for(U32 frame_index = 0; frame_index < ARRAY_BENCHMARK_FRAME_COUNT; ++frame_index)
+    {
+        events->clear();
+        for(U32 event_index = 0; event_index < ARRAY_BENCHMARK_EVENTS_PER_FRAME; ++event_index)
+        {
+            event.key = (I32)event_index;
+            events->push_back(event);
+        }
+    }
+    F64 result = (F64)(os->get_qpc() - start_counts) / (F64)os->frequency;
+    return result;
+}
+
+// NOTE(alexey): A container per frame that only lives for the frame, like the lists of things found during an update.
+// Returns the seconds, the heap allocations there were go to *allocation_count.
+template<class Container>
+function F64 time_frame_local_events(U64 *allocation_count)
+{
+    Event event = {};
+    event.type = EventType_KeyPressed;
+    U32 last_key_sum = 0;
+    
+    U64 start_allocation_count = heap_allocation_counter.allocation_count;
+    U64 start_counts = os->get_qpc();
+    for(U32 frame_index = 0; frame_index < ARRAY_BENCHMARK_FRAME_COUNT; ++frame_index)
+    {
+        Container events;
+        for(U32 event_index = 0; event_index < ARRAY_BENCHMARK_EVENTS_PER_FRAME; ++event_index)
+        {
+            event.key = (I32)event_index;
+            events.push_back(event);
+        }
+        // NOTE(alexey): Checked after the loop, so the compiler doesn't throw the frames away.
+        last_key_sum += events[ARRAY_BENCHMARK_EVENTS_PER_FRAME - 1].key;
+    }
+    F64 result = (F64)(os->get_qpc() - start_counts) / (F64)os->frequency;
+    assert(last_key_sum == ARRAY_BENCHMARK_FRAME_COUNT*(ARRAY_BENCHMARK_EVENTS_PER_FRAME - 1));
+    *allocation_count = heap_allocation_counter.allocation_count - start_allocation_count;
+    return result;
+}
+
+function void fill_events(Array<Event> *events, U32 count)
+{
+    events->clear();
+    events->reserve(count);
+    
+    Event event = {};
+    event.type = EventType_KeyPressed;
+    for(U32 index = 0; index < count; ++index)
+    {
+        event.key = (I32)index;
+        events->push_back(event);
+    }
+}
+
+inline Bool32 is_removed_event(const Event &event)
+{
+    Bool32 result = ((event.key % ARRAY_BENCHMARK_REMOVE_EVERY) == 0);
+    return result;
+}
+
+// NOTE(alexey): Returns the seconds it takes to remove every ARRAY_BENCHMARK_REMOVE_EVERY-th event 
+// with remove_if, swap_remove and erase. Erase moves everything past the erased element every time, 
+// it's timed for the first ARRAY_BENCHMARK_ERASE_SAMPLE_COUNT elements, which move the whole array,
+// and extrapolated with half of that for the rest.
+function void time_event_removal(F64 *remove_if_seconds, F64 *swap_remove_seconds, F64 *erase_seconds)
+{
+    Array<Event> events;
+    F64 seconds_per_count = 1.0 / (F64)os->frequency;
+    
+    fill_events(&events, ARRAY_BENCHMARK_ELEMENT_COUNT);
+    U64 start_counts = os->get_qpc();
+    events.remove_if(is_removed_event);
+    *remove_if_seconds = (os->get_qpc() - start_counts)*seconds_per_count;
+    
+    fill_events(&events, ARRAY_BENCHMARK_ELEMENT_COUNT);
+    start_counts = os->get_qpc();
+    for(Event *at = events.begin(); at != events.end();)
+    {
+        if(is_removed_event(*at))
+        {
+            events.swap_remove(at);
+        }
+        else
+        {
+            ++at;
+        }
+    }
+    *swap_remove_seconds = (os->get_qpc() - start_counts)*seconds_per_count;
+    
+    fill_events(&events, ARRAY_BENCHMARK_ELEMENT_COUNT);
+    U32 erase_count = 0;
+    start_counts = os->get_qpc();
+    for(Event *at = events.begin(); (at != events.end()) && (erase_count < ARRAY_BENCHMARK_ERASE_SAMPLE_COUNT);)
+    {
+        if(is_removed_event(*at))
+        {
+            at = events.erase(at);
+            ++erase_count;
+        }
+        else
+        {
+            ++at;
+        }
+    }
+    F64 total_erase_count = (F64)ARRAY_BENCHMARK_ELEMENT_COUNT / ARRAY_BENCHMARK_REMOVE_EVERY;
+    *erase_seconds = (os->get_qpc() - start_counts)*seconds_per_count / erase_count*total_erase_count*0.5;
+}
+
+// NOTE(alexey): Array<Event> against std::vector<Event>, push_back from empty, with a reserve, 
+// from an arena, and the event capture pattern (see ARRAY_BENCHMARK_ELEMENT_COUNT). 
+// Then the arrays that live for a frame, and the removal.
+function void run_array_benchmark(GameState *state)
+{
+    MemoryArena *arena = &state->m_simulation_arena;
+    size_t arena_used = arena->used;
+    
+    F64 array_seconds, reserved_array_seconds, arena_array_seconds, capture_array_seconds;
+    {
+        Array<Event> events;
+        array_seconds = time_event_push_backs(&events, ARRAY_BENCHMARK_ELEMENT_COUNT);
+    }
+    {
+        Array<Event> events;
+        events.reserve(ARRAY_BENCHMARK_ELEMENT_COUNT);
+        reserved_array_seconds = time_event_push_backs(&events, ARRAY_BENCHMARK_ELEMENT_COUNT);
+    }
+    {
+        Array<Event, ArenaAllocator> events((ArenaAllocator(arena)));
+        arena_array_seconds = time_event_push_backs(&events, ARRAY_BENCHMARK_ELEMENT_COUNT);
+    }
+    {
+        Array<Event> events;
+        capture_array_seconds = time_event_capture(&events);
+    }
+    arena->used = arena_used;
+    
+    F64 vector_seconds, reserved_vector_seconds, capture_vector_seconds;
+    {
+        std::vector<Event> events;
+        vector_seconds = time_event_push_backs(&events, ARRAY_BENCHMARK_ELEMENT_COUNT);
+    }
+    {
+        std::vector<Event> events;
+        events.reserve(ARRAY_BENCHMARK_ELEMENT_COUNT);
+        reserved_vector_seconds = time_event_push_backs(&events, ARRAY_BENCHMARK_ELEMENT_COUNT);
+    }
+    {
+        std::vector<Event> events;
+        capture_vector_seconds = time_event_capture(&events);
+    }
+    
+    DebugOut("Array: %u push_backs %.2f ms (reserved %.2f ms, arena %.2f ms), std::vector %.2f ms (reserved %.2f ms); "
+             "%u frames of %u events %.2f ms, std::vector %.2f ms\n",
+             ARRAY_BENCHMARK_ELEMENT_COUNT,
+             array_seconds*1000.0, reserved_array_seconds*1000.0, arena_array_seconds*1000.0,
+             vector_seconds*1000.0, reserved_vector_seconds*1000.0,
+             ARRAY_BENCHMARK_FRAME_COUNT, ARRAY_BENCHMARK_EVENTS_PER_FRAME,
+             capture_array_seconds*1000.0, capture_vector_seconds*1000.0);
+    
+    U64 array_allocation_count, small_allocation_count, fixed_allocation_count;
+    F64 local_array_seconds = time_frame_local_events<Array<Event>>(&array_allocation_count);
+    F64 local_small_seconds = 
+        time_frame_local_events<SmallArray<Event, ARRAY_BENCHMARK_EVENTS_PER_FRAME>>(&small_allocation_count);
+    F64 local_fixed_seconds = 
+        time_frame_local_events<FixedArray<Event, ARRAY_BENCHMARK_EVENTS_PER_FRAME>>(&fixed_allocation_count);
+    DebugOut("Array: %u frames with an array of their own, Array %.2f ms (%llu allocations), "
+             "SmallArray %.2f ms (%llu), FixedArray %.2f ms (%llu)\n",
+             ARRAY_BENCHMARK_FRAME_COUNT,
+             local_array_seconds*1000.0, (unsigned long long)array_allocation_count,
+             local_small_seconds*1000.0, (unsigned long long)small_allocation_count,
+             local_fixed_seconds*1000.0, (unsigned long long)fixed_allocation_count);
+    
+    F64 remove_if_seconds, swap_remove_seconds, erase_seconds;
+    time_event_removal(&remove_if_seconds, &swap_remove_seconds, &erase_seconds);
+    DebugOut("Array: removing every %uth of %u events, remove_if %.2f ms, swap_remove %.2f ms, "
+             "erase one by one ~%.0f ms (estimated from %u erases)\n",
+             ARRAY_BENCHMARK_REMOVE_EVERY, ARRAY_BENCHMARK_ELEMENT_COUNT,
+             remove_if_seconds*1000.0, swap_remove_seconds*1000.0, erase_seconds*1000.0,
+             ARRAY_BENCHMARK_ERASE_SAMPLE_COUNT);
+}
+
+// NOTE(alexey): EVENT_BENCHMARK_FRAME_COUNT frames of the mouse stream, with every move queued or coalesced.
+// Returns the seconds it took to queue and process the events, the most events a frame had go to *max_event_count.
+function F64 time_mouse_stream(Bool32 coalesce, U32 *max_event_count, U64 *allocation_count)
+{
+    EventQueue events;
+    Input input = {};
+    U32 moves_per_frame = EVENT_BENCHMARK_MOUSE_RATE / EVENT_BENCHMARK_FRAME_RATE;
+    
+    *max_event_count = 0;
+    U64 start_allocation_count = heap_allocation_counter.allocation_count;
+    U64 start_counts = os->get_qpc();
+    for(U32 frame_index = 0; frame_index < EVENT_BENCHMARK_FRAME_COUNT; ++frame_index)
+    {
+        for(U32 move_index = 0; move_index < moves_per_frame; ++move_index)
+        {
+            Vec2 cursor((F32)(move_index & 0xFF), (F32)(frame_index & 0xFF));
+            Vec2 cursor_delta(1.0f, 0.0f);
+            if(coalesce)
+            {
+                push_mouse_move(&events, cursor, cursor_delta);
+            }
+            else
+            {
+                Event event = {};
+                event.type = EventType_MouseMoved;
+                event.cursor = cursor;
+                event.cursor_delta = cursor_delta;
+                events.push_back(event);
+            }
+            
+            // NOTE(alexey): A key goes down and up in the middle of the moves, the way W does while walking.
+            if(move_index == moves_per_frame / 2)
+            {
+                Event event = {};
+                event.type = (frame_index & 1) ? EventType_KeyReleased : EventType_KeyPressed;
+                event.key = Key_W;
+                events.push_back(event);
+            }
+        }
+        
+        *max_event_count = Maximum(*max_event_count, (U32)events.length());
+        process_events(&input, &events);
+    }
+    F64 result = (F64)(os->get_qpc() - start_counts) / (F64)os->frequency;
+    *allocation_count = heap_allocation_counter.allocation_count - start_allocation_count;
+    return result;
+}
+
+// NOTE(alexey): See EVENT_BENCHMARK_MOUSE_RATE.
+function void run_event_benchmark()
+{
+    U32 queued_max_event_count, coalesced_max_event_count;
+    U64 queued_allocation_count, coalesced_allocation_count;
+    F64 queued_seconds = time_mouse_stream(false, &queued_max_event_count, &queued_allocation_count);
+    F64 coalesced_seconds = time_mouse_stream(true, &coalesced_max_event_count, &coalesced_allocation_count);
+    
+    F64 us_per_frame = 1e6 / EVENT_BENCHMARK_FRAME_COUNT;
+    DebugOut("Events: %u Hz mouse at %u frames/s, every move queued %.2f us/frame, %u events (%u bytes), "
+             "%llu allocations; coalesced %.2f us/frame, %u events (%u bytes), %llu allocations\n",
+             EVENT_BENCHMARK_MOUSE_RATE, EVENT_BENCHMARK_FRAME_RATE,
+             queued_seconds*us_per_frame, queued_max_event_count, queued_max_event_count*(U32)sizeof(Event),
+             (unsigned long long)queued_allocation_count,
+             coalesced_seconds*us_per_frame, coalesced_max_event_count, coalesced_max_event_count*(U32)sizeof(Event),
+             (unsigned long long)coalesced_allocation_count);
+}
+
+// NOTE(alexey): Chunks of a square region, the chunk_index-th one row by row.
+inline U64 get_benchmark_chunk_key(U32 chunk_index, U32 side)
+{
+    U64 result = pack_chunk_key((I32)(chunk_index % side), (I32)(chunk_index / side));
+    return result;
+}
+
+// NOTE(alexey): See HASH_MAP_BENCHMARK_MAX_COUNT. The chunks are visited in a single random cycle,
+// every chunk's value is the index of the chunk after it.
+function void run_hash_map_benchmark(GameState *state)
+{
+    MemoryArena *arena = &state->m_simulation_arena;
+    size_t arena_used = arena->used;
+    F64 seconds_per_count = 1.0 / (F64)os->frequency;
+    
+    U32 chunk_counts[] = {1000, 1000000, HASH_MAP_BENCHMARK_MAX_COUNT};
+    for(U32 count_index = 0; count_index < ArrayCount(chunk_counts); ++count_index)
+    {
+        U32 chunk_count = chunk_counts[count_index];
+        U32 side = (U32)ceil(sqrt((F64)chunk_count));
+        
+        // NOTE(alexey): Sattolo's shuffle, a permutation that is a single cycle.
+        U32 *next_chunk = push_array(arena, chunk_count, U32);
+        for(U32 chunk_index = 0; chunk_index < chunk_count; ++chunk_index)
+        {
+            next_chunk[chunk_index] = chunk_index;
+        }
+        RandomSeries series = {chunk_count};
+        for(U32 chunk_index = chunk_count - 1; chunk_index > 0; --chunk_index)
+        {
+            U32 swap_index = random_next(&series) % chunk_index;
+            U32 temp = next_chunk[chunk_index];
+            next_chunk[chunk_index] = next_chunk[swap_index];
+            next_chunk[swap_index] = temp;
+        }
+        
+        HashMap<U32> map;
+        map.init(arena, chunk_count);
+        std::unordered_map<U64, U32> std_map;
+        std_map.reserve(chunk_count);
+        U32 *grid = push_array(arena, side*side, U32);
+        
+        U64 start_counts = os->get_qpc();
+        for(U32 chunk_index = 0; chunk_index < chunk_count; ++chunk_index)
+        {
+            map.insert(get_benchmark_chunk_key(chunk_index, side), next_chunk[chunk_index]);
+        }
+        F64 insert_seconds = (os->get_qpc() - start_counts)*seconds_per_count;
+        
+        start_counts = os->get_qpc();
+        for(U32 chunk_index = 0; chunk_index < chunk_count; ++chunk_index)
+        {
+            std_map[get_benchmark_chunk_key(chunk_index, side)] = next_chunk[chunk_index];
+        }
+        F64 std_insert_seconds = (os->get_qpc() - start_counts)*seconds_per_count;
+        
+        for(U32 chunk_index = 0; chunk_index < chunk_count; ++chunk_index)
+        {
+            grid[chunk_index] = next_chunk[chunk_index];
+        }
+        
+        U32 map_chunk = 0;
+        start_counts = os->get_qpc();
+        for(U32 lookup_index = 0; lookup_index < HASH_MAP_BENCHMARK_LOOKUP_COUNT; ++lookup_index)
+        {
+            map_chunk = *map.find(get_benchmark_chunk_key(map_chunk, side));
+        }
+        F64 lookup_seconds = (os->get_qpc() - start_counts)*seconds_per_count;
+        
+        U32 std_chunk = 0;
+        start_counts = os->get_qpc();
+        for(U32 lookup_index = 0; lookup_index < HASH_MAP_BENCHMARK_LOOKUP_COUNT; ++lookup_index)
+        {
+            std_chunk = std_map.find(get_benchmark_chunk_key(std_chunk, side))->second;
+        }
+        F64 std_lookup_seconds = (os->get_qpc() - start_counts)*seconds_per_count;
+        
+        // NOTE(alexey): The same index math as getWorldTileMap.
+        U32 grid_chunk = 0;
+        start_counts = os->get_qpc();
+        for(U32 lookup_index = 0; lookup_index < HASH_MAP_BENCHMARK_LOOKUP_COUNT; ++lookup_index)
+        {
+            U32 chunk_x = grid_chunk % side;
+            U32 chunk_y = grid_chunk / side;
+            grid_chunk = grid[chunk_y*side + chunk_x];
+        }
+        F64 grid_lookup_seconds = (os->get_qpc() - start_counts)*seconds_per_count;
+        assert((map_chunk == std_chunk) && (map_chunk == grid_chunk));
+        
+        F64 ns_per_lookup = 1e9 / HASH_MAP_BENCHMARK_LOOKUP_COUNT;
+        DebugOut("HashMap: %u chunks, lookup %.1f ns, std::unordered_map %.1f ns, grid %.1f ns; "
+                 "inserts %.2f ms, std::unordered_map %.2f ms\n",
+                 chunk_count,
+                 lookup_seconds*ns_per_lookup, std_lookup_seconds*ns_per_lookup, grid_lookup_seconds*ns_per_lookup,
+                 insert_seconds*1000.0, std_insert_seconds*1000.0);
+        
+        arena->used = arena_used;
+    }
+}
+
+// NOTE(alexey): Sum of the tiles of a generated tile map, weighted by their place,
+// hashed with the tile map's index so that the sum over the tile maps doesn't depend on their order.
+function U64 get_generated_tile_map_checksum(U32 *tiles, U32 tile_count, U32 tile_map_index)
+{
+    U64 weighted_sum = 0;
+    for(U32 tile_index = 0; tile_index < tile_count; ++tile_index)
+    {
+        weighted_sum += (U64)tiles[tile_index]*(tile_index + 1);
+    }
+    U64 result = hash_u64(weighted_sum + tile_map_index);
+    return result;
+}
+
+// NOTE(alexey): See GENERATOR_BENCHMARK_SIDE. The tile maps are generated once in order and once backwards,
+// both passes have to give the same world (see game_world_generator.h).
+function void run_generator_benchmark(GameState *state)
+{
+    MemoryArena *arena = &state->m_simulation_arena;
+    size_t arena_used = arena->used;
+    F64 seconds_per_count = 1.0 / (F64)os->frequency;
+    
+    WorldGeneratorParams params = {};
+    params.seed = os->world_seed ? os->world_seed : os->get_qpc();
+    params.tile_map_count_x = GENERATOR_BENCHMARK_SIDE;
+    params.tile_map_count_y = GENERATOR_BENCHMARK_SIDE;
+    params.tile_count_x = TilesCountX;
+    params.tile_count_y = TilesCountY;
+    
+    U32 tile_map_count = GENERATOR_BENCHMARK_SIDE*GENERATOR_BENCHMARK_SIDE;
+    U32 tile_count = TilesCountX*TilesCountY;
+    U32 *tiles = push_array(arena, tile_count, U32);
+    
+    U64 forward_checksum = 0;
+    U64 start_counts = os->get_qpc();
+    for(U32 tile_map_index = 0; tile_map_index < tile_map_count; ++tile_map_index)
+    {
+        generate_tile_map(&params, (I32)(tile_map_index % GENERATOR_BENCHMARK_SIDE), 
+                          (I32)(tile_map_index / GENERATOR_BENCHMARK_SIDE), tiles);
+        forward_checksum += get_generated_tile_map_checksum(tiles, tile_count, tile_map_index);
+    }
+    F64 forward_seconds = (os->get_qpc() - start_counts)*seconds_per_count;
+    
+    U64 backward_checksum = 0;
+    start_counts = os->get_qpc();
+    for(U32 tile_map_index = tile_map_count; tile_map_index-- > 0;)
+    {
+        generate_tile_map(&params, (I32)(tile_map_index % GENERATOR_BENCHMARK_SIDE), 
+                          (I32)(tile_map_index / GENERATOR_BENCHMARK_SIDE), tiles);
+        backward_checksum += get_generated_tile_map_checksum(tiles, tile_count, tile_map_index);
+    }
+    F64 backward_seconds = (os->get_qpc() - start_counts)*seconds_per_count;
+    assert(forward_checksum == backward_checksum);
+    
+    F64 seconds = forward_seconds + backward_seconds;
+    DebugOut("Generator: seed %llu, %ux%u tile maps of %ux%u tiles, %.2f us/tile map, %.0f tile maps/s, "
+             "order %s\n",
+             (unsigned long long)params.seed, GENERATOR_BENCHMARK_SIDE, GENERATOR_BENCHMARK_SIDE, 
+             TilesCountX, TilesCountY, seconds*1e6 / (2*tile_map_count), (2*tile_map_count) / seconds,
+             (forward_checksum == backward_checksum) ? "independent" : "DEPENDENT");
+    
+    arena->used = arena_used;
+}
+
+// NOTE(alexey): Once a simulation batch, not a step, so a key that went down runs its benchmark once
+// (see run_simulation_batch). The benchmarks run on the simulation side, in between the steps.
+function void handle_benchmark_keys(GameState *state, Input *input)
+{
+    if(input->onKeyWentDown(Key_F2)) run_pathfinding_benchmark(state);
+    if(input->onKeyWentDown(Key_F3)) run_path_graph_benchmark(state);
+    if(input->onKeyWentDown(Key_F4)) run_flow_field_benchmark(state);
+    if(input->onKeyWentDown(Key_F5)) run_lighting_benchmark(state);
+    if(input->onKeyWentDown(Key_F6)) run_present_benchmark(state);
+    if(input->onKeyWentDown(Key_F9)) run_array_benchmark(state);
+    if(input->onKeyWentDown(Key_F10)) run_hash_map_benchmark(state);
+    if(input->onKeyWentDown(Key_F11)) run_event_benchmark();
+    if(input->onKeyWentDown(Key_F12)) run_generator_benchmark(state);
+}
@@ -0,0 +1,57 @@
+/* date = October 18th 2026 9:50 pm */
+#ifndef GAME_BENCHMARKS_H
+
+/*
+  Benchmarks of the game's systems, each one runs when its key goes down (see handle_benchmark_keys).
+  They aren't part of the game library, only of the builds with GAME_BENCHMARKS: build.sh makes libgame_bench.so,
+  which the POSIX host loads with --benchmarks and drives with the F-keys of its --keys script ('2' is F2, '=' is F12).
+*/
+
+// NOTE(alexey): Size of the pathfinding benchmark batches (F2 and F3),
+// the first path of the batch is kept to be drawn by the debug overlay.
+#define PATHFINDING_BENCHMARK_QUERY_COUNT 1024
+#define PATH_GRAPH_BENCHMARK_QUERY_COUNT 256
+#define PATHFINDING_BENCHMARK_MAX_POINT_COUNT DEBUG_PATH_MAX_POINT_COUNT
+
+// NOTE(alexey): Crowd of the flow field benchmark (F4), and how many of them are walked to the goal to check the field.
+#define FLOW_FIELD_BENCHMARK_AGENT_COUNT 100000
+#define FLOW_FIELD_BENCHMARK_WALK_COUNT 256
+
+// NOTE(alexey): Lights of the lighting benchmark (F5), they stay in the world afterwards.
+#define LIGHTING_BENCHMARK_LIGHT_COUNT 256
+#define LIGHTING_BENCHMARK_ITERATION_COUNT 32
+
+// NOTE(alexey): The present benchmark (F6), clear and conversion of a frame at a few resolutions.
+#define PRESENT_BENCHMARK_ITERATION_COUNT 16
+#define PRESENT_BENCHMARK_DRAW_COUNT 2000
+
+// NOTE(alexey): The container benchmark (F9), Array against std::vector. ARRAY_BENCHMARK_ELEMENT_COUNT push_backs
+// into an empty array, and the event capture, an array that is cleared and gets a few events every frame.
+#define ARRAY_BENCHMARK_ELEMENT_COUNT 1000000
+#define ARRAY_BENCHMARK_FRAME_COUNT 100000
+#define ARRAY_BENCHMARK_EVENTS_PER_FRAME 16
+
+// NOTE(alexey): Every ARRAY_BENCHMARK_REMOVE_EVERY-th of ARRAY_BENCHMARK_ELEMENT_COUNT elements is removed,
+// with remove_if, with swap_remove, and with erase one by one. The last one is quadratic,
+// only the first ARRAY_BENCHMARK_ERASE_SAMPLE_COUNT erases are timed.
+#define ARRAY_BENCHMARK_REMOVE_EVERY 10
+#define ARRAY_BENCHMARK_ERASE_SAMPLE_COUNT 1000
+
+// NOTE(alexey): The hash map benchmark (F10), lookups of chunk keys in HashMap, std::unordered_map 
+// and the grid of tile maps that getWorldTileMap indexes, with 1K, 1M and HASH_MAP_BENCHMARK_MAX_COUNT chunks.
+// The lookups depend on each other (the value is the next chunk to look up), so it's their latency.
+#define HASH_MAP_BENCHMARK_MAX_COUNT 10000000
+#define HASH_MAP_BENCHMARK_LOOKUP_COUNT 10000000
+
+// NOTE(alexey): The event benchmark (F11), EVENT_BENCHMARK_MOUSE_RATE mouse moves a second and a key event per frame
+// through an EventQueue, every move queued against the moves coalesced (see push_mouse_move).
+#define EVENT_BENCHMARK_MOUSE_RATE 8000
+#define EVENT_BENCHMARK_FRAME_RATE 60
+#define EVENT_BENCHMARK_FRAME_COUNT 10000
+
+// NOTE(alexey): The generator benchmark (F12), a world of GENERATOR_BENCHMARK_SIDE x GENERATOR_BENCHMARK_SIDE
+// tile maps from game_world_generator.h, generated forwards and backwards. The seed is Os::world_seed when there is one.
+#define GENERATOR_BENCHMARK_SIDE 256
+
+#define GAME_BENCHMARKS_H
+#endif //GAME_BENCHMARKS_H
@@ -5,108 +5,265 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <atomic>
 #include <initializer_list>
+#include <type_traits>
 #include <utility>
 
-template<class T>
+// NOTE(alexey): Every heap allocation of the arrays is counted, so the internal builds can check
+// that a frame doesn't allocate once it's in the steady state. The game and the platform layer have one each.
+struct HeapAllocationCounter
+{
+	std::atomic<uint64_t> allocation_count;
+	std::atomic<uint64_t> byte_count;
+};
+
+static HeapAllocationCounter heap_allocation_counter;
+
+inline void count_heap_allocation(size_t size)
+{
+	heap_allocation_counter.allocation_count.fetch_add(1, std::memory_order_relaxed);
+	heap_allocation_counter.byte_count.fetch_add(size, std::memory_order_relaxed);
+}
+
+// NOTE(alexey): Allocators are values inside of the array, the default one is the C heap.
+// reallocate keeps the first old_size bytes, the memory isn't zeroed by any of them.
+// See ArenaAllocator in game_memory_arena.h for the one that allocates from a MemoryArena,
+// InlineAllocator and FixedAllocator below for the ones of SmallArray and FixedArray.
+struct HeapAllocator
+{
+	void *allocate(size_t size) { count_heap_allocation(size); return malloc(size); }
+	void *reallocate(void *memory, size_t /*old_size*/, size_t new_size) { count_heap_allocation(new_size); return realloc(memory, new_size); }
+	void deallocate(void *memory, size_t /*size*/) { free(memory); }
+};
+
+// NOTE(alexey): The capacity doubles, starting from ARRAY_MIN_CAPACITY, so push_back is amortized O(1).
+// Trivially copyable elements are moved with allocator.reallocate (realloc for the heap, 
+// in place for the last allocation in an arena), the others are move-constructed into the new memory.
+// Elements are constructed in place and destroyed when they're removed, the memory past size is uninitialized.
+#define ARRAY_MIN_CAPACITY 8
+
+template<class T, class Allocator = HeapAllocator>
 struct Array
 {
 	typedef int32_t bool32;
 	typedef T DataType;
 	typedef DataType* Iterator;
 	typedef const DataType* ConstIterator;
+	typedef Allocator AllocatorType;
     
 	Array() {}
+	Array(Allocator allocator_) : allocator(allocator_) {}
 	Array(std::initializer_list<DataType> list) { push_range(list.begin(), list.end()); }
-	~Array() { if (data) free(data); } 
+	~Array() { destroy_range(begin(), end()); release(); } 
     
-	Array(const Array<DataType>& source) 
-		: size(source.size), cap(source.cap)
+	Array(const Array& source) 
+		: allocator(source.allocator)
 	{
-		data = alloc_and_zero(cap * sizeof(DataType));
-		size_t copy_size = size * sizeof(DataType);
-		memcpy(data, source.data, copy_size);
+		copy_from(source);
 	}
     
-	Array<DataType>& operator=(const Array<DataType>& source)
+	Array& operator=(const Array& source)
 	{
-		if (data) free(data);
-		size = source.size;
-		cap = source.cap;
-		data = alloc_and_zero(cap * sizeof(DataType));
-		size_t copy_size = size * sizeof(DataType);
-		memcpy(data, source.data, copy_size);
+		if (this != &source)
+		{
+			clear();
+			copy_from(source);
+		}
 		return *this;
 	}
     
-	Array(Array<DataType>&& source)
-		: size(source.size), cap(source.cap), data(source.data)
+	Array(Array&& source)
+		: size(source.size), cap(source.cap), data(source.data), allocator(source.allocator)
 	{
 		source.size = 0;
 		source.cap  = 0;
 		source.data = nullptr;
 	}
     
-	Array<DataType>& operator=(Array<DataType>&& source) 
+	Array& operator=(Array&& source) 
 	{
-		size = source.size;
-		cap = source.cap;
-		if (data) free(data);
-		data = source.data;
-		source.size = 0;
-		source.cap = 0;
-		source.data = nullptr;
+		if (this != &source)
+		{
+			destroy_range(begin(), end());
+			release();
+			size = source.size;
+			cap = source.cap;
+			data = source.data;
+			allocator = source.allocator;
+			source.size = 0;
+			source.cap = 0;
+			source.data = nullptr;
+		}
 		return *this;
 	}
     
-	DataType* alloc_and_zero(size_t alloc_size)
+	static void destroy_range(Iterator first, Iterator last)
 	{
-		DataType* result = static_cast<DataType*>(malloc(alloc_size));
-		assert(result);
-		memset(result, 0, alloc_size);
-		return result;
+		if (!std::is_trivially_destructible<DataType>::value)
+			for (Iterator at = first; at != last; ++at)
+				at->~DataType();
 	}
     
-	void grow()
+	void release()
 	{
-		size_t new_cap = (size * 2 + 1);
-		DataType* new_data = alloc_and_zero(new_cap * sizeof(DataType));
-		size_t copy_size = size * sizeof(DataType);
-		memcpy(new_data, data, copy_size);
-		if (data) free(data);
+		if (data) allocator.deallocate(data, cap * sizeof(DataType));
+		data = nullptr;
+		cap = 0;
+	}
+    
+	// NOTE(alexey): Expects the array to be empty, keeps the capacity when it's enough.
+	void copy_from(const Array& source)
+	{
+		assert(!size);
+		if (source.size > cap)
+		{
+			release();
+			data = static_cast<DataType*>(allocator.allocate(source.size * sizeof(DataType)));
+			assert(data);
+			cap = source.size;
+		}
+        
+		if (std::is_trivially_copyable<DataType>::value)
+		{
+			if (source.size) memcpy((void*)data, (const void*)source.data, source.size * sizeof(DataType));
+		}
+		else
+		{
+			for (size_t index = 0; index < source.size; ++index)
+				new (data + index) DataType(source.data[index]);
+		}
+		size = source.size;
+	}
+    
+	void reallocate(size_t new_cap)
+	{
+		assert(new_cap >= size);
+		DataType* new_data;
+		if (std::is_trivially_copyable<DataType>::value)
+		{
+			new_data = static_cast<DataType*>(data ? 
+                                              allocator.reallocate(data, cap * sizeof(DataType), new_cap * sizeof(DataType)) :
+                                              allocator.allocate(new_cap * sizeof(DataType)));
+			assert(new_data);
+		}
+		else
+		{
+			new_data = static_cast<DataType*>(allocator.allocate(new_cap * sizeof(DataType)));
+			assert(new_data);
+			for (size_t index = 0; index < size; ++index)
+				new (new_data + index) DataType(std::move(data[index]));
+			destroy_range(begin(), end());
+			if (data) allocator.deallocate(data, cap * sizeof(DataType));
+		}
 		data = new_data;
 		cap = new_cap;
 	}
     
-	void fit(size_t count) { if (count > cap) grow(); }
-	void erase_range(Iterator range_start, Iterator range_end)
+	void reserve(size_t count) { if (count > cap) reallocate(count); }
+    
+	void fit(size_t count)
 	{
-		assert(range_start >= begin() && range_start < end());
-		assert(range_end >= begin() && range_end < end());
+		if (count > cap)
+		{
+			size_t new_cap = cap ? (cap * 2) : ARRAY_MIN_CAPACITY;
+			if (new_cap < count) new_cap = count;
+			reallocate(new_cap);
+		}
+	}
+    
+	// NOTE(alexey): Keeps the order, everything past the range is moved down once. 
+	// range_end can be end(), returns the iterator to the first element after the erased ones.
+	Iterator erase_range(Iterator range_start, Iterator range_end)
+	{
+		assert(range_start >= begin() && range_start <= range_end);
+		assert(range_end <= end());
 		if (range_start < range_end)
 		{
-			uintptr_t erase_count = (range_end - range_start);
-			for (Iterator at = range_end; at != end(); ++at)
-				*range_start++ = *at;
-			size -= erase_count;
+			Iterator to = range_start;
+			for (Iterator at = range_end; at != end(); ++at, ++to)
+				*to = std::move(*at);
+			destroy_range(to, end());
+			size = to - begin();
 		}
+		return range_start;
 	}
     
-	void erase(Iterator itr)
+	Iterator erase(Iterator itr)
 	{
 		assert(itr >= begin() && itr < end());
-		for (Iterator at = itr; at != end(); ++at, ++itr)
-			if(at != (end() - 1))
-				*at = *(itr + 1);
-		--size;
+		return erase_range(itr, itr + 1);
 	}
     
-	void push_back(const DataType& value) { fit(size + 1); data[size] = value; ++size; } 
-    // NOTE(alexey): Don't care about moving???
-	void push_back(DataType&& value) { fit(size + 1); data[size] = std::move(value); ++size; }
+	// NOTE(alexey): O(1), the last element takes the place of the removed one, so the order isn't kept.
+	// When iterating, the element at itr has to be looked at again after the call.
+	void swap_remove(Iterator itr)
+	{
+		assert(itr >= begin() && itr < end());
+		if (itr != (end() - 1))
+			*itr = std::move(*(end() - 1));
+		pop_back();
+	}
+    
+	// NOTE(alexey): Removes every element the predicate returns true for in a single pass, keeping the order
+	// of the rest, returns how many were removed.
+	template<class Predicate>
+	size_t remove_if(Predicate predicate)
+	{
+		Iterator to = begin();
+		for (Iterator at = begin(); at != end(); ++at)
+		{
+			if (!predicate(*at))
+			{
+				if (to != at) *to = std::move(*at);
+				++to;
+			}
+		}
+        
+		size_t removed_count = end() - to;
+		destroy_range(to, end());
+		size = to - begin();
+		return removed_count;
+	}
+    
+	// NOTE(alexey): The arguments must not refer to the array's own elements, they might move.
+	template<class... Args>
+	DataType& emplace_back(Args&&... args)
+	{
+		if (size == cap) fit(size + 1);
+		DataType* result = new (data + size) DataType(std::forward<Args>(args)...);
+		++size;
+		return *result;
+	}
+    
+	// NOTE(alexey): value can be one of our elements, so it's copied before they move.
+	void push_back_and_grow(const DataType& value)
+	{
+		DataType copy(value);
+		fit(size + 1);
+		new (data + size) DataType(std::move(copy));
+		++size;
+	}
+    
+	void push_back(const DataType& value) 
+	{ 
+		if (size < cap)
+		{
+			new (data + size) DataType(value);
+			++size;
+		}
+		else
+		{
+			push_back_and_grow(value);
+		}
+	} 
+	void push_back(DataType&& value) { emplace_back(std::move(value)); }
     
 	void push_range(ConstIterator begin, ConstIterator end)
 	{
+		reserve(size + (end - begin));
 		for (ConstIterator at = begin;
              at != end; 
              ++at)
@@ -115,27 +272,179 @@ struct Array
 		}
 	}
     
-	void pop_back() { --size; } 
+	void pop_back() { assert(size); --size; destroy_range(end(), end() + 1); } 
     
     // TODO(alexey): Think more how to handle the situation when the size equal to 0.
     // So we don't get a negative index.
-	const DataType& back() { assert(size); return data[size - 1]; } 
+	DataType& back() { assert(size); return data[size - 1]; } 
 	size_t length() const { return size; }
 	size_t capacity() const {  return cap; } 
-	void clear() { size = 0; }
+	void clear() { destroy_range(begin(), end()); size = 0; }
 	bool32 empty() const { return !length(); }
 	DataType& operator[](int32_t index) { assert((index >= 0) && (index < size)); return data[index]; } 
     
 	const DataType& operator[](int32_t index) const { assert((index >= 0) && (index < size)); return data[index]; } 
     
-	Iterator begin() { return &data[0]; } 
-	Iterator end() { return &data[size]; } 
-	ConstIterator begin() const { return &data[0]; } 
-	ConstIterator end() const { return &data[size]; } 
+	Iterator begin() { return data; } 
+	Iterator end() { return data + size; } 
+	ConstIterator begin() const { return data; } 
+	ConstIterator end() const { return data + size; } 
     
 	size_t size{ 0 };
 	size_t cap{ 0 };
 	DataType* data{ nullptr };
+	Allocator allocator;
+};
+
+// NOTE(alexey): Storage of SmallArray, the first Size bytes that are asked for come from the buffer inside of it,
+// anything bigger from the fallback allocator. Copies of the allocator only copy the fallback, never the buffer.
+template<size_t Size, class Allocator>
+struct InlineAllocator
+{
+	InlineAllocator() {}
+	InlineAllocator(Allocator fallback_) : fallback(fallback_) {}
+	InlineAllocator(const InlineAllocator& source) : fallback(source.fallback) {}
+	InlineAllocator& operator=(const InlineAllocator& source) { fallback = source.fallback; return *this; }
+    
+	bool is_inline(void *memory) const { return memory == (const void *)buffer; }
+    
+	void *allocate(size_t size)
+	{
+		if (!buffer_is_used && (size <= Size))
+		{
+			buffer_is_used = true;
+			return buffer;
+		}
+		return fallback.allocate(size);
+	}
+    
+	void *reallocate(void *memory, size_t old_size, size_t new_size)
+	{
+		if (!is_inline(memory))
+			return fallback.reallocate(memory, old_size, new_size);
+        
+		if (new_size <= Size)
+			return memory;
+        
+		void *result = fallback.allocate(new_size);
+		if (result) memcpy(result, memory, old_size);
+		buffer_is_used = false;
+		return result;
+	}
+    
+	void deallocate(void *memory, size_t size)
+	{
+		if (is_inline(memory))
+			buffer_is_used = false;
+		else
+			fallback.deallocate(memory, size);
+	}
+    
+	alignas(16) uint8_t buffer[Size];
+	bool buffer_is_used{ false };
+	Allocator fallback;
+};
+
+// NOTE(alexey): Storage of FixedArray, never more than the buffer inside of it.
+template<size_t Size>
+struct FixedAllocator
+{
+	FixedAllocator() {}
+	FixedAllocator(const FixedAllocator& /*source*/) {}
+	FixedAllocator& operator=(const FixedAllocator& /*source*/) { return *this; }
+    
+	void *allocate(size_t size) { assert(size <= Size); return buffer; }
+	void *reallocate(void *memory, size_t /*old_size*/, size_t new_size) { assert(new_size <= Size); return memory; }
+	void deallocate(void * /*memory*/, size_t /*size*/) {}
+    
+	alignas(16) uint8_t buffer[Size];
+};
+
+// NOTE(alexey): Arrays for the lists that are small most of the time (the events of a frame).
+// SmallArray keeps up to N elements inside of itself and spills to the fallback allocator after that,
+// FixedArray never has more than N elements (pushing past that asserts) and never allocates.
+// They're Arrays with the storage inside of them, so moving one moves its elements when they're stored inline.
+template<class T, size_t N, class Allocator = HeapAllocator>
+struct SmallArray : Array<T, InlineAllocator<N * sizeof(T), Allocator>>
+{
+	typedef Array<T, InlineAllocator<N * sizeof(T), Allocator>> Base;
+    
+	SmallArray() { this->reserve(N); }
+	SmallArray(Allocator fallback) : Base(typename Base::AllocatorType(fallback)) { this->reserve(N); }
+	SmallArray(std::initializer_list<T> list) { this->reserve(N); this->push_range(list.begin(), list.end()); }
+	SmallArray(const SmallArray& source) : Base(source.allocator) { this->reserve(N); this->copy_from(source); }
+	SmallArray& operator=(const SmallArray& source) { Base::operator=(source); return *this; }
+    
+	SmallArray(SmallArray&& source) : Base(source.allocator)
+	{
+		this->reserve(N);
+		move_from(source);
+	}
+    
+	SmallArray& operator=(SmallArray&& source)
+	{
+		if (this != &source)
+		{
+			this->clear();
+			move_from(source);
+		}
+		return *this;
+	}
+    
+	// NOTE(alexey): Expects the array to be empty. Takes the source's heap memory, the inline elements are moved.
+	void move_from(SmallArray& source)
+	{
+		if (source.allocator.is_inline(source.data))
+		{
+			this->reserve(source.size);
+			for (T& element : source)
+				this->emplace_back(std::move(element));
+			source.clear();
+		}
+		else
+		{
+			this->release();
+			this->data = source.data;
+			this->size = source.size;
+			this->cap = source.cap;
+			source.data = nullptr;
+			source.size = 0;
+			source.cap = 0;
+			source.reserve(N);
+		}
+	}
+};
+
+template<class T, size_t N>
+struct FixedArray : Array<T, FixedAllocator<N * sizeof(T)>>
+{
+	typedef Array<T, FixedAllocator<N * sizeof(T)>> Base;
+    
+	FixedArray() { this->reserve(N); }
+	FixedArray(std::initializer_list<T> list) { this->reserve(N); this->push_range(list.begin(), list.end()); }
+	FixedArray(const FixedArray& source) { this->reserve(N); this->copy_from(source); }
+	FixedArray& operator=(const FixedArray& source) { Base::operator=(source); return *this; }
+    
+	FixedArray(FixedArray&& source) { this->reserve(N); move_from(source); }
+    
+	FixedArray& operator=(FixedArray&& source)
+	{
+		if (this != &source)
+		{
+			this->clear();
+			move_from(source);
+		}
+		return *this;
+	}
+    
+	void move_from(FixedArray& source)
+	{
+		for (T& element : source)
+			this->emplace_back(std::move(element));
+		source.clear();
+	}
+    
+	bool full() const { return this->size == N; }
 };
 
 #define GAME_DYNAMIC_ARRAY_H
@@ -0,0 +1,417 @@
+// NOTE(alexey): Steps of the FlowDirections, in the same order.
+static TilePoint flow_direction_steps[FlowDirection_None] =
+{
+    {1, 0},
+    {1, 1},
+    {0, 1},
+    {-1, 1},
+    {-1, 0},
+    {-1, -1},
+    {0, -1},
+    {1, -1},
+};
+
+void FlowField::init(MemoryArena *arena, PathGraph *path_graph, I32 chunk_radius)
+{
+    m_path_graph = path_graph;
+    m_world = path_graph->m_world;
+    m_chunk_radius = chunk_radius;
+    m_region_side = 2*chunk_radius + 1;
+    m_chunk_count = (U32)(m_region_side*m_region_side);
+    
+    // NOTE(alexey): The whole region has to stay in the graph's slots while the field is built.
+    assert(m_chunk_count <= path_graph->m_slot_count);
+    
+    I32 tile_count_x = m_world->m_tile_count_x;
+    I32 tile_count_y = m_world->m_tile_count_y;
+    U32 tile_count = (U32)(tile_count_x*tile_count_y);
+    
+    m_max_seed_count = path_graph->m_max_entrance_count + 1;
+    m_chunks = push_array(arena, m_chunk_count, FlowFieldChunk);
+    for(U32 chunk_index = 0; chunk_index < m_chunk_count; ++chunk_index)
+    {
+        FlowFieldChunk *chunk = &m_chunks[chunk_index];
+        chunk->seeds = push_array(arena, m_max_seed_count, F32);
+        chunk->integration = push_array(arena, tile_count, F32);
+        chunk->directions = push_array(arena, tile_count, U8);
+        memset(chunk->directions, FlowDirection_None, tile_count);
+    }
+    
+    m_new_seeds = push_array(arena, m_max_seed_count, F32);
+    m_work_chunks = push_array(arena, m_chunk_count, U32);
+    
+    U32 job_count = path_graph->m_pathfinder->m_scratch_count;
+    m_jobs = push_array(arena, job_count, FlowFieldJob);
+    for(U32 job_index = 0; job_index < job_count; ++job_index)
+    {
+        m_jobs[job_index].padded_integration = push_array(arena, (tile_count_x + 2)*(tile_count_y + 2), F32);
+    }
+}
+
+void FlowField::invalidateChunk(I32 tile_map_x, I32 tile_map_y)
+{
+    I32 chunk_x = tile_map_x - m_region.min_tile_map_x;
+    I32 chunk_y = tile_map_y - m_region.min_tile_map_y;
+    if((chunk_x < 0) || (chunk_y < 0) || (chunk_x >= m_region_side) || (chunk_y >= m_region_side))
+    {
+        return;
+    }
+    
+    FlowFieldChunk *chunk = &m_chunks[chunk_y*m_region_side + chunk_x];
+    if(chunk->is_valid && (chunk->tile_map_x == tile_map_x) && (chunk->tile_map_y == tile_map_y))
+    {
+        chunk->is_dirty = true;
+        m_is_dirty = true;
+    }
+}
+
+// NOTE(alexey): Same as PathGraph::invalidateTile, a tile on the border changes the entrances of the neighbour too.
+void FlowField::invalidateTile(I32 abs_tile_x, I32 abs_tile_y)
+{
+    if((abs_tile_x < 0) || (abs_tile_y < 0))
+    {
+        return;
+    }
+    
+    I32 tile_count_x = m_world->m_tile_count_x;
+    I32 tile_count_y = m_world->m_tile_count_y;
+    I32 tile_map_x = abs_tile_x / tile_count_x;
+    I32 tile_map_y = abs_tile_y / tile_count_y;
+    I32 tile_x = abs_tile_x % tile_count_x;
+    I32 tile_y = abs_tile_y % tile_count_y;
+    
+    invalidateChunk(tile_map_x, tile_map_y);
+    
+    if(tile_x == 0)
+    {
+        invalidateChunk(tile_map_x - 1, tile_map_y);
+    }
+    
+    if(tile_x == tile_count_x - 1)
+    {
+        invalidateChunk(tile_map_x + 1, tile_map_y);
+    }
+    
+    if(tile_y == 0)
+    {
+        invalidateChunk(tile_map_x, tile_map_y - 1);
+    }
+    
+    if(tile_y == tile_count_y - 1)
+    {
+        invalidateChunk(tile_map_x, tile_map_y + 1);
+    }
+}
+
+void FlowField::invalidateAll()
+{
+    for(U32 chunk_index = 0; chunk_index < m_chunk_count; ++chunk_index)
+    {
+        m_chunks[chunk_index].is_dirty = true;
+    }
+    
+    m_is_dirty = true;
+}
+
+// NOTE(alexey): F32Max outside of the region.
+F32 FlowField::getIntegration(I32 abs_tile_x, I32 abs_tile_y)
+{
+    if((abs_tile_x < 0) || (abs_tile_y < 0))
+    {
+        return F32Max;
+    }
+    
+    I32 tile_count_x = m_world->m_tile_count_x;
+    I32 tile_count_y = m_world->m_tile_count_y;
+    I32 tile_map_x = abs_tile_x / tile_count_x;
+    I32 tile_map_y = abs_tile_y / tile_count_y;
+    if((tile_map_x < m_region.min_tile_map_x) || (tile_map_y < m_region.min_tile_map_y) ||
+       (tile_map_x > m_region.max_tile_map_x) || (tile_map_y > m_region.max_tile_map_y))
+    {
+        return F32Max;
+    }
+    
+    FlowFieldChunk *chunk = &m_chunks[(tile_map_y - m_region.min_tile_map_y)*m_region_side +
+                                      (tile_map_x - m_region.min_tile_map_x)];
+    F32 result = chunk->integration[(abs_tile_y % tile_count_y)*tile_count_x + (abs_tile_x % tile_count_x)];
+    return result;
+}
+
+// NOTE(alexey): Dijkstra inside of the chunk, from all the seeds at once.
+void FlowField::buildIntegration(PathScratch *scratch, FlowFieldChunk *chunk)
+{
+    I32 tile_count_x = m_world->m_tile_count_x;
+    I32 tile_count_y = m_world->m_tile_count_y;
+    ChunkGraph *graph = chunk->graph;
+    
+    m_path_graph->loadChunkWindow(scratch, graph);
+    begin_path_search(scratch, PATHFINDER_MAX_NODE_COUNT);
+    
+    for(U32 entrance_index = 0; entrance_index < graph->entrance_count; ++entrance_index)
+    {
+        if(chunk->seeds[entrance_index] < F32Max)
+        {
+            open_path_node(scratch, get_window_node(scratch, graph->entrances[entrance_index]), PATH_NODE_NONE,
+                           chunk->seeds[entrance_index], 0.0f);
+        }
+    }
+    
+    if(chunk->seeds[chunk->seed_count - 1] < F32Max)
+    {
+        open_path_node(scratch, get_window_node(scratch, m_goal), PATH_NODE_NONE, 0.0f, 0.0f);
+    }
+    
+    expand_path_window(scratch);
+    
+    I32 min_x = chunk->tile_map_x*tile_count_x;
+    I32 min_y = chunk->tile_map_y*tile_count_y;
+    for(I32 tile_y = 0; tile_y < tile_count_y; ++tile_y)
+    {
+        for(I32 tile_x = 0; tile_x < tile_count_x; ++tile_x)
+        {
+            chunk->integration[tile_y*tile_count_x + tile_x] = get_flooded_distance(scratch, {min_x + tile_x, min_y + tile_y});
+        }
+    }
+}
+
+// NOTE(alexey): Every tile points to the neighbour with the lowest distance, if it's lower than the tile's own,
+// with the same moves as the pathfinder (diagonal steps can't cut corners).
+void FlowField::buildDirections(FlowFieldChunk *chunk, F32 *padded_integration)
+{
+    I32 tile_count_x = m_world->m_tile_count_x;
+    I32 tile_count_y = m_world->m_tile_count_y;
+    I32 stride = tile_count_x + 2;
+    I32 min_x = chunk->tile_map_x*tile_count_x;
+    I32 min_y = chunk->tile_map_y*tile_count_y;
+    
+    for(I32 tile_y = -1; tile_y <= tile_count_y; ++tile_y)
+    {
+        F32 *row = padded_integration + (tile_y + 1)*stride + 1;
+        if((tile_y < 0) || (tile_y == tile_count_y))
+        {
+            for(I32 tile_x = -1; tile_x <= tile_count_x; ++tile_x)
+            {
+                row[tile_x] = getIntegration(min_x + tile_x, min_y + tile_y);
+            }
+        }
+        else
+        {
+            row[-1] = getIntegration(min_x - 1, min_y + tile_y);
+            memcpy(row, chunk->integration + tile_y*tile_count_x, tile_count_x*sizeof(F32));
+            row[tile_count_x] = getIntegration(min_x + tile_count_x, min_y + tile_y);
+        }
+    }
+    
+    for(I32 tile_y = 0; tile_y < tile_count_y; ++tile_y)
+    {
+        for(I32 tile_x = 0; tile_x < tile_count_x; ++tile_x)
+        {
+            F32 *center = padded_integration + (tile_y + 1)*stride + (tile_x + 1);
+            F32 best_distance = *center;
+            U8 best_direction = FlowDirection_None;
+            
+            // NOTE(alexey): Walls and the tiles that can't reach the goal are F32Max, nothing is lower than them.
+            if(best_distance < F32Max)
+            {
+                for(U32 direction = 0; direction < FlowDirection_None; ++direction)
+                {
+                    TilePoint step = flow_direction_steps[direction];
+                    F32 distance = center[step.y*stride + step.x];
+                    if(distance >= best_distance)
+                    {
+                        continue;
+                    }
+                    
+                    if(step.x && step.y && ((center[step.x] == F32Max) || (center[step.y*stride] == F32Max)))
+                    {
+                        continue;
+                    }
+                    
+                    best_distance = distance;
+                    best_direction = (U8)direction;
+                }
+            }
+            
+            chunk->directions[tile_y*tile_count_x + tile_x] = best_direction;
+        }
+    }
+}
+
+// NOTE(alexey): Runs on the compute queue's threads and on the main thread.
+// The integration pass only writes to its own chunks, the directions pass only reads the integration fields.
+function void flow_field_work(WorkQueue *queue, void *data)
+{
+    FlowFieldJob *job = (FlowFieldJob *)data;
+    FlowField *field = job->field;
+    for(U32 index = 0; index < job->chunk_count; ++index)
+    {
+        FlowFieldChunk *chunk = &field->m_chunks[job->chunk_indices[index]];
+        if(job->pass == FlowFieldPass_Integration)
+        {
+            field->buildIntegration(job->scratch, chunk);
+        }
+        else
+        {
+            field->buildDirections(chunk, job->padded_integration);
+        }
+    }
+}
+
+// NOTE(alexey): Goes through the first chunk_count chunks of m_work_chunks.
+void FlowField::runPass(FlowFieldPass pass, U32 chunk_count)
+{
+    Pathfinder *pathfinder = m_path_graph->m_pathfinder;
+    U32 job_count = Minimum(pathfinder->m_scratch_count, chunk_count);
+    for(U32 job_index = 0; job_index < job_count; ++job_index)
+    {
+        U32 first_chunk = (U32)(((U64)chunk_count*job_index) / job_count);
+        U32 one_past_last_chunk = (U32)(((U64)chunk_count*(job_index + 1)) / job_count);
+        
+        FlowFieldJob *job = &m_jobs[job_index];
+        job->field = this;
+        job->pass = pass;
+        job->scratch = &pathfinder->m_scratches[job_index];
+        job->chunk_indices = m_work_chunks + first_chunk;
+        job->chunk_count = one_past_last_chunk - first_chunk;
+        
+        if((job_index == job_count - 1) || !os->add_work_entry(os->compute_queue, flow_field_work, job))
+        {
+            flow_field_work(0, job);
+        }
+    }
+    
+    os->complete_all_work(os->compute_queue);
+}
+
+Bool32 FlowField::build(TilePoint goal)
+{
+    if(m_is_built && !m_is_dirty && (goal.x == m_goal.x) && (goal.y == m_goal.y))
+    {
+        return true;
+    }
+    
+    I32 tile_count_x = m_world->m_tile_count_x;
+    I32 tile_count_y = m_world->m_tile_count_y;
+    if((goal.x < 0) || (goal.y < 0) ||
+       (goal.x >= m_world->m_tile_map_count_x*tile_count_x) || (goal.y >= m_world->m_tile_map_count_y*tile_count_y))
+    {
+        m_is_built = false;
+        return false;
+    }
+    
+    BEGIN_TIMED_BLOCK(BuildFlowField);
+    
+    I32 goal_tile_map_x = goal.x / tile_count_x;
+    I32 goal_tile_map_y = goal.y / tile_count_y;
+    
+    ChunkRect region;
+    region.min_tile_map_x = Maximum(goal_tile_map_x - m_chunk_radius, 0);
+    region.min_tile_map_y = Maximum(goal_tile_map_y - m_chunk_radius, 0);
+    region.max_tile_map_x = Minimum(goal_tile_map_x + m_chunk_radius, m_world->m_tile_map_count_x - 1);
+    region.max_tile_map_y = Minimum(goal_tile_map_y + m_chunk_radius, m_world->m_tile_map_count_y - 1);
+    
+    // NOTE(alexey): The goal's seed is the same wherever it is in the chunk, so its chunk is flooded again when it moves.
+    Bool32 goal_moved = ((goal.x != m_goal.x) || (goal.y != m_goal.y));
+    
+    m_is_built = false;
+    m_is_dirty = false;
+    m_region = region;
+    m_goal = goal;
+    if(!m_path_graph->searchFromPoint(goal, region))
+    {
+        END_TIMED_BLOCK(BuildFlowField);
+        return false;
+    }
+    
+    // NOTE(alexey): Chunks whose seeds didn't change keep their integration fields.
+    U32 tile_count = (U32)(tile_count_x*tile_count_y);
+    U32 work_count = 0;
+    for(I32 chunk_y = 0; chunk_y < m_region_side; ++chunk_y)
+    {
+        for(I32 chunk_x = 0; chunk_x < m_region_side; ++chunk_x)
+        {
+            U32 chunk_index = (U32)(chunk_y*m_region_side + chunk_x);
+            FlowFieldChunk *chunk = &m_chunks[chunk_index];
+            chunk->needs_directions = false;
+            
+            I32 tile_map_x = region.min_tile_map_x + chunk_x;
+            I32 tile_map_y = region.min_tile_map_y + chunk_y;
+            if((tile_map_x > region.max_tile_map_x) || (tile_map_y > region.max_tile_map_y))
+            {
+                if(chunk->is_valid)
+                {
+                    chunk->is_valid = false;
+                    memset(chunk->directions, FlowDirection_None, tile_count);
+                }
+                
+                continue;
+            }
+            
+            if((chunk->tile_map_x != tile_map_x) || (chunk->tile_map_y != tile_map_y))
+            {
+                chunk->is_valid = false;
+                chunk->tile_map_x = tile_map_x;
+                chunk->tile_map_y = tile_map_y;
+            }
+            
+            ChunkGraph *graph = m_path_graph->getSearchedGraph(tile_map_x, tile_map_y);
+            assert(graph);
+            
+            U32 seed_count = 0;
+            for(U32 entrance_index = 0; entrance_index < graph->entrance_count; ++entrance_index)
+            {
+                m_new_seeds[seed_count++] = m_path_graph->getEntranceDistance(graph, entrance_index);
+            }
+            Bool32 has_goal = ((tile_map_x == goal_tile_map_x) && (tile_map_y == goal_tile_map_y));
+            m_new_seeds[seed_count++] = has_goal ? 0.0f : F32Max;
+            
+            chunk->graph = graph;
+            if(chunk->is_valid && !chunk->is_dirty && !(has_goal && goal_moved) && (chunk->seed_count == seed_count) &&
+               (memcmp(chunk->seeds, m_new_seeds, seed_count*sizeof(F32)) == 0))
+            {
+                continue;
+            }
+            
+            memcpy(chunk->seeds, m_new_seeds, seed_count*sizeof(F32));
+            chunk->seed_count = seed_count;
+            chunk->is_valid = true;
+            chunk->is_dirty = false;
+            m_work_chunks[work_count++] = chunk_index;
+        }
+    }
+    
+    runPass(FlowFieldPass_Integration, work_count);
+    m_built_chunk_count += work_count;
+    
+    // NOTE(alexey): Directions of the border tiles depend on the neighbour chunks too.
+    for(U32 work_index = 0; work_index < work_count; ++work_index)
+    {
+        I32 chunk_x = (I32)(m_work_chunks[work_index] % m_region_side);
+        I32 chunk_y = (I32)(m_work_chunks[work_index] / m_region_side);
+        for(I32 neighbour_y = Maximum(chunk_y - 1, 0); neighbour_y <= Minimum(chunk_y + 1, m_region_side - 1); ++neighbour_y)
+        {
+            for(I32 neighbour_x = Maximum(chunk_x - 1, 0); neighbour_x <= Minimum(chunk_x + 1, m_region_side - 1); ++neighbour_x)
+            {
+                FlowFieldChunk *neighbour = &m_chunks[neighbour_y*m_region_side + neighbour_x];
+                neighbour->needs_directions = neighbour->is_valid;
+            }
+        }
+    }
+    
+    U32 direction_count = 0;
+    for(U32 chunk_index = 0; chunk_index < m_chunk_count; ++chunk_index)
+    {
+        if(m_chunks[chunk_index].needs_directions)
+        {
+            m_work_chunks[direction_count++] = chunk_index;
+        }
+    }
+    
+    runPass(FlowFieldPass_Directions, direction_count);
+    m_direction_chunk_count += direction_count;
+    m_is_built = true;
+    
+    END_TIMED_BLOCK_COUNTED(BuildFlowField, work_count);
+    
+    return true;
+}
@@ -0,0 +1,151 @@
+/* date = October 24th 2023 10:45 am */
+#ifndef GAME_FLOW_FIELD_H
+
+/*
+  Flow field towards a single goal, for the crowds that all go to the same place.
+
+  The field covers the tile maps (chunks) within FLOW_FIELD_CHUNK_RADIUS of the goal's one.
+  Every tile gets the distance to the goal (the integration field) and the direction to its neighbour
+  that is the closest to the goal, so an entity only looks its direction up (sample), whatever the size of the crowd.
+
+  The chunks are built independently from each other: PathGraph::searchFromPoint gives the distances
+  from all the entrances in the region to the goal, and every chunk floods its tiles from its entrances
+  (and from the goal, if it's there). The chunks are built on the compute queue, then the directions,
+  which look at the neighbour chunks' border tiles.
+  The distances are the ones of the path graph, a few percent longer than the shortest paths at most,
+  and every step goes to a tile that is strictly closer to the goal, so following the field always ends at the goal.
+
+  The field is kept until the goal moves to another tile or a tile inside of it changes (invalidateTile).
+  Only the chunks whose entrance distances changed are flooded again, and the directions around them.
+  Tiles that can't reach the goal, and the ones outside of the field, have no direction.
+*/
+
+#define FLOW_FIELD_CHUNK_RADIUS 8
+
+enum FlowDirection
+{
+    FlowDirection_East,
+    FlowDirection_NorthEast,
+    FlowDirection_North,
+    FlowDirection_NorthWest,
+    FlowDirection_West,
+    FlowDirection_SouthWest,
+    FlowDirection_South,
+    FlowDirection_SouthEast,
+
+    FlowDirection_None,
+    FlowDirection_Count,
+};
+
+struct FlowFieldChunk
+{
+    I32 tile_map_x;
+    I32 tile_map_y;
+
+    Bool32 is_valid; // the integration field was built for this tile map.
+    Bool32 is_dirty; // a tile changed since.
+    Bool32 needs_directions;
+
+    // NOTE(alexey): The chunk's path graph, for the current build only.
+    ChunkGraph *graph;
+
+    // NOTE(alexey): The distances the integration field was flooded from, one per entrance
+    // and the goal's last (F32Max when it's not in the chunk). Unchanged seeds give the same field.
+    U32 seed_count;
+    F32 *seeds;
+
+    // NOTE(alexey): Per tile, the bottom row first. F32Max for the tiles that can't reach the goal.
+    F32 *integration;
+    U8 *directions;
+};
+
+struct FlowField;
+
+enum FlowFieldPass
+{
+    FlowFieldPass_Integration,
+    FlowFieldPass_Directions,
+};
+
+struct FlowFieldJob
+{
+    FlowField *field;
+    FlowFieldPass pass;
+    PathScratch *scratch;
+    F32 *padded_integration; // the chunk's integration field with a tile of the neighbours around it.
+    U32 *chunk_indices;
+    U32 chunk_count;
+};
+
+struct FlowField
+{
+    void init(MemoryArena *arena, PathGraph *path_graph, I32 chunk_radius);
+
+    // NOTE(alexey): Returns false if the goal isn't passable, there's no field then.
+    Bool32 build(TilePoint goal);
+    void invalidateTile(I32 abs_tile_x, I32 abs_tile_y);
+    void invalidateAll();
+
+    // NOTE(alexey): Unit vector towards the goal, zero at the goal and where there's no direction.
+    inline Vec2 sample(WorldPos pos);
+
+    void buildIntegration(PathScratch *scratch, FlowFieldChunk *chunk);
+    void buildDirections(FlowFieldChunk *chunk, F32 *padded_integration);
+    F32 getIntegration(I32 abs_tile_x, I32 abs_tile_y);
+    void invalidateChunk(I32 tile_map_x, I32 tile_map_y);
+    void runPass(FlowFieldPass pass, U32 chunk_count);
+
+    PathGraph *m_path_graph;
+    GameWorld *m_world;
+
+    Bool32 m_is_built;
+    Bool32 m_is_dirty;
+    TilePoint m_goal;
+
+    // NOTE(alexey): Chunks of the region go row by row, m_region_side wide,
+    // the ones of the regions clipped by the world's edges stay unused.
+    ChunkRect m_region;
+    I32 m_chunk_radius;
+    I32 m_region_side;
+    U32 m_chunk_count;
+    FlowFieldChunk *m_chunks;
+
+    U32 m_max_seed_count;
+    F32 *m_new_seeds;
+    U32 *m_work_chunks;
+    FlowFieldJob *m_jobs;
+
+    // stats
+    U64 m_built_chunk_count;
+    U64 m_direction_chunk_count;
+};
+
+static Vec2 flow_direction_vectors[FlowDirection_Count] =
+{
+    Vec2(1.0f, 0.0f),
+    Vec2(0.70710678f, 0.70710678f),
+    Vec2(0.0f, 1.0f),
+    Vec2(-0.70710678f, 0.70710678f),
+    Vec2(-1.0f, 0.0f),
+    Vec2(-0.70710678f, -0.70710678f),
+    Vec2(0.0f, -1.0f),
+    Vec2(0.70710678f, -0.70710678f),
+    Vec2(0.0f, 0.0f),
+};
+
+inline Vec2 FlowField::sample(WorldPos pos)
+{
+    I32 chunk_x = pos.tile_map_x - m_region.min_tile_map_x;
+    I32 chunk_y = pos.tile_map_y - m_region.min_tile_map_y;
+    if(!m_is_built || (chunk_x < 0) || (chunk_y < 0) || (chunk_x >= m_region_side) || (chunk_y >= m_region_side))
+    {
+        return flow_direction_vectors[FlowDirection_None];
+    }
+
+    FlowFieldChunk *chunk = &m_chunks[chunk_y*m_region_side + chunk_x];
+    U8 direction = chunk->directions[pos.tile_y*m_world->m_tile_count_x + pos.tile_x];
+    return flow_direction_vectors[direction];
+}
+
+#define GAME_FLOW_FIELD_H
+#endif //GAME_FLOW_FIELD_H
@@ -0,0 +1,162 @@
+/* date = October 18th 2026 10:05 am */
+
+#ifndef GAME_HASH_MAP_H
+
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// NOTE(alexey): Chunk coordinates packed into a single key, 21 bits per coordinate (signed),
+// so a chunk coordinate has to be in [-2^20, 2^20).
+inline uint64_t pack_chunk_key(int32_t chunk_x, int32_t chunk_y, int32_t chunk_z = 0)
+{
+	assert((chunk_x >= -(1 << 20)) && (chunk_x < (1 << 20)));
+	assert((chunk_y >= -(1 << 20)) && (chunk_y < (1 << 20)));
+	assert((chunk_z >= -(1 << 20)) && (chunk_z < (1 << 20)));
+	uint64_t result =
+		((uint64_t)(chunk_x & 0x1FFFFF) << 42) | ((uint64_t)(chunk_y & 0x1FFFFF) << 21) | (uint64_t)(chunk_z & 0x1FFFFF);
+	return result;
+}
+
+// NOTE(alexey): Open addressing with linear probing and Robin Hood insertion, for the packed integer keys.
+// A slot remembers how far it is from its home slot (distance 0 means the slot is empty),
+// an insert takes the slot of any key that is closer to its home than the inserted one is,
+// so a lookup can stop as soon as it sees a key that is closer to home than it would be.
+// Removal shifts the following keys back by one until a key that is at its home, so there are no tombstones.
+// The slots are allocated from an arena once, nothing is allocated after init.
+// An insert fails (returns 0) when the map is 7/8 full (HASH_MAP_MAX_LOAD_*).
+// The hash is a Fibonacci one (the key multiplied by 2^64/phi, the top bits are the slot),
+// which is enough to spread the chunk coordinates that are next to each other.
+#define HASH_MAP_MAX_LOAD_NUMERATOR 7
+#define HASH_MAP_MAX_LOAD_DENOMINATOR 8
+
+template<class Value>
+struct HashMap
+{
+	struct Slot
+	{
+		uint64_t key;
+		uint32_t distance; // from the home slot plus one, 0 for the empty slots.
+		Value value;
+	};
+    
+	// NOTE(alexey): Room for max_count keys, the slot count is the next power of two that keeps the load under the max.
+	void init(MemoryArena *arena, size_t max_count)
+	{
+		size_t min_slot_count = (max_count*HASH_MAP_MAX_LOAD_DENOMINATOR) / HASH_MAP_MAX_LOAD_NUMERATOR + 1;
+		shift = 64;
+		slot_count = 1;
+		while (slot_count < min_slot_count)
+		{
+			slot_count <<= 1;
+			--shift;
+		}
+		mask = slot_count - 1;
+		max_key_count = (slot_count*HASH_MAP_MAX_LOAD_NUMERATOR) / HASH_MAP_MAX_LOAD_DENOMINATOR;
+		slots = (Slot *)push_size(arena, slot_count*sizeof(Slot), 64);
+		clear();
+	}
+    
+	void clear()
+	{
+		memset((void*)slots, 0, slot_count*sizeof(Slot));
+		count = 0;
+	}
+    
+	size_t get_home(uint64_t key) const
+	{
+		// NOTE(alexey): shift is 64 for a single slot, shifting by 64 is undefined.
+		return (shift < 64) ? (size_t)((key*0x9E3779B97F4A7C15ull) >> shift) : 0;
+	}
+    
+	Slot *find_slot(uint64_t key)
+	{
+		size_t index = get_home(key);
+		for (uint32_t distance = 1;; ++distance)
+		{
+			Slot *slot = slots + index;
+			if (slot->distance < distance)
+				return 0;
+			if (slot->key == key)
+				return slot;
+			index = (index + 1) & mask;
+		}
+	}
+    
+	Value *find(uint64_t key)
+	{
+		Slot *slot = find_slot(key);
+		return slot ? &slot->value : 0;
+	}
+    
+	// NOTE(alexey): Replaces the value if the key is there already.
+	Value *insert(uint64_t key, const Value &value)
+	{
+		Value *existing = find(key);
+		if (existing)
+		{
+			*existing = value;
+			return existing;
+		}
+		if (count == max_key_count)
+			return 0;
+    
+		Slot inserted = {key, 1, value};
+		Value *result = 0;
+		size_t index = get_home(key);
+		for (;;)
+		{
+			Slot *slot = slots + index;
+			if (!slot->distance)
+			{
+				*slot = inserted;
+				if (!result) result = &slot->value;
+				break;
+			}
+			if (slot->distance < inserted.distance)
+			{
+				Slot displaced = *slot;
+				*slot = inserted;
+				if (!result) result = &slot->value;
+				inserted = displaced;
+			}
+			index = (index + 1) & mask;
+			++inserted.distance;
+		}
+		++count;
+		return result;
+	}
+    
+	bool remove(uint64_t key)
+	{
+		Slot *slot = find_slot(key);
+		if (!slot)
+			return false;
+    
+		size_t index = slot - slots;
+		for (;;)
+		{
+			size_t next_index = (index + 1) & mask;
+			Slot *next = slots + next_index;
+			if (next->distance <= 1)
+				break;
+			slots[index] = *next;
+			--slots[index].distance;
+			index = next_index;
+		}
+		slots[index].distance = 0;
+		--count;
+		return true;
+	}
+    
+	Slot *slots;
+	size_t slot_count;
+	size_t mask;
+	size_t max_key_count;
+	size_t count;
+	uint32_t shift;
+};
+
+#define GAME_HASH_MAP_H
+#endif //GAME_HASH_MAP_H
@@ -0,0 +1,192 @@
+function U64 write_image_decimal(U8 *dest, U32 value)
+{
+    U8 digits[10];
+    U32 digit_count = 0;
+    do
+    {
+        digits[digit_count++] = (U8)('0' + value % 10);
+        value /= 10;
+    } while(value);
+    
+    for(U32 digit_index = 0; digit_index < digit_count; ++digit_index)
+    {
+        dest[digit_index] = digits[digit_count - 1 - digit_index];
+    }
+    
+    return digit_count;
+}
+
+function ImageFile encode_ppm(MemoryArena *arena, U8 *rgba, I32 width, I32 height, I32 pitch)
+{
+    // NOTE(alexey): "P6\n<width> <height>\n255\n", 10 digits at most per number.
+    U8 header[32];
+    U64 header_size = 0;
+    header[header_size++] = 'P';
+    header[header_size++] = '6';
+    header[header_size++] = '\n';
+    header_size += write_image_decimal(header + header_size, width);
+    header[header_size++] = ' ';
+    header_size += write_image_decimal(header + header_size, height);
+    memcpy(header + header_size, "\n255\n", 5);
+    header_size += 5;
+    
+    ImageFile result = {};
+    result.size = header_size + (U64)width*height*3;
+    result.data = push_array(arena, result.size, U8);
+    memcpy(result.data, header, header_size);
+    
+    U8 *dest = result.data + header_size;
+    for(I32 y = 0; y < height; ++y)
+    {
+        U8 *src = rgba + (size_t)y*pitch;
+        for(I32 x = 0; x < width; ++x)
+        {
+            dest[0] = src[0];
+            dest[1] = src[1];
+            dest[2] = src[2];
+            dest += 3;
+            src += 4;
+        }
+    }
+    
+    return result;
+}
+
+static U32 png_crc_table[256];
+
+function void init_png_crc_table()
+{
+    for(U32 n = 0; n < 256; ++n)
+    {
+        U32 c = n;
+        for(U32 k = 0; k < 8; ++k)
+        {
+            c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+        }
+        png_crc_table[n] = c;
+    }
+}
+
+function U32 update_png_crc(U32 crc, U8 *data, U64 size)
+{
+    for(U64 i = 0; i < size; ++i)
+    {
+        crc = png_crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    
+    return crc;
+}
+
+inline U8 *write_png_u32(U8 *dest, U32 value)
+{
+    dest[0] = (U8)(value >> 24);
+    dest[1] = (U8)(value >> 16);
+    dest[2] = (U8)(value >> 8);
+    dest[3] = (U8)value;
+    return dest + 4;
+}
+
+// NOTE(alexey): Writes the chunk's length, type and CRC around the data that's already at dest + 8.
+function U8 *write_png_chunk(U8 *dest, const char *type, U32 data_size)
+{
+    write_png_u32(dest, data_size);
+    memcpy(dest + 4, type, 4);
+    
+    U32 crc = update_png_crc(0xFFFFFFFF, dest + 4, 4 + data_size);
+    return write_png_u32(dest + 8 + data_size, crc ^ 0xFFFFFFFF);
+}
+
+// NOTE(alexey): A single IDAT chunk with the zlib stream of stored deflate blocks,
+// every row is the filter byte (none) and the row's pixels.
+function ImageFile encode_png(MemoryArena *arena, U8 *rgba, I32 width, I32 height, I32 pitch)
+{
+    if(!png_crc_table[1])
+    {
+        init_png_crc_table();
+    }
+    
+    U64 row_size = (U64)width*4 + 1;
+    U64 raw_size = row_size*height;
+    U64 max_block_size = 65535;
+    U64 block_count = (raw_size + max_block_size - 1) / max_block_size;
+    U64 zlib_size = 2 + raw_size + 5*block_count + 4;
+    assert(zlib_size < 0x7FFFFFFF);
+    
+    ImageFile result = {};
+    result.size = 8 + (12 + 13) + (12 + zlib_size) + 12;
+    result.data = push_array(arena, result.size, U8);
+    
+    U8 *dest = result.data;
+    U8 signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    memcpy(dest, signature, sizeof(signature));
+    dest += sizeof(signature);
+    
+    U8 *header = dest + 8;
+    header = write_png_u32(header, width);
+    header = write_png_u32(header, height);
+    header[0] = 8; // bit depth
+    header[1] = 6; // color type, RGBA
+    header[2] = 0; // compression
+    header[3] = 0; // filter
+    header[4] = 0; // interlace
+    dest = write_png_chunk(dest, "IHDR", 13);
+    
+    // NOTE(alexey): Rows are copied into the blocks as they come, a row can span two blocks.
+    U8 *zlib = dest + 8;
+    U8 *out = zlib;
+    *out++ = 0x78;
+    *out++ = 0x01;
+    
+    U32 adler_a = 1;
+    U32 adler_b = 0;
+    U64 block_left = 0;
+    U64 raw_left = raw_size;
+    for(I32 y = 0; y < height; ++y)
+    {
+        U8 filter = 0;
+        U8 *row = rgba + (size_t)y*pitch;
+        for(U64 offset = 0; offset < row_size;)
+        {
+            if(block_left == 0)
+            {
+                block_left = Minimum(raw_left, max_block_size);
+                raw_left -= block_left;
+                *out++ = (raw_left == 0) ? 1 : 0;
+                out[0] = (U8)block_left;
+                out[1] = (U8)(block_left >> 8);
+                out[2] = (U8)~block_left;
+                out[3] = (U8)(~block_left >> 8);
+                out += 4;
+            }
+            
+            U8 *src = (offset == 0) ? &filter : (row + offset - 1);
+            U64 size = (offset == 0) ? 1 : Minimum(row_size - offset, block_left);
+            memcpy(out, src, size);
+            
+            // NOTE(alexey): The sums stay below 2^32 for up to 5552 bytes between the modulos.
+            for(U64 i = 0; i < size;)
+            {
+                U64 end = Minimum(size, i + 5552);
+                for(; i < end; ++i)
+                {
+                    adler_a += src[i];
+                    adler_b += adler_a;
+                }
+                adler_a %= 65521;
+                adler_b %= 65521;
+            }
+            
+            out += size;
+            offset += size;
+            block_left -= size;
+        }
+    }
+    out = write_png_u32(out, (adler_b << 16) | adler_a);
+    assert((U64)(out - zlib) == zlib_size);
+    dest = write_png_chunk(dest, "IDAT", (U32)zlib_size);
+    
+    dest = write_png_chunk(dest, "IEND", 0);
+    assert((U64)(dest - result.data) == result.size);
+    
+    return result;
+}
@@ -0,0 +1,19 @@
+/* date = October 28th 2023 11:20 am */
+#ifndef GAME_IMAGE_H
+
+/*
+  Image files of the frames, for the hosts without a window (dumps, screenshots, comparisons between the builds).
+  The pixels come from convert_buffer_to_rgba: bytes R, G, B, A, rows top-down.
+
+  PPM (binary P6) drops the alpha. PNG keeps it and isn't compressed, the deflate stream is made of stored blocks,
+  so the files are as big as the pixels, but any image viewer opens them and writing one costs a copy and a CRC.
+*/
+
+struct ImageFile
+{
+    U8 *data;
+    U64 size;
+};
+
+#define GAME_IMAGE_H
+#endif //GAME_IMAGE_H
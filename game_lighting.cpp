@@ -0,0 +1,382 @@
+// NOTE(alexey): Maps the first octant onto the other seven, (x, y) = (dx*xx + dy*xy, dx*yx + dy*yy).
+static I32 light_octant_transforms[4][8] =
+{
+    {1, 0, 0, -1, -1, 0, 0, 1},
+    {0, 1, -1, 0, 0, -1, 1, 0},
+    {0, 1, 1, 0, 0, -1, -1, 0},
+    {1, 0, 0, 1, -1, 0, 0, -1},
+};
+
+inline Bool32 is_light_blocked(LightCast *cast, I32 x, I32 y)
+{
+    if(((U32)x >= LIGHTING_WINDOW_SIDE) || ((U32)y >= LIGHTING_WINDOW_SIDE))
+    {
+        return true;
+    }
+    
+    Bool32 result = (Bool32)((cast->opaque[y] >> x) & 1);
+    return result;
+}
+
+inline void set_light_visible(LightCast *cast, I32 x, I32 y)
+{
+    if(((U32)x < LIGHTING_WINDOW_SIDE) && ((U32)y < LIGHTING_WINDOW_SIDE))
+    {
+        cast->visible[y] |= ((U64)1 << x);
+    }
+}
+
+// NOTE(alexey): Recursive shadowcasting of a single octant, rows go away from the center,
+// the slopes are the part of the row that isn't in the shadow yet.
+// Opaque tiles are marked visible as well, so the walls facing the light are lit.
+function void cast_light_octant(LightCast *cast, I32 first_row, F32 start_slope, F32 end_slope,
+                                I32 xx, I32 xy, I32 yx, I32 yy)
+{
+    if(start_slope < end_slope)
+    {
+        return;
+    }
+    
+    I32 radius_squared = cast->radius*cast->radius;
+    F32 next_start_slope = start_slope;
+    for(I32 row = first_row; row <= cast->radius; ++row)
+    {
+        Bool32 is_blocked = false;
+        I32 dy = -row;
+        for(I32 dx = -row; dx <= 0; ++dx)
+        {
+            F32 left_slope = (dx - 0.5f) / (dy + 0.5f);
+            F32 right_slope = (dx + 0.5f) / (dy - 0.5f);
+            if(start_slope < right_slope)
+            {
+                continue;
+            }
+            
+            if(end_slope > left_slope)
+            {
+                break;
+            }
+            
+            I32 x = cast->center_x + dx*xx + dy*xy;
+            I32 y = cast->center_y + dx*yx + dy*yy;
+            if(dx*dx + dy*dy <= radius_squared)
+            {
+                set_light_visible(cast, x, y);
+            }
+            
+            Bool32 is_opaque = is_light_blocked(cast, x, y);
+            if(is_blocked)
+            {
+                if(is_opaque)
+                {
+                    next_start_slope = right_slope;
+                }
+                else
+                {
+                    is_blocked = false;
+                    start_slope = next_start_slope;
+                }
+            }
+            else if(is_opaque && (row < cast->radius))
+            {
+                is_blocked = true;
+                cast_light_octant(cast, row + 1, start_slope, left_slope, xx, xy, yx, yy);
+                next_start_slope = right_slope;
+            }
+        }
+        
+        if(is_blocked)
+        {
+            break;
+        }
+    }
+}
+
+function void cast_light(LightCast *cast)
+{
+    set_light_visible(cast, cast->center_x, cast->center_y);
+    for(U32 octant = 0; octant < 8; ++octant)
+    {
+        cast_light_octant(cast, 1, 1.0f, 0.0f,
+                          light_octant_transforms[0][octant], light_octant_transforms[1][octant],
+                          light_octant_transforms[2][octant], light_octant_transforms[3][octant]);
+    }
+}
+
+void Lighting::init(MemoryArena *arena, GameWorld *world, WorldStreamer *streamer)
+{
+    m_world = world;
+    m_streamer = streamer;
+    m_chunk_tiles = push_array(arena, world->m_tile_count_x*world->m_tile_count_y, U32);
+    m_light_map = push_array(arena, LIGHTING_WINDOW_SIDE*LIGHTING_WINDOW_SIDE, F32, 16);
+    m_levels = push_array(arena, LIGHTING_WINDOW_SIDE*LIGHTING_WINDOW_SIDE, U8, 16);
+    m_is_dirty = true;
+}
+
+Bool32 Lighting::addLight(Light light)
+{
+    if(m_light_count == LIGHTING_MAX_LIGHT_COUNT)
+    {
+        return false;
+    }
+    
+    light.radius = Clamp(light.radius, 0, LIGHTING_MAX_RADIUS);
+    m_lights[m_light_count++] = light;
+    m_is_dirty = true;
+    return true;
+}
+
+void Lighting::clearLights()
+{
+    m_light_count = 0;
+    m_is_dirty = true;
+}
+
+void Lighting::setDoorsBlockLight(Bool32 doors_block_light)
+{
+    m_doors_block_light = doors_block_light;
+    m_is_dirty = true;
+}
+
+void Lighting::invalidateTile(I32 abs_tile_x, I32 abs_tile_y)
+{
+    if((abs_tile_x >= m_window_min_x) && (abs_tile_y >= m_window_min_y) &&
+       (abs_tile_x < m_window_min_x + LIGHTING_WINDOW_SIDE) && (abs_tile_y < m_window_min_y + LIGHTING_WINDOW_SIDE))
+    {
+        m_is_dirty = true;
+    }
+}
+
+// NOTE(alexey): Everything starts opaque, the empty tiles (and the doors) of the chunks that could be read are cleared.
+void Lighting::buildOpacity()
+{
+    for(I32 row = 0; row < LIGHTING_WINDOW_SIDE; ++row)
+    {
+        m_opaque[row] = ~(U64)0;
+    }
+    
+    I32 tile_count_x = m_world->m_tile_count_x;
+    I32 tile_count_y = m_world->m_tile_count_y;
+    I32 min_x = Maximum(m_window_min_x, 0);
+    I32 min_y = Maximum(m_window_min_y, 0);
+    I32 max_x = Minimum(m_window_min_x + LIGHTING_WINDOW_SIDE, m_world->m_tile_map_count_x*tile_count_x);
+    I32 max_y = Minimum(m_window_min_y + LIGHTING_WINDOW_SIDE, m_world->m_tile_map_count_y*tile_count_y);
+    if((min_x >= max_x) || (min_y >= max_y))
+    {
+        return;
+    }
+    
+    for(I32 tile_map_y = min_y / tile_count_y; tile_map_y <= (max_y - 1) / tile_count_y; ++tile_map_y)
+    {
+        for(I32 tile_map_x = min_x / tile_count_x; tile_map_x <= (max_x - 1) / tile_count_x; ++tile_map_x)
+        {
+            TileMap *tile_map = m_world->getWorldTileMap(tile_map_x, tile_map_y);
+            U32 *tiles = tile_map ? tile_map->tiles : 0;
+            if(tile_map && !tiles && m_streamer)
+            {
+                tiles = m_streamer->readChunkTiles(tile_map_x, tile_map_y, m_chunk_tiles);
+            }
+            
+            if(!tiles)
+            {
+                continue;
+            }
+            
+            I32 chunk_min_x = Maximum(min_x, tile_map_x*tile_count_x);
+            I32 chunk_min_y = Maximum(min_y, tile_map_y*tile_count_y);
+            I32 chunk_max_x = Minimum(max_x, (tile_map_x + 1)*tile_count_x);
+            I32 chunk_max_y = Minimum(max_y, (tile_map_y + 1)*tile_count_y);
+            I32 count = chunk_max_x - chunk_min_x;
+            I32 shift = chunk_min_x - m_window_min_x;
+            
+            for(I32 abs_tile_y = chunk_min_y; abs_tile_y < chunk_max_y; ++abs_tile_y)
+            {
+                I32 tile_y = abs_tile_y - tile_map_y*tile_count_y;
+                U32 *source = tiles + (tile_count_y - tile_y - 1)*tile_count_x + (chunk_min_x - tile_map_x*tile_count_x);
+                
+                U64 transparent = 0;
+                for(I32 index = 0; index < count; ++index)
+                {
+                    U32 tile_value = source[index];
+                    if((tile_value == TileValue_Empty) || ((tile_value == TileValue_Door) && !m_doors_block_light))
+                    {
+                        transparent |= ((U64)1 << (shift + index));
+                    }
+                }
+                
+                m_opaque[abs_tile_y - m_window_min_y] &= ~transparent;
+            }
+        }
+    }
+}
+
+// NOTE(alexey): Casts the light, and adds intensity*(1 - d^2/(radius + 1)^2) to every tile it reaches.
+// The visible rows are cleared on the way, so m_visible is empty again for the next light.
+void Lighting::accumulateLight(TilePoint tile, I32 radius, F32 intensity)
+{
+    LightCast cast;
+    cast.opaque = m_opaque;
+    cast.visible = m_visible;
+    cast.center_x = tile.x - m_window_min_x;
+    cast.center_y = tile.y - m_window_min_y;
+    cast.radius = radius;
+    cast_light(&cast);
+    
+    F32 inv_radius_squared = 1.0f / (F32)((radius + 1)*(radius + 1));
+    I32 min_row = Maximum(cast.center_y - radius, 0);
+    I32 max_row = Minimum(cast.center_y + radius, LIGHTING_WINDOW_SIDE - 1);
+    I32 min_x = Maximum(cast.center_x - radius, 0) & ~3;
+    I32 max_x = Minimum(cast.center_x + radius, LIGHTING_WINDOW_SIDE - 1);
+
+#if GAME_RENDER_SIMD
+    __m128 lane_offsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    __m128i lane_bits = _mm_setr_epi32(1, 2, 4, 8);
+    __m128 center_x = _mm_set1_ps((F32)cast.center_x);
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 zero = _mm_setzero_ps();
+    __m128 inv_radius_squared_4x = _mm_set1_ps(inv_radius_squared);
+    __m128 intensity_4x = _mm_set1_ps(intensity);
+#endif
+    
+    for(I32 row = min_row; row <= max_row; ++row)
+    {
+        U64 bits = m_visible[row];
+        m_visible[row] = 0;
+        if(!bits)
+        {
+            continue;
+        }
+        
+        F32 *light_row = m_light_map + row*LIGHTING_WINDOW_SIDE;
+        F32 dy = (F32)(row - cast.center_y);
+
+#if GAME_RENDER_SIMD
+        // NOTE(alexey): 4 tiles at a time, the lanes the light didn't reach are masked out with their visibility bits.
+        __m128 dy_squared = _mm_set1_ps(dy*dy);
+        for(I32 x = min_x; x <= max_x; x += 4)
+        {
+            U32 nibble = (U32)(bits >> x) & 0xF;
+            if(!nibble)
+            {
+                continue;
+            }
+            
+            __m128 dx = _mm_sub_ps(_mm_add_ps(_mm_set1_ps((F32)x), lane_offsets), center_x);
+            __m128 distance_squared = _mm_add_ps(_mm_mul_ps(dx, dx), dy_squared);
+            __m128 light = _mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(distance_squared, inv_radius_squared_4x)), zero);
+            light = _mm_mul_ps(light, intensity_4x);
+            
+            __m128i mask = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32((I32)nibble), lane_bits), lane_bits);
+            light = _mm_and_ps(light, _mm_castsi128_ps(mask));
+            _mm_store_ps(light_row + x, _mm_add_ps(_mm_load_ps(light_row + x), light));
+        }
+#else
+        for(I32 x = min_x; x <= max_x; ++x)
+        {
+            if((bits >> x) & 1)
+            {
+                F32 dx = (F32)(x - cast.center_x);
+                F32 light = 1.0f - (dx*dx + dy*dy)*inv_radius_squared;
+                light_row[x] += intensity*Maximum(light, 0.0f);
+            }
+        }
+#endif
+    }
+}
+
+void Lighting::recompute()
+{
+    BEGIN_TIMED_BLOCK(UpdateLighting);
+    
+    m_window_min_x = m_center.x - LIGHTING_WINDOW_SIDE / 2;
+    m_window_min_y = m_center.y - LIGHTING_WINDOW_SIDE / 2;
+    buildOpacity();
+    
+    // NOTE(alexey): The field of view reaches the window's edges.
+    memset(m_field_of_view, 0, sizeof(m_field_of_view));
+    LightCast view;
+    view.opaque = m_opaque;
+    view.visible = m_field_of_view;
+    view.center_x = LIGHTING_WINDOW_SIDE / 2;
+    view.center_y = LIGHTING_WINDOW_SIDE / 2;
+    view.radius = LIGHTING_WINDOW_SIDE / 2;
+    cast_light(&view);
+    
+    memset(m_visible, 0, sizeof(m_visible));
+    memset(m_light_map, 0, LIGHTING_WINDOW_SIDE*LIGHTING_WINDOW_SIDE*sizeof(F32));
+    accumulateLight(m_center, LIGHTING_PLAYER_RADIUS, LIGHTING_PLAYER_INTENSITY);
+    
+    m_last_light_count = 0;
+    for(U32 light_index = 0; light_index < m_light_count; ++light_index)
+    {
+        Light *light = &m_lights[light_index];
+        I32 x = light->tile.x - m_window_min_x;
+        I32 y = light->tile.y - m_window_min_y;
+        if((x >= 0) && (y >= 0) && (x < LIGHTING_WINDOW_SIDE) && (y < LIGHTING_WINDOW_SIDE))
+        {
+            accumulateLight(light->tile, light->radius, light->intensity);
+            ++m_last_light_count;
+        }
+    }
+    
+    // NOTE(alexey): Levels are (ambient + light) clamped to 1 in the field of view and the fog outside of it.
+    F32 fog = (F32)LIGHTING_FOG_LEVEL / 255.0f;
+    for(I32 row = 0; row < LIGHTING_WINDOW_SIDE; ++row)
+    {
+        U64 view_bits = m_field_of_view[row];
+        F32 *light_row = m_light_map + row*LIGHTING_WINDOW_SIDE;
+        U8 *level_row = m_levels + row*LIGHTING_WINDOW_SIDE;
+
+#if GAME_RENDER_SIMD
+        __m128i lane_bits = _mm_setr_epi32(1, 2, 4, 8);
+        __m128 ambient = _mm_set1_ps(LIGHTING_AMBIENT);
+        __m128 one = _mm_set1_ps(1.0f);
+        __m128 fog_4x = _mm_set1_ps(fog);
+        __m128 max_level = _mm_set1_ps(255.0f);
+        __m128 half = _mm_set1_ps(0.5f);
+        for(I32 x = 0; x < LIGHTING_WINDOW_SIDE; x += 16)
+        {
+            __m128i levels[4];
+            for(I32 lane_group = 0; lane_group < 4; ++lane_group)
+            {
+                I32 group_x = x + 4*lane_group;
+                __m128i nibble = _mm_set1_epi32((I32)((view_bits >> group_x) & 0xF));
+                __m128 mask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(nibble, lane_bits), lane_bits));
+                
+                __m128 light = _mm_min_ps(_mm_add_ps(_mm_load_ps(light_row + group_x), ambient), one);
+                light = _mm_or_ps(_mm_and_ps(mask, light), _mm_andnot_ps(mask, fog_4x));
+                
+                // NOTE(alexey): Rounded the same way as round_real32_to_uint32, not to the nearest even.
+                levels[lane_group] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(light, max_level), half));
+            }
+            
+            __m128i packed = _mm_packus_epi16(_mm_packs_epi32(levels[0], levels[1]), _mm_packs_epi32(levels[2], levels[3]));
+            _mm_store_si128((__m128i *)(level_row + x), packed);
+        }
+#else
+        for(I32 x = 0; x < LIGHTING_WINDOW_SIDE; ++x)
+        {
+            F32 light = ((view_bits >> x) & 1) ? Minimum(light_row[x] + LIGHTING_AMBIENT, 1.0f) : fog;
+            level_row[x] = (U8)round_real32_to_uint32(light*255.0f);
+        }
+#endif
+    }
+    
+    m_is_built = true;
+    m_is_dirty = false;
+    ++m_recompute_count;
+    
+    END_TIMED_BLOCK(UpdateLighting);
+}
+
+Bool32 Lighting::update(TilePoint center)
+{
+    if(m_is_built && !m_is_dirty && (center.x == m_center.x) && (center.y == m_center.y))
+    {
+        return false;
+    }
+    
+    m_center = center;
+    recompute();
+    return true;
+}
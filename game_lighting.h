@@ -0,0 +1,104 @@
+/* date = October 25th 2023 9:15 am */
+#ifndef GAME_LIGHTING_H
+
+/*
+  Field of view and lights over the tiles around the player.
+
+  Everything is computed in a window of LIGHTING_WINDOW_SIDE x LIGHTING_WINDOW_SIDE tiles centered on the player,
+  so a row of the window is a single U64 bitset: the tiles that block the light, and the ones a cast reaches.
+  Visibility is recursive shadowcasting, from the player for the field of view and from every light in the window.
+  Lights fall off with the squared distance, they're accumulated into the light map 4 tiles at a time,
+  straight from the visibility bits. The light map is turned into a level per tile,
+  which GameState::render multiplies the tile colors with. Tiles outside of the field of view get LIGHTING_FOG_LEVEL.
+
+  Walls always block the light, doors only if m_doors_block_light is set.
+  Chunks that aren't resident are read through WorldStreamer::readChunkTiles, the ones that can't be read block the light.
+
+  update recomputes the window only when the player moves into another tile, or when something changed
+  (a tile in the window, the lights or the settings), otherwise it costs nothing.
+*/
+
+#define LIGHTING_WINDOW_SIDE 64
+#define LIGHTING_MAX_LIGHT_COUNT 1024
+
+// NOTE(alexey): Radius in tiles, the lights further away than that from the window's edge are cut off.
+#define LIGHTING_MAX_RADIUS 24
+
+#define LIGHTING_AMBIENT 0.3f
+#define LIGHTING_FOG_LEVEL 40
+#define LIGHTING_PLAYER_RADIUS 9
+#define LIGHTING_PLAYER_INTENSITY 0.8f
+
+struct Light
+{
+    TilePoint tile; // absolute tile.
+    I32 radius;
+    F32 intensity;
+};
+
+// NOTE(alexey): A single shadowcast, the center is in the window's coordinates.
+struct LightCast
+{
+    U64 *opaque;
+    U64 *visible;
+    I32 center_x;
+    I32 center_y;
+    I32 radius;
+};
+
+struct Lighting
+{
+    void init(MemoryArena *arena, GameWorld *world, WorldStreamer *streamer);
+
+    // NOTE(alexey): Returns true if the window was recomputed.
+    Bool32 update(TilePoint center);
+    void recompute();
+    void buildOpacity();
+    void accumulateLight(TilePoint tile, I32 radius, F32 intensity);
+
+    Bool32 addLight(Light light);
+    void clearLights();
+    void setDoorsBlockLight(Bool32 doors_block_light);
+    void invalidateTile(I32 abs_tile_x, I32 abs_tile_y);
+
+    inline U8 getLevel(I32 abs_tile_x, I32 abs_tile_y);
+
+    GameWorld *m_world;
+    WorldStreamer *m_streamer;
+    U32 *m_chunk_tiles; // decode buffer for the chunks that aren't resident.
+
+    Bool32 m_is_built;
+    Bool32 m_is_dirty;
+    Bool32 m_doors_block_light;
+    TilePoint m_center;
+    I32 m_window_min_x;
+    I32 m_window_min_y;
+
+    U64 m_opaque[LIGHTING_WINDOW_SIDE];
+    U64 m_field_of_view[LIGHTING_WINDOW_SIDE];
+    U64 m_visible[LIGHTING_WINDOW_SIDE];
+    F32 *m_light_map; // LIGHTING_WINDOW_SIDE floats per row, 16-byte aligned.
+    U8 *m_levels;
+
+    Light m_lights[LIGHTING_MAX_LIGHT_COUNT];
+    U32 m_light_count;
+
+    // stats
+    U64 m_recompute_count;
+    U32 m_last_light_count; // lights that were inside of the window the last time.
+};
+
+inline U8 Lighting::getLevel(I32 abs_tile_x, I32 abs_tile_y)
+{
+    I32 x = abs_tile_x - m_window_min_x;
+    I32 y = abs_tile_y - m_window_min_y;
+    if(!m_is_built || (x < 0) || (y < 0) || (x >= LIGHTING_WINDOW_SIDE) || (y >= LIGHTING_WINDOW_SIDE))
+    {
+        return LIGHTING_FOG_LEVEL;
+    }
+
+    return m_levels[y*LIGHTING_WINDOW_SIDE + x];
+}
+
+#define GAME_LIGHTING_H
+#endif //GAME_LIGHTING_H
@@ -0,0 +1,117 @@
+/* date = October 18th 2023 6:12 pm */
+
+#ifndef GAME_MEMORY_ARENA_H
+
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// NOTE(alexey): Linear allocator on top of the memory that the platform layer gives us.
+// Nothing is freed individually, the whole arena is reset at once.
+// The platform's memory is only reserved address space until it's committed (see Os::commit_memory),
+// an arena with a commit function commits ARENA_COMMIT_STEP at a time, as it grows past what it committed.
+// Committing memory that is committed already is cheap, so an arena that is reinitialized every frame
+// doesn't cost anything more than a call per step. Without a commit function the whole arena is committed already.
+#define ARENA_COMMIT_STEP (16ull*1024*1024)
+
+typedef int32_t (*ArenaCommitPtr)(void *memory, uint64_t size);
+
+struct MemoryArena
+{
+	uint8_t *base;
+	size_t size;
+	size_t used;
+	size_t committed;
+	ArenaCommitPtr commit;
+};
+
+inline void init_arena(MemoryArena *arena, void *base, size_t size, ArenaCommitPtr commit = 0)
+{
+	arena->base = (uint8_t *)base;
+	arena->size = size;
+	arena->used = 0;
+	arena->committed = commit ? 0 : size;
+	arena->commit = commit;
+}
+
+inline void commit_arena(MemoryArena *arena, size_t used)
+{
+	assert(used <= arena->size);
+	size_t committed = ((used + ARENA_COMMIT_STEP - 1) / ARENA_COMMIT_STEP)*ARENA_COMMIT_STEP;
+	if (committed > arena->size)
+		committed = arena->size;
+    
+	int32_t is_committed = arena->commit(arena->base + arena->committed, committed - arena->committed);
+	assert(is_committed);
+	(void)is_committed;
+	arena->committed = committed;
+}
+
+// NOTE(alexey): alignment has to be a power of two.
+inline size_t get_alignment_offset(MemoryArena *arena, size_t alignment)
+{
+	assert(alignment && !(alignment & (alignment - 1)));
+	uintptr_t at = (uintptr_t)(arena->base + arena->used);
+	size_t result = (size_t)((alignment - (at & (alignment - 1))) & (alignment - 1));
+	return result;
+}
+
+inline void *push_size(MemoryArena *arena, size_t size, size_t alignment = 8)
+{
+	size_t offset = get_alignment_offset(arena, alignment);
+	assert((arena->used + offset + size) <= arena->size);
+	if ((arena->used + offset + size) > arena->committed)
+		commit_arena(arena, arena->used + offset + size);
+	void *result = arena->base + arena->used + offset;
+	arena->used += (offset + size);
+	return result;
+}
+
+inline void reset_arena(MemoryArena *arena) { arena->used = 0; }
+
+// NOTE(alexey): Allocator for Array<T, ArenaAllocator>, see game_dynamic_array.h.
+// The last allocation in the arena grows (and is given back) in place, 
+// anything else is copied to the top of the arena and the old memory is left as it is until the arena is reset.
+struct ArenaAllocator
+{
+	ArenaAllocator(MemoryArena *arena_ = 0) : arena(arena_) {}
+    
+	bool is_last(void *memory, size_t size) { return ((uint8_t *)memory + size) == (arena->base + arena->used); }
+    
+	void *allocate(size_t size) 
+	{
+		assert(arena);
+		return push_size(arena, size, 16);
+	}
+    
+	void *reallocate(void *memory, size_t old_size, size_t new_size)
+	{
+		if (is_last(memory, old_size))
+		{
+			assert((arena->used - old_size + new_size) <= arena->size);
+			if ((arena->used - old_size + new_size) > arena->committed)
+				commit_arena(arena, arena->used - old_size + new_size);
+			arena->used = arena->used - old_size + new_size;
+			return memory;
+		}
+        
+		void *result = allocate(new_size);
+		memcpy(result, memory, (old_size < new_size) ? old_size : new_size);
+		return result;
+	}
+    
+	void deallocate(void *memory, size_t size) 
+	{
+		if (is_last(memory, size)) 
+			arena->used -= size;
+	}
+    
+	MemoryArena *arena;
+};
+
+#define push_struct(arena, type, ...) (type *)push_size(arena, sizeof(type), ## __VA_ARGS__)
+#define push_array(arena, count, type, ...) (type *)push_size(arena, (count)*sizeof(type), ## __VA_ARGS__)
+
+#define GAME_MEMORY_ARENA_H
+#endif //GAME_MEMORY_ARENA_H
@@ -0,0 +1,849 @@
+// NOTE(alexey): Direction from a chunk to its neighbour across the side.
+static TilePoint path_side_directions[PathSide_Count] =
+{
+    {-1, 0},
+    {1, 0},
+    {0, -1},
+    {0, 1},
+};
+
+inline PathSide get_opposite_side(PathSide side)
+{
+    PathSide result = (PathSide)(side ^ 1);
+    return result;
+}
+
+inline U32 get_window_node(PathScratch *scratch, TilePoint tile)
+{
+    U32 result = (tile.y - scratch->window_min_y + 1)*scratch->window_stride + (tile.x - scratch->window_min_x + 1);
+    return result;
+}
+
+// NOTE(alexey): Dijkstra over the whole window, with the same moves as the jump point search,
+// from the nodes that are already open.
+function void expand_path_window(PathScratch *scratch)
+{
+    I32 stride = scratch->window_stride;
+    
+    while(scratch->heap_count)
+    {
+        U32 node_index = heap_pop(scratch);
+        F32 g = scratch->nodes[node_index].g;
+        I32 x = (I32)(node_index % stride);
+        I32 y = (I32)(node_index / stride);
+        
+        for(I32 dy = -1; dy <= 1; ++dy)
+        {
+            for(I32 dx = -1; dx <= 1; ++dx)
+            {
+                if((!dx && !dy) || !is_passable(scratch, x + dx, y + dy))
+                {
+                    continue;
+                }
+                
+                if(dx && dy && !(is_passable(scratch, x + dx, y) && is_passable(scratch, x, y + dy)))
+                {
+                    continue;
+                }
+                
+                F32 cost = (dx && dy) ? PATH_DIAGONAL_COST : 1.0f;
+                open_path_node(scratch, (y + dy)*stride + (x + dx), node_index, g + cost, 0.0f);
+            }
+        }
+    }
+}
+
+function void flood_path_window(PathScratch *scratch, U32 start_node)
+{
+    begin_path_search(scratch, PATHFINDER_MAX_NODE_COUNT);
+    open_path_node(scratch, start_node, PATH_NODE_NONE, 0.0f, 0.0f);
+    expand_path_window(scratch);
+}
+
+// NOTE(alexey): Distance from the start of the last flood, F32Max if the tile wasn't reached.
+inline F32 get_flooded_distance(PathScratch *scratch, TilePoint tile)
+{
+    PathNode *node = &scratch->nodes[get_window_node(scratch, tile)];
+    F32 result = (node->search_index == scratch->search_index) ? node->g : F32Max;
+    return result;
+}
+
+void PathGraph::init(MemoryArena *arena, Pathfinder *pathfinder, U32 slot_count)
+{
+    m_pathfinder = pathfinder;
+    m_world = pathfinder->m_world;
+    
+    I32 tile_count_x = m_world->m_tile_count_x;
+    I32 tile_count_y = m_world->m_tile_count_y;
+    
+    // NOTE(alexey): Open runs on a side are at least one closed tile apart, and a run only gets
+    // two entrances when it's long, so a side of n tiles never has more than (n + 1)/2 entrances.
+    m_max_entrance_count = (U32)(tile_count_x + tile_count_y + 2);
+    m_slot_count = slot_count;
+    
+    m_graphs = push_array(arena, slot_count, ChunkGraph);
+    m_free_slots = push_array(arena, slot_count, U32);
+    m_build_list = push_array(arena, slot_count, ChunkGraph *);
+    m_jobs = push_array(arena, pathfinder->m_scratch_count, ChunkGraphJob);
+    for(U32 slot_index = 0; slot_index < slot_count; ++slot_index)
+    {
+        m_free_slots[m_free_slot_count++] = slot_count - slot_index - 1;
+        
+        ChunkGraph *graph = &m_graphs[slot_index];
+        graph->entrances = push_array(arena, m_max_entrance_count, TilePoint);
+        graph->distances = push_array(arena, m_max_entrance_count*m_max_entrance_count, F32);
+        graph->passable = push_array(arena, tile_count_x*tile_count_y, U8);
+    }
+    
+    m_chunk_graphs = push_array(arena, (U64)m_world->m_tile_map_count_x*m_world->m_tile_map_count_y, U32);
+    
+    pathfinder->initScratch(arena, &m_window);
+    
+    m_start_node = slot_count*m_max_entrance_count;
+    m_goal_node = m_start_node + 1;
+    m_node_count = m_goal_node + 1;
+    m_search.nodes = push_array(arena, m_node_count, PathNode, 64);
+    m_search.heap = push_array(arena, m_node_count, PathHeapEntry, 64);
+    
+    m_start_costs = push_array(arena, m_max_entrance_count, F32);
+    m_goal_costs = push_array(arena, m_max_entrance_count, F32);
+    m_abstract_path = push_array(arena, m_node_count, TilePoint);
+    
+    m_max_refined_point_count = (U32)(tile_count_x*tile_count_y);
+    m_refined_points = push_array(arena, m_max_refined_point_count, TilePoint);
+}
+
+void PathGraph::invalidateChunk(I32 tile_map_x, I32 tile_map_y)
+{
+    if((tile_map_x < 0) || (tile_map_y < 0) ||
+       (tile_map_x >= m_world->m_tile_map_count_x) || (tile_map_y >= m_world->m_tile_map_count_y))
+    {
+        return;
+    }
+    
+    U64 chunk_index = (U64)tile_map_y*m_world->m_tile_map_count_x + tile_map_x;
+    U32 slot_number = m_chunk_graphs[chunk_index];
+    if(slot_number)
+    {
+        m_graphs[slot_number - 1].is_used = false;
+        m_chunk_graphs[chunk_index] = 0;
+        m_free_slots[m_free_slot_count++] = slot_number - 1;
+    }
+}
+
+// NOTE(alexey): Entrances only depend on the border tiles of the two chunks of an edge,
+// so a tile on the border invalidates the neighbour across it as well.
+void PathGraph::invalidateTile(I32 abs_tile_x, I32 abs_tile_y)
+{
+    if((abs_tile_x < 0) || (abs_tile_y < 0))
+    {
+        return;
+    }
+    
+    I32 tile_count_x = m_world->m_tile_count_x;
+    I32 tile_count_y = m_world->m_tile_count_y;
+    I32 tile_map_x = abs_tile_x / tile_count_x;
+    I32 tile_map_y = abs_tile_y / tile_count_y;
+    I32 tile_x = abs_tile_x % tile_count_x;
+    I32 tile_y = abs_tile_y % tile_count_y;
+    
+    invalidateChunk(tile_map_x, tile_map_y);
+    
+    if(tile_x == 0)
+    {
+        invalidateChunk(tile_map_x - 1, tile_map_y);
+    }
+    
+    if(tile_x == tile_count_x - 1)
+    {
+        invalidateChunk(tile_map_x + 1, tile_map_y);
+    }
+    
+    if(tile_y == 0)
+    {
+        invalidateChunk(tile_map_x, tile_map_y - 1);
+    }
+    
+    if(tile_y == tile_count_y - 1)
+    {
+        invalidateChunk(tile_map_x, tile_map_y + 1);
+    }
+}
+
+void PathGraph::invalidateAll()
+{
+    for(U32 slot_index = 0; slot_index < m_slot_count; ++slot_index)
+    {
+        ChunkGraph *graph = &m_graphs[slot_index];
+        if(graph->is_used)
+        {
+            invalidateChunk(graph->tile_map_x, graph->tile_map_y);
+        }
+    }
+}
+
+// NOTE(alexey): Takes a free slot, or evicts the least recently used graph.
+// Graphs that the current search uses are never evicted, returns NULL when all of them are.
+ChunkGraph *PathGraph::allocateGraph()
+{
+    if(m_free_slot_count)
+    {
+        return &m_graphs[m_free_slots[--m_free_slot_count]];
+    }
+    
+    ChunkGraph *result = 0;
+    for(U32 slot_index = 0; slot_index < m_slot_count; ++slot_index)
+    {
+        ChunkGraph *graph = &m_graphs[slot_index];
+        if((graph->last_search_index != m_search.search_index) &&
+           (!result || (graph->last_search_index < result->last_search_index)))
+        {
+            result = graph;
+        }
+    }
+    
+    if(result)
+    {
+        invalidateChunk(result->tile_map_x, result->tile_map_y);
+        --m_free_slot_count;
+        ++m_evicted_graph_count;
+    }
+    
+    return result;
+}
+
+ChunkGraph *PathGraph::getChunkGraph(I32 tile_map_x, I32 tile_map_y, Bool32 *out_of_slots)
+{
+    if((tile_map_x < 0) || (tile_map_y < 0) ||
+       (tile_map_x >= m_world->m_tile_map_count_x) || (tile_map_y >= m_world->m_tile_map_count_y))
+    {
+        return 0;
+    }
+    
+    U64 chunk_index = (U64)tile_map_y*m_world->m_tile_map_count_x + tile_map_x;
+    U32 slot_number = m_chunk_graphs[chunk_index];
+    
+    ChunkGraph *graph = 0;
+    if(slot_number)
+    {
+        graph = &m_graphs[slot_number - 1];
+        if(graph->is_partial && (graph->last_search_index != m_search.search_index))
+        {
+            BEGIN_TIMED_BLOCK(BuildChunkGraph);
+            buildChunkGraph(&m_window, graph);
+            END_TIMED_BLOCK(BuildChunkGraph);
+        }
+    }
+    else
+    {
+        graph = allocateGraph();
+        if(!graph)
+        {
+            *out_of_slots = true;
+            return 0;
+        }
+        
+        graph->is_used = true;
+        graph->tile_map_x = tile_map_x;
+        graph->tile_map_y = tile_map_y;
+        m_chunk_graphs[chunk_index] = (U32)(graph - m_graphs) + 1;
+        
+        BEGIN_TIMED_BLOCK(BuildChunkGraph);
+        buildChunkGraph(&m_window, graph);
+        END_TIMED_BLOCK(BuildChunkGraph);
+    }
+    
+    graph->last_search_index = m_search.search_index;
+    return graph;
+}
+
+// NOTE(alexey): Window of exactly the chunk, from the passability that was kept when the graph was built.
+void PathGraph::loadChunkWindow(PathScratch *scratch, ChunkGraph *graph)
+{
+    I32 tile_count_x = m_world->m_tile_count_x;
+    I32 tile_count_y = m_world->m_tile_count_y;
+    I32 stride = tile_count_x + 2;
+    
+    scratch->window_min_x = graph->tile_map_x*tile_count_x;
+    scratch->window_min_y = graph->tile_map_y*tile_count_y;
+    scratch->window_stride = stride;
+    
+    memset(scratch->passable, 0, stride);
+    memset(scratch->passable + (tile_count_y + 1)*stride, 0, stride);
+    for(I32 tile_y = 0; tile_y < tile_count_y; ++tile_y)
+    {
+        U8 *row = scratch->passable + (tile_y + 1)*stride;
+        row[0] = 0;
+        memcpy(row + 1, graph->passable + tile_y*tile_count_x, tile_count_x);
+        row[tile_count_x + 1] = 0;
+    }
+}
+
+// NOTE(alexey): Runs on the compute queue's threads as well (see prepareRegion),
+// it only writes to the graph and the scratch.
+void PathGraph::buildChunkGraph(PathScratch *scratch, ChunkGraph *graph)
+{
+    U64 start_counts = os->get_qpc();
+    
+    I32 tile_count_x = m_world->m_tile_count_x;
+    I32 tile_count_y = m_world->m_tile_count_y;
+    I32 min_x = graph->tile_map_x*tile_count_x;
+    I32 min_y = graph->tile_map_y*tile_count_y;
+    I32 max_x = min_x + tile_count_x - 1;
+    I32 max_y = min_y + tile_count_y - 1;
+    
+    // NOTE(alexey): The chunk with a tile of the neighbours around it, to see which border tiles open into them.
+    // Outside of the world it's the window's wall border.
+    I32 world_tile_count_x = m_world->m_tile_map_count_x*tile_count_x;
+    I32 world_tile_count_y = m_world->m_tile_map_count_y*tile_count_y;
+    Bool32 is_complete = m_pathfinder->buildWindow(scratch,
+                                                   Maximum(min_x - 1, 0),
+                                                   Maximum(min_y - 1, 0),
+                                                   Minimum(max_x + 2, world_tile_count_x),
+                                                   Minimum(max_y + 2, world_tile_count_y));
+    
+    graph->entrance_count = 0;
+    for(U32 side = 0; side < PathSide_Count; ++side)
+    {
+        graph->first_entrance[side] = graph->entrance_count;
+        
+        TilePoint out = path_side_directions[side];
+        TilePoint along = out.x ? TilePoint{0, 1} : TilePoint{1, 0};
+        TilePoint first = {(out.x > 0) ? max_x : min_x, (out.y > 0) ? max_y : min_y};
+        I32 length = out.x ? tile_count_y : tile_count_x;
+        
+        I32 run_start = -1;
+        for(I32 position = 0; position <= length; ++position)
+        {
+            Bool32 is_open = false;
+            if(position < length)
+            {
+                TilePoint tile = {first.x + position*along.x, first.y + position*along.y};
+                U32 node = get_window_node(scratch, tile);
+                U32 out_node = node + out.y*scratch->window_stride + out.x;
+                is_open = (scratch->passable[node] && scratch->passable[out_node]);
+            }
+            
+            if(is_open && (run_start < 0))
+            {
+                run_start = position;
+            }
+            else if(!is_open && (run_start >= 0))
+            {
+                I32 run_end = position - 1;
+                I32 entrance_positions[2] = {(run_start + run_end) / 2};
+                U32 entrance_position_count = 1;
+                if(run_end - run_start + 1 >= PATH_GRAPH_LONG_ENTRANCE_LENGTH)
+                {
+                    entrance_positions[0] = run_start;
+                    entrance_positions[1] = run_end;
+                    entrance_position_count = 2;
+                }
+                
+                for(U32 index = 0; index < entrance_position_count; ++index)
+                {
+                    assert(graph->entrance_count < m_max_entrance_count);
+                    graph->entrances[graph->entrance_count++] = {first.x + entrance_positions[index]*along.x,
+                                                                 first.y + entrance_positions[index]*along.y};
+                }
+                
+                run_start = -1;
+            }
+        }
+    }
+    
+    graph->first_entrance[PathSide_Count] = graph->entrance_count;
+    graph->is_partial = !is_complete;
+    
+    // NOTE(alexey): Distances inside of the chunk only, the paths that leave it are found by the abstract search.
+    for(I32 tile_y = 0; tile_y < tile_count_y; ++tile_y)
+    {
+        U8 *row = scratch->passable + get_window_node(scratch, {min_x, min_y + tile_y});
+        memcpy(graph->passable + tile_y*tile_count_x, row, tile_count_x);
+    }
+    loadChunkWindow(scratch, graph);
+    
+    for(U32 from = 0; from < graph->entrance_count; ++from)
+    {
+        F32 *distances = graph->distances + from*m_max_entrance_count;
+        flood_path_window(scratch, get_window_node(scratch, graph->entrances[from]));
+        for(U32 to = 0; to < graph->entrance_count; ++to)
+        {
+            distances[to] = get_flooded_distance(scratch, graph->entrances[to]);
+        }
+    }
+    
+    atomic_add_uint64(&m_built_graph_count, 1);
+    atomic_add_uint64(&m_build_counts, os->get_qpc() - start_counts);
+}
+
+// NOTE(alexey): Distances from the point to the entrances of its chunk, and to the other point
+// if it's in the same chunk (other_cost isn't NULL then). Returns false if the point isn't passable.
+Bool32 PathGraph::connectPoint(ChunkGraph *graph, TilePoint point, F32 *costs, TilePoint other, F32 *other_cost)
+{
+    loadChunkWindow(&m_window, graph);
+    
+    U32 node = get_window_node(&m_window, point);
+    if(!m_window.passable[node])
+    {
+        return false;
+    }
+    
+    flood_path_window(&m_window, node);
+    for(U32 entrance_index = 0; entrance_index < graph->entrance_count; ++entrance_index)
+    {
+        costs[entrance_index] = get_flooded_distance(&m_window, graph->entrances[entrance_index]);
+    }
+    
+    if(other_cost)
+    {
+        *other_cost = get_flooded_distance(&m_window, other);
+    }
+    
+    return true;
+}
+
+TilePoint PathGraph::getNodeTile(U32 node)
+{
+    TilePoint result;
+    if(node == m_start_node)
+    {
+        result = m_start;
+    }
+    else if(node == m_goal_node)
+    {
+        result = m_goal;
+    }
+    else
+    {
+        result = m_graphs[node / m_max_entrance_count].entrances[node % m_max_entrance_count];
+    }
+    
+    return result;
+}
+
+void PathGraph::openNode(U32 node, U32 parent, F32 g, TilePoint tile)
+{
+    open_path_node(&m_search, node, parent, g, octile_distance(tile.x, tile.y, m_goal.x, m_goal.y));
+}
+
+// NOTE(alexey): Merges the point into the last segment when the path goes on in the same direction.
+// Returns false when the query is out of points.
+Bool32 PathGraph::appendPoint(PathQuery *query, TilePoint point)
+{
+    U32 count = query->point_count;
+    if(count >= 2)
+    {
+        TilePoint a = query->points[count - 2];
+        TilePoint b = query->points[count - 1];
+        if((sign_i32(b.x - a.x) == sign_i32(point.x - b.x)) && (sign_i32(b.y - a.y) == sign_i32(point.y - b.y)))
+        {
+            query->points[count - 1] = point;
+            return true;
+        }
+    }
+    
+    if(count == query->max_point_count)
+    {
+        return false;
+    }
+    
+    query->points[query->point_count++] = point;
+    return true;
+}
+
+// NOTE(alexey): Steps between the chunks are single straight moves across the edge,
+// the steps inside of a chunk are searched again in the chunk's window.
+void PathGraph::refinePath(PathQuery *query, U32 abstract_point_count)
+{
+    I32 tile_count_x = m_world->m_tile_count_x;
+    I32 tile_count_y = m_world->m_tile_count_y;
+    
+    appendPoint(query, m_abstract_path[0]);
+    for(U32 point_index = 1; point_index < abstract_point_count; ++point_index)
+    {
+        TilePoint from = m_abstract_path[point_index - 1];
+        TilePoint to = m_abstract_path[point_index];
+        if((from.x == to.x) && (from.y == to.y))
+        {
+            continue;
+        }
+        
+        I32 tile_map_x = from.x / tile_count_x;
+        I32 tile_map_y = from.y / tile_count_y;
+        if((tile_map_x != to.x / tile_count_x) || (tile_map_y != to.y / tile_count_y))
+        {
+            if(!appendPoint(query, to))
+            {
+                query->status = PathStatus_OutOfPoints;
+                return;
+            }
+            
+            continue;
+        }
+        
+        PathQuery step = {};
+        step.start = from;
+        step.goal = to;
+        step.points = m_refined_points;
+        step.max_point_count = m_max_refined_point_count;
+        
+        // NOTE(alexey): The graphs of the current search are never evicted, so this one is still there.
+        Bool32 out_of_slots = false;
+        loadChunkWindow(&m_window, getChunkGraph(tile_map_x, tile_map_y, &out_of_slots));
+        m_pathfinder->searchWindow(&m_window, &step);
+        
+        // NOTE(alexey): The distances came from the same window, so the step always exists.
+        assert(step.status == PathStatus_Found);
+        if(step.status != PathStatus_Found)
+        {
+            query->status = PathStatus_NotFound;
+            return;
+        }
+        
+        for(U32 step_point_index = 1; step_point_index < step.point_count; ++step_point_index)
+        {
+            if(!appendPoint(query, step.points[step_point_index]))
+            {
+                query->status = PathStatus_OutOfPoints;
+                return;
+            }
+        }
+    }
+    
+    query->status = PathStatus_Found;
+}
+
+void PathGraph::findPath(PathQuery *query)
+{
+    query->status = PathStatus_Pending;
+    query->point_count = 0;
+    query->length = 0.0f;
+    
+    I32 tile_count_x = m_world->m_tile_count_x;
+    I32 tile_count_y = m_world->m_tile_count_y;
+    I32 world_tile_count_x = m_world->m_tile_map_count_x*tile_count_x;
+    I32 world_tile_count_y = m_world->m_tile_map_count_y*tile_count_y;
+    
+    TilePoint start = query->start;
+    TilePoint goal = query->goal;
+    if((start.x < 0) || (start.y < 0) || (start.x >= world_tile_count_x) || (start.y >= world_tile_count_y) ||
+       (goal.x < 0) || (goal.y < 0) || (goal.x >= world_tile_count_x) || (goal.y >= world_tile_count_y))
+    {
+        query->status = PathStatus_NotFound;
+        return;
+    }
+    
+    I32 start_tile_map_x = start.x / tile_count_x;
+    I32 start_tile_map_y = start.y / tile_count_y;
+    I32 goal_tile_map_x = goal.x / tile_count_x;
+    I32 goal_tile_map_y = goal.y / tile_count_y;
+    
+    // NOTE(alexey): The flat search only looks at a window around the two points,
+    // if it doesn't find anything the path could still go around.
+    if((abs(start_tile_map_x - goal_tile_map_x) <= PATH_GRAPH_FLAT_SEARCH_RADIUS) &&
+       (abs(start_tile_map_y - goal_tile_map_y) <= PATH_GRAPH_FLAT_SEARCH_RADIUS))
+    {
+        m_pathfinder->findPath(&m_window, query);
+        if(query->status != PathStatus_NotFound)
+        {
+            return;
+        }
+    }
+    
+    m_start = start;
+    m_goal = goal;
+    begin_path_search(&m_search, m_node_count);
+    
+    Bool32 out_of_slots = false;
+    ChunkGraph *start_graph = getChunkGraph(start_tile_map_x, start_tile_map_y, &out_of_slots);
+    ChunkGraph *goal_graph = getChunkGraph(goal_tile_map_x, goal_tile_map_y, &out_of_slots);
+    
+    F32 direct_cost = F32Max;
+    if(!start_graph || !goal_graph ||
+       !connectPoint(start_graph, start, m_start_costs, goal, (start_graph == goal_graph) ? &direct_cost : 0) ||
+       !connectPoint(goal_graph, goal, m_goal_costs, start, 0))
+    {
+        query->status = PathStatus_NotFound;
+        return;
+    }
+    
+    U32 start_slot_index = (U32)(start_graph - m_graphs);
+    openNode(m_start_node, PATH_NODE_NONE, 0.0f, start);
+    
+    while(m_search.heap_count)
+    {
+        U32 node_index = heap_pop(&m_search);
+        F32 g = m_search.nodes[node_index].g;
+        
+        if(node_index == m_goal_node)
+        {
+            U32 abstract_point_count = 0;
+            for(U32 path_node = m_goal_node; path_node != PATH_NODE_NONE; path_node = m_search.nodes[path_node].parent)
+            {
+                ++abstract_point_count;
+            }
+            
+            U32 point_index = abstract_point_count;
+            for(U32 path_node = m_goal_node; path_node != PATH_NODE_NONE; path_node = m_search.nodes[path_node].parent)
+            {
+                m_abstract_path[--point_index] = getNodeTile(path_node);
+            }
+            
+            query->length = g;
+            refinePath(query, abstract_point_count);
+            return;
+        }
+        
+        if(node_index == m_start_node)
+        {
+            for(U32 entrance_index = 0; entrance_index < start_graph->entrance_count; ++entrance_index)
+            {
+                if(m_start_costs[entrance_index] < F32Max)
+                {
+                    openNode(start_slot_index*m_max_entrance_count + entrance_index, node_index,
+                             m_start_costs[entrance_index], start_graph->entrances[entrance_index]);
+                }
+            }
+            
+            if(direct_cost < F32Max)
+            {
+                openNode(m_goal_node, node_index, direct_cost, goal);
+            }
+            
+            continue;
+        }
+        
+        U32 slot_index = node_index / m_max_entrance_count;
+        U32 entrance_index = node_index % m_max_entrance_count;
+        ChunkGraph *graph = &m_graphs[slot_index];
+        
+        if((graph == goal_graph) && (m_goal_costs[entrance_index] < F32Max))
+        {
+            openNode(m_goal_node, node_index, g + m_goal_costs[entrance_index], goal);
+        }
+        
+        F32 *distances = graph->distances + entrance_index*m_max_entrance_count;
+        for(U32 other_index = 0; other_index < graph->entrance_count; ++other_index)
+        {
+            if((other_index != entrance_index) && (distances[other_index] < F32Max))
+            {
+                openNode(slot_index*m_max_entrance_count + other_index, node_index,
+                         g + distances[other_index], graph->entrances[other_index]);
+            }
+        }
+        
+        // NOTE(alexey): A straight step across the edge, into the entrance with the same index on the other side.
+        U32 side = 0;
+        while(entrance_index >= graph->first_entrance[side + 1])
+        {
+            ++side;
+        }
+        
+        TilePoint direction = path_side_directions[side];
+        ChunkGraph *neighbour = getChunkGraph(graph->tile_map_x + direction.x, graph->tile_map_y + direction.y,
+                                              &out_of_slots);
+        if(neighbour)
+        {
+            PathSide opposite = get_opposite_side((PathSide)side);
+            U32 partner_index = neighbour->first_entrance[opposite] + (entrance_index - graph->first_entrance[side]);
+            if(partner_index < neighbour->first_entrance[opposite + 1])
+            {
+                TilePoint tile = graph->entrances[entrance_index];
+                TilePoint partner_tile = neighbour->entrances[partner_index];
+                assert((partner_tile.x == tile.x + direction.x) && (partner_tile.y == tile.y + direction.y));
+                
+                openNode((U32)(neighbour - m_graphs)*m_max_entrance_count + partner_index, node_index,
+                         g + 1.0f, partner_tile);
+            }
+        }
+    }
+    
+    // NOTE(alexey): Running out of slots means the search needed more of the world than the cache holds.
+    query->status = out_of_slots ? PathStatus_TooFar : PathStatus_NotFound;
+}
+
+// NOTE(alexey): Runs on the compute queue's threads and on the main thread.
+function void build_chunk_graphs_work(WorkQueue *queue, void *data)
+{
+    ChunkGraphJob *job = (ChunkGraphJob *)data;
+    for(U32 graph_index = 0; graph_index < job->graph_count; ++graph_index)
+    {
+        job->path_graph->buildChunkGraph(job->scratch, job->graphs[graph_index]);
+    }
+}
+
+// NOTE(alexey): Makes sure every chunk in the region has an up to date graph, and marks them as used by the current search.
+// Slots are taken on the main thread, the missing graphs are built on the compute queue.
+// Returns false if the region doesn't fit into the slots.
+Bool32 PathGraph::prepareRegion(ChunkRect region)
+{
+    Bool32 result = true;
+    
+    U32 build_count = 0;
+    for(I32 tile_map_y = region.min_tile_map_y; result && (tile_map_y <= region.max_tile_map_y); ++tile_map_y)
+    {
+        for(I32 tile_map_x = region.min_tile_map_x; tile_map_x <= region.max_tile_map_x; ++tile_map_x)
+        {
+            U64 chunk_index = (U64)tile_map_y*m_world->m_tile_map_count_x + tile_map_x;
+            U32 slot_number = m_chunk_graphs[chunk_index];
+            
+            ChunkGraph *graph = 0;
+            if(slot_number)
+            {
+                graph = &m_graphs[slot_number - 1];
+                if(graph->is_partial && (graph->last_search_index != m_search.search_index))
+                {
+                    m_build_list[build_count++] = graph;
+                }
+            }
+            else
+            {
+                graph = allocateGraph();
+                if(!graph)
+                {
+                    result = false;
+                    break;
+                }
+                
+                graph->is_used = true;
+                graph->tile_map_x = tile_map_x;
+                graph->tile_map_y = tile_map_y;
+                m_chunk_graphs[chunk_index] = (U32)(graph - m_graphs) + 1;
+                m_build_list[build_count++] = graph;
+            }
+            
+            graph->last_search_index = m_search.search_index;
+        }
+    }
+    
+    BEGIN_TIMED_BLOCK(BuildChunkGraph);
+    
+    U32 job_count = Minimum(m_pathfinder->m_scratch_count, build_count);
+    for(U32 job_index = 0; job_index < job_count; ++job_index)
+    {
+        U32 first_graph = (U32)(((U64)build_count*job_index) / job_count);
+        U32 one_past_last_graph = (U32)(((U64)build_count*(job_index + 1)) / job_count);
+        
+        ChunkGraphJob *job = &m_jobs[job_index];
+        job->path_graph = this;
+        job->scratch = &m_pathfinder->m_scratches[job_index];
+        job->graphs = m_build_list + first_graph;
+        job->graph_count = one_past_last_graph - first_graph;
+        
+        if((job_index == job_count - 1) || !os->add_work_entry(os->compute_queue, build_chunk_graphs_work, job))
+        {
+            build_chunk_graphs_work(0, job);
+        }
+    }
+    
+    os->complete_all_work(os->compute_queue);
+    
+    END_TIMED_BLOCK_COUNTED(BuildChunkGraph, build_count);
+    
+    return result;
+}
+
+// NOTE(alexey): Graph of the chunk if the last search used it, NULL otherwise.
+ChunkGraph *PathGraph::getSearchedGraph(I32 tile_map_x, I32 tile_map_y)
+{
+    if((tile_map_x < 0) || (tile_map_y < 0) ||
+       (tile_map_x >= m_world->m_tile_map_count_x) || (tile_map_y >= m_world->m_tile_map_count_y))
+    {
+        return 0;
+    }
+    
+    U32 slot_number = m_chunk_graphs[(U64)tile_map_y*m_world->m_tile_map_count_x + tile_map_x];
+    ChunkGraph *result = 0;
+    if(slot_number && (m_graphs[slot_number - 1].last_search_index == m_search.search_index))
+    {
+        result = &m_graphs[slot_number - 1];
+    }
+    
+    return result;
+}
+
+// NOTE(alexey): Distance from the entrance to the point of the last searchFromPoint, F32Max if it wasn't reached.
+F32 PathGraph::getEntranceDistance(ChunkGraph *graph, U32 entrance_index)
+{
+    PathNode *node = &m_search.nodes[(U32)(graph - m_graphs)*m_max_entrance_count + entrance_index];
+    F32 result = (node->search_index == m_search.search_index) ? node->g : F32Max;
+    return result;
+}
+
+// NOTE(alexey): Dijkstra from the point over the entrances of the chunks in the region (inclusive),
+// the paths never leave the region. The distances are read with getEntranceDistance afterwards.
+// Returns false if the point isn't passable or the region doesn't fit into the slots.
+Bool32 PathGraph::searchFromPoint(TilePoint point, ChunkRect region)
+{
+    I32 tile_count_x = m_world->m_tile_count_x;
+    I32 tile_count_y = m_world->m_tile_count_y;
+    
+    begin_path_search(&m_search, m_node_count);
+    if(!prepareRegion(region))
+    {
+        return false;
+    }
+    
+    ChunkGraph *point_graph = getSearchedGraph(point.x / tile_count_x, point.y / tile_count_y);
+    if(!point_graph || !connectPoint(point_graph, point, m_start_costs, point, 0))
+    {
+        return false;
+    }
+    
+    U32 point_slot_index = (U32)(point_graph - m_graphs);
+    for(U32 entrance_index = 0; entrance_index < point_graph->entrance_count; ++entrance_index)
+    {
+        if(m_start_costs[entrance_index] < F32Max)
+        {
+            open_path_node(&m_search, point_slot_index*m_max_entrance_count + entrance_index, PATH_NODE_NONE,
+                           m_start_costs[entrance_index], 0.0f);
+        }
+    }
+    
+    while(m_search.heap_count)
+    {
+        U32 node_index = heap_pop(&m_search);
+        F32 g = m_search.nodes[node_index].g;
+        
+        U32 slot_index = node_index / m_max_entrance_count;
+        U32 entrance_index = node_index % m_max_entrance_count;
+        ChunkGraph *graph = &m_graphs[slot_index];
+        
+        F32 *distances = graph->distances + entrance_index*m_max_entrance_count;
+        for(U32 other_index = 0; other_index < graph->entrance_count; ++other_index)
+        {
+            if((other_index != entrance_index) && (distances[other_index] < F32Max))
+            {
+                open_path_node(&m_search, slot_index*m_max_entrance_count + other_index, node_index,
+                               g + distances[other_index], 0.0f);
+            }
+        }
+        
+        U32 side = 0;
+        while(entrance_index >= graph->first_entrance[side + 1])
+        {
+            ++side;
+        }
+        
+        TilePoint direction = path_side_directions[side];
+        I32 neighbour_x = graph->tile_map_x + direction.x;
+        I32 neighbour_y = graph->tile_map_y + direction.y;
+        if((neighbour_x < region.min_tile_map_x) || (neighbour_y < region.min_tile_map_y) ||
+           (neighbour_x > region.max_tile_map_x) || (neighbour_y > region.max_tile_map_y))
+        {
+            continue;
+        }
+        
+        ChunkGraph *neighbour = getSearchedGraph(neighbour_x, neighbour_y);
+        PathSide opposite = get_opposite_side((PathSide)side);
+        U32 partner_index = neighbour->first_entrance[opposite] + (entrance_index - graph->first_entrance[side]);
+        if(partner_index < neighbour->first_entrance[opposite + 1])
+        {
+            open_path_node(&m_search, (U32)(neighbour - m_graphs)*m_max_entrance_count + partner_index, node_index,
+                           g + 1.0f, 0.0f);
+        }
+    }
+    
+    return true;
+}
@@ -0,0 +1,151 @@
+/* date = October 23rd 2023 4:20 pm */
+#ifndef GAME_PATH_GRAPH_H
+
+/*
+  Hierarchical pathfinding (HPA*) on top of Pathfinder, for the paths that go across many tile maps.
+
+  Every tile map (chunk) gets a small graph: entrances on its edges and the distances between them.
+  An entrance is a border tile that is passable together with the neighbour's tile across the edge,
+  every run of such tiles gets one entrance in the middle, or two at the ends if the run is long.
+  Both chunks of an edge find the same runs, so the entrance on the other side of the edge
+  is always the one with the same index on the neighbour's opposite side.
+  Distances between the entrances are the shortest paths inside of the chunk.
+
+  A search connects the start and the goal to the entrances of their chunks, runs A* over the entrances,
+  and refines every step of the abstract path with a jump point search inside of a single chunk.
+  The paths are within a few percent of the shortest ones, the detours come from the entrance placement.
+  Short queries try the flat search first.
+
+  Graphs are built the first time a search needs them, and kept in a fixed budget of slots,
+  the least recently used one is evicted. Chunks are read through Pathfinder::getChunkTiles,
+  so in the mapped and the loaded modes the graphs cover the whole world, not only the tile maps around the player.
+  The only memory that depends on the world size is the slot lookup, 4 bytes per chunk.
+
+  Whoever changes a tile calls invalidateTile, that throws away the graph of its chunk
+  (and of the neighbour, if the tile is on the border), it's rebuilt when a search needs it again.
+  Graphs built while some of the chunks couldn't be read (streamed mode) are rebuilt on every new search.
+
+  searchFromPoint gives the distances from all the entrances in a region to a single point,
+  it's what the flow fields (game_flow_field.h) are built from. The region's graphs are built
+  on the compute queue, everything else runs on the main thread.
+*/
+
+// NOTE(alexey): Memory of a slot depends on the tile map size, it's around 4KB for 17x9 tile maps.
+#define PATH_GRAPH_SLOT_COUNT 4096
+
+// NOTE(alexey): Runs of open border tiles at least this long get an entrance at each end.
+#define PATH_GRAPH_LONG_ENTRANCE_LENGTH 6
+
+// NOTE(alexey): Queries with the start and the goal at most this many tile maps apart
+// try the flat search first, it's faster than connecting them to the graph.
+#define PATH_GRAPH_FLAT_SEARCH_RADIUS 2
+
+enum PathSide
+{
+    PathSide_West,
+    PathSide_East,
+    PathSide_South,
+    PathSide_North,
+
+    PathSide_Count,
+};
+
+struct ChunkGraph
+{
+    Bool32 is_used;
+    Bool32 is_partial; // some of the chunks couldn't be read when the graph was built.
+
+    I32 tile_map_x;
+    I32 tile_map_y;
+
+    // NOTE(alexey): Entrances of a side are [first_entrance[side], first_entrance[side + 1]),
+    // in the order along the side. Entrances are absolute tiles inside of the chunk.
+    U32 entrance_count;
+    U32 first_entrance[PathSide_Count + 1];
+    TilePoint *entrances;
+
+    // NOTE(alexey): Row per entrance, PathGraph::m_max_entrance_count wide.
+    // F32Max when there is no path between the two entrances inside of the chunk.
+    F32 *distances;
+
+    // NOTE(alexey): Passability of the chunk's tiles, the bottom row first, so connecting the points
+    // and refining the paths never have to read (and decode) the chunk again.
+    U8 *passable;
+
+    // NOTE(alexey): Search index of the last search that used the graph (least recently used goes first).
+    U32 last_search_index;
+};
+
+struct PathGraph;
+
+struct ChunkGraphJob
+{
+    PathGraph *path_graph;
+    PathScratch *scratch;
+    ChunkGraph **graphs;
+    U32 graph_count;
+};
+
+struct PathGraph
+{
+    void init(MemoryArena *arena, Pathfinder *pathfinder, U32 slot_count);
+    void findPath(PathQuery *query);
+    void invalidateTile(I32 abs_tile_x, I32 abs_tile_y);
+    void invalidateChunk(I32 tile_map_x, I32 tile_map_y);
+    void invalidateAll();
+
+    // NOTE(alexey): The region has to be inside of the world.
+    Bool32 searchFromPoint(TilePoint point, ChunkRect region);
+    Bool32 prepareRegion(ChunkRect region);
+    ChunkGraph *getSearchedGraph(I32 tile_map_x, I32 tile_map_y);
+    F32 getEntranceDistance(ChunkGraph *graph, U32 entrance_index);
+
+    ChunkGraph *getChunkGraph(I32 tile_map_x, I32 tile_map_y, Bool32 *out_of_slots);
+    ChunkGraph *allocateGraph();
+    void buildChunkGraph(PathScratch *scratch, ChunkGraph *graph);
+    void loadChunkWindow(PathScratch *scratch, ChunkGraph *graph);
+    Bool32 connectPoint(ChunkGraph *graph, TilePoint point, F32 *costs, TilePoint other, F32 *other_cost);
+    void openNode(U32 node, U32 parent, F32 g, TilePoint tile);
+    TilePoint getNodeTile(U32 node);
+    Bool32 appendPoint(PathQuery *query, TilePoint point);
+    void refinePath(PathQuery *query, U32 abstract_point_count);
+
+    Pathfinder *m_pathfinder;
+    GameWorld *m_world;
+
+    // NOTE(alexey): m_window is for the windows of single chunks (building the graphs and refining the paths).
+    // m_search is the abstract search, a node for every entrance of every slot, and two more for the start and the goal,
+    // only its nodes and its heap are used.
+    PathScratch m_window;
+    PathScratch m_search;
+    U32 m_node_count;
+    U32 m_start_node;
+    U32 m_goal_node;
+    TilePoint m_start;
+    TilePoint m_goal;
+
+    // NOTE(alexey): Slot index + 1 for each chunk, 0 when there is none.
+    U32 *m_chunk_graphs;
+    ChunkGraph *m_graphs;
+    U32 m_slot_count;
+    U32 m_max_entrance_count;
+    U32 *m_free_slots;
+    U32 m_free_slot_count;
+
+    ChunkGraph **m_build_list;
+    ChunkGraphJob *m_jobs;
+
+    F32 *m_start_costs;
+    F32 *m_goal_costs;
+    TilePoint *m_abstract_path;
+    TilePoint *m_refined_points;
+    U32 m_max_refined_point_count;
+
+    // stats
+    U64 volatile m_built_graph_count;
+    U64 volatile m_build_counts;
+    U64 m_evicted_graph_count;
+};
+
+#define GAME_PATH_GRAPH_H
+#endif //GAME_PATH_GRAPH_H
@@ -0,0 +1,597 @@
+#define PATH_NODE_NONE Uint32Max
+#define PATH_NODE_CLOSED Uint32Max
+#define PATH_NODE_NOT_IN_HEAP (Uint32Max - 1)
+
+#define PATH_DIAGONAL_COST 1.41421356f
+
+#define PATHFINDER_MAX_NODE_COUNT ((PATHFINDER_MAX_WINDOW_SIDE + 2)*(PATHFINDER_MAX_WINDOW_SIDE + 2))
+
+inline F32 octile_distance(I32 ax, I32 ay, I32 bx, I32 by)
+{
+    I32 dx = abs(ax - bx);
+    I32 dy = abs(ay - by);
+    F32 result = (dx > dy) ?
+        ((F32)(dx - dy) + PATH_DIAGONAL_COST*(F32)dy) :
+        ((F32)(dy - dx) + PATH_DIAGONAL_COST*(F32)dx);
+    return result;
+}
+
+inline I32 sign_i32(I32 value)
+{
+    I32 result = (value > 0) - (value < 0);
+    return result;
+}
+
+inline Bool32 is_passable(PathScratch *scratch, I32 x, I32 y)
+{
+    Bool32 result = scratch->passable[y*scratch->window_stride + x];
+    return result;
+}
+
+// NOTE(alexey): Open list is a binary min-heap on f, nodes remember where in the heap they are,
+// so a cheaper path to a node that is already open just moves it up.
+function void heap_move_up(PathScratch *scratch, U32 heap_index)
+{
+    PathHeapEntry entry = scratch->heap[heap_index];
+    while(heap_index)
+    {
+        U32 parent_index = (heap_index - 1) / 2;
+        PathHeapEntry parent = scratch->heap[parent_index];
+        if(parent.f <= entry.f)
+        {
+            break;
+        }
+        
+        scratch->heap[heap_index] = parent;
+        scratch->nodes[parent.node].heap_index = heap_index;
+        heap_index = parent_index;
+    }
+    
+    scratch->heap[heap_index] = entry;
+    scratch->nodes[entry.node].heap_index = heap_index;
+}
+
+function U32 heap_pop(PathScratch *scratch)
+{
+    U32 result = scratch->heap[0].node;
+    
+    PathHeapEntry entry = scratch->heap[--scratch->heap_count];
+    U32 heap_index = 0;
+    for(;;)
+    {
+        U32 child_index = 2*heap_index + 1;
+        if(child_index >= scratch->heap_count)
+        {
+            break;
+        }
+        
+        if((child_index + 1 < scratch->heap_count) &&
+           (scratch->heap[child_index + 1].f < scratch->heap[child_index].f))
+        {
+            ++child_index;
+        }
+        
+        if(entry.f <= scratch->heap[child_index].f)
+        {
+            break;
+        }
+        
+        scratch->heap[heap_index] = scratch->heap[child_index];
+        scratch->nodes[scratch->heap[heap_index].node].heap_index = heap_index;
+        heap_index = child_index;
+    }
+    
+    if(scratch->heap_count)
+    {
+        scratch->heap[heap_index] = entry;
+        scratch->nodes[entry.node].heap_index = heap_index;
+    }
+    
+    scratch->nodes[result].heap_index = PATH_NODE_CLOSED;
+    return result;
+}
+
+// NOTE(alexey): Walks from (x, y) in the direction (dx, dy) until it hits a wall (no jump point),
+// the goal, or a tile with a forced neighbour (jump point).
+// Diagonal walks stop at the tiles where either of the straight walks would find a jump point.
+function Bool32 jump(PathScratch *scratch, I32 x, I32 y, I32 dx, I32 dy, I32 *jump_x, I32 *jump_y)
+{
+    for(;;)
+    {
+        // NOTE(alexey): No cutting the corners, a diagonal step needs both straight neighbours to be free.
+        if(dx && dy && !(is_passable(scratch, x + dx, y) && is_passable(scratch, x, y + dy)))
+        {
+            return false;
+        }
+        
+        x += dx;
+        y += dy;
+        if(!is_passable(scratch, x, y))
+        {
+            return false;
+        }
+        
+        Bool32 is_jump_point = ((x == scratch->goal.x) && (y == scratch->goal.y));
+        if(!is_jump_point)
+        {
+            if(dx && dy)
+            {
+                I32 ignored_x, ignored_y;
+                is_jump_point = (jump(scratch, x, y, dx, 0, &ignored_x, &ignored_y) ||
+                                 jump(scratch, x, y, 0, dy, &ignored_x, &ignored_y));
+            }
+            else if(dx)
+            {
+                is_jump_point = ((is_passable(scratch, x, y - 1) && !is_passable(scratch, x - dx, y - 1)) ||
+                                 (is_passable(scratch, x, y + 1) && !is_passable(scratch, x - dx, y + 1)));
+            }
+            else
+            {
+                is_jump_point = ((is_passable(scratch, x - 1, y) && !is_passable(scratch, x - 1, y - dy)) ||
+                                 (is_passable(scratch, x + 1, y) && !is_passable(scratch, x + 1, y - dy)));
+            }
+        }
+        
+        if(is_jump_point)
+        {
+            *jump_x = x;
+            *jump_y = y;
+            return true;
+        }
+    }
+}
+
+// NOTE(alexey): Directions worth searching from (x, y), given the direction we came from.
+// Returns the amount of directions written, at most 8.
+function U32 get_pruned_directions(PathScratch *scratch, I32 x, I32 y, I32 dx, I32 dy, TilePoint *directions)
+{
+    U32 count = 0;
+    
+    if(!dx && !dy)
+    {
+        for(I32 test_dy = -1; test_dy <= 1; ++test_dy)
+        {
+            for(I32 test_dx = -1; test_dx <= 1; ++test_dx)
+            {
+                if(test_dx || test_dy)
+                {
+                    directions[count++] = {test_dx, test_dy};
+                }
+            }
+        }
+    }
+    else if(dx && dy)
+    {
+        Bool32 is_x_passable = is_passable(scratch, x + dx, y);
+        Bool32 is_y_passable = is_passable(scratch, x, y + dy);
+        if(is_y_passable)
+        {
+            directions[count++] = {0, dy};
+        }
+        
+        if(is_x_passable)
+        {
+            directions[count++] = {dx, 0};
+        }
+        
+        if(is_x_passable && is_y_passable)
+        {
+            directions[count++] = {dx, dy};
+        }
+    }
+    else if(dx)
+    {
+        Bool32 is_next_passable = is_passable(scratch, x + dx, y);
+        Bool32 is_up_passable = is_passable(scratch, x, y + 1);
+        Bool32 is_down_passable = is_passable(scratch, x, y - 1);
+        if(is_next_passable)
+        {
+            directions[count++] = {dx, 0};
+            if(is_up_passable)
+            {
+                directions[count++] = {dx, 1};
+            }
+            
+            if(is_down_passable)
+            {
+                directions[count++] = {dx, -1};
+            }
+        }
+        
+        if(is_up_passable)
+        {
+            directions[count++] = {0, 1};
+        }
+        
+        if(is_down_passable)
+        {
+            directions[count++] = {0, -1};
+        }
+    }
+    else
+    {
+        Bool32 is_next_passable = is_passable(scratch, x, y + dy);
+        Bool32 is_right_passable = is_passable(scratch, x + 1, y);
+        Bool32 is_left_passable = is_passable(scratch, x - 1, y);
+        if(is_next_passable)
+        {
+            directions[count++] = {0, dy};
+            if(is_right_passable)
+            {
+                directions[count++] = {1, dy};
+            }
+            
+            if(is_left_passable)
+            {
+                directions[count++] = {-1, dy};
+            }
+        }
+        
+        if(is_right_passable)
+        {
+            directions[count++] = {1, 0};
+        }
+        
+        if(is_left_passable)
+        {
+            directions[count++] = {-1, 0};
+        }
+    }
+    
+    return count;
+}
+
+// NOTE(alexey): Starts a new search in the scratch, the nodes of the previous searches become stale.
+function void begin_path_search(PathScratch *scratch, U32 node_count)
+{
+    if(++scratch->search_index == 0)
+    {
+        for(U32 node_index = 0; node_index < node_count; ++node_index)
+        {
+            scratch->nodes[node_index].search_index = 0;
+        }
+        
+        scratch->search_index = 1;
+    }
+    
+    scratch->heap_count = 0;
+}
+
+// NOTE(alexey): Opens the node, or moves it up in the heap if g is better than what it had.
+function void open_path_node(PathScratch *scratch, U32 node_index, U32 parent, F32 g, F32 h)
+{
+    PathNode *node = &scratch->nodes[node_index];
+    if(node->search_index != scratch->search_index)
+    {
+        node->search_index = scratch->search_index;
+        node->heap_index = PATH_NODE_NOT_IN_HEAP;
+        node->g = F32Max;
+    }
+    
+    if((node->heap_index == PATH_NODE_CLOSED) || (g >= node->g))
+    {
+        return;
+    }
+    
+    node->g = g;
+    node->parent = parent;
+    
+    if(node->heap_index == PATH_NODE_NOT_IN_HEAP)
+    {
+        U32 heap_index = scratch->heap_count++;
+        scratch->heap[heap_index].node = node_index;
+        scratch->heap[heap_index].f = g + h;
+        heap_move_up(scratch, heap_index);
+    }
+    else
+    {
+        scratch->heap[node->heap_index].f = g + h;
+        heap_move_up(scratch, node->heap_index);
+    }
+}
+
+void Pathfinder::init(MemoryArena *arena, GameWorld *world, WorldStreamer *streamer, U32 scratch_count)
+{
+    // NOTE(alexey): The window of a chunk with a tile of its neighbours around has to fit (see PathGraph).
+    assert((world->m_tile_count_x + 2 <= PATHFINDER_MAX_WINDOW_SIDE) &&
+           (world->m_tile_count_y + 2 <= PATHFINDER_MAX_WINDOW_SIDE));
+    
+    m_world = world;
+    m_streamer = streamer;
+    m_scratch_count = scratch_count;
+    m_scratches = push_array(arena, scratch_count, PathScratch);
+    m_jobs = push_array(arena, scratch_count, PathBatchJob);
+    
+    for(U32 scratch_index = 0; scratch_index < scratch_count; ++scratch_index)
+    {
+        initScratch(arena, &m_scratches[scratch_index]);
+    }
+}
+
+void Pathfinder::initScratch(MemoryArena *arena, PathScratch *scratch)
+{
+    *scratch = {};
+    scratch->nodes = push_array(arena, PATHFINDER_MAX_NODE_COUNT, PathNode, 64);
+    scratch->heap = push_array(arena, PATHFINDER_MAX_NODE_COUNT, PathHeapEntry, 64);
+    scratch->passable = push_array(arena, PATHFINDER_MAX_NODE_COUNT, U8, 64);
+    scratch->chunk_tiles = push_array(arena, m_world->m_tile_count_x*m_world->m_tile_count_y, U32, 16);
+    
+    // NOTE(alexey): Search index 0 is never used, the arena memory comes zeroed,
+    // so the nodes don't belong to any search from the start.
+}
+
+// NOTE(alexey): Resident tile maps first, the rest is read from the world file if the streamer can do that.
+// Doesn't touch anything shared, so it's fine to call from the compute threads.
+U32 *Pathfinder::getChunkTiles(PathScratch *scratch, I32 tile_map_x, I32 tile_map_y)
+{
+    U32 *result = 0;
+    
+    TileMap *tile_map = m_world->getWorldTileMap(tile_map_x, tile_map_y);
+    if(tile_map)
+    {
+        result = tile_map->tiles;
+        if(!result && m_streamer)
+        {
+            result = m_streamer->readChunkTiles(tile_map_x, tile_map_y, scratch->chunk_tiles);
+        }
+    }
+    
+    return result;
+}
+
+Bool32 Pathfinder::isTilePassable(PathScratch *scratch, I32 abs_tile_x, I32 abs_tile_y)
+{
+    if((abs_tile_x < 0) || (abs_tile_y < 0))
+    {
+        return false;
+    }
+    
+    I32 tile_count_x = m_world->m_tile_count_x;
+    I32 tile_count_y = m_world->m_tile_count_y;
+    I32 tile_map_x = abs_tile_x / tile_count_x;
+    I32 tile_map_y = abs_tile_y / tile_count_y;
+    
+    U32 *tiles = getChunkTiles(scratch, tile_map_x, tile_map_y);
+    if(!tiles)
+    {
+        return false;
+    }
+    
+    I32 tile_x = abs_tile_x % tile_count_x;
+    I32 tile_y = abs_tile_y % tile_count_y;
+    U32 tile_value = tiles[(tile_count_y - tile_y - 1)*tile_count_x + tile_x];
+    
+    Bool32 result = ((tile_value == TileValue_Empty) || (tile_value == TileValue_Door));
+    return result;
+}
+
+// NOTE(alexey): Copies the passability of the tiles in the window into the scratch,
+// a chunk at a time, so the search itself never touches GameWorld.
+Bool32 Pathfinder::buildWindow(PathScratch *scratch, I32 min_x, I32 min_y, I32 max_x, I32 max_y)
+{
+    assert((min_x < max_x) && (min_y < max_y) &&
+           (max_x - min_x <= PATHFINDER_MAX_WINDOW_SIDE) && (max_y - min_y <= PATHFINDER_MAX_WINDOW_SIDE));
+    
+    I32 window_width = max_x - min_x;
+    I32 window_height = max_y - min_y;
+    I32 stride = window_width + 2;
+    
+    scratch->window_min_x = min_x;
+    scratch->window_min_y = min_y;
+    scratch->window_stride = stride;
+    
+    // NOTE(alexey): The wall border around the window.
+    memset(scratch->passable, 0, stride);
+    memset(scratch->passable + (window_height + 1)*stride, 0, stride);
+    for(I32 row_index = 1; row_index <= window_height; ++row_index)
+    {
+        scratch->passable[row_index*stride] = 0;
+        scratch->passable[row_index*stride + window_width + 1] = 0;
+    }
+    
+    Bool32 result = true;
+    
+    I32 tile_count_x = m_world->m_tile_count_x;
+    I32 tile_count_y = m_world->m_tile_count_y;
+    for(I32 tile_map_y = min_y / tile_count_y; tile_map_y <= (max_y - 1) / tile_count_y; ++tile_map_y)
+    {
+        for(I32 tile_map_x = min_x / tile_count_x; tile_map_x <= (max_x - 1) / tile_count_x; ++tile_map_x)
+        {
+            I32 chunk_min_x = Maximum(min_x, tile_map_x*tile_count_x);
+            I32 chunk_min_y = Maximum(min_y, tile_map_y*tile_count_y);
+            I32 chunk_max_x = Minimum(max_x, (tile_map_x + 1)*tile_count_x);
+            I32 chunk_max_y = Minimum(max_y, (tile_map_y + 1)*tile_count_y);
+            I32 count = chunk_max_x - chunk_min_x;
+            
+            U32 *tiles = getChunkTiles(scratch, tile_map_x, tile_map_y);
+            if(!tiles)
+            {
+                result = false;
+            }
+            
+            for(I32 abs_tile_y = chunk_min_y; abs_tile_y < chunk_max_y; ++abs_tile_y)
+            {
+                U8 *dest = scratch->passable + (abs_tile_y - min_y + 1)*stride + (chunk_min_x - min_x + 1);
+                if(tiles)
+                {
+                    I32 tile_y = abs_tile_y - tile_map_y*tile_count_y;
+                    U32 *source = tiles + (tile_count_y - tile_y - 1)*tile_count_x + (chunk_min_x - tile_map_x*tile_count_x);
+                    for(I32 index = 0; index < count; ++index)
+                    {
+                        dest[index] = ((source[index] == TileValue_Empty) || (source[index] == TileValue_Door));
+                    }
+                }
+                else
+                {
+                    memset(dest, 0, count);
+                }
+            }
+        }
+    }
+    
+    return result;
+}
+
+void Pathfinder::findPath(PathScratch *scratch, PathQuery *query)
+{
+    query->status = PathStatus_Pending;
+    query->point_count = 0;
+    query->length = 0.0f;
+    
+    I32 world_tile_count_x = m_world->m_tile_map_count_x*m_world->m_tile_count_x;
+    I32 world_tile_count_y = m_world->m_tile_map_count_y*m_world->m_tile_count_y;
+    
+    TilePoint start = query->start;
+    TilePoint goal = query->goal;
+    if((start.x < 0) || (start.y < 0) || (start.x >= world_tile_count_x) || (start.y >= world_tile_count_y) ||
+       (goal.x < 0) || (goal.y < 0) || (goal.x >= world_tile_count_x) || (goal.y >= world_tile_count_y))
+    {
+        query->status = PathStatus_NotFound;
+        return;
+    }
+    
+    I32 bounds_width = abs(start.x - goal.x) + 1;
+    I32 bounds_height = abs(start.y - goal.y) + 1;
+    if((bounds_width > PATHFINDER_MAX_WINDOW_SIDE) || (bounds_height > PATHFINDER_MAX_WINDOW_SIDE))
+    {
+        query->status = PathStatus_TooFar;
+        return;
+    }
+    
+    I32 margin_x = Minimum(PATHFINDER_WINDOW_MARGIN, (PATHFINDER_MAX_WINDOW_SIDE - bounds_width) / 2);
+    I32 margin_y = Minimum(PATHFINDER_WINDOW_MARGIN, (PATHFINDER_MAX_WINDOW_SIDE - bounds_height) / 2);
+    
+    I32 min_x = Maximum(Minimum(start.x, goal.x) - margin_x, 0);
+    I32 min_y = Maximum(Minimum(start.y, goal.y) - margin_y, 0);
+    I32 max_x = Minimum(Maximum(start.x, goal.x) + margin_x + 1, world_tile_count_x);
+    I32 max_y = Minimum(Maximum(start.y, goal.y) + margin_y + 1, world_tile_count_y);
+    
+    buildWindow(scratch, min_x, min_y, max_x, max_y);
+    searchWindow(scratch, query);
+}
+
+// NOTE(alexey): Jump point search inside of the window that was built last,
+// both the start and the goal have to lie in the window.
+void Pathfinder::searchWindow(PathScratch *scratch, PathQuery *query)
+{
+    query->status = PathStatus_Pending;
+    query->point_count = 0;
+    query->length = 0.0f;
+    
+    I32 stride = scratch->window_stride;
+    I32 start_x = query->start.x - scratch->window_min_x + 1;
+    I32 start_y = query->start.y - scratch->window_min_y + 1;
+    scratch->goal.x = query->goal.x - scratch->window_min_x + 1;
+    scratch->goal.y = query->goal.y - scratch->window_min_y + 1;
+    
+    U32 start_node = start_y*stride + start_x;
+    U32 goal_node = scratch->goal.y*stride + scratch->goal.x;
+    if(!scratch->passable[start_node] || !scratch->passable[goal_node])
+    {
+        query->status = PathStatus_NotFound;
+        return;
+    }
+    
+    begin_path_search(scratch, PATHFINDER_MAX_NODE_COUNT);
+    open_path_node(scratch, start_node, PATH_NODE_NONE, 0.0f, 
+                   octile_distance(start_x, start_y, scratch->goal.x, scratch->goal.y));
+    
+    PathNode *nodes = scratch->nodes;
+    while(scratch->heap_count)
+    {
+        U32 node_index = heap_pop(scratch);
+        PathNode *node = &nodes[node_index];
+        
+        if(node_index == goal_node)
+        {
+            U32 point_count = 0;
+            for(U32 path_node = goal_node; path_node != PATH_NODE_NONE; path_node = nodes[path_node].parent)
+            {
+                ++point_count;
+            }
+            
+            query->length = node->g;
+            if(point_count > query->max_point_count)
+            {
+                query->status = PathStatus_OutOfPoints;
+                return;
+            }
+            
+            U32 point_index = point_count;
+            for(U32 path_node = goal_node; path_node != PATH_NODE_NONE; path_node = nodes[path_node].parent)
+            {
+                TilePoint *point = &query->points[--point_index];
+                point->x = (I32)(path_node % stride) - 1 + scratch->window_min_x;
+                point->y = (I32)(path_node / stride) - 1 + scratch->window_min_y;
+            }
+            
+            query->point_count = point_count;
+            query->status = PathStatus_Found;
+            return;
+        }
+        
+        I32 x = (I32)(node_index % stride);
+        I32 y = (I32)(node_index / stride);
+        
+        I32 dx = 0;
+        I32 dy = 0;
+        if(node->parent != PATH_NODE_NONE)
+        {
+            dx = sign_i32(x - (I32)(node->parent % stride));
+            dy = sign_i32(y - (I32)(node->parent / stride));
+        }
+        
+        TilePoint directions[8];
+        U32 direction_count = get_pruned_directions(scratch, x, y, dx, dy, directions);
+        for(U32 direction_index = 0; direction_index < direction_count; ++direction_index)
+        {
+            I32 jump_x, jump_y;
+            if(jump(scratch, x, y, directions[direction_index].x, directions[direction_index].y, &jump_x, &jump_y))
+            {
+                open_path_node(scratch, jump_y*stride + jump_x, node_index,
+                               node->g + octile_distance(x, y, jump_x, jump_y),
+                               octile_distance(jump_x, jump_y, scratch->goal.x, scratch->goal.y));
+            }
+        }
+    }
+    
+    query->status = PathStatus_NotFound;
+}
+
+// NOTE(alexey): Runs on the compute queue's threads and on the main thread.
+function void find_paths_work(WorkQueue *queue, void *data)
+{
+    PathBatchJob *job = (PathBatchJob *)data;
+    for(U32 query_index = 0; query_index < job->query_count; ++query_index)
+    {
+        job->pathfinder->findPath(job->scratch, &job->queries[query_index]);
+    }
+}
+
+void Pathfinder::findPaths(PathQuery *queries, U32 query_count)
+{
+    BEGIN_TIMED_BLOCK(FindPaths);
+    
+    U32 job_count = Minimum(m_scratch_count, query_count);
+    for(U32 job_index = 0; job_index < job_count; ++job_index)
+    {
+        U32 first_query = (U32)(((U64)query_count*job_index) / job_count);
+        U32 one_past_last_query = (U32)(((U64)query_count*(job_index + 1)) / job_count);
+        
+        PathBatchJob *job = &m_jobs[job_index];
+        job->pathfinder = this;
+        job->scratch = &m_scratches[job_index];
+        job->queries = queries + first_query;
+        job->query_count = one_past_last_query - first_query;
+        
+        // NOTE(alexey): The last job is done on the main thread, as well as the ones that didn't fit into the queue.
+        if((job_index == job_count - 1) || !os->add_work_entry(os->compute_queue, find_paths_work, job))
+        {
+            find_paths_work(0, job);
+        }
+    }
+    
+    os->complete_all_work(os->compute_queue);
+    
+    END_TIMED_BLOCK_COUNTED(FindPaths, query_count);
+}
@@ -0,0 +1,123 @@
+/* date = October 22nd 2023 11:05 am */
+#ifndef GAME_PATHFINDING_H
+
+// NOTE(alexey): Tiles are passable the same way as for the player (GameWorld::isTileMapPointEmpty),
+// empty tiles and doors. Tile maps that aren't resident are read straight from the world file
+// (see WorldStreamer::readChunkTiles), the ones that can't be read are treated as walls.
+// Movement is 8-connected, diagonal steps can't cut the corners of walls.
+
+// NOTE(alexey): Searches are limited to a window around the start and the goal tiles,
+// it's the bounding box of the two extended by PATHFINDER_WINDOW_MARGIN tiles on each side.
+// Queries with the bounding box wider or higher than PATHFINDER_MAX_WINDOW_SIDE fail with PathStatus_TooFar.
+#define PATHFINDER_MAX_WINDOW_SIDE 256
+#define PATHFINDER_WINDOW_MARGIN 32
+
+enum PathStatus
+{
+    PathStatus_Pending,
+    PathStatus_Found,
+    PathStatus_NotFound,
+    PathStatus_TooFar,
+    PathStatus_OutOfPoints, // the path exists, but doesn't fit into the query's points.
+};
+
+// NOTE(alexey): Absolute tile coordinates (see GameWorld::getAbsTileValue).
+struct TilePoint
+{
+    I32 x;
+    I32 y;
+};
+
+struct PathQuery
+{
+    TilePoint start;
+    TilePoint goal;
+
+    // NOTE(alexey): Points are provided by the caller. The path is written as the list of jump points,
+    // the start is the first one and the goal is the last one, every two consecutive points
+    // lie on the same row, column or diagonal.
+    TilePoint *points;
+    U32 max_point_count;
+
+    PathStatus status;
+    U32 point_count;
+    F32 length; // in tiles, diagonal steps are sqrt(2).
+};
+
+struct PathNode
+{
+    // NOTE(alexey): The node belongs to the current search only if search_index matches the scratch's one,
+    // that way the nodes never have to be cleared between the searches.
+    U32 search_index;
+    U32 parent;
+    U32 heap_index;
+    F32 g;
+};
+
+struct PathHeapEntry
+{
+    F32 f;
+    U32 node;
+};
+
+// NOTE(alexey): Everything a single search needs, one per thread that runs the searches.
+// Nodes and passability are indexed with the window's local coordinates,
+// the window has a one tile wall border around it, so the jumps never have to check the bounds.
+struct PathScratch
+{
+    PathNode *nodes;
+    PathHeapEntry *heap;
+    U32 heap_count;
+    U8 *passable;
+    U32 *chunk_tiles; // decode buffer for the chunks that aren't resident.
+
+    I32 window_min_x;
+    I32 window_min_y;
+    I32 window_stride;
+
+    TilePoint goal;
+    U32 search_index;
+};
+
+struct Pathfinder;
+
+struct PathBatchJob
+{
+    Pathfinder *pathfinder;
+    PathScratch *scratch;
+    PathQuery *queries;
+    U32 query_count;
+};
+
+/*
+  Jump point search over GameWorld's tiles.
+
+  findPaths splits the batch between the compute queue's threads and the main thread,
+  and returns when all the queries are done. The world mustn't change while the batch runs,
+  so it has to be called outside of the streamer's update.
+*/
+struct Pathfinder
+{
+    void init(MemoryArena *arena, GameWorld *world, WorldStreamer *streamer, U32 scratch_count);
+    void initScratch(MemoryArena *arena, PathScratch *scratch);
+    void findPath(PathScratch *scratch, PathQuery *query);
+    void findPaths(PathQuery *queries, U32 query_count);
+    Bool32 isTilePassable(PathScratch *scratch, I32 abs_tile_x, I32 abs_tile_y);
+
+    // NOTE(alexey): The window is the range of absolute tiles, min is inclusive, max is exclusive,
+    // neither side can be longer than PATHFINDER_MAX_WINDOW_SIDE.
+    // Returns false if some of the chunks in the window couldn't be read.
+    Bool32 buildWindow(PathScratch *scratch, I32 min_x, I32 min_y, I32 max_x, I32 max_y);
+    void searchWindow(PathScratch *scratch, PathQuery *query);
+    U32 *getChunkTiles(PathScratch *scratch, I32 tile_map_x, I32 tile_map_y);
+
+    GameWorld *m_world;
+    WorldStreamer *m_streamer;
+
+    PathScratch *m_scratches;
+    PathBatchJob *m_jobs;
+    U32 m_scratch_count;
+};
+
+#define GAME_PATHFINDING_H
+#endif //GAME_PATHFINDING_H
@@ -0,0 +1,1080 @@
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// NOTE(alexey): Set to 0 in order to run the scalar reference path
+// and compare its DrawBitmap cycles per pixel against the SIMD kernels.
+#ifndef GAME_RENDER_SIMD
+#define GAME_RENDER_SIMD 1
+#endif
+
+// NOTE(alexey): Colors are expected to be in 0..1 range, anything else is a bug on the caller's side
+// (for example passing 0..255 values), which would otherwise end up as garbage bytes in neighbouring channels.
+function bool32 is_color_valid(Vec4 color)
+{
+    bool32 result = true;
+    for(I32 channel_index = 0; channel_index < 4; ++channel_index)
+    {
+        F32 channel = color.e[channel_index];
+        if(!(channel >= 0.0f && channel <= 1.0f))
+        {
+            result = false;
+        }
+    }
+    
+    return result;
+}
+
+function PackedColor pack_color(Vec4 color)
+{
+    PackedColor result = 
+    round_real32_to_uint32(color.b * 255.0f) | 
+    (round_real32_to_uint32(color.g * 255.0f) << 8) | 
+    (round_real32_to_uint32(color.r * 255.0f) << 16) |  
+    (round_real32_to_uint32(color.a * 255.0f) << 24); 
+    
+    return result;
+}
+
+function void init_palette(Palette *palette)
+{
+    Vec4 colors[PaletteColor_Count] = {};
+    
+    colors[PaletteColor_Background] = Vec4(236.0f/255.0f, 213.0f/255.0f, 160.0f/255.0f);
+    
+    colors[PaletteColor_Wall] = Vec4(0.25f);
+    colors[PaletteColor_Door] = Vec4(0.25f, 0.5f, 0.5f);
+    colors[PaletteColor_PlayerTile] = Vec4(0.8f, 0.7f, 0.54f);
+    colors[PaletteColor_TileFrame] = Vec4(0.8f, 0.788f, 0.65f);
+    colors[PaletteColor_TileCorner] = Vec4(1.0f, 1.0f, 0.0f);
+    
+    colors[PaletteColor_Player] = Vec4(0.80f, 1.0f, 0.44f);
+    colors[PaletteColor_PlayerCollisionBox] = Vec4(0.95f, 0.21f, 1.0f);
+    colors[PaletteColor_PlayerProbe] = Vec4(1.0f, 0.0f, 0.47f);
+    
+    colors[PaletteColor_DebugPath] = Vec4(0.1f, 0.6f, 1.0f);
+    
+    // NOTE(alexey): The palette is the only place the colors are packed, so it's the only place they're checked.
+    for(I32 color_index = 0; color_index < PaletteColor_Count; ++color_index)
+    {
+        if(!is_color_valid(colors[color_index]))
+        {
+            DebugOut("Palette color %d is out of the 0..1 range\n", color_index);
+            assert(!"invalid palette color");
+        }
+        palette->colors[color_index] = pack_color(colors[color_index]);
+    }
+}
+
+// NOTE(alexey): Multiplies the color channels by level/255, alpha stays as it is.
+inline PackedColor scale_color(PackedColor color, U32 level)
+{
+    PackedColor result = color & 0xFF000000;
+    for(U32 shift = 0; shift < 24; shift += 8)
+    {
+        U32 channel = (color >> shift) & 0xFF;
+        result |= (((channel*level + 127) / 255) << shift);
+    }
+    
+    return result;
+}
+
+/*
+(minx, miny)
+      +------------+
+      |            |
+      |            |
+      |            |
+      |            |
+      +------------+ (maxx, maxy)
+  
+  minx/miny are inclusive, maxx/maxy are exclusive.
+  The rectangle is clipped against the buffer in integer space,
+  the wireframe is drawn only along the edges that survived the clipping.
+*/
+function void draw_pixel_rectangle(OffscreenBuffer *buffer,
+                                   RectangleStyle draw_style,
+                                   I32 minx, I32 miny,
+                                   I32 maxx, I32 maxy,
+                                   PackedColor color)
+{
+    BEGIN_TIMED_BLOCK(DrawRectangleCall);
+    
+    I32 clipped_minx = (minx < 0) ? 0 : minx;
+    I32 clipped_miny = (miny < 0) ? 0 : miny;
+    I32 clipped_maxx = (maxx > buffer->width) ? buffer->width : maxx;
+    I32 clipped_maxy = (maxy > buffer->height) ? buffer->height : maxy;
+    
+    if((clipped_minx >= clipped_maxx) || (clipped_miny >= clipped_maxy))
+    {
+        END_TIMED_BLOCK(DrawRectangleCall);
+        return;
+    }
+    
+    BEGIN_TIMED_BLOCK(DrawRectangle);
+    
+    uint8 *row = (uint8 *)buffer->data + clipped_miny*buffer->pitch + clipped_minx*buffer->bpp;
+    
+    if(draw_style == RectangleStyle_Filled)
+    {
+        for(I32 y = clipped_miny; y < clipped_maxy; ++y)
+        {
+            uint32 *pixels = (uint32 *)row;
+            for(I32 x = clipped_minx; x < clipped_maxx; ++x)
+            {
+                // 0x BB GG RR AA
+                *pixels++ = color;
+            }
+            row += buffer->pitch;
+        }
+    }
+    else if(draw_style == RectangleStyle_Wireframe)
+    {
+        for(I32 y = clipped_miny; y < clipped_maxy; ++y)
+        {
+            uint32 *pixels = (uint32 *)row;
+            for(I32 x = clipped_minx; x < clipped_maxx; ++x)
+            {
+                int32 frame_y = (y == miny) || (y == maxy - 1);
+                int32 frame_x = (x == minx) || (x == maxx - 1);
+                if(frame_y || frame_x)
+                {
+                    // 0x BB GG RR AA
+                    *pixels = color;
+                }
+                ++pixels;
+            }
+            row += buffer->pitch;
+        }
+    }
+    else
+    {
+        assert(!"Unknown draw style!");
+    }
+    
+    END_TIMED_BLOCK_COUNTED(DrawRectangle, (clipped_maxx - clipped_minx)*(clipped_maxy - clipped_miny));
+    END_TIMED_BLOCK(DrawRectangleCall);
+}
+
+function void draw_rectangle(OffscreenBuffer *buffer,
+                             RectangleStyle draw_style,
+                             real32 rminx, real32 rminy,
+                             real32 rmaxx, real32 rmaxy,
+                             PackedColor color)
+{
+    I32 minx = round_real32_to_int32(rminx);
+    I32 miny = round_real32_to_int32(rminy);
+    I32 maxx = round_real32_to_int32(rmaxx);
+    I32 maxy = round_real32_to_int32(rmaxy);
+    
+    draw_pixel_rectangle(buffer, draw_style, minx, miny, maxx, maxy, color);
+}
+
+function void fill_pixels_scalar(U32 *pixels, I32 count, PackedColor color)
+{
+    for(I32 i = 0; i < count; ++i)
+    {
+        pixels[i] = color;
+    }
+}
+
+// NOTE(alexey): Non-temporal (streaming) stores go around the caches. It only pays off for the buffers
+// that don't fit into them anyway, a smaller buffer is better left in the caches for the tiles drawn right after
+// (at 1080x720, 3MB, the regular stores clear twice as fast and the tiles are a third faster to draw after them).
+// The buffers of at least CLEAR_STREAMING_MIN_SIZE bytes are cleared with the streaming stores.
+#define CLEAR_STREAMING_MIN_SIZE Mb(16)
+
+// NOTE(alexey): The aligned stores need aligned addresses, so the unaligned head and the tail are stored one pixel at a time.
+function void fill_pixels(U32 *pixels, I32 count, PackedColor color, Bool32 streaming)
+{
+#if !GAME_RENDER_SIMD
+    fill_pixels_scalar(pixels, count, color);
+#else
+#if defined(__AVX2__)
+    I32 alignment = 32;
+#else
+    I32 alignment = 16;
+#endif
+    I32 head = Minimum(count, (I32)(((alignment - ((size_t)pixels & (alignment - 1))) & (alignment - 1)) / sizeof(U32)));
+    fill_pixels_scalar(pixels, head, color);
+    
+    I32 i = head;
+#if defined(__AVX2__)
+    __m256i wide_color = _mm256_set1_epi32((int)color);
+    if(streaming)
+    {
+        for(; i + 8 <= count; i += 8)
+        {
+            _mm256_stream_si256((__m256i *)(pixels + i), wide_color);
+        }
+    }
+    else
+    {
+        for(; i + 8 <= count; i += 8)
+        {
+            _mm256_store_si256((__m256i *)(pixels + i), wide_color);
+        }
+    }
+#else
+    __m128i wide_color = _mm_set1_epi32((int)color);
+    if(streaming)
+    {
+        for(; i + 4 <= count; i += 4)
+        {
+            _mm_stream_si128((__m128i *)(pixels + i), wide_color);
+        }
+    }
+    else
+    {
+        for(; i + 4 <= count; i += 4)
+        {
+            _mm_store_si128((__m128i *)(pixels + i), wide_color);
+        }
+    }
+#endif
+    
+    fill_pixels_scalar(pixels + i, count - i, color);
+#endif
+}
+
+// NOTE(alexey): The whole buffer in a single color, a buffer without padding between the rows 
+// is filled as a single row.
+function void clear_buffer(OffscreenBuffer *buffer, PackedColor color, Bool32 streaming)
+{
+    BEGIN_TIMED_BLOCK(ClearBuffer);
+    
+    I32 row_count = buffer->height;
+    I32 row_pixel_count = buffer->width;
+    if(buffer->pitch == buffer->width*buffer->bpp)
+    {
+        row_pixel_count *= row_count;
+        row_count = 1;
+    }
+    
+    uint8 *row = (uint8 *)buffer->data;
+    for(I32 y = 0; y < row_count; ++y)
+    {
+        fill_pixels((U32 *)row, row_pixel_count, color, streaming);
+        row += buffer->pitch;
+    }
+    
+#if GAME_RENDER_SIMD
+    // NOTE(alexey): The streaming stores have to be visible before anything else touches the buffer.
+    if(streaming)
+    {
+        _mm_sfence();
+    }
+#endif
+    
+    END_TIMED_BLOCK_COUNTED(ClearBuffer, buffer->width*buffer->height);
+}
+
+function void clear_buffer(OffscreenBuffer *buffer, PackedColor color)
+{
+    Bool32 streaming = ((U64)buffer->pitch*buffer->height >= CLEAR_STREAMING_MIN_SIZE);
+    clear_buffer(buffer, color, streaming);
+}
+
+function Bitmap allocate_bitmap(MemoryArena *arena, I32 width, I32 height)
+{
+    Bitmap result = {};
+    
+    result.width = width;
+    result.height = height;
+    result.pitch = ((width*sizeof(U32)) + (BITMAP_ROW_ALIGNMENT - 1)) & ~(BITMAP_ROW_ALIGNMENT - 1);
+    result.memory = (U32 *)push_size(arena, (size_t)result.pitch*height, BITMAP_ROW_ALIGNMENT);
+    
+    return result;
+}
+
+#pragma pack(push, 1)
+struct BitmapHeader
+{
+    U16 file_type;
+    U32 file_size;
+    U16 reserved1;
+    U16 reserved2;
+    U32 bitmap_offset;
+    
+    U32 size;
+    I32 width;
+    I32 height;
+    U16 planes;
+    U16 bits_per_pixel;
+    U32 compression;
+    U32 size_of_bitmap;
+    I32 horz_resolution;
+    I32 vert_resolution;
+    U32 colors_used;
+    U32 colors_important;
+    
+    // NOTE(alexey): Only valid for BI_BITFIELDS,
+    // alpha mask is only present in V3 and later headers.
+    U32 red_mask;
+    U32 green_mask;
+    U32 blue_mask;
+    U32 alpha_mask;
+};
+#pragma pack(pop)
+
+#define BMP_FILE_TYPE 0x4D42 // 'BM'
+#define BMP_BI_RGB 0
+#define BMP_BI_BITFIELDS 3
+
+function U32 find_least_significant_set_bit(U32 value)
+{
+    U32 result = 0;
+    for(U32 bit = 0; bit < 32; ++bit)
+    {
+        if(value & (1u << bit))
+        {
+            result = bit;
+            break;
+        }
+    }
+    
+    return result;
+}
+
+// NOTE(alexey): Supports uncompressed 24-bit and 32-bit bmp files (BI_RGB and BI_BITFIELDS),
+// both bottom-up and top-down. Pixels are converted to pre-multiplied alpha on load.
+// Returns a bitmap with memory set to NULL if the file couldn't be loaded.
+function Bitmap load_bmp(MemoryArena *arena, const char *file_name)
+{
+    Bitmap result = {};
+    
+    FileContents file = os->read_entire_file(file_name);
+    if(!file.data)
+    {
+        return result;
+    }
+    
+    BitmapHeader *header = (BitmapHeader *)file.data;
+    
+    U32 header_size = (U32)(sizeof(BitmapHeader) - 4*sizeof(U32));
+    bool32 is_valid = ((file.size >= header_size) &&
+                       (header->file_type == BMP_FILE_TYPE) &&
+                       (header->width > 0) && (header->height != 0) &&
+                       ((header->bits_per_pixel == 24) || (header->bits_per_pixel == 32)) &&
+                       ((header->compression == BMP_BI_RGB) || (header->compression == BMP_BI_BITFIELDS)));
+    
+    I32 width = 0;
+    I32 height = 0;
+    U32 bytes_per_pixel = 0;
+    U32 src_pitch = 0;
+    
+    if(is_valid)
+    {
+        width = header->width;
+        height = (header->height < 0) ? -header->height : header->height;
+        bytes_per_pixel = header->bits_per_pixel / 8;
+        src_pitch = ((width*bytes_per_pixel) + 3) & ~3u;
+        
+        is_valid = ((uint64)header->bitmap_offset + (uint64)src_pitch*height <= file.size);
+    }
+    
+    if(is_valid)
+    {
+        U32 red_mask = 0x00FF0000;
+        U32 green_mask = 0x0000FF00;
+        U32 blue_mask = 0x000000FF;
+        U32 alpha_mask = (bytes_per_pixel == 4) ? 0xFF000000 : 0;
+        
+        if(header->compression == BMP_BI_BITFIELDS)
+        {
+            red_mask = header->red_mask;
+            green_mask = header->green_mask;
+            blue_mask = header->blue_mask;
+            alpha_mask = (header->size >= 56) ? header->alpha_mask : 0;
+        }
+        
+        U32 red_shift = find_least_significant_set_bit(red_mask);
+        U32 green_shift = find_least_significant_set_bit(green_mask);
+        U32 blue_shift = find_least_significant_set_bit(blue_mask);
+        U32 alpha_shift = find_least_significant_set_bit(alpha_mask);
+        
+        result = allocate_bitmap(arena, width, height);
+        
+        // NOTE(alexey): Plenty of 32-bit bmp files have zeroes in the alpha byte,
+        // treat those as opaque.
+        bool32 has_alpha = false;
+        
+        uint8 *src_pixels = (uint8 *)file.data + header->bitmap_offset;
+        for(I32 y = 0; y < height; ++y)
+        {
+            I32 src_y = (header->height < 0) ? (height - y - 1) : y;
+            uint8 *src = src_pixels + (size_t)src_y*src_pitch;
+            U32 *dst = (U32 *)((uint8 *)result.memory + (size_t)y*result.pitch);
+            
+            for(I32 x = 0; x < width; ++x)
+            {
+                U32 c = 0;
+                if(bytes_per_pixel == 4)
+                {
+                    c = *(U32 *)src;
+                }
+                else
+                {
+                    c = src[0] | (src[1] << 8) | (src[2] << 16);
+                }
+                src += bytes_per_pixel;
+                
+                U32 r = (c & red_mask) >> red_shift;
+                U32 g = (c & green_mask) >> green_shift;
+                U32 b = (c & blue_mask) >> blue_shift;
+                U32 a = alpha_mask ? ((c & alpha_mask) >> alpha_shift) : 0xFF;
+                if(a)
+                {
+                    has_alpha = true;
+                }
+                
+                *dst++ = (a << 24) | (r << 16) | (g << 8) | b;
+            }
+        }
+        
+        for(I32 y = 0; y < height; ++y)
+        {
+            U32 *pixel = (U32 *)((uint8 *)result.memory + (size_t)y*result.pitch);
+            for(I32 x = 0; x < width; ++x, ++pixel)
+            {
+                U32 a = has_alpha ? (*pixel >> 24) : 0xFF;
+                U32 r = (((*pixel >> 16) & 0xFF)*a + 127) / 255;
+                U32 g = (((*pixel >> 8) & 0xFF)*a + 127) / 255;
+                U32 b = ((*pixel & 0xFF)*a + 127) / 255;
+                *pixel = (a << 24) | (r << 16) | (g << 8) | b;
+            }
+        }
+    }
+    
+    os->free_file_memory(file.data);
+    
+    return result;
+}
+
+// NOTE(alexey): A soft black ellipse, used as a drop shadow under sprites.
+function Bitmap make_shadow_bitmap(MemoryArena *arena, I32 width, I32 height, F32 max_alpha)
+{
+    Bitmap result = allocate_bitmap(arena, width, height);
+    
+    F32 half_width = 0.5f*width;
+    F32 half_height = 0.5f*height;
+    for(I32 y = 0; y < height; ++y)
+    {
+        U32 *pixel = (U32 *)((uint8 *)result.memory + (size_t)y*result.pitch);
+        for(I32 x = 0; x < width; ++x)
+        {
+            F32 dx = ((F32)x + 0.5f - half_width) / half_width;
+            F32 dy = ((F32)y + 0.5f - half_height) / half_height;
+            F32 t = 1.0f - (dx*dx + dy*dy);
+            if(t < 0.0f)
+            {
+                t = 0.0f;
+            }
+            
+            // pre-multiplied black, only the alpha is non-zero.
+            U32 a = round_real32_to_uint32(t*max_alpha*255.0f);
+            *pixel++ = (a << 24);
+        }
+    }
+    
+    return result;
+}
+
+// NOTE(alexey): dst = src + dst*(255 - src_alpha)/255 for every channel.
+// The division by 255 is done as (t + (t >> 8)) >> 8 with t = x + 128,
+// which is exact for x in [0, 255*255], so the SIMD kernels below produce exactly the same bytes.
+inline U32 blend_pixel(U32 dst, U32 src)
+{
+    U32 inv_alpha = 255 - (src >> 24);
+    U32 result = 0;
+    for(U32 shift = 0; shift < 32; shift += 8)
+    {
+        U32 t = ((dst >> shift) & 0xFF)*inv_alpha + 128;
+        t = (t + (t >> 8)) >> 8;
+        U32 c = ((src >> shift) & 0xFF) + t;
+        if(c > 255)
+        {
+            c = 255;
+        }
+        result |= (c << shift);
+    }
+    
+    return result;
+}
+
+function void blend_row_scalar(U32 *dst, U32 *src, I32 count)
+{
+    for(I32 i = 0; i < count; ++i)
+    {
+        dst[i] = blend_pixel(dst[i], src[i]);
+    }
+}
+
+// NOTE(alexey): Blends 4 pixels at a time, channels are widened to 16 bits.
+function void blend_row_sse2(U32 *dst, U32 *src, I32 count)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i max_alpha = _mm_set1_epi32(255);
+    __m128i half = _mm_set1_epi16(128);
+    
+    I32 i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128i s = _mm_loadu_si128((__m128i *)(src + i));
+        __m128i d = _mm_loadu_si128((__m128i *)(dst + i));
+        
+        // (255 - alpha) broadcasted into every 16-bit channel of its pixel.
+        __m128i inv_alpha = _mm_sub_epi32(max_alpha, _mm_srli_epi32(s, 24));
+        inv_alpha = _mm_or_si128(inv_alpha, _mm_slli_epi32(inv_alpha, 16));
+        __m128i inv_alpha_lo = _mm_unpacklo_epi32(inv_alpha, inv_alpha);
+        __m128i inv_alpha_hi = _mm_unpackhi_epi32(inv_alpha, inv_alpha);
+        
+        __m128i t_lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inv_alpha_lo), half);
+        __m128i t_hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inv_alpha_hi), half);
+        t_lo = _mm_srli_epi16(_mm_add_epi16(t_lo, _mm_srli_epi16(t_lo, 8)), 8);
+        t_hi = _mm_srli_epi16(_mm_add_epi16(t_hi, _mm_srli_epi16(t_hi, 8)), 8);
+        
+        __m128i result = _mm_adds_epu8(s, _mm_packus_epi16(t_lo, t_hi));
+        _mm_storeu_si128((__m128i *)(dst + i), result);
+    }
+    
+    blend_row_scalar(dst + i, src + i, count - i);
+}
+
+#if defined(__AVX2__)
+// NOTE(alexey): The same as the SSE2 kernel, but 8 pixels at a time.
+// Unpacks and packs work within 128-bit lanes, so pixels end up where they started.
+function void blend_row_avx2(U32 *dst, U32 *src, I32 count)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i max_alpha = _mm256_set1_epi32(255);
+    __m256i half = _mm256_set1_epi16(128);
+    
+    I32 i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256i s = _mm256_loadu_si256((__m256i *)(src + i));
+        __m256i d = _mm256_loadu_si256((__m256i *)(dst + i));
+        
+        __m256i inv_alpha = _mm256_sub_epi32(max_alpha, _mm256_srli_epi32(s, 24));
+        inv_alpha = _mm256_or_si256(inv_alpha, _mm256_slli_epi32(inv_alpha, 16));
+        __m256i inv_alpha_lo = _mm256_unpacklo_epi32(inv_alpha, inv_alpha);
+        __m256i inv_alpha_hi = _mm256_unpackhi_epi32(inv_alpha, inv_alpha);
+        
+        __m256i t_lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), inv_alpha_lo), half);
+        __m256i t_hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), inv_alpha_hi), half);
+        t_lo = _mm256_srli_epi16(_mm256_add_epi16(t_lo, _mm256_srli_epi16(t_lo, 8)), 8);
+        t_hi = _mm256_srli_epi16(_mm256_add_epi16(t_hi, _mm256_srli_epi16(t_hi, 8)), 8);
+        
+        __m256i result = _mm256_adds_epu8(s, _mm256_packus_epi16(t_lo, t_hi));
+        _mm256_storeu_si256((__m256i *)(dst + i), result);
+    }
+    
+    blend_row_sse2(dst + i, src + i, count - i);
+}
+#endif
+
+/*
+  (x, y) is the bottom-left corner of the bitmap in buffer's pixels.
+  The bitmap is clipped against the buffer in integer space.
+*/
+function void draw_bitmap(OffscreenBuffer *buffer, Bitmap *bitmap, F32 real_x, F32 real_y)
+{
+    if(!bitmap->memory)
+    {
+        return;
+    }
+    
+    I32 minx = floor_real32_to_int32(real_x + 0.5f);
+    I32 miny = floor_real32_to_int32(real_y + 0.5f);
+    I32 maxx = minx + bitmap->width;
+    I32 maxy = miny + bitmap->height;
+    
+    I32 src_offset_x = 0;
+    I32 src_offset_y = 0;
+    if(minx < 0)
+    {
+        src_offset_x = -minx;
+        minx = 0;
+    }
+    
+    if(miny < 0)
+    {
+        src_offset_y = -miny;
+        miny = 0;
+    }
+    
+    if(maxx > buffer->width)
+    {
+        maxx = buffer->width;
+    }
+    
+    if(maxy > buffer->height)
+    {
+        maxy = buffer->height;
+    }
+    
+    if((minx >= maxx) || (miny >= maxy))
+    {
+        return;
+    }
+    
+    BEGIN_TIMED_BLOCK(DrawBitmap);
+    
+    I32 count = maxx - minx;
+    uint8 *src_row = (uint8 *)bitmap->memory + (size_t)src_offset_y*bitmap->pitch + src_offset_x*sizeof(U32);
+    uint8 *dst_row = (uint8 *)buffer->data + (size_t)miny*buffer->pitch + minx*buffer->bpp;
+    for(I32 y = miny; y < maxy; ++y)
+    {
+#if !GAME_RENDER_SIMD
+        blend_row_scalar((U32 *)dst_row, (U32 *)src_row, count);
+#elif defined(__AVX2__)
+        blend_row_avx2((U32 *)dst_row, (U32 *)src_row, count);
+#else
+        blend_row_sse2((U32 *)dst_row, (U32 *)src_row, count);
+#endif
+        src_row += bitmap->pitch;
+        dst_row += buffer->pitch;
+    }
+    
+    END_TIMED_BLOCK_COUNTED(DrawBitmap, count*(maxy - miny));
+}
+
+/*
+  Present format conversion, for everything that isn't the win32 StretchDIBits:
+  the buffer is 0x AA RR GG BB per pixel (bytes B, G, R, A in memory) with the rows going bottom-up,
+  images want the bytes R, G, B, A with the rows going top-down.
+  dest is width*height pixels, dest_pitch bytes per row.
+*/
+inline U32 swizzle_pixel_to_rgba(U32 pixel)
+{
+    U32 result = (pixel & 0xFF00FF00) | ((pixel >> 16) & 0xFF) | ((pixel & 0xFF) << 16);
+    return result;
+}
+
+function void swizzle_row_scalar(U32 *dst, U32 *src, I32 count)
+{
+    for(I32 i = 0; i < count; ++i)
+    {
+        dst[i] = swizzle_pixel_to_rgba(src[i]);
+    }
+}
+
+// NOTE(alexey): SSE2 has no byte shuffle, so R and B swap places with shifts and masks, 4 pixels at a time.
+function void swizzle_row_sse2(U32 *dst, U32 *src, I32 count)
+{
+    __m128i alpha_green = _mm_set1_epi32((int)0xFF00FF00);
+    __m128i low_byte = _mm_set1_epi32(0xFF);
+    
+    I32 i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128i pixels = _mm_loadu_si128((__m128i *)(src + i));
+        __m128i red = _mm_and_si128(_mm_srli_epi32(pixels, 16), low_byte);
+        __m128i blue = _mm_slli_epi32(_mm_and_si128(pixels, low_byte), 16);
+        __m128i result = _mm_or_si128(_mm_and_si128(pixels, alpha_green), _mm_or_si128(red, blue));
+        _mm_storeu_si128((__m128i *)(dst + i), result);
+    }
+    
+    swizzle_row_scalar(dst + i, src + i, count - i);
+}
+
+#if defined(__AVX2__)
+// NOTE(alexey): A single byte shuffle, 8 pixels at a time.
+function void swizzle_row_avx2(U32 *dst, U32 *src, I32 count)
+{
+    __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                       2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    
+    I32 i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256i pixels = _mm256_loadu_si256((__m256i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_shuffle_epi8(pixels, shuffle));
+    }
+    
+    swizzle_row_scalar(dst + i, src + i, count - i);
+}
+#endif
+
+function void convert_buffer_to_rgba(OffscreenBuffer *buffer, U8 *dest, I32 dest_pitch)
+{
+    BEGIN_TIMED_BLOCK(ConvertBuffer);
+    
+    uint8 *src_row = (uint8 *)buffer->data + (size_t)(buffer->height - 1)*buffer->pitch;
+    uint8 *dst_row = dest;
+    for(I32 y = 0; y < buffer->height; ++y)
+    {
+#if !GAME_RENDER_SIMD
+        swizzle_row_scalar((U32 *)dst_row, (U32 *)src_row, buffer->width);
+#elif defined(__AVX2__)
+        swizzle_row_avx2((U32 *)dst_row, (U32 *)src_row, buffer->width);
+#else
+        swizzle_row_sse2((U32 *)dst_row, (U32 *)src_row, buffer->width);
+#endif
+        src_row -= buffer->pitch;
+        dst_row += dest_pitch;
+    }
+    
+    END_TIMED_BLOCK_COUNTED(ConvertBuffer, buffer->width*buffer->height);
+}
+
+/*
+  Scaling between resolutions, for the internal render resolution that is upscaled to the output.
+  Source positions are 16.16 fixed point, a destination pixel samples the source at the position of its center,
+  (x + 0.5)*source_width/dest_width - 0.5, the same in y.
+  Nearest takes the closest source pixel. Bilinear scales the two closest source rows horizontally first,
+  every pixel is a blend of two neighbours, then blends the two rows, with 7-bit weights, 
+  so the products of a channel and a weight still fit 16 bits.
+  Works for the downscale too, though bilinear only looks at 2x2 source pixels then.
+*/
+#define SCALE_WEIGHT_BITS 7
+#define SCALE_WEIGHT_ONE (1 << SCALE_WEIGHT_BITS)
+
+struct ScaleAxis
+{
+    int64 start;
+    int64 step;
+    int64 max_position; // of the last source pixel.
+};
+
+function ScaleAxis make_scale_axis(I32 source_count, I32 dest_count)
+{
+    ScaleAxis result;
+    result.step = ((int64)source_count << 16) / dest_count;
+    result.start = result.step / 2 - 0x8000;
+    result.max_position = (int64)(source_count - 1) << 16;
+    return result;
+}
+
+inline I32 get_nearest_index(ScaleAxis *axis, I32 dest_index)
+{
+    int64 position = axis->start + dest_index*axis->step + 0x8000;
+    I32 result = (I32)(Minimum(position, axis->max_position) >> 16);
+    return result;
+}
+
+// NOTE(alexey): Returns the first source index, the weight of the second one goes into weight.
+inline I32 get_bilinear_index(ScaleAxis *axis, I32 dest_index, U32 *weight)
+{
+    int64 position = Clamp(axis->start + dest_index*axis->step, 0, axis->max_position);
+    *weight = (U32)(position >> (16 - SCALE_WEIGHT_BITS)) & (SCALE_WEIGHT_ONE - 1);
+    I32 result = (I32)(position >> 16);
+    return result;
+}
+
+function void scale_row_nearest_scalar(U32 *dst, U32 *src, I32 *source_x, I32 count)
+{
+    for(I32 i = 0; i < count; ++i)
+    {
+        dst[i] = src[source_x[i]];
+    }
+}
+
+// NOTE(alexey): SSE2 has no gather, the pixels are loaded one by one and stored 4 at a time.
+// The AVX2 gather was slower than that (0.58 against 0.44 cycles per pixel at 2x), so there's no AVX2 version.
+function void scale_row_nearest_sse2(U32 *dst, U32 *src, I32 *source_x, I32 count)
+{
+    I32 i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128i pixels = _mm_setr_epi32((int)src[source_x[i]], (int)src[source_x[i + 1]], 
+                                        (int)src[source_x[i + 2]], (int)src[source_x[i + 3]]);
+        _mm_storeu_si128((__m128i *)(dst + i), pixels);
+    }
+    
+    scale_row_nearest_scalar(dst + i, src, source_x + i, count - i);
+}
+
+// NOTE(alexey): a*(1 - weight) + b*weight for every channel, weight is in SCALE_WEIGHT_ONE units.
+inline U32 blend_pixel_weighted(U32 a, U32 b, U32 weight)
+{
+    U32 result = 0;
+    for(U32 shift = 0; shift < 32; shift += 8)
+    {
+        U32 channel = (((a >> shift) & 0xFF)*(SCALE_WEIGHT_ONE - weight) + 
+                       ((b >> shift) & 0xFF)*weight + (SCALE_WEIGHT_ONE / 2)) >> SCALE_WEIGHT_BITS;
+        result |= channel << shift;
+    }
+    return result;
+}
+
+function void blend_rows_scalar(U32 *dst, U32 *row0, U32 *row1, U32 weight, I32 count)
+{
+    for(I32 i = 0; i < count; ++i)
+    {
+        dst[i] = blend_pixel_weighted(row0[i], row1[i], weight);
+    }
+}
+
+function void blend_rows_sse2(U32 *dst, U32 *row0, U32 *row1, U32 weight, I32 count)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i weight0 = _mm_set1_epi16((short)(SCALE_WEIGHT_ONE - weight));
+    __m128i weight1 = _mm_set1_epi16((short)weight);
+    __m128i round = _mm_set1_epi16(SCALE_WEIGHT_ONE / 2);
+    
+    I32 i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128i a = _mm_loadu_si128((__m128i *)(row0 + i));
+        __m128i b = _mm_loadu_si128((__m128i *)(row1 + i));
+        
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), weight0),
+                                   _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), weight1));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), weight0),
+                                   _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), weight1));
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, round), SCALE_WEIGHT_BITS);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, round), SCALE_WEIGHT_BITS);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    
+    blend_rows_scalar(dst + i, row0 + i, row1 + i, weight, count - i);
+}
+
+// NOTE(alexey): weights are (SCALE_WEIGHT_ONE - w) in the low and w in the high 16 bits, 
+// src has a pixel past every source_x.
+function void scale_row_bilinear_scalar(U32 *dst, U32 *src, I32 *source_x, U32 *weights, I32 count)
+{
+    for(I32 i = 0; i < count; ++i)
+    {
+        dst[i] = blend_pixel_weighted(src[source_x[i]], src[source_x[i] + 1], weights[i] >> 16);
+    }
+}
+
+// NOTE(alexey): Both neighbours are a single 64-bit load, their channels are interleaved 
+// and _mm_madd_epi16 does a*(1 - w) + b*w for 4 channels at once.
+inline __m128i blend_pixel_pair_sse2(U32 *pair, __m128i weights)
+{
+    __m128i pixels = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)pair), _mm_setzero_si128());
+    __m128i interleaved = _mm_unpacklo_epi16(pixels, _mm_srli_si128(pixels, 8));
+    __m128i result = _mm_madd_epi16(interleaved, weights);
+    result = _mm_srli_epi32(_mm_add_epi32(result, _mm_set1_epi32(SCALE_WEIGHT_ONE / 2)), SCALE_WEIGHT_BITS);
+    return result;
+}
+
+function void scale_row_bilinear_sse2(U32 *dst, U32 *src, I32 *source_x, U32 *weights, I32 count)
+{
+    I32 i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128i four_weights = _mm_loadu_si128((__m128i *)(weights + i));
+        __m128i p0 = blend_pixel_pair_sse2(src + source_x[i], _mm_shuffle_epi32(four_weights, 0x00));
+        __m128i p1 = blend_pixel_pair_sse2(src + source_x[i + 1], _mm_shuffle_epi32(four_weights, 0x55));
+        __m128i p2 = blend_pixel_pair_sse2(src + source_x[i + 2], _mm_shuffle_epi32(four_weights, 0xAA));
+        __m128i p3 = blend_pixel_pair_sse2(src + source_x[i + 3], _mm_shuffle_epi32(four_weights, 0xFF));
+        
+        __m128i result = _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+        _mm_storeu_si128((__m128i *)(dst + i), result);
+    }
+    
+    scale_row_bilinear_scalar(dst + i, src, source_x + i, weights + i, count - i);
+}
+
+/*
+  dest and source are width x height pixels with the pitch in bytes, they must not overlap.
+  temp_arena is only used for the duration of the call.
+*/
+function void scale_pixels(U32 *dest, I32 dest_width, I32 dest_height, I32 dest_pitch,
+                           U32 *source, I32 source_width, I32 source_height, I32 source_pitch,
+                           ScaleFilter filter, MemoryArena *temp_arena)
+{
+    if((dest_width <= 0) || (dest_height <= 0) || (source_width <= 0) || (source_height <= 0))
+    {
+        return;
+    }
+    
+    BEGIN_TIMED_BLOCK(ScaleBuffer);
+    
+    size_t arena_used = temp_arena->used;
+    ScaleAxis axis_x = make_scale_axis(source_width, dest_width);
+    ScaleAxis axis_y = make_scale_axis(source_height, dest_height);
+    I32 *source_x = push_array(temp_arena, dest_width, I32, 16);
+    
+    // NOTE(alexey): Bilinear needs at least a pair of pixels in a source row.
+    if((filter == ScaleFilter_Nearest) || (source_width < 2))
+    {
+        for(I32 x = 0; x < dest_width; ++x)
+        {
+            source_x[x] = get_nearest_index(&axis_x, x);
+        }
+        
+        // NOTE(alexey): When upscaling, the rows that sample the same source row are copies of the previous one.
+        I32 prev_source_y = -1;
+        U8 *dst_row = (U8 *)dest;
+        for(I32 y = 0; y < dest_height; ++y)
+        {
+            I32 source_y = get_nearest_index(&axis_y, y);
+            if(source_y == prev_source_y)
+            {
+                memcpy(dst_row, dst_row - dest_pitch, dest_width*sizeof(U32));
+            }
+            else
+            {
+                U32 *src_row = (U32 *)((U8 *)source + (size_t)source_y*source_pitch);
+#if !GAME_RENDER_SIMD
+                scale_row_nearest_scalar((U32 *)dst_row, src_row, source_x, dest_width);
+#else
+                scale_row_nearest_sse2((U32 *)dst_row, src_row, source_x, dest_width);
+#endif
+            }
+            
+            prev_source_y = source_y;
+            dst_row += dest_pitch;
+        }
+    }
+    else
+    {
+        U32 *weights = push_array(temp_arena, dest_width, U32, 16);
+        for(I32 x = 0; x < dest_width; ++x)
+        {
+            U32 weight;
+            I32 index = get_bilinear_index(&axis_x, x, &weight);
+            
+            // NOTE(alexey): The last source pixel is blended from the one before it with the full weight,
+            // so the pair loads never go past the end of the row.
+            if(index == source_width - 1)
+            {
+                index -= 1;
+                weight = SCALE_WEIGHT_ONE;
+            }
+            
+            source_x[x] = index;
+            weights[x] = (weight << 16) | (SCALE_WEIGHT_ONE - weight);
+        }
+        
+        // NOTE(alexey): The source rows are scaled horizontally once, and the last two of them are kept,
+        // a destination row is then a blend of two of those. When upscaling, every source row is used 
+        // by several destination rows in a row, so there are fewer horizontal passes than destination rows.
+        I32 scaled_row_source_y[2] = {-1, -1};
+        U32 *scaled_rows[2];
+        scaled_rows[0] = push_array(temp_arena, dest_width, U32, 16);
+        scaled_rows[1] = push_array(temp_arena, dest_width, U32, 16);
+        
+        U8 *dst_row = (U8 *)dest;
+        for(I32 y = 0; y < dest_height; ++y)
+        {
+            U32 weight_y;
+            I32 source_y0 = get_bilinear_index(&axis_y, y, &weight_y);
+            I32 source_y1 = Minimum(source_y0 + 1, source_height - 1);
+            
+            U32 *rows[2];
+            I32 needed_source_y[2] = {source_y0, source_y1};
+            for(U32 needed_index = 0; needed_index < 2; ++needed_index)
+            {
+                I32 needed_y = needed_source_y[needed_index];
+                U32 slot = (scaled_row_source_y[1] == needed_y);
+                if(scaled_row_source_y[slot] != needed_y)
+                {
+                    // NOTE(alexey): Overwrite the slot that doesn't hold the other row this destination row needs.
+                    slot = (needed_index == 1) ? (rows[0] == scaled_rows[0]) : (scaled_row_source_y[0] == source_y1);
+                    
+                    U32 *src_row = (U32 *)((U8 *)source + (size_t)needed_y*source_pitch);
+#if !GAME_RENDER_SIMD
+                    scale_row_bilinear_scalar(scaled_rows[slot], src_row, source_x, weights, dest_width);
+#else
+                    scale_row_bilinear_sse2(scaled_rows[slot], src_row, source_x, weights, dest_width);
+#endif
+                    scaled_row_source_y[slot] = needed_y;
+                }
+                
+                rows[needed_index] = scaled_rows[slot];
+            }
+            
+            if(weight_y == 0)
+            {
+                memcpy(dst_row, rows[0], dest_width*sizeof(U32));
+            }
+            else
+            {
+#if !GAME_RENDER_SIMD
+                blend_rows_scalar((U32 *)dst_row, rows[0], rows[1], weight_y, dest_width);
+#else
+                blend_rows_sse2((U32 *)dst_row, rows[0], rows[1], weight_y, dest_width);
+#endif
+            }
+            
+            dst_row += dest_pitch;
+        }
+    }
+    
+    temp_arena->used = arena_used;
+    
+    END_TIMED_BLOCK_COUNTED(ScaleBuffer, dest_width*dest_height);
+}
+
+function void scale_buffer(OffscreenBuffer *dest, OffscreenBuffer *source, ScaleFilter filter, MemoryArena *temp_arena)
+{
+    scale_pixels((U32 *)dest->data, dest->width, dest->height, dest->pitch,
+                 (U32 *)source->data, source->width, source->height, source->pitch, filter, temp_arena);
+}
+
+// NOTE(alexey): dest keeps its memory, which has to be big enough for width x height pixels.
+function void scale_bitmap(Bitmap *dest, Bitmap *source, I32 width, I32 height, MemoryArena *temp_arena)
+{
+    dest->width = width;
+    dest->height = height;
+    dest->pitch = ((width*sizeof(U32)) + (BITMAP_ROW_ALIGNMENT - 1)) & ~(BITMAP_ROW_ALIGNMENT - 1);
+    if(source->memory)
+    {
+        scale_pixels(dest->memory, dest->width, dest->height, dest->pitch,
+                     source->memory, source->width, source->height, source->pitch, ScaleFilter_Bilinear, temp_arena);
+    }
+}
+
+void DebugOverlay::begin(MemoryArena *frame_arena, U32 max_rect_count)
+{
+    m_rects = 0;
+    m_rect_count = 0;
+    m_max_rect_count = 0;
+    
+    if(m_is_enabled)
+    {
+        m_rects = push_array(frame_arena, max_rect_count, DebugRect);
+        m_max_rect_count = max_rect_count;
+    }
+}
+
+void DebugOverlay::pushRect(RectangleStyle style, I32 minx, I32 miny, I32 maxx, I32 maxy, PackedColor color)
+{
+    assert(m_is_enabled);
+    
+    // NOTE(alexey): Silently drop the primitives that don't fit, it's only debug visualization.
+    if(m_rect_count < m_max_rect_count)
+    {
+        DebugRect *rect = &m_rects[m_rect_count++];
+        rect->minx = minx;
+        rect->miny = miny;
+        rect->maxx = maxx;
+        rect->maxy = maxy;
+        rect->color = color;
+        rect->style = style;
+    }
+}
+
+void DebugOverlay::pushRect(RectangleStyle style, F32 minx, F32 miny, F32 maxx, F32 maxy, PackedColor color)
+{
+    pushRect(style, 
+             round_real32_to_int32(minx), round_real32_to_int32(miny), 
+             round_real32_to_int32(maxx), round_real32_to_int32(maxy), 
+             color);
+}
+
+void DebugOverlay::render(OffscreenBuffer *buffer)
+{
+    if(!m_is_enabled)
+    {
+        return;
+    }
+    
+    BEGIN_TIMED_BLOCK(DebugOverlay);
+    
+    for(U32 rect_index = 0; rect_index < m_rect_count; ++rect_index)
+    {
+        DebugRect *rect = &m_rects[rect_index];
+        draw_pixel_rectangle(buffer, rect->style, rect->minx, rect->miny, rect->maxx, rect->maxy, rect->color);
+    }
+    
+    END_TIMED_BLOCK_COUNTED(DebugOverlay, m_rect_count);
+}
@@ -0,0 +1,90 @@
+/* date = October 18th 2023 6:40 pm */
+#ifndef GAME_RENDER_H
+
+// NOTE(alexey): Color in the OffscreenBuffer's format 0x AA RR GG BB.
+// Colors are packed once (see init_palette), so the draw calls never touch floats.
+typedef U32 PackedColor;
+
+enum PaletteColor
+{
+    PaletteColor_Background,
+    
+    PaletteColor_Wall,
+    PaletteColor_Door,
+    PaletteColor_PlayerTile,
+    PaletteColor_TileFrame,
+    PaletteColor_TileCorner,
+    
+    PaletteColor_Player,
+    PaletteColor_PlayerCollisionBox,
+    PaletteColor_PlayerProbe,
+    
+    PaletteColor_DebugPath,
+    
+    PaletteColor_Count,
+};
+
+struct Palette
+{
+    PackedColor colors[PaletteColor_Count];
+};
+
+enum RectangleStyle
+{
+    RectangleStyle_Filled = 1,
+    RectangleStyle_Wireframe,
+};
+
+// NOTE(alexey): Pixels are stored the same way as in the OffscreenBuffer,
+// 0x AA RR GG BB, rows go bottom-up.
+// Colors are pre-multiplied by alpha, so blending is dst = src + dst*(1 - src_alpha).
+// Memory and pitch are 16-byte aligned, so the SIMD kernels can walk whole rows.
+struct Bitmap
+{
+    I32 width;
+    I32 height;
+    I32 pitch;
+    U32 *memory;
+};
+
+#define BITMAP_ROW_ALIGNMENT 16
+
+// NOTE(alexey): How the internal render resolution is scaled to the output (see scale_buffer).
+enum ScaleFilter
+{
+    ScaleFilter_Nearest,
+    ScaleFilter_Bilinear,
+    
+    ScaleFilter_Count,
+};
+
+struct DebugRect
+{
+    I32 minx;
+    I32 miny;
+    I32 maxx;
+    I32 maxy;
+    PackedColor color;
+    RectangleStyle style;
+};
+
+// NOTE(alexey): Debug visualization is recorded into a batch while the scene is drawn,
+// and rasterized in one pass on top of it. The batch lives in frame memory.
+// When the overlay is disabled, nothing is recorded and nothing is allocated,
+// callers are expected to check m_is_enabled before computing any debug geometry.
+struct DebugOverlay
+{
+    void begin(MemoryArena *frame_arena, U32 max_rect_count);
+    void pushRect(RectangleStyle style, I32 minx, I32 miny, I32 maxx, I32 maxy, PackedColor color);
+    void pushRect(RectangleStyle style, F32 minx, F32 miny, F32 maxx, F32 maxy, PackedColor color);
+    void render(OffscreenBuffer *buffer);
+    
+    Bool32 m_is_enabled;
+    
+    DebugRect *m_rects;
+    U32 m_rect_count;
+    U32 m_max_rect_count;
+};
+
+#define GAME_RENDER_H
+#endif //GAME_RENDER_H
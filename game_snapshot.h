@@ -0,0 +1,80 @@
+/* date = October 27th 2023 8:40 pm */
+#ifndef GAME_SNAPSHOT_H
+
+/*
+  Everything GameState::render needs from the simulation, copied out at the end of a simulation batch.
+
+  The simulation can run on its own thread (os->simulation_queue), so the renderer never looks at the live state,
+  only at the latest snapshot. Snapshots go through a triple buffer: the simulation always has a slot of its own
+  to write into, the renderer has the one it draws, and the third one is the latest published snapshot.
+  Publishing and taking the latest snapshot are a single exchange each, neither side ever waits for the other.
+  If the simulation publishes twice before the renderer looks, the older snapshot is simply dropped,
+  and if the renderer is faster it keeps drawing the snapshot it has (interpolated further along).
+  The input goes the other way through a triple buffer of its own. TripleBuffer itself is in os.h,
+  the platform hands the controller over from its polling thread with one too.
+
+  The tiles are the ones the camera sees from both of the last two steps, so any interpolated camera position
+  between them finds all of its tiles in the snapshot.
+*/
+
+struct RenderSnapshot
+{
+    U64 step_index; // the simulation steps done so far, 0 until the first snapshot.
+    U64 input_qpc; // when the input the snapshot was simulated with was sampled.
+    U64 publish_qpc;
+    F32 accumulator; // simulation time that wasn't stepped yet when the snapshot was published.
+
+    WorldPos prev_player_pos;
+    WorldPos player_pos;
+    WorldPos prev_camera_pos;
+    WorldPos camera_pos;
+
+    Bool32 debug_overlay_is_enabled;
+    U32 debug_path_point_count;
+    TilePoint *debug_path;
+
+    // NOTE(alexey): Absolute tiles, the bottom row first.
+    // The tiles outside of the rect read as TileValue_Invalid.
+    TileRect tiles;
+    U32 *tile_values;
+    U8 *light_levels;
+
+    inline U32 getTileValue(I32 abs_tile_x, I32 abs_tile_y);
+    inline U8 getLightLevel(I32 abs_tile_x, I32 abs_tile_y);
+};
+
+// NOTE(alexey): A timestamped copy of the platform's input, for the simulation thread.
+// view_dim is what the camera sees at the output's size, in meters (see get_view_dim).
+struct InputSample
+{
+    Input input;
+    U64 qpc;
+    Vec2 view_dim;
+};
+
+inline U32 RenderSnapshot::getTileValue(I32 abs_tile_x, I32 abs_tile_y)
+{
+    if((abs_tile_x < tiles.min_tile_x) || (abs_tile_y < tiles.min_tile_y) ||
+       (abs_tile_x >= tiles.max_tile_x) || (abs_tile_y >= tiles.max_tile_y))
+    {
+        return TileValue_Invalid;
+    }
+
+    I32 width = tiles.max_tile_x - tiles.min_tile_x;
+    return tile_values[(abs_tile_y - tiles.min_tile_y)*width + (abs_tile_x - tiles.min_tile_x)];
+}
+
+inline U8 RenderSnapshot::getLightLevel(I32 abs_tile_x, I32 abs_tile_y)
+{
+    if((abs_tile_x < tiles.min_tile_x) || (abs_tile_y < tiles.min_tile_y) ||
+       (abs_tile_x >= tiles.max_tile_x) || (abs_tile_y >= tiles.max_tile_y))
+    {
+        return LIGHTING_FOG_LEVEL;
+    }
+
+    I32 width = tiles.max_tile_x - tiles.min_tile_x;
+    return light_levels[(abs_tile_y - tiles.min_tile_y)*width + (abs_tile_x - tiles.min_tile_x)];
+}
+
+#define GAME_SNAPSHOT_H
+#endif //GAME_SNAPSHOT_H
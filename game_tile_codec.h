@@ -0,0 +1,99 @@
+/* date = October 20th 2023 10:15 am */
+#ifndef GAME_TILE_CODEC_H
+
+/*
+  Run-length encoding for the tile maps.
+  
+  A tile map is mostly empty tiles with walls along the borders, so a row like
+  1 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 1 turns into three runs. Runs go across the rows,
+  the last wall of a row and the first wall of the next one end up in the same run.
+  
+  Every run is a single U32: the top 8 bits are the length (1..255), the low 24 bits are the tile value.
+  Tile values that don't fit into 24 bits can't be encoded, such chunks are stored raw.
+*/
+
+#define TILE_RUN_MAX_LENGTH 255
+#define TILE_RUN_MAX_VALUE ((1u << 24) - 1)
+
+// NOTE(alexey): Returns the size of the encoded data in bytes, or 0 if the tiles can't be encoded
+// or the encoded data wouldn't fit into dest_size bytes.
+function U32 rle_encode_tiles(U32 *tiles, U32 tile_count, U32 *dest, U32 dest_size)
+{
+    U32 run_count = 0;
+    U32 max_run_count = dest_size / sizeof(U32);
+    
+    U32 tile_index = 0;
+    while(tile_index < tile_count)
+    {
+        U32 value = tiles[tile_index];
+        if(value > TILE_RUN_MAX_VALUE)
+        {
+            return 0;
+        }
+        
+        U32 length = 1;
+        while((tile_index + length < tile_count) &&
+              (tiles[tile_index + length] == value) &&
+              (length < TILE_RUN_MAX_LENGTH))
+        {
+            ++length;
+        }
+        
+        if(run_count == max_run_count)
+        {
+            return 0;
+        }
+        
+        dest[run_count++] = (length << 24) | value;
+        tile_index += length;
+    }
+    
+    U32 result = run_count*sizeof(U32);
+    return result;
+}
+
+// NOTE(alexey): The data comes from a file, so it's validated as we go.
+// Returns false if the runs don't add up to exactly tile_count tiles.
+function bool32 rle_decode_tiles(U32 *runs, U32 size, U32 *dest, U32 tile_count)
+{
+    if(size % sizeof(U32))
+    {
+        return false;
+    }
+    
+    U32 *at = dest;
+    U32 *end = dest + tile_count;
+    
+    U32 run_count = size / sizeof(U32);
+    for(U32 run_index = 0; run_index < run_count; ++run_index)
+    {
+        U32 run = runs[run_index];
+        U32 length = (run >> 24);
+        U32 value = (run & TILE_RUN_MAX_VALUE);
+        
+        if(!length || (length > (U32)(end - at)))
+        {
+            return false;
+        }
+        
+        // NOTE(alexey): Most of the runs are long runs of empty tiles, fill them four at a time.
+        __m128i value_4x = _mm_set1_epi32((int)value);
+        while(length >= 4)
+        {
+            _mm_storeu_si128((__m128i *)at, value_4x);
+            at += 4;
+            length -= 4;
+        }
+        
+        while(length--)
+        {
+            *at++ = value;
+        }
+    }
+    
+    bool32 result = (at == end);
+    return result;
+}
+
+#define GAME_TILE_CODEC_H
+#endif //GAME_TILE_CODEC_H
@@ -0,0 +1,53 @@
+/* date = October 19th 2023 11:20 am */
+#ifndef GAME_WORLD_FILE_H
+
+/*
+  World file layout:
+
+  +--------------------+  0
+  | WorldFileHeader    |
+  +--------------------+
+  | chunk data         |  one blob per tile map (chunk), see WorldFileChunkEntry
+  | ...                |
+  +--------------------+  header.chunk_index_offset
+  | WorldFileChunkEntry|  tile_map_count_x*tile_map_count_y entries,
+  | ...                |  entry index is tile_map_y*tile_map_count_x + tile_map_x
+  +--------------------+
+
+  Chunk data is tile_count_x*tile_count_y U32 values laid out the same way as TileMap::tiles
+  (the first row is the top one). When the chunk has WorldFileChunkFlag_RLE set,
+  the data is run-length encoded instead (see game_tile_codec.h) and size is the encoded size.
+*/
+
+#define WORLD_FILE_MAGIC (('T' << 0) | ('W' << 8) | ('L' << 16) | ('D' << 24))
+#define WORLD_FILE_VERSION 2 // 2: the chunks can be run-length encoded (WorldFileChunkFlag_RLE).
+
+#pragma pack(push, 1)
+struct WorldFileHeader
+{
+    U32 magic;
+    U32 version;
+
+    I32 tile_map_count_x;
+    I32 tile_map_count_y;
+    I32 tile_count_x;
+    I32 tile_count_y;
+
+    U64 chunk_index_offset;
+};
+
+enum WorldFileChunkFlag
+{
+    WorldFileChunkFlag_RLE = 0x1,
+};
+
+struct WorldFileChunkEntry
+{
+    U64 offset;
+    U32 size;
+    U32 flags;
+};
+#pragma pack(pop)
+
+#define GAME_WORLD_FILE_H
+#endif //GAME_WORLD_FILE_H
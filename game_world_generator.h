@@ -0,0 +1,199 @@
+/* date = October 21st 2023 3:30 pm */
+#ifndef GAME_WORLD_GENERATOR_H
+
+/*
+  Procedural tile maps for the stress test worlds.
+
+  Every tile map is generated from the hash of the seed and its own coordinates only,
+  so the tile maps can be generated in any order, on any amount of threads, and the result is always the same.
+
+  A tile map is a walled room that is split into smaller rooms (binary space partition),
+  every inner wall has an opening, so all the tiles inside of a tile map are reachable.
+  Doors between two neighbouring tile maps are picked from the hash of the edge they share,
+  so both tile maps put the door at the same place without knowing anything about each other.
+*/
+
+struct WorldGeneratorParams
+{
+    U64 seed;
+
+    I32 tile_map_count_x;
+    I32 tile_map_count_y;
+    I32 tile_count_x;
+    I32 tile_count_y;
+};
+
+enum WorldGeneratorSalt
+{
+    WorldGeneratorSalt_TileMap,
+    WorldGeneratorSalt_VerticalEdge,   // edge between (x, y) and (x + 1, y)
+    WorldGeneratorSalt_HorizontalEdge, // edge between (x, y) and (x, y + 1)
+};
+
+// NOTE(alexey): splitmix64 finalizer.
+inline U64 hash_u64(U64 value)
+{
+    value ^= (value >> 30);
+    value *= 0xbf58476d1ce4e5b9ull;
+    value ^= (value >> 27);
+    value *= 0x94d049bb133111ebull;
+    value ^= (value >> 31);
+    return value;
+}
+
+inline U64 hash_tile_map(U64 seed, I32 tile_map_x, I32 tile_map_y, WorldGeneratorSalt salt)
+{
+    U64 result = hash_u64(seed ^ 0x9e3779b97f4a7c15ull);
+    result = hash_u64(result ^ (U32)tile_map_x);
+    result = hash_u64(result ^ ((U64)(U32)tile_map_y << 32));
+    result = hash_u64(result + (U64)salt);
+    return result;
+}
+
+struct RandomSeries
+{
+    U64 state;
+};
+
+inline U32 random_next(RandomSeries *series)
+{
+    series->state = hash_u64(series->state + 0x9e3779b97f4a7c15ull);
+    U32 result = (U32)(series->state >> 32);
+    return result;
+}
+
+// NOTE(alexey): Returns a value in [min, max], both inclusive.
+inline I32 random_between(RandomSeries *series, I32 min, I32 max)
+{
+    assert(min <= max);
+    I32 result = min + (I32)(random_next(series) % (U32)(max - min + 1));
+    return result;
+}
+
+// NOTE(alexey): The first row of tiles is the top one (the same way as TileMap::tiles).
+inline void set_generated_tile(WorldGeneratorParams *params, U32 *tiles, I32 tile_x, I32 tile_y, U32 value)
+{
+    tiles[(params->tile_count_y - tile_y - 1)*params->tile_count_x + tile_x] = value;
+}
+
+// NOTE(alexey): The region is the inclusive range of tiles that still can be split,
+// tile_y goes up here, the same way as in the rest of the game.
+function void generate_rooms(WorldGeneratorParams *params, RandomSeries *series, U32 *tiles,
+                             I32 min_x, I32 min_y, I32 max_x, I32 max_y, I32 depth)
+{
+    I32 width = max_x - min_x + 1;
+    I32 height = max_y - min_y + 1;
+
+    // NOTE(alexey): Rooms on both sides of a wall are at least two tiles wide.
+    bool32 can_split_x = (width >= 5);
+    bool32 can_split_y = (height >= 5);
+    if(!depth || (!can_split_x && !can_split_y))
+    {
+        return;
+    }
+
+    bool32 split_x = can_split_x;
+    if(can_split_x && can_split_y)
+    {
+        // NOTE(alexey): Prefer splitting the longer side, so the rooms don't end up as corridors only.
+        split_x = ((I32)(random_next(series) % (U32)(width + height)) < width);
+    }
+
+    I32 opening_x;
+    I32 opening_y;
+    if(split_x)
+    {
+        I32 wall_x = random_between(series, min_x + 2, max_x - 2);
+        for(I32 tile_y = min_y; tile_y <= max_y; ++tile_y)
+        {
+            set_generated_tile(params, tiles, wall_x, tile_y, TileValue_Wall);
+        }
+
+        opening_x = wall_x;
+        opening_y = random_between(series, min_y, max_y);
+
+        generate_rooms(params, series, tiles, min_x, min_y, wall_x - 1, max_y, depth - 1);
+        generate_rooms(params, series, tiles, wall_x + 1, min_y, max_x, max_y, depth - 1);
+
+        // NOTE(alexey): The walls of the smaller rooms could have closed the opening from either side.
+        set_generated_tile(params, tiles, opening_x - 1, opening_y, TileValue_Empty);
+        set_generated_tile(params, tiles, opening_x + 1, opening_y, TileValue_Empty);
+    }
+    else
+    {
+        I32 wall_y = random_between(series, min_y + 2, max_y - 2);
+        for(I32 tile_x = min_x; tile_x <= max_x; ++tile_x)
+        {
+            set_generated_tile(params, tiles, tile_x, wall_y, TileValue_Wall);
+        }
+
+        opening_x = random_between(series, min_x, max_x);
+        opening_y = wall_y;
+
+        generate_rooms(params, series, tiles, min_x, min_y, max_x, wall_y - 1, depth - 1);
+        generate_rooms(params, series, tiles, min_x, wall_y + 1, max_x, max_y, depth - 1);
+
+        set_generated_tile(params, tiles, opening_x, opening_y - 1, TileValue_Empty);
+        set_generated_tile(params, tiles, opening_x, opening_y + 1, TileValue_Empty);
+    }
+
+    set_generated_tile(params, tiles, opening_x, opening_y, TileValue_Empty);
+}
+
+// NOTE(alexey): Doors never go into the corners, and the tile in front of a door is always cleared.
+function void generate_door(WorldGeneratorParams *params, U32 *tiles, I32 door_x, I32 door_y,
+                            I32 inside_x, I32 inside_y)
+{
+    set_generated_tile(params, tiles, door_x, door_y, TileValue_Door);
+    set_generated_tile(params, tiles, inside_x, inside_y, TileValue_Empty);
+}
+
+function void generate_tile_map(WorldGeneratorParams *params, I32 tile_map_x, I32 tile_map_y, U32 *tiles)
+{
+    I32 max_tile_x = params->tile_count_x - 1;
+    I32 max_tile_y = params->tile_count_y - 1;
+
+    for(I32 tile_y = 0; tile_y <= max_tile_y; ++tile_y)
+    {
+        for(I32 tile_x = 0; tile_x <= max_tile_x; ++tile_x)
+        {
+            bool32 is_border = ((tile_x == 0) || (tile_y == 0) || (tile_x == max_tile_x) || (tile_y == max_tile_y));
+            set_generated_tile(params, tiles, tile_x, tile_y, is_border ? TileValue_Wall : TileValue_Empty);
+        }
+    }
+
+    RandomSeries series = {hash_tile_map(params->seed, tile_map_x, tile_map_y, WorldGeneratorSalt_TileMap)};
+    generate_rooms(params, &series, tiles, 1, 1, max_tile_x - 1, max_tile_y - 1, 3);
+
+    // NOTE(alexey): Every tile map has a door on each of the edges it shares with another tile map.
+    if(tile_map_x > 0)
+    {
+        U64 hash = hash_tile_map(params->seed, tile_map_x - 1, tile_map_y, WorldGeneratorSalt_VerticalEdge);
+        I32 door_y = 1 + (I32)(hash % (U64)(max_tile_y - 1));
+        generate_door(params, tiles, 0, door_y, 1, door_y);
+    }
+
+    if(tile_map_x < params->tile_map_count_x - 1)
+    {
+        U64 hash = hash_tile_map(params->seed, tile_map_x, tile_map_y, WorldGeneratorSalt_VerticalEdge);
+        I32 door_y = 1 + (I32)(hash % (U64)(max_tile_y - 1));
+        generate_door(params, tiles, max_tile_x, door_y, max_tile_x - 1, door_y);
+    }
+
+    if(tile_map_y > 0)
+    {
+        U64 hash = hash_tile_map(params->seed, tile_map_x, tile_map_y - 1, WorldGeneratorSalt_HorizontalEdge);
+        I32 door_x = 1 + (I32)(hash % (U64)(max_tile_x - 1));
+        generate_door(params, tiles, door_x, 0, door_x, 1);
+    }
+
+    if(tile_map_y < params->tile_map_count_y - 1)
+    {
+        U64 hash = hash_tile_map(params->seed, tile_map_x, tile_map_y, WorldGeneratorSalt_HorizontalEdge);
+        I32 door_x = 1 + (I32)(hash % (U64)(max_tile_x - 1));
+        generate_door(params, tiles, door_x, max_tile_y, door_x, max_tile_y - 1);
+    }
+}
+
+#define GAME_WORLD_GENERATOR_H
+#endif //GAME_WORLD_GENERATOR_H
@@ -0,0 +1,657 @@
+// NOTE(alexey): Runs on the platform's loader thread.
+function void load_chunk_work(WorkQueue *queue, void *data)
+{
+    ChunkSlot *slot = (ChunkSlot *)data;
+    WorldStreamer *streamer = slot->streamer;
+    
+    U64 chunk_index = (U64)slot->tile_map_y*streamer->m_header.tile_map_count_x + slot->tile_map_x;
+    WorldFileChunkEntry *entry = &streamer->m_chunk_index[chunk_index];
+    
+    if(entry->flags & WorldFileChunkFlag_RLE)
+    {
+        slot->read_failed = (!os->read_file_at(&streamer->m_file, entry->offset, entry->size, slot->encoded) ||
+                             !streamer->decodeChunk(slot->encoded, entry->size, slot->tiles));
+    }
+    else
+    {
+        slot->read_failed = !os->read_file_at(&streamer->m_file, entry->offset, entry->size, slot->tiles);
+    }
+    
+    slot->complete_counts = os->get_qpc();
+    
+    atomic_store_uint32(&slot->state, ChunkSlotState_Ready);
+}
+
+// NOTE(alexey): Mapped is the default, set to WorldStreamerMode_Streamed to go back to the slots and the loader thread,
+// or to WorldStreamerMode_Loaded to compare the startup time against reading the whole world.
+#ifndef GAME_WORLD_STREAMER_MODE
+#define GAME_WORLD_STREAMER_MODE WorldStreamerMode_Mapped
+#endif
+
+// NOTE(alexey): Called from the loader thread in the streamed mode, hence the atomics.
+Bool32 WorldStreamer::decodeChunk(U32 *encoded, U32 encoded_size, U32 *tiles)
+{
+    U64 start_counts = os->get_qpc();
+    
+    U32 tile_count = (U32)(m_header.tile_count_x*m_header.tile_count_y);
+    Bool32 result = rle_decode_tiles(encoded, encoded_size, tiles, tile_count);
+    
+    atomic_add_uint64(&m_decoded_counts, os->get_qpc() - start_counts);
+    atomic_add_uint64(&m_decoded_bytes, tile_count*sizeof(U32));
+    
+    return result;
+}
+
+Bool32 WorldStreamer::openFileMemory(const char *file_name)
+{
+    if(m_mode == WorldStreamerMode_Mapped)
+    {
+        m_mapping = os->map_file(file_name);
+        m_file_memory = (U8 *)m_mapping.memory;
+        m_file_size = m_mapping.size;
+    }
+    else
+    {
+        m_contents = os->read_entire_file(file_name);
+        m_file_memory = (U8 *)m_contents.data;
+        m_file_size = m_contents.size;
+    }
+    
+    return (m_file_memory != 0);
+}
+
+void WorldStreamer::close()
+{
+    if(m_mode == WorldStreamerMode_Streamed)
+    {
+        os->close_file(&m_file);
+    }
+    else if(m_mode == WorldStreamerMode_Mapped)
+    {
+        os->unmap_file(&m_mapping);
+    }
+    else
+    {
+        os->free_file_memory(m_contents.data);
+        m_contents = {};
+    }
+    
+    m_file_memory = 0;
+    m_file_size = 0;
+    m_is_open = false;
+}
+
+Bool32 WorldStreamer::open(MemoryArena *arena, const char *file_name, WorldStreamerMode mode, 
+                           U32 slot_count, I32 load_radius)
+{
+    U64 start_counts = os->get_qpc();
+    
+    m_is_open = false;
+    m_mode = mode;
+    m_arena = arena;
+    
+    Bool32 is_valid = false;
+    if(m_mode == WorldStreamerMode_Streamed)
+    {
+        m_file = os->open_file(file_name);
+        if(!m_file.handle)
+        {
+            return false;
+        }
+        
+        m_file_size = m_file.size;
+        is_valid = ((m_file_size >= sizeof(WorldFileHeader)) &&
+                    os->read_file_at(&m_file, 0, sizeof(WorldFileHeader), &m_header));
+    }
+    else
+    {
+        if(!openFileMemory(file_name))
+        {
+            return false;
+        }
+        
+        is_valid = (m_file_size >= sizeof(WorldFileHeader));
+        if(is_valid)
+        {
+            memcpy(&m_header, m_file_memory, sizeof(WorldFileHeader));
+        }
+    }
+    
+    is_valid = (is_valid &&
+                (m_header.magic == WORLD_FILE_MAGIC) &&
+                (m_header.version == WORLD_FILE_VERSION) &&
+                (m_header.tile_map_count_x > 0) && (m_header.tile_map_count_y > 0) &&
+                (m_header.tile_count_x > 0) && (m_header.tile_count_y > 0));
+    
+    U64 chunk_count = (U64)m_header.tile_map_count_x*m_header.tile_map_count_y;
+    U64 index_size = chunk_count*sizeof(WorldFileChunkEntry);
+    
+    is_valid = (is_valid && (m_header.chunk_index_offset + index_size <= m_file_size));
+    if(is_valid)
+    {
+        if(m_mode == WorldStreamerMode_Streamed)
+        {
+            m_chunk_index = push_array(arena, chunk_count, WorldFileChunkEntry);
+            is_valid = os->read_file_at(&m_file, m_header.chunk_index_offset, index_size, m_chunk_index);
+        }
+        else
+        {
+            m_chunk_index = (WorldFileChunkEntry *)(m_file_memory + m_header.chunk_index_offset);
+        }
+    }
+    
+    if(!is_valid)
+    {
+        close();
+        return false;
+    }
+    
+    // NOTE(alexey): Permanent memory comes zeroed from the platform, so all the tile maps start out
+    // not resident and without a slot, without us touching the pages. In the mapped mode that's what keeps 
+    // the startup independent of the world size, only the tile maps around the player are ever written.
+    m_maps = push_array(arena, chunk_count, TileMap);
+    m_chunk_slots = push_array(arena, chunk_count, U32);
+    
+    // NOTE(alexey): In the streamed mode the slots hold every chunk that was read,
+    // in the other modes only the decoded chunks (the hot chunk cache), raw chunks are used in place.
+    U32 tile_count = (U32)(m_header.tile_count_x*m_header.tile_count_y);
+    m_slot_count = slot_count;
+    m_slots = push_array(arena, slot_count, ChunkSlot);
+    for(U32 slot_index = 0; slot_index < slot_count; ++slot_index)
+    {
+        ChunkSlot *slot = &m_slots[slot_index];
+        *slot = {};
+        slot->state = ChunkSlotState_Free;
+        slot->tiles = push_array(arena, tile_count, U32, 16);
+        if(m_mode == WorldStreamerMode_Streamed)
+        {
+            slot->encoded = push_array(arena, tile_count, U32, 16);
+        }
+        slot->streamer = this;
+    }
+    
+    m_mapped_rect = {0, 0, -1, -1};
+    m_mapped_rect_is_complete = false;
+    m_load_radius = load_radius;
+    m_frame_index = 0;
+    m_is_open = true;
+    
+    m_open_counts = os->get_qpc() - start_counts;
+    
+    return true;
+}
+
+void WorldStreamer::attach(GameWorld *world)
+{
+    m_world = world;
+    
+    if(m_mode == WorldStreamerMode_Loaded)
+    {
+        for(I32 tile_map_y = 0; tile_map_y < m_header.tile_map_count_y; ++tile_map_y)
+        {
+            for(I32 tile_map_x = 0; tile_map_x < m_header.tile_map_count_x; ++tile_map_x)
+            {
+                // NOTE(alexey): Encoded chunks go through the hot chunk cache, see updateFileMemory.
+                WorldFileChunkEntry *entry = getValidChunkEntry(tile_map_x, tile_map_y);
+                if(entry && !(entry->flags & WorldFileChunkFlag_RLE))
+                {
+                    TileMap *map = m_world->getWorldTileMap(tile_map_x, tile_map_y);
+                    map->tiles = (U32 *)(m_file_memory + entry->offset);
+                    ++m_loaded_chunk_count;
+                }
+            }
+        }
+    }
+}
+
+// NOTE(alexey): Returns NULL for broken entries, such chunks stay unloaded (and solid) forever.
+WorldFileChunkEntry *WorldStreamer::getValidChunkEntry(I32 tile_map_x, I32 tile_map_y)
+{
+    WorldFileChunkEntry *result = &m_chunk_index[(U64)tile_map_y*m_header.tile_map_count_x + tile_map_x];
+    
+    U32 chunk_size = (U32)(m_header.tile_count_x*m_header.tile_count_y*sizeof(U32));
+    Bool32 is_valid = ((result->flags & WorldFileChunkFlag_RLE) ? 
+                       (result->size && (result->size <= chunk_size) && !(result->size % sizeof(U32))) :
+                       (result->size == chunk_size));
+    
+    if(!is_valid || (result->offset + result->size > m_file_size))
+    {
+        result = 0;
+    }
+    
+    return result;
+}
+
+ChunkRect WorldStreamer::getLoadRect(I32 center_tile_map_x, I32 center_tile_map_y)
+{
+    ChunkRect result;
+    result.min_tile_map_x = center_tile_map_x - m_load_radius;
+    result.max_tile_map_x = center_tile_map_x + m_load_radius;
+    result.min_tile_map_y = center_tile_map_y - m_load_radius;
+    result.max_tile_map_y = center_tile_map_y + m_load_radius;
+    
+    if(result.min_tile_map_x < 0)
+    {
+        result.min_tile_map_x = 0;
+    }
+    
+    if(result.min_tile_map_y < 0)
+    {
+        result.min_tile_map_y = 0;
+    }
+    
+    if(result.max_tile_map_x >= m_header.tile_map_count_x)
+    {
+        result.max_tile_map_x = m_header.tile_map_count_x - 1;
+    }
+    
+    if(result.max_tile_map_y >= m_header.tile_map_count_y)
+    {
+        result.max_tile_map_y = m_header.tile_map_count_y - 1;
+    }
+    
+    return result;
+}
+
+// NOTE(alexey): The chunks of a row are next to each other in the file, 
+// so there is a single hint per row instead of one per chunk.
+void WorldStreamer::adviseChunks(ChunkRect rect, PlatformMemoryAdvice advice)
+{
+    for(I32 tile_map_y = rect.min_tile_map_y; tile_map_y <= rect.max_tile_map_y; ++tile_map_y)
+    {
+        U64 begin = Uint64Max;
+        U64 end = 0;
+        for(I32 tile_map_x = rect.min_tile_map_x; tile_map_x <= rect.max_tile_map_x; ++tile_map_x)
+        {
+            WorldFileChunkEntry *entry = getValidChunkEntry(tile_map_x, tile_map_y);
+            if(entry)
+            {
+                begin = (entry->offset < begin) ? entry->offset : begin;
+                end = (entry->offset + entry->size > end) ? (entry->offset + entry->size) : end;
+            }
+        }
+        
+        if(begin < end)
+        {
+            os->advise_memory(m_file_memory + begin, end - begin, advice);
+        }
+    }
+}
+
+// NOTE(alexey): Only does the work when the load rect changed, or when a chunk of it didn't get a slot last time
+// (all the slots were wanted), then the missing chunks are tried again every frame until they're in.
+void WorldStreamer::updateFileMemory(WorldPos center)
+{
+    ChunkRect rect = getLoadRect(center.tile_map_x, center.tile_map_y);
+    ChunkRect old_rect = m_mapped_rect;
+    Bool32 rect_changed = ((rect.min_tile_map_x != old_rect.min_tile_map_x) ||
+                           (rect.max_tile_map_x != old_rect.max_tile_map_x) ||
+                           (rect.min_tile_map_y != old_rect.min_tile_map_y) ||
+                           (rect.max_tile_map_y != old_rect.max_tile_map_y));
+    if(!rect_changed && m_mapped_rect_is_complete)
+    {
+        return;
+    }
+    
+    if(rect_changed && (m_mode == WorldStreamerMode_Mapped))
+    {
+        adviseMapping(old_rect, rect, center);
+    }
+    
+    // Mark the wanted chunks in the hot chunk cache as used first, so decoding below doesn't evict them.
+    for(I32 tile_map_y = rect.min_tile_map_y; tile_map_y <= rect.max_tile_map_y; ++tile_map_y)
+    {
+        for(I32 tile_map_x = rect.min_tile_map_x; tile_map_x <= rect.max_tile_map_x; ++tile_map_x)
+        {
+            U32 slot_number = m_chunk_slots[(U64)tile_map_y*m_header.tile_map_count_x + tile_map_x];
+            if(slot_number && (slot_number != CHUNK_SLOT_FAILED))
+            {
+                m_slots[slot_number - 1].last_used_frame = m_frame_index;
+            }
+        }
+    }
+    
+    Bool32 is_complete = true;
+    for(I32 tile_map_y = rect.min_tile_map_y; tile_map_y <= rect.max_tile_map_y; ++tile_map_y)
+    {
+        for(I32 tile_map_x = rect.min_tile_map_x; tile_map_x <= rect.max_tile_map_x; ++tile_map_x)
+        {
+            U64 chunk_index = (U64)tile_map_y*m_header.tile_map_count_x + tile_map_x;
+            TileMap *map = m_world->getWorldTileMap(tile_map_x, tile_map_y);
+            WorldFileChunkEntry *entry = getValidChunkEntry(tile_map_x, tile_map_y);
+            if(map->tiles || !entry || (m_chunk_slots[chunk_index] == CHUNK_SLOT_FAILED))
+            {
+                continue;
+            }
+            
+            if(entry->flags & WorldFileChunkFlag_RLE)
+            {
+                ChunkSlot *slot = allocateSlot();
+                if(!slot)
+                {
+                    is_complete = false;
+                }
+                else if(decodeChunk((U32 *)(m_file_memory + entry->offset), entry->size, slot->tiles))
+                {
+                    slot->tile_map_x = tile_map_x;
+                    slot->tile_map_y = tile_map_y;
+                    slot->last_used_frame = m_frame_index;
+                    slot->state = ChunkSlotState_Resident;
+                    
+                    m_chunk_slots[chunk_index] = (U32)(slot - m_slots) + 1;
+                    map->tiles = slot->tiles;
+                    ++m_loaded_chunk_count;
+                }
+                else
+                {
+                    // NOTE(alexey): The data won't decode any better next time, the slot stays free.
+                    m_chunk_slots[chunk_index] = CHUNK_SLOT_FAILED;
+                    ++m_failed_chunk_count;
+                }
+            }
+            else
+            {
+                map->tiles = (U32 *)(m_file_memory + entry->offset);
+                ++m_loaded_chunk_count;
+            }
+        }
+    }
+    
+    m_mapped_rect = rect;
+    m_mapped_rect_is_complete = is_complete;
+    m_center_tile_map_x = center.tile_map_x;
+    m_center_tile_map_y = center.tile_map_y;
+}
+
+void WorldStreamer::adviseMapping(ChunkRect old_rect, ChunkRect rect, WorldPos center)
+{
+    // Give back the chunks that were left behind. They stay pointed into the mapping (or the cache),
+    // if the player comes back, the pages are simply faulted in again.
+    ChunkRect below = old_rect;
+    below.max_tile_map_y = Minimum(old_rect.max_tile_map_y, rect.min_tile_map_y - 1);
+    
+    ChunkRect above = old_rect;
+    above.min_tile_map_y = Maximum(old_rect.min_tile_map_y, rect.max_tile_map_y + 1);
+    
+    ChunkRect left = old_rect;
+    left.min_tile_map_y = Maximum(old_rect.min_tile_map_y, rect.min_tile_map_y);
+    left.max_tile_map_y = Minimum(old_rect.max_tile_map_y, rect.max_tile_map_y);
+    
+    ChunkRect right = left;
+    left.max_tile_map_x = Minimum(old_rect.max_tile_map_x, rect.min_tile_map_x - 1);
+    right.min_tile_map_x = Maximum(old_rect.min_tile_map_x, rect.max_tile_map_x + 1);
+    
+    adviseChunks(below, PlatformMemoryAdvice_DontNeed);
+    adviseChunks(above, PlatformMemoryAdvice_DontNeed);
+    adviseChunks(left, PlatformMemoryAdvice_DontNeed);
+    adviseChunks(right, PlatformMemoryAdvice_DontNeed);
+    
+    // Prefetch one chunk further in the direction the player is moving.
+    I32 direction_x = 0;
+    I32 direction_y = 0;
+    if(old_rect.min_tile_map_x <= old_rect.max_tile_map_x)
+    {
+        direction_x = Clamp(center.tile_map_x - m_center_tile_map_x, -1, 1);
+        direction_y = Clamp(center.tile_map_y - m_center_tile_map_y, -1, 1);
+    }
+    
+    adviseChunks(rect, PlatformMemoryAdvice_WillNeed);
+    if(direction_x || direction_y)
+    {
+        adviseChunks(getLoadRect(center.tile_map_x + direction_x, center.tile_map_y + direction_y), 
+                     PlatformMemoryAdvice_WillNeed);
+    }
+}
+
+// NOTE(alexey): The mapping is read-only and the slots get reused, so a chunk that is going to be modified
+// is copied into the arena first and the tile map is pointed at the copy. The copy is never evicted.
+U32 *WorldStreamer::getWritableTiles(I32 tile_map_x, I32 tile_map_y)
+{
+    TileMap *map = m_world->getWorldTileMap(tile_map_x, tile_map_y);
+    if(!map || !map->tiles)
+    {
+        return 0;
+    }
+    
+    U64 chunk_index = (U64)tile_map_y*m_header.tile_map_count_x + tile_map_x;
+    U32 slot_number = m_chunk_slots[chunk_index];
+    
+    U8 *tiles = (U8 *)map->tiles;
+    Bool32 is_mapped = ((m_mode == WorldStreamerMode_Mapped) && 
+                        (tiles >= m_file_memory) && (tiles < m_file_memory + m_file_size));
+    
+    if(is_mapped || slot_number)
+    {
+        U32 tile_count = (U32)(m_header.tile_count_x*m_header.tile_count_y);
+        U32 *copy = push_array(m_arena, tile_count, U32, 16);
+        memcpy(copy, map->tiles, tile_count*sizeof(U32));
+        
+        map->tiles = copy;
+        ++m_copied_chunk_count;
+        
+        if(slot_number)
+        {
+            m_slots[slot_number - 1].state = ChunkSlotState_Free;
+            m_chunk_slots[chunk_index] = 0;
+        }
+    }
+    
+    return map->tiles;
+}
+
+// NOTE(alexey): Tiles of any chunk for reading, without making it resident (the pathfinding looks far ahead).
+// Raw chunks point straight into the file memory, encoded ones are decoded into tiles.
+// Only the mapped and the loaded modes have the file in memory, returns NULL in the streamed mode.
+// Safe to call from any thread, tile maps that were modified are always resident, so check those first.
+U32 *WorldStreamer::readChunkTiles(I32 tile_map_x, I32 tile_map_y, U32 *tiles)
+{
+    if(!m_is_open || !m_file_memory)
+    {
+        return 0;
+    }
+    
+    WorldFileChunkEntry *entry = getValidChunkEntry(tile_map_x, tile_map_y);
+    if(!entry)
+    {
+        return 0;
+    }
+    
+    U32 *result = (U32 *)(m_file_memory + entry->offset);
+    if(entry->flags & WorldFileChunkFlag_RLE)
+    {
+        result = decodeChunk(result, entry->size, tiles) ? tiles : 0;
+    }
+    
+    return result;
+}
+
+// NOTE(alexey): Takes a free slot, or evicts the least recently wanted resident chunk.
+// Chunks that were wanted this frame and chunks that are still loading are never evicted.
+ChunkSlot *WorldStreamer::allocateSlot()
+{
+    ChunkSlot *result = 0;
+    
+    for(U32 slot_index = 0; slot_index < m_slot_count; ++slot_index)
+    {
+        ChunkSlot *slot = &m_slots[slot_index];
+        U32 state = atomic_load_uint32(&slot->state);
+        if(state == ChunkSlotState_Free)
+        {
+            return slot;
+        }
+        
+        if((state == ChunkSlotState_Resident) &&
+           (slot->last_used_frame < m_frame_index) &&
+           (!result || (slot->last_used_frame < result->last_used_frame)))
+        {
+            result = slot;
+        }
+    }
+    
+    if(result)
+    {
+        TileMap *map = m_world->getWorldTileMap(result->tile_map_x, result->tile_map_y);
+        map->tiles = 0;
+        m_chunk_slots[(U64)result->tile_map_y*m_header.tile_map_count_x + result->tile_map_x] = 0;
+        result->state = ChunkSlotState_Free;
+        ++m_evicted_chunk_count;
+    }
+    
+    return result;
+}
+
+void WorldStreamer::requestChunk(I32 tile_map_x, I32 tile_map_y)
+{
+    U64 chunk_index = (U64)tile_map_y*m_header.tile_map_count_x + tile_map_x;
+    if(!getValidChunkEntry(tile_map_x, tile_map_y))
+    {
+        return;
+    }
+    
+    ChunkSlot *slot = allocateSlot();
+    if(slot)
+    {
+        slot->tile_map_x = tile_map_x;
+        slot->tile_map_y = tile_map_y;
+        slot->read_failed = false;
+        slot->last_used_frame = m_frame_index;
+        slot->request_counts = os->get_qpc();
+        slot->state = ChunkSlotState_Loading;
+        
+        if(os->add_work_entry(os->loader_queue, load_chunk_work, slot))
+        {
+            m_chunk_slots[chunk_index] = (U32)(slot - m_slots) + 1;
+            ++m_requested_chunk_count;
+        }
+        else
+        {
+            // NOTE(alexey): The queue is full, try again next frame.
+            slot->state = ChunkSlotState_Free;
+        }
+    }
+}
+
+void WorldStreamer::update(WorldPos center)
+{
+    if(!m_is_open)
+    {
+        return;
+    }
+    
+    ++m_frame_index;
+    
+    if(m_mode != WorldStreamerMode_Streamed)
+    {
+        updateFileMemory(center);
+        return;
+    }
+    
+    // Publish the chunks that the loader thread has finished.
+    for(U32 slot_index = 0; slot_index < m_slot_count; ++slot_index)
+    {
+        ChunkSlot *slot = &m_slots[slot_index];
+        if(atomic_load_uint32(&slot->state) == ChunkSlotState_Ready)
+        {
+            if(slot->read_failed)
+            {
+                // NOTE(alexey): Not retried, a bad or truncated file would fail at the same offset every frame.
+                m_chunk_slots[(U64)slot->tile_map_y*m_header.tile_map_count_x + slot->tile_map_x] = CHUNK_SLOT_FAILED;
+                slot->state = ChunkSlotState_Free;
+                ++m_failed_chunk_count;
+            }
+            else
+            {
+                TileMap *map = m_world->getWorldTileMap(slot->tile_map_x, slot->tile_map_y);
+                map->tiles = slot->tiles;
+                slot->state = ChunkSlotState_Resident;
+                ++m_loaded_chunk_count;
+                
+                U64 latency_us = ((slot->complete_counts - slot->request_counts)*1000000ull) / os->frequency;
+                U32 bucket = 0;
+                while((latency_us >> (bucket + 1)) && (bucket < CHUNK_LATENCY_BUCKET_COUNT - 1))
+                {
+                    ++bucket;
+                }
+                ++m_latency_histogram[bucket];
+            }
+        }
+    }
+    
+    ChunkRect rect = getLoadRect(center.tile_map_x, center.tile_map_y);
+    I32 min_tile_map_x = rect.min_tile_map_x;
+    I32 max_tile_map_x = rect.max_tile_map_x;
+    I32 min_tile_map_y = rect.min_tile_map_y;
+    I32 max_tile_map_y = rect.max_tile_map_y;
+    
+    // Mark the wanted chunks as used first, so requests below don't evict them.
+    for(I32 tile_map_y = min_tile_map_y; tile_map_y <= max_tile_map_y; ++tile_map_y)
+    {
+        for(I32 tile_map_x = min_tile_map_x; tile_map_x <= max_tile_map_x; ++tile_map_x)
+        {
+            U32 slot_number = m_chunk_slots[(U64)tile_map_y*m_header.tile_map_count_x + tile_map_x];
+            if(slot_number && (slot_number != CHUNK_SLOT_FAILED))
+            {
+                m_slots[slot_number - 1].last_used_frame = m_frame_index;
+            }
+        }
+    }
+    
+    // Request the missing ones, closest rings first.
+    for(I32 ring = 0; ring <= m_load_radius; ++ring)
+    {
+        for(I32 tile_map_y = min_tile_map_y; tile_map_y <= max_tile_map_y; ++tile_map_y)
+        {
+            for(I32 tile_map_x = min_tile_map_x; tile_map_x <= max_tile_map_x; ++tile_map_x)
+            {
+                I32 distance_x = abs(tile_map_x - center.tile_map_x);
+                I32 distance_y = abs(tile_map_y - center.tile_map_y);
+                I32 distance = (distance_x > distance_y) ? distance_x : distance_y;
+                // NOTE(alexey): Chunks without a slot can still have tiles, if they were copied out to be modified.
+                // The failed ones have CHUNK_SLOT_FAILED instead of a slot, so they aren't requested again.
+                if((distance == ring) &&
+                   !m_chunk_slots[(U64)tile_map_y*m_header.tile_map_count_x + tile_map_x] &&
+                   !m_world->getWorldTileMap(tile_map_x, tile_map_y)->tiles)
+                {
+                    requestChunk(tile_map_x, tile_map_y);
+                }
+            }
+        }
+    }
+}
+
+void WorldStreamer::printStats()
+{
+#if INTERNAL_BUILD
+    static const char *world_streamer_mode_names[] = 
+    {
+        "streamed",
+        "mapped",
+        "loaded",
+    };
+    
+    DebugOut("WorldStreamer (%s): opened in %.3f ms, requested %llu, loaded %llu, evicted %llu, failed %llu (not retried), "
+             "copied %llu, stalls %llu\n"
+             "  decoded %.2f MB at %.2f GB/s\n",
+             world_streamer_mode_names[m_mode],
+             (F64)m_open_counts*1000.0 / (F64)os->frequency,
+             (unsigned long long)m_requested_chunk_count,
+             (unsigned long long)m_loaded_chunk_count,
+             (unsigned long long)m_evicted_chunk_count,
+             (unsigned long long)m_failed_chunk_count,
+             (unsigned long long)m_copied_chunk_count,
+             (unsigned long long)m_world->m_stall_count,
+             (F64)m_decoded_bytes / (1024.0*1024.0),
+             m_decoded_counts ? ((F64)m_decoded_bytes / ((F64)m_decoded_counts / (F64)os->frequency)) / 1e9 : 0.0);
+    
+    for(U32 bucket = 0; bucket < CHUNK_LATENCY_BUCKET_COUNT; ++bucket)
+    {
+        if(m_latency_histogram[bucket])
+        {
+            DebugOut("  [%llu, %llu) us: %llu\n",
+                     (1ull << bucket) - (bucket == 0),
+                     (1ull << (bucket + 1)),
+                     (unsigned long long)m_latency_histogram[bucket]);
+        }
+    }
+#endif
+}
@@ -0,0 +1,136 @@
+/* date = October 19th 2023 12:40 pm */
+#ifndef GAME_WORLD_STREAMER_H
+
+#include "game_world_file.h"
+#include "game_tile_codec.h"
+
+enum ChunkSlotState
+{
+    ChunkSlotState_Free,
+    ChunkSlotState_Loading,  // owned by the loader thread.
+    ChunkSlotState_Ready,    // loader is done, waits to be published by the main thread.
+    ChunkSlotState_Resident, // tiles are visible through GameWorld::m_maps.
+};
+
+enum WorldStreamerMode
+{
+    WorldStreamerMode_Streamed, // chunks are read into a fixed budget of slots on the loader thread.
+    WorldStreamerMode_Mapped,   // the file is mapped, tiles point straight into the mapping.
+    WorldStreamerMode_Loaded,   // the whole file is read up front, only here to compare the startup against.
+};
+
+struct WorldStreamer;
+
+struct ChunkSlot
+{
+    uint32 volatile state;
+    Bool32 read_failed;
+
+    I32 tile_map_x;
+    I32 tile_map_y;
+    U32 *tiles;
+    U32 *encoded; // read buffer for the encoded chunks, streamed mode only.
+
+    U64 last_used_frame;
+    U64 request_counts;
+    U64 complete_counts;
+
+    WorldStreamer *streamer;
+};
+
+// NOTE(alexey): Range of tile maps, both min and max are inclusive. Empty when min > max.
+struct ChunkRect
+{
+    I32 min_tile_map_x;
+    I32 min_tile_map_y;
+    I32 max_tile_map_x;
+    I32 max_tile_map_y;
+};
+
+// NOTE(alexey): In WorldStreamer::m_chunk_slots, a chunk that couldn't be read or decoded.
+// It isn't requested again, it stays unloaded (and solid) like a chunk with a broken entry.
+#define CHUNK_SLOT_FAILED 0xFFFFFFFF
+
+// NOTE(alexey): Bucket i counts the chunks loaded in [2^i, 2^(i+1)) microseconds.
+#define CHUNK_LATENCY_BUCKET_COUNT 24
+
+/*
+  Streams tile maps (chunks) of a world file into a fixed budget of chunk slots.
+  Every frame the chunks around the player are requested, reads happen on the platform's loader thread,
+  so the update loop never waits for I/O. When all slots are taken, the least recently wanted chunk is evicted.
+  A tile lookup into a chunk that isn't resident yet is counted as a stall (see GameWorld::m_stall_count).
+  
+  In the mapped mode nothing is copied and there are no slots, the tile maps around the player
+  are pointed into the mapping, and the OS pages them in. As the player moves, the chunks ahead
+  are prefetched and the ones left behind are given back, so neither the startup time
+  nor the resident memory depend on the world size.
+  Chunks that have to be modified are copied into the arena first (see getWritableTiles).
+  
+  Encoded (RLE) chunks stay encoded in the mapping, and are decoded on demand into the slots,
+  which work as a small hot chunk cache with the same LRU eviction. Collision and rendering
+  only ever see decoded tiles through TileMap::tiles.
+*/
+struct WorldStreamer
+{
+    Bool32 open(MemoryArena *arena, const char *file_name, WorldStreamerMode mode, U32 slot_count, I32 load_radius);
+    void attach(GameWorld *world);
+    void update(WorldPos center);
+    U32 *getWritableTiles(I32 tile_map_x, I32 tile_map_y);
+    U32 *readChunkTiles(I32 tile_map_x, I32 tile_map_y, U32 *tiles);
+    void printStats();
+    void close();
+
+    Bool32 openFileMemory(const char *file_name);
+    WorldFileChunkEntry *getValidChunkEntry(I32 tile_map_x, I32 tile_map_y);
+    Bool32 decodeChunk(U32 *encoded, U32 encoded_size, U32 *tiles);
+    void updateFileMemory(WorldPos center);
+    void adviseMapping(ChunkRect old_rect, ChunkRect rect, WorldPos center);
+    ChunkRect getLoadRect(I32 center_tile_map_x, I32 center_tile_map_y);
+    void adviseChunks(ChunkRect rect, PlatformMemoryAdvice advice);
+    ChunkSlot *allocateSlot();
+    void requestChunk(I32 tile_map_x, I32 tile_map_y);
+
+    Bool32 m_is_open;
+    WorldStreamerMode m_mode;
+    MemoryArena *m_arena;
+
+    PlatformFile m_file;
+    WorldFileHeader m_header;
+    WorldFileChunkEntry *m_chunk_index;
+
+    // NOTE(alexey): The whole file in memory, only in the mapped and the loaded modes.
+    PlatformFileMapping m_mapping;
+    FileContents m_contents;
+    U8 *m_file_memory;
+    U64 m_file_size;
+    ChunkRect m_mapped_rect;
+    Bool32 m_mapped_rect_is_complete; // every chunk of m_mapped_rect is in, or failed.
+    I32 m_center_tile_map_x;
+    I32 m_center_tile_map_y;
+
+    GameWorld *m_world;
+    TileMap *m_maps;
+
+    // NOTE(alexey): Slot index + 1 for each chunk (in the file's chunk order), 0 when there is none,
+    // CHUNK_SLOT_FAILED when it failed.
+    U32 *m_chunk_slots;
+    ChunkSlot *m_slots;
+    U32 m_slot_count;
+
+    I32 m_load_radius;
+    U64 m_frame_index;
+
+    // stats
+    U64 m_open_counts;
+    U64 m_requested_chunk_count;
+    U64 m_loaded_chunk_count;
+    U64 m_evicted_chunk_count;
+    U64 m_failed_chunk_count; // chunks marked CHUNK_SLOT_FAILED.
+    U64 m_copied_chunk_count;
+    U64 volatile m_decoded_bytes;
+    U64 volatile m_decoded_counts;
+    U64 m_latency_histogram[CHUNK_LATENCY_BUCKET_COUNT];
+};
+
+#define GAME_WORLD_STREAMER_H
+#endif //GAME_WORLD_STREAMER_H
@@ -0,0 +1,365 @@
+/*
+  Gamepad input on linux, for the linux host (it includes this file after os.h).
+
+  The device is an evdev one (/dev/input/eventN), polled on a thread of its own CONTROLLER_POLL_RATE times a second.
+  Every SYN_REPORT is a complete state of the pad, which is processed the same way win32 does it with XInput
+  (process_stick, process_trigger) and published through a ControllerMailbox.
+  The axes and the buttons are the ones the xpad driver reports.
+
+  Any file of struct input_event can be the device: the stand-in for the tests is a regular file that reports
+  are appended to (linux_write_stand_in_report), every poll reads whatever was appended since the last one.
+  The stand-in's axes have the ranges of an XInput pad, since EVIOCGABS fails on a regular file.
+  Reports are timestamped with CLOCK_MONOTONIC, so the poller measures the latency from the report to its publish,
+  linux_run_gamepad_benchmark uses that and the time every poll takes.
+*/
+
+#include <linux/input.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+// NOTE(alexey): Older headers only have the timeval.
+#ifndef input_event_sec
+#define input_event_sec time.tv_sec
+#define input_event_usec time.tv_usec
+#endif
+
+#define LINUX_GAMEPAD_READ_EVENT_COUNT 64
+
+// NOTE(alexey): The benchmark's reports are written at LINUX_GAMEPAD_BENCHMARK_REPORT_RATE a second.
+#define LINUX_GAMEPAD_BENCHMARK_REPORT_COUNT 2000
+#define LINUX_GAMEPAD_BENCHMARK_REPORT_RATE 500
+
+enum LinuxGamepadAxis
+{
+    LinuxGamepadAxis_LeftX,
+    LinuxGamepadAxis_LeftY,
+    LinuxGamepadAxis_RightX,
+    LinuxGamepadAxis_RightY,
+    LinuxGamepadAxis_LeftTrigger,
+    LinuxGamepadAxis_RightTrigger,
+    LinuxGamepadAxis_DPadX,
+    LinuxGamepadAxis_DPadY,
+    
+    LinuxGamepadAxis_Count,
+};
+
+static const uint16 linux_gamepad_axis_codes[LinuxGamepadAxis_Count] =
+{
+    ABS_X, ABS_Y, ABS_RX, ABS_RY, ABS_Z, ABS_RZ, ABS_HAT0X, ABS_HAT0Y,
+};
+
+// NOTE(alexey): In ControllerButton order, the d-pad comes from the hat axes.
+static const uint16 linux_gamepad_button_codes[ControllerButton_DPadUp] =
+{
+    BTN_A, BTN_B, BTN_X, BTN_Y, BTN_TL, BTN_TR, BTN_SELECT, BTN_START,
+};
+
+struct LinuxGamepad
+{
+    int fd;
+    pthread_t thread;
+    bool32 volatile is_running;
+    ControllerMailbox *mailbox;
+    
+    int32 axis_min[LinuxGamepadAxis_Count];
+    int32 axis_max[LinuxGamepadAxis_Count];
+    int32 axes[LinuxGamepadAxis_Count];
+    uint32 buttons;
+    
+    // stats
+    uint64 poll_count;
+    uint64 poll_ns;
+    uint64 report_count;
+    uint64 latency_ns;
+    uint64 max_latency_ns;
+};
+
+inline uint64 linux_monotonic_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64 result = (uint64)now.tv_sec*1000000000ull + (uint64)now.tv_nsec;
+    return result;
+}
+
+function bool32 linux_open_gamepad(LinuxGamepad *gamepad, const char *path, ControllerMailbox *mailbox)
+{
+    *gamepad = {};
+    gamepad->mailbox = mailbox;
+    gamepad->fd = open(path, O_RDONLY | O_NONBLOCK);
+    if(gamepad->fd < 0)
+    {
+        return false;
+    }
+    
+    // NOTE(alexey): The timestamps are compared with CLOCK_MONOTONIC, a stand-in writes them that way already.
+    int clock_id = CLOCK_MONOTONIC;
+    ioctl(gamepad->fd, EVIOCSCLOCKID, &clock_id);
+    
+    for(uint32 axis_index = 0; axis_index < LinuxGamepadAxis_Count; ++axis_index)
+    {
+        struct input_absinfo info;
+        if(ioctl(gamepad->fd, EVIOCGABS(linux_gamepad_axis_codes[axis_index]), &info) == 0)
+        {
+            gamepad->axis_min[axis_index] = info.minimum;
+            gamepad->axis_max[axis_index] = info.maximum;
+            gamepad->axes[axis_index] = info.value;
+        }
+        else if((axis_index == LinuxGamepadAxis_LeftTrigger) || (axis_index == LinuxGamepadAxis_RightTrigger))
+        {
+            gamepad->axis_min[axis_index] = 0;
+            gamepad->axis_max[axis_index] = 255;
+        }
+        else if((axis_index == LinuxGamepadAxis_DPadX) || (axis_index == LinuxGamepadAxis_DPadY))
+        {
+            gamepad->axis_min[axis_index] = -1;
+            gamepad->axis_max[axis_index] = 1;
+        }
+        else
+        {
+            gamepad->axis_min[axis_index] = -32768;
+            gamepad->axis_max[axis_index] = 32767;
+        }
+    }
+    
+    return true;
+}
+
+// NOTE(alexey): To [-1, 1], or to [0, 1] for the triggers.
+inline real32 linux_normalize_axis(LinuxGamepad *gamepad, LinuxGamepadAxis axis)
+{
+    real32 range = (real32)(gamepad->axis_max[axis] - gamepad->axis_min[axis]);
+    real32 result = (range > 0.0f) ? ((gamepad->axes[axis] - gamepad->axis_min[axis]) / range) : 0.0f;
+    if((axis != LinuxGamepadAxis_LeftTrigger) && (axis != LinuxGamepadAxis_RightTrigger))
+    {
+        result = 2.0f*result - 1.0f;
+    }
+    return result;
+}
+
+function Controller linux_process_gamepad_state(LinuxGamepad *gamepad)
+{
+    Controller result = {};
+    result.is_connected = true;
+    
+    // NOTE(alexey): evdev's y goes down, XInput's and ours goes up.
+    result.left_stick = process_stick(linux_normalize_axis(gamepad, LinuxGamepadAxis_LeftX),
+                                      -linux_normalize_axis(gamepad, LinuxGamepadAxis_LeftY),
+                                      CONTROLLER_STICK_DEADZONE, CONTROLLER_RESPONSE_EXPONENT);
+    result.right_stick = process_stick(linux_normalize_axis(gamepad, LinuxGamepadAxis_RightX),
+                                       -linux_normalize_axis(gamepad, LinuxGamepadAxis_RightY),
+                                       CONTROLLER_STICK_DEADZONE, CONTROLLER_RESPONSE_EXPONENT);
+    result.left_trigger = process_trigger(linux_normalize_axis(gamepad, LinuxGamepadAxis_LeftTrigger),
+                                          CONTROLLER_TRIGGER_DEADZONE);
+    result.right_trigger = process_trigger(linux_normalize_axis(gamepad, LinuxGamepadAxis_RightTrigger),
+                                           CONTROLLER_TRIGGER_DEADZONE);
+    
+    result.buttons = gamepad->buttons;
+    int32 dpad_x = gamepad->axes[LinuxGamepadAxis_DPadX];
+    int32 dpad_y = gamepad->axes[LinuxGamepadAxis_DPadY];
+    if(dpad_y < 0) result.buttons |= (1 << ControllerButton_DPadUp);
+    if(dpad_y > 0) result.buttons |= (1 << ControllerButton_DPadDown);
+    if(dpad_x < 0) result.buttons |= (1 << ControllerButton_DPadLeft);
+    if(dpad_x > 0) result.buttons |= (1 << ControllerButton_DPadRight);
+    
+    return result;
+}
+
+function void linux_apply_gamepad_event(LinuxGamepad *gamepad, struct input_event *event)
+{
+    if(event->type == EV_ABS)
+    {
+        for(uint32 axis_index = 0; axis_index < LinuxGamepadAxis_Count; ++axis_index)
+        {
+            if(event->code == linux_gamepad_axis_codes[axis_index])
+            {
+                gamepad->axes[axis_index] = event->value;
+                break;
+            }
+        }
+    }
+    else if(event->type == EV_KEY)
+    {
+        for(uint32 button_index = 0; button_index < ArrayCount(linux_gamepad_button_codes); ++button_index)
+        {
+            if(event->code == linux_gamepad_button_codes[button_index])
+            {
+                if(event->value)
+                {
+                    gamepad->buttons |= (1 << button_index);
+                }
+                else
+                {
+                    gamepad->buttons &= ~(1 << button_index);
+                }
+                break;
+            }
+        }
+    }
+    else if((event->type == EV_SYN) && (event->code == SYN_REPORT))
+    {
+        uint64 now_ns = linux_monotonic_ns();
+        Controller controller = linux_process_gamepad_state(gamepad);
+        controller.sample_qpc = now_ns;
+        publish_controller(gamepad->mailbox, &controller);
+        
+        uint64 report_ns = (uint64)event->input_event_sec*1000000000ull + (uint64)event->input_event_usec*1000ull;
+        uint64 latency_ns = (now_ns > report_ns) ? (now_ns - report_ns) : 0;
+        ++gamepad->report_count;
+        gamepad->latency_ns += latency_ns;
+        gamepad->max_latency_ns = Maximum(gamepad->max_latency_ns, latency_ns);
+    }
+}
+
+// NOTE(alexey): Reads everything that is there, a device returns EAGAIN and a file returns 0 when there's no more.
+function void linux_poll_gamepad(LinuxGamepad *gamepad)
+{
+    uint64 start_ns = linux_monotonic_ns();
+    
+    struct input_event events[LINUX_GAMEPAD_READ_EVENT_COUNT];
+    for(;;)
+    {
+        ssize_t read_size = read(gamepad->fd, events, sizeof(events));
+        if(read_size <= 0)
+        {
+            break;
+        }
+        
+        uint32 event_count = (uint32)(read_size / sizeof(struct input_event));
+        for(uint32 event_index = 0; event_index < event_count; ++event_index)
+        {
+            linux_apply_gamepad_event(gamepad, &events[event_index]);
+        }
+    }
+    
+    ++gamepad->poll_count;
+    gamepad->poll_ns += linux_monotonic_ns() - start_ns;
+}
+
+function void *linux_gamepad_thread_proc(void *parameter)
+{
+    LinuxGamepad *gamepad = (LinuxGamepad *)parameter;
+    
+    struct timespec poll_interval = {0, 1000000000 / CONTROLLER_POLL_RATE};
+    while(atomic_load_uint32((uint32 volatile *)&gamepad->is_running))
+    {
+        linux_poll_gamepad(gamepad);
+        nanosleep(&poll_interval, 0);
+    }
+    
+    return 0;
+}
+
+function bool32 linux_start_gamepad_thread(LinuxGamepad *gamepad)
+{
+    gamepad->mailbox->buffer.init();
+    gamepad->is_running = true;
+    bool32 result = (pthread_create(&gamepad->thread, 0, linux_gamepad_thread_proc, gamepad) == 0);
+    if(!result)
+    {
+        gamepad->is_running = false;
+    }
+    return result;
+}
+
+function void linux_close_gamepad(LinuxGamepad *gamepad)
+{
+    if(gamepad->is_running)
+    {
+        atomic_store_uint32((uint32 volatile *)&gamepad->is_running, false);
+        pthread_join(gamepad->thread, 0);
+    }
+    if(gamepad->fd >= 0)
+    {
+        close(gamepad->fd);
+    }
+    gamepad->fd = -1;
+}
+
+// NOTE(alexey): A report of the left stick and the buttons (a bit per ControllerButton, the d-pad isn't written),
+// timestamped with the time it was written, the way the kernel does it for a device.
+function bool32 linux_write_stand_in_report(int fd, int32 left_x, int32 left_y, uint32 buttons)
+{
+    uint64 now_ns = linux_monotonic_ns();
+    
+    struct input_event events[2 + ArrayCount(linux_gamepad_button_codes) + 1] = {};
+    uint32 event_count = 0;
+    events[event_count].type = EV_ABS;
+    events[event_count].code = ABS_X;
+    events[event_count++].value = left_x;
+    events[event_count].type = EV_ABS;
+    events[event_count].code = ABS_Y;
+    events[event_count++].value = left_y;
+    for(uint32 button_index = 0; button_index < ArrayCount(linux_gamepad_button_codes); ++button_index)
+    {
+        events[event_count].type = EV_KEY;
+        events[event_count].code = linux_gamepad_button_codes[button_index];
+        events[event_count++].value = (buttons >> button_index) & 1;
+    }
+    events[event_count].type = EV_SYN;
+    events[event_count++].code = SYN_REPORT;
+    
+    for(uint32 event_index = 0; event_index < event_count; ++event_index)
+    {
+        events[event_index].input_event_sec = (time_t)(now_ns / 1000000000ull);
+        events[event_index].input_event_usec = (suseconds_t)((now_ns % 1000000000ull) / 1000ull);
+    }
+    
+    // NOTE(alexey): A single write, so the poller never reads half of a report.
+    ssize_t size = event_count*sizeof(struct input_event);
+    bool32 result = (write(fd, events, size) == size);
+    return result;
+}
+
+// NOTE(alexey): Writes LINUX_GAMEPAD_BENCHMARK_REPORT_COUNT reports of a circling stick to a stand-in at path,
+// while the polling thread reads them, and prints what the polls cost and how late the reports were published.
+function void linux_run_gamepad_benchmark(const char *path)
+{
+    int writer = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if(writer < 0)
+    {
+        DebugOut("Gamepad: couldn't create the stand-in %s\n", path);
+        return;
+    }
+    
+    ControllerMailbox mailbox;
+    LinuxGamepad gamepad;
+    if(linux_open_gamepad(&gamepad, path, &mailbox) && linux_start_gamepad_thread(&gamepad))
+    {
+        Controller latest = {};
+        struct timespec report_interval = {0, 1000000000 / LINUX_GAMEPAD_BENCHMARK_REPORT_RATE};
+        for(uint32 report_index = 0; report_index < LINUX_GAMEPAD_BENCHMARK_REPORT_COUNT; ++report_index)
+        {
+            real32 angle = report_index*0.01f;
+            linux_write_stand_in_report(writer, (int32)(cosf(angle)*32767.0f), (int32)(sinf(angle)*32767.0f),
+                                        (report_index & 1) << ControllerButton_A);
+            nanosleep(&report_interval, 0);
+            take_latest_controller(&mailbox, &latest);
+        }
+        
+        // NOTE(alexey): The last poll picks up what's left.
+        struct timespec drain_interval = {0, 20000000};
+        nanosleep(&drain_interval, 0);
+        linux_close_gamepad(&gamepad);
+        take_latest_controller(&mailbox, &latest);
+        
+        DebugOut("Gamepad: %llu reports at %u/s, %llu polls at %u/s, %.2f us/poll, "
+                 "latency %.1f us (%.1f us max), stick at the end (%.2f, %.2f)\n",
+                 (unsigned long long)gamepad.report_count, LINUX_GAMEPAD_BENCHMARK_REPORT_RATE,
+                 (unsigned long long)gamepad.poll_count, CONTROLLER_POLL_RATE,
+                 gamepad.poll_count ? gamepad.poll_ns / 1000.0 / gamepad.poll_count : 0.0,
+                 gamepad.report_count ? gamepad.latency_ns / 1000.0 / gamepad.report_count : 0.0,
+                 gamepad.max_latency_ns / 1000.0,
+                 latest.left_stick.x, latest.left_stick.y);
+    }
+    else
+    {
+        DebugOut("Gamepad: couldn't open the stand-in %s\n", path);
+        linux_close_gamepad(&gamepad);
+    }
+    
+    close(writer);
+}
@@ -17,28 +17,34 @@ OutputDebugStringA(buf);\
 }
 #undef min
 #undef max
+#else
+# include <stdio.h>
+# define DebugBreak() __builtin_trap()
+# define DebugOut(format, ...) fprintf(stderr, format, ## __VA_ARGS__)
 #endif
 
-#define TilesCountX 17 
-#define TilesCountY 9
+#include "game_default_world.h"
+#include "game_world_generator.h"
+#include "game_render.cpp"
+#include "game_world_streamer.cpp"
+#include "game_pathfinding.cpp"
+#include "game_path_graph.cpp"
+#include "game_flow_field.cpp"
+#include "game_lighting.cpp"
+#include "game_image.cpp"
 
 GameWorld::GameWorld(TileMap *maps, int32 tile_map_count_x, int32 tile_map_count_y, int32 tile_count_x, 
-                     int32 tile_count_y, 
-                     int32 offset_x, int32 offset_y, real32 tile_dim, real32 tile_side_in_pixels, 
-                     real32 tile_side_in_meters) 
+                     int32 tile_count_y, real32 tile_side_in_pixels, real32 tile_side_in_meters) 
 : m_maps(maps),
 m_tile_map_count_x(tile_map_count_x), 
 m_tile_map_count_y(tile_map_count_y),
 m_tile_count_x(tile_count_x),
 m_tile_count_y(tile_count_y),
-m_offset_x(offset_x),
-m_offset_y(offset_y),
-m_tile_dim(tile_dim),
-m_tile_half_dim(0.5f*tile_dim),
 m_tile_side_in_pixels(tile_side_in_pixels),
 m_tile_side_in_meters(tile_side_in_meters),
 m_half_tile_side_in_meters(0.5f*tile_side_in_meters),
-m_pixels_per_meter(tile_side_in_pixels / tile_side_in_meters)
+m_pixels_per_meter(tile_side_in_pixels / tile_side_in_meters),
+m_stall_count(0)
 {}
 
 uint32 GameWorld::getTileValue(TileMap *tile_map, int32 test_tile_x, int32 test_tile_y)
@@ -46,6 +52,12 @@ uint32 GameWorld::getTileValue(TileMap *tile_map, int32 test_tile_x, int32 test_
     assert((test_tile_x >= 0 && test_tile_x < m_tile_count_x) &&
            (test_tile_y >= 0 && test_tile_y < m_tile_count_y));
     
+    if(!tile_map->tiles)
+    {
+        ++m_stall_count;
+        return TileValue_Invalid;
+    }
+    
     int32 index = ((m_tile_count_y - test_tile_y - 1)*m_tile_count_x) + test_tile_x;
     uint32 value = tile_map->tiles[index];
     
@@ -60,7 +72,7 @@ bool32 GameWorld::isDoorTile(TileMap *tile_map, int32 test_tile_x, int32 test_ti
        (test_tile_y >= 0 && test_tile_y < m_tile_count_y))
     {
         uint32 tile_value = getTileValue(tile_map, test_tile_x, test_tile_y);
-        result = (tile_value == 2);
+        result = (tile_value == TileValue_Door);
     }
     
     return result;
@@ -74,7 +86,7 @@ bool32 GameWorld::isTileEmpty(TileMap *tile_map, int32 test_tile_x, int32 test_t
        (test_tile_y >= 0 && test_tile_y < m_tile_count_y))
     {
         uint32 value = getTileValue(tile_map, test_tile_x, test_tile_y);
-        result = (value == 0);
+        result = (value == TileValue_Empty);
     }
     
     return result;
@@ -128,16 +140,6 @@ WorldPos GameWorld::recomputeWorldPos(WorldPos world_pos)
     assert(result.tile_center_rel_y > -m_half_tile_side_in_meters);
     assert(result.tile_center_rel_y < m_half_tile_side_in_meters);
     
-#if INTERNAL_BUILD
-    DebugOut("TileOffset: (%i, %i)\nTileRel:(%.2f, %.2f)\nTile:(%i, %i)\n\n",
-             tile_x_offset, 
-             tile_y_offset, 
-             result.tile_center_rel_x, 
-             result.tile_center_rel_y, 
-             (int32)result.tile_x, 
-             (int32)result.tile_y);
-#endif
-    
     if(result.tile_x < 0)
     {
         result.tile_x += m_tile_count_x;
@@ -177,151 +179,140 @@ bool32 GameWorld::isTileMapPointEmpty( WorldPos world_pos)
     return result;
 }
 
-enum RectangleStyle
+U32 GameWorld::getAbsTileValue(I32 abs_tile_x, I32 abs_tile_y)
 {
-    RectangleStyle_Filled = 1,
-    RectangleStyle_Wireframe,
-};
-
-// NOTE(alexey): This is a part of the renderer class!
-
-/*
-(minx, miny)
-      +------------+
-      |            |
-      |            |
-      |            |
-      |            |
-      +------------+ (maxx, maxy)
-*/
-function void draw_rectangle(OffscreenBuffer *buffer,
-                             RectangleStyle draw_style,
-                             real32 rminx, real32 rminy, 
-                             real32 rmaxx, real32 rmaxy,
-                             Vec4 color)
-{
-    I32 minx = round_real32_to_int32(rminx);
-    I32 miny = round_real32_to_int32(rminy);
-    I32 maxx = round_real32_to_int32(rmaxx);
-    I32 maxy = round_real32_to_int32(rmaxy);
+    U32 result = TileValue_Invalid;
     
-    // minx, miny
-    if(minx < 0)
-    {
-        minx = 0;
-    }
+    // NOTE(alexey): Floor division, so negative absolute tiles end up in tile map -1.
+    I32 tile_map_x = floor_div_int32(abs_tile_x, m_tile_count_x);
+    I32 tile_map_y = floor_div_int32(abs_tile_y, m_tile_count_y);
     
-    if(minx > buffer->width)
+    TileMap *tile_map = getWorldTileMap(tile_map_x, tile_map_y);
+    if(tile_map)
     {
-        minx = buffer->width;
+        I32 tile_x = abs_tile_x - tile_map_x*m_tile_count_x;
+        I32 tile_y = abs_tile_y - tile_map_y*m_tile_count_y;
+        result = getTileValue(tile_map, tile_x, tile_y);
     }
     
-    if(miny < 0)
-    {
-        miny = 0;
-    }
+    return result;
+}
+
+Vec2 GameWorld::subtractWorldPos(WorldPos a, WorldPos b)
+{
+    Vec2 result;
     
-    if(miny > buffer->height)
-    {
-        miny = buffer->height;
-    }
+    I32 delta_tile_x = getAbsTileX(a) - getAbsTileX(b);
+    I32 delta_tile_y = getAbsTileY(a) - getAbsTileY(b);
     
-    // maxx, maxy
-    if(maxx < 0)
-    {
-        maxx = 0;
-    }
+    result.x = delta_tile_x*m_tile_side_in_meters + (a.tile_center_rel_x - b.tile_center_rel_x);
+    result.y = delta_tile_y*m_tile_side_in_meters + (a.tile_center_rel_y - b.tile_center_rel_y);
     
-    if(maxx > buffer->width)
-    {
-        maxx = buffer->width;
-    }
+    return result;
+}
+
+WorldPos GameWorld::lerpWorldPos(WorldPos a, WorldPos b, F32 t)
+{
+    Vec2 delta = subtractWorldPos(b, a);
     
-    if(maxy < 0)
-    {
-        maxy = 0;
-    }
+    WorldPos result = a;
+    result.tile_center_rel_x += t*delta.x;
+    result.tile_center_rel_y += t*delta.y;
+    result = recomputeWorldPos(result);
     
-    if(maxy > buffer->height)
+    return result;
+}
+
+void Camera::follow(GameWorld *world, WorldPos target, F32 dt)
+{
+    // NOTE(alexey): Exponential-ish smoothing, the camera covers m_follow_rate*dt 
+    // fraction of the remaining distance each frame, and snaps when it would overshoot.
+    F32 t = m_follow_rate*dt;
+    if(t > 1.0f)
     {
-        maxy = buffer->height;
+        t = 1.0f;
     }
     
-    uint32 coloru32 = 
-    round_real32_to_uint32(color.b * 255.0f) | 
-    (round_real32_to_uint32(color.g * 255.0f) << 8) | 
-    (round_real32_to_uint32(color.r * 255.0f) << 16) |  
-    (round_real32_to_uint32(color.a * 255.0f) << 24); 
+    Vec2 delta = world->subtractWorldPos(target, m_pos);
+    m_pos.tile_center_rel_x += t*delta.x;
+    m_pos.tile_center_rel_y += t*delta.y;
+    m_pos = world->recomputeWorldPos(m_pos);
+}
+
+TileRect Camera::getVisibleTiles(GameWorld *world, Vec2 view_dim)
+{
+    TileRect result;
     
-    uint8 *row = (uint8 *)buffer->data + miny*buffer->pitch + minx*buffer->bpp;
+    // NOTE(alexey): Half of the screen in meters.
+    F32 half_screen_x = 0.5f*view_dim.x;
+    F32 half_screen_y = 0.5f*view_dim.y;
     
-    if(draw_style == RectangleStyle_Filled)
-    {
-        for(I32 y = miny; y < maxy; ++y)
-        {
-            uint32 *pixels = (uint32 *)row;
-            for(I32 x = minx; x < maxx; ++x)
-            {
-                // 0x BB GG RR AA
-                *pixels++ = coloru32;
-            }
-            row += buffer->pitch;
-        }    
-    }
-    else if(draw_style == RectangleStyle_Wireframe)
-    {
-        for(I32 y = miny; y < maxy; ++y)
-        {
-            uint32 *pixels = (uint32 *)row;
-            for(I32 x = minx; x < maxx; ++x)
-            {
-                int32 frame_y = (y == miny) || (y == maxy - 1);
-                int32 frame_x = (x == minx) || (x == maxx - 1);
-                if(frame_y || frame_x)
-                {
-                    // 0x BB GG RR AA
-                    *pixels = coloru32;
-                }
-                ++pixels;
-            }
-            row += buffer->pitch;
-        }
-    }
-    else
-    {
-        assert(!"Unknown draw style!");
-    }
+    // NOTE(alexey): Tile offset (relative to the camera's tile) that contains a point p (meters)
+    // relative to the camera is floor((p + rel + half_tile) / tile_side).
+    F32 rel_x = m_pos.tile_center_rel_x + world->m_half_tile_side_in_meters;
+    F32 rel_y = m_pos.tile_center_rel_y + world->m_half_tile_side_in_meters;
+    
+    I32 camera_tile_x = world->getAbsTileX(m_pos);
+    I32 camera_tile_y = world->getAbsTileY(m_pos);
+    
+    result.min_tile_x = camera_tile_x + floor_real32_to_int32((rel_x - half_screen_x) / world->m_tile_side_in_meters);
+    result.min_tile_y = camera_tile_y + floor_real32_to_int32((rel_y - half_screen_y) / world->m_tile_side_in_meters);
+    result.max_tile_x = camera_tile_x + floor_real32_to_int32((rel_x + half_screen_x) / world->m_tile_side_in_meters) + 1;
+    result.max_tile_y = camera_tile_y + floor_real32_to_int32((rel_y + half_screen_y) / world->m_tile_side_in_meters) + 1;
+    
+    return result;
 }
 
-function void handleOsEvents()
+// NOTE(alexey): Applies the events of a frame to the input and empties the queue.
+function void process_events(Input *input, EventQueue *events)
 {
+    memset(input->keys_changed, 0, sizeof(input->keys_changed));
+    input->cursor_delta = Vec2(0.0f);
     for(I32 event_index = 0;
-        event_index < os->events.length();
+        event_index < events->length();
         ++event_index)
     {
-        Event& event = os->events[event_index];
+        Event& event = (*events)[event_index];
         if(event_equal(event, EventType_KeyPressed))
         {
-            os->input.keys[event.key] = 1;
+            input->setKey((Key)event.key, true);
         }
         else if(event_equal(event, EventType_KeyReleased))
         {
-            os->input.keys[event.key] = 0;
+            input->setKey((Key)event.key, false);
+        }
+        else if(event_equal(event, EventType_MouseMoved))
+        {
+            input->cursor = event.cursor;
+            input->cursor_delta += event.cursor_delta;
         }
         else if(event_equal(event, EventType_MouseButtonPressed))
         {
-            os->input.mouse_buttons[event.button] = 1;
+            input->mouse_buttons[event.button] = 1;
         }
         else if(event_equal(event, EventType_MouseButtonReleased))
         {
-            os->input.mouse_buttons[event.button] = 0;
+            input->mouse_buttons[event.button] = 0;
         }
     }
-    os->events.clear();
+    events->clear();
 }
 
+function void handleOsEvents()
+{
+    process_events(&os->input, &os->events);
+}
+
+#if GAME_BENCHMARKS
+#include "game_benchmarks.h"
+#include "game_benchmarks.cpp"
+#endif
+
 void GameState::update(Input *input/*...*/)
 {
+    m_prev_world_pos = m_world_pos;
+    m_prev_camera_pos = m_camera.m_pos;
+    
     F32 dt_player_x = 0.0f;
     F32 dt_player_y = 0.0f;
     
@@ -349,6 +340,19 @@ void GameState::update(Input *input/*...*/)
         dt_player_x += 1.0f;
     }
     
+    // NOTE(alexey): The controller only when no key is down. How far the stick is pushed is how fast the player goes,
+    // the d-pad is digital like the keys.
+    Controller *controller = &input->controller;
+    if(controller->is_connected && (dt_player_x == 0.0f) && (dt_player_y == 0.0f))
+    {
+        dt_player_x = controller->left_stick.x;
+        dt_player_y = controller->left_stick.y;
+        if(controller->isButtonDown(ControllerButton_DPadUp)) dt_player_y = 1.0f;
+        if(controller->isButtonDown(ControllerButton_DPadDown)) dt_player_y = -1.0f;
+        if(controller->isButtonDown(ControllerButton_DPadLeft)) dt_player_x = -1.0f;
+        if(controller->isButtonDown(ControllerButton_DPadRight)) dt_player_x = 1.0f;
+    }
+    
     // Going from pixels to meters
     dt_player_x *= m_player_speed_in_meters;
     dt_player_y *= m_player_speed_in_meters;
@@ -407,27 +411,169 @@ void GameState::update(Input *input/*...*/)
     {
         m_world_pos = new_world_pos;
     }
+    
+    m_camera.follow(m_world, m_world_pos, input->dt_for_frame);
+    
+    // NOTE(alexey): Only does the work when the player moved into another tile.
+    m_lighting.update({m_world->getAbsTileX(m_world_pos), m_world->getAbsTileY(m_world_pos)});
+    
+    // NOTE(alexey): Toggle only on the transition, the key stays pressed for many frames.
+    Bool32 toggle_key_is_down = input->onKeyPressed(Key_F1);
+    if(toggle_key_is_down && !m_debug_overlay_key_was_down)
+    {
+        m_debug_overlay_is_enabled = !m_debug_overlay_is_enabled;
+    }
+    m_debug_overlay_key_was_down = toggle_key_is_down;
+}
+
+function I32 get_tile_rect_count(TileRect rect)
+{
+    I32 result = Maximum(rect.max_tile_x - rect.min_tile_x, 0)*Maximum(rect.max_tile_y - rect.min_tile_y, 0);
+    return result;
+}
+
+void GameState::captureSnapshot(RenderSnapshot *snapshot, InputSample *sample)
+{
+    snapshot->step_index = m_simulation_step_count;
+    snapshot->input_qpc = sample->qpc;
+    snapshot->accumulator = m_simulation_accumulator;
+    
+    snapshot->prev_player_pos = m_prev_world_pos;
+    snapshot->player_pos = m_world_pos;
+    snapshot->prev_camera_pos = m_prev_camera_pos;
+    snapshot->camera_pos = m_camera.m_pos;
+    
+    snapshot->debug_overlay_is_enabled = m_debug_overlay_is_enabled;
+    snapshot->debug_path_point_count = m_debug_path_point_count;
+    memcpy(snapshot->debug_path, m_debug_path, m_debug_path_point_count*sizeof(TilePoint));
+    
+    // NOTE(alexey): The tiles of both cameras, if the camera jumped too far in one step 
+    // (a teleport), only the current camera's tiles, the renderer draws the prev ones as missing for a frame.
+    Camera prev_camera = m_camera;
+    prev_camera.m_pos = m_prev_camera_pos;
+    TileRect tiles = m_camera.getVisibleTiles(m_world, sample->view_dim);
+    TileRect prev_tiles = prev_camera.getVisibleTiles(m_world, sample->view_dim);
+    
+    TileRect rect;
+    rect.min_tile_x = Minimum(tiles.min_tile_x, prev_tiles.min_tile_x);
+    rect.min_tile_y = Minimum(tiles.min_tile_y, prev_tiles.min_tile_y);
+    rect.max_tile_x = Maximum(tiles.max_tile_x, prev_tiles.max_tile_x);
+    rect.max_tile_y = Maximum(tiles.max_tile_y, prev_tiles.max_tile_y);
+    if(get_tile_rect_count(rect) > (I32)m_max_snapshot_tile_count)
+    {
+        rect = tiles;
+    }
+    
+    I32 width = Maximum(rect.max_tile_x - rect.min_tile_x, 1);
+    rect.max_tile_y = Minimum(rect.max_tile_y, rect.min_tile_y + (I32)m_max_snapshot_tile_count / width);
+    snapshot->tiles = rect;
+    
+    U32 tile_index = 0;
+    for(I32 tile_y = rect.min_tile_y; tile_y < rect.max_tile_y; ++tile_y)
+    {
+        for(I32 tile_x = rect.min_tile_x; tile_x < rect.max_tile_x; ++tile_x)
+        {
+            snapshot->tile_values[tile_index] = m_world->getAbsTileValue(tile_x, tile_y);
+            snapshot->light_levels[tile_index] = m_lighting.getLevel(tile_x, tile_y);
+            ++tile_index;
+        }
+    }
+    
+    snapshot->publish_qpc = os->get_qpc();
 }
 
-void GameState::render(OffscreenBuffer *buffer)
+void GameState::render(OffscreenBuffer *buffer, Vec2 view_dim, RenderSnapshot *snapshot, F32 alpha)
 {
-    // flush background.
-    draw_rectangle(buffer, RectangleStyle_Filled,
-                   0.0f, 0.0f, 
-                   Cast(F32, buffer->width),
-                   Cast(F32, buffer->height), 
-                   Vec4(236, 213, 160));
-    
-    TileMap *map = m_world->getWorldTileMap(Cast(I32, m_world_pos.tile_map_x),
-                                            Cast(I32, m_world_pos.tile_map_y));
-    for(I32 tile_y = 0;
-        tile_y < m_world->m_tile_count_y;
+    // NOTE(alexey): The simulation thread didn't publish anything yet.
+    if((snapshot->step_index == 0) || (view_dim.x <= 0.0f))
+    {
+        clear_buffer(buffer, m_palette.colors[PaletteColor_Background]);
+        return;
+    }
+    
+    // NOTE(alexey): Everything is drawn where it is at the render time, between the last two simulation steps,
+    // so the motion is smooth whatever the frame rate is.
+    WorldPos player_pos = m_world->lerpWorldPos(snapshot->prev_player_pos, snapshot->player_pos, alpha);
+    Camera camera = {};
+    camera.m_pos = m_world->lerpWorldPos(snapshot->prev_camera_pos, snapshot->camera_pos, alpha);
+    
+    // NOTE(alexey): The camera is always in the center of the screen.
+    // Only the tiles that intersect the buffer are visited, 
+    // so the cost depends on the screen size, not on the size of the world.
+    F32 screen_center_x = 0.5f*buffer->width;
+    F32 screen_center_y = 0.5f*buffer->height;
+    F32 pixels_per_meter = buffer->width / view_dim.x;
+    F32 tile_side_in_pixels = m_world->m_tile_side_in_meters*pixels_per_meter;
+    
+    TileRect visible_tiles = camera.getVisibleTiles(m_world, view_dim);
+    
+    // NOTE(alexey): Every tile is drawn, the empty ones too, and the visible tiles cover the whole buffer,
+    // so the background only shows where there are no tiles (past the world's edges).
+    // The clear is skipped when there's no such tile on the screen.
+    Bool32 tiles_cover_buffer = true;
+    for(I32 tile_y = visible_tiles.min_tile_y; tiles_cover_buffer && (tile_y < visible_tiles.max_tile_y); ++tile_y)
+    {
+        for(I32 tile_x = visible_tiles.min_tile_x; tile_x < visible_tiles.max_tile_x; ++tile_x)
+        {
+            if(snapshot->getTileValue(tile_x, tile_y) == TileValue_Invalid)
+            {
+                tiles_cover_buffer = false;
+                break;
+            }
+        }
+    }
+    
+    if(!tiles_cover_buffer)
+    {
+        clear_buffer(buffer, m_palette.colors[PaletteColor_Background]);
+    }
+    
+    // NOTE(alexey): 4 corner points per tile, player's collision box, 5 collision probes 
+    // and a point per tile of the debug path.
+    I32 visible_tile_count = 
+        (visible_tiles.max_tile_x - visible_tiles.min_tile_x)*(visible_tiles.max_tile_y - visible_tiles.min_tile_y);
+    I32 debug_path_tile_count = (snapshot->debug_path_point_count > 0);
+    for(U32 point_index = 1; point_index < snapshot->debug_path_point_count; ++point_index)
+    {
+        TilePoint from = snapshot->debug_path[point_index - 1];
+        TilePoint to = snapshot->debug_path[point_index];
+        debug_path_tile_count += Maximum(abs(to.x - from.x), abs(to.y - from.y));
+    }
+    
+    DebugOverlay *overlay = &m_debug_overlay;
+    overlay->m_is_enabled = snapshot->debug_overlay_is_enabled;
+    overlay->begin(&m_frame_arena, 4*visible_tile_count + 6 + debug_path_tile_count);
+    
+    I32 camera_tile_x = m_world->getAbsTileX(camera.m_pos);
+    I32 camera_tile_y = m_world->getAbsTileY(camera.m_pos);
+    I32 player_tile_x = m_world->getAbsTileX(player_pos);
+    I32 player_tile_y = m_world->getAbsTileY(player_pos);
+    
+    // NOTE(alexey): Pixel position of the left(bottom) edge of the camera's tile.
+    F32 tile_origin_x = 
+        screen_center_x - (camera.m_pos.tile_center_rel_x + m_world->m_half_tile_side_in_meters)*pixels_per_meter;
+    F32 tile_origin_y = 
+        screen_center_y - (camera.m_pos.tile_center_rel_y + m_world->m_half_tile_side_in_meters)*pixels_per_meter;
+    
+    for(I32 tile_y = visible_tiles.min_tile_y;
+        tile_y < visible_tiles.max_tile_y;
         ++tile_y)
     {
-        for(I32 tile_x = 0;
-            tile_x < m_world->m_tile_count_x;
+        // NOTE(alexey): Edges are snapped in integer space, so adjacent tiles share 
+        // exactly the same edge and we don't get any seams while scrolling.
+        I32 miny = floor_real32_to_int32(tile_origin_y + (tile_y - camera_tile_y)*tile_side_in_pixels + 0.5f);
+        I32 maxy = floor_real32_to_int32(tile_origin_y + (tile_y - camera_tile_y + 1)*tile_side_in_pixels + 0.5f);
+        
+        for(I32 tile_x = visible_tiles.min_tile_x;
+            tile_x < visible_tiles.max_tile_x;
             ++tile_x)
         {
+            U32 tile_value = snapshot->getTileValue(tile_x, tile_y);
+            if(tile_value == TileValue_Invalid)
+            {
+                continue;
+            }
+            
             /*
               +------------+ (maxy, maxy) (world->tile_dim, world->tile_dim).
               |            |
@@ -438,61 +584,60 @@ void GameState::render(OffscreenBuffer *buffer)
               +------------+
              (minx, miny), (0, 0)
             */
-            F32 minx = (tile_x * m_world->m_tile_dim) + m_world->m_offset_x;
-            F32 miny = (tile_y * m_world->m_tile_dim) + m_world->m_offset_y;
-            F32 maxx = minx + m_world->m_tile_dim;
-            F32 maxy = miny + m_world->m_tile_dim;
+            I32 minx = floor_real32_to_int32(tile_origin_x + (tile_x - camera_tile_x)*tile_side_in_pixels + 0.5f);
+            I32 maxx = floor_real32_to_int32(tile_origin_x + (tile_x - camera_tile_x + 1)*tile_side_in_pixels + 0.5f);
             
-            if(m_world_pos.tile_x == tile_x &&
-               m_world_pos.tile_y == tile_y)
+            // NOTE(alexey): Empty tiles are drawn too, with the background color, so the light map covers them.
+            U32 light_level = snapshot->getLightLevel(tile_x, tile_y);
+            if(player_tile_x == tile_x &&
+               player_tile_y == tile_y)
             {
-                Vec4 color(0.8f, 0.7f, 0.54f);
-                draw_rectangle(buffer, RectangleStyle_Filled, minx, miny, maxx, maxy, color);
+                draw_pixel_rectangle(buffer, RectangleStyle_Filled, minx, miny, maxx, maxy, 
+                                     m_palette.colors[PaletteColor_PlayerTile]);
             }
-            else if(!m_world->isTileEmpty(map, tile_x, tile_y))
+            else
             {
-                U32 tile_value = m_world->getTileValue(map, tile_x, tile_y);
-                Vec4 color = (tile_value == 2) ? Vec4(0.25f, 0.5f, 0.5f) : Vec4(0.25f);
-                draw_rectangle(buffer, RectangleStyle_Filled, minx, miny, maxx, maxy, color);
+                PackedColor color = m_palette.colors[PaletteColor_Background];
+                if(tile_value == TileValue_Door)
+                {
+                    color = m_palette.colors[PaletteColor_Door];
+                }
+                else if(tile_value != TileValue_Empty)
+                {
+                    color = m_palette.colors[PaletteColor_Wall];
+                }
+                
+                draw_pixel_rectangle(buffer, RectangleStyle_Filled, minx, miny, maxx, maxy, scale_color(color, light_level));
             }
             
             // draw debug points.
-            Vec4 color(1.0f, 1.0f, 0.0f);
-            
-            Rect2 r0(Vec2(minx - 3, miny - 3), Vec2(minx + 3, miny + 3));
-            draw_rectangle(&os->buffer, RectangleStyle_Filled, r0.min.x, r0.min.y, r0.max.x, r0.max.y, color);
-            
-            Rect2 r1(Vec2(maxx - 3, miny - 3), Vec2(maxx + 3, miny + 3));
-            draw_rectangle(buffer, RectangleStyle_Filled, r1.min.x, r1.min.y, r1.max.x, r1.max.y, color);
-            
-            Rect2 r2(Vec2(minx - 3, maxy - 3), Vec2(minx + 3, maxy + 3));
-            draw_rectangle(buffer, RectangleStyle_Filled, r2.min.x, r2.min.y, r2.max.x, r2.max.y, color);
-            
-            Rect2 r3(Vec2(maxx - 3, maxy - 3), Vec2(maxx + 3, maxy + 3));
-            draw_rectangle(buffer, RectangleStyle_Filled, r3.min.x, r3.min.y, r3.max.x, r3.max.y, color);
+            if(overlay->m_is_enabled)
+            {
+                PackedColor color = m_palette.colors[PaletteColor_TileCorner];
+                
+                overlay->pushRect(RectangleStyle_Filled, minx - 3, miny - 3, minx + 3, miny + 3, color);
+                overlay->pushRect(RectangleStyle_Filled, maxx - 3, miny - 3, maxx + 3, miny + 3, color);
+                overlay->pushRect(RectangleStyle_Filled, minx - 3, maxy - 3, minx + 3, maxy + 3, color);
+                overlay->pushRect(RectangleStyle_Filled, maxx - 3, maxy - 3, maxx + 3, maxy + 3, color);
+            }
             
             // Draw fram for each tile.
-            Vec4 frame_color(0.8f, 0.788f, 0.65f);
-            draw_rectangle(buffer, RectangleStyle_Wireframe, minx, miny, maxx, maxy, frame_color);
+            draw_pixel_rectangle(buffer, RectangleStyle_Wireframe, minx, miny, maxx, maxy, 
+                                 scale_color(m_palette.colors[PaletteColor_TileFrame], light_level));
         }
     }
     
-    // If we have meters, we would have to multiply meters * world->pixels_per_meter.
-    // In order to convert to pixels.
-    // compute player's absolute position
-    F32 player_abs_x = 
-    (m_world_pos.tile_x*m_world->m_tile_dim) + m_world->m_offset_x +
-    (m_world_pos.tile_center_rel_x*m_world->m_pixels_per_meter) + m_world->m_tile_half_dim; 
-    
-    F32 player_abs_y = 
-    (m_world_pos.tile_y * m_world->m_tile_dim) + m_world->m_offset_y +
-    (m_world_pos.tile_center_rel_y*m_world->m_pixels_per_meter) + m_world->m_tile_half_dim;
+    // NOTE(alexey): Player's position relative to the camera in meters, 
+    // multiplied by pixels_per_meter in order to convert to pixels.
+    Vec2 player_rel = m_world->subtractWorldPos(player_pos, camera.m_pos);
+    F32 player_abs_x = screen_center_x + player_rel.x*pixels_per_meter;
+    F32 player_abs_y = screen_center_y + player_rel.y*pixels_per_meter;
     
-    F32 player_minx = player_abs_x - (0.5f*m_player_dim.x*m_world->m_pixels_per_meter);
+    F32 player_minx = player_abs_x - (0.5f*m_player_dim.x*pixels_per_meter);
     F32 player_miny = player_abs_y;
     
-    F32 player_maxx = player_minx + m_player_dim.x*m_world->m_pixels_per_meter;
-    F32 player_maxy = player_miny + m_player_dim.y*m_world->m_pixels_per_meter;
+    F32 player_maxx = player_minx + m_player_dim.x*pixels_per_meter;
+    F32 player_maxy = player_miny + m_player_dim.y*pixels_per_meter;
     
 #if 0    
     DebugOut("PlayerAbsolute: (%.2f, %.2f)\nPlayerMin: (%.2f, %.2f)\nPlayerMax(%.2f, %.2f)\n\n", 
@@ -504,55 +649,167 @@ void GameState::render(OffscreenBuffer *buffer)
              player_maxy);
 #endif
     
-    // draw player
-    Vec4 player_color(0.80f, 1.0f, 0.44f);
-    draw_rectangle(&os->buffer, RectangleStyle_Filled, player_minx, player_miny, 
-                   player_maxx, player_maxy, player_color);
-    
-    // Draw player's collision box.
-    F32 maxy = player_abs_y + 0.45f*m_player_dim.y*m_world->m_pixels_per_meter;
-    draw_rectangle(buffer, RectangleStyle_Wireframe, player_minx, player_miny,
-                   player_maxx, maxy, Vec4(0.95f, 0.21f, 1.0f));
+    draw_bitmap(buffer, &m_scaled_shadow_bitmap, 
+                player_abs_x - 0.5f*m_scaled_shadow_bitmap.width, 
+                player_abs_y - 0.5f*m_scaled_shadow_bitmap.height);
     
-    Vec4 debug_color(1.0f, 0.0f, 0.47f);
-    // Draw debug rect for player's gravity center.
+    // draw player
+    if(m_scaled_player_bitmap.memory)
+    {
+        draw_bitmap(buffer, &m_scaled_player_bitmap, player_abs_x - 0.5f*m_scaled_player_bitmap.width, player_miny);
+    }
+    else
     {
-        Vec2 min(player_abs_x - 4.0f, player_abs_y - 4.0f);
-        Vec2 max(player_abs_x + 4.0f, player_abs_y + 4.0f);
-        draw_rectangle(buffer, RectangleStyle_Wireframe, min.x, min.y, max.x, max.y, debug_color);
+        draw_rectangle(buffer, RectangleStyle_Filled, player_minx, player_miny, 
+                       player_maxx, player_maxy, m_palette.colors[PaletteColor_Player]);
     }
     
-    // Draw debug rect for player's left point.
+    if(overlay->m_is_enabled)
     {
-        Vec2 min(player_minx - 4.0f, player_abs_y - 4.0f);
-        Vec2 max(player_minx + 4.0f, player_abs_y + 4.0f);
-        draw_rectangle(buffer,RectangleStyle_Wireframe,  min.x, min.y, max.x, max.y, debug_color);
+        // Draw player's collision box.
+        F32 maxy = player_abs_y + 0.45f*m_player_dim.y*pixels_per_meter;
+        overlay->pushRect(RectangleStyle_Wireframe, player_minx, player_miny,
+                          player_maxx, maxy, m_palette.colors[PaletteColor_PlayerCollisionBox]);
+        
+        PackedColor debug_color = m_palette.colors[PaletteColor_PlayerProbe];
+        // Draw debug rect for player's gravity center.
+        {
+            Vec2 min(player_abs_x - 4.0f, player_abs_y - 4.0f);
+            Vec2 max(player_abs_x + 4.0f, player_abs_y + 4.0f);
+            overlay->pushRect(RectangleStyle_Wireframe, min.x, min.y, max.x, max.y, debug_color);
+        }
+        
+        // Draw debug rect for player's left point.
+        {
+            Vec2 min(player_minx - 4.0f, player_abs_y - 4.0f);
+            Vec2 max(player_minx + 4.0f, player_abs_y + 4.0f);
+            overlay->pushRect(RectangleStyle_Wireframe, min.x, min.y, max.x, max.y, debug_color);
+        }
+        
+        // Draw debug rect for player's right point.
+        {
+            F32 x = player_abs_x + (0.5f*m_player_dim.x*pixels_per_meter); 
+            Vec2 min(x - 4.0f, player_abs_y - 4.0f);
+            Vec2 max(x + 4.0f, player_abs_y + 4.0f);
+            overlay->pushRect(RectangleStyle_Wireframe, min.x, min.y, max.x, max.y, debug_color);
+        }
+        
+        // Draw debug rect of player's top left point
+        {
+            F32 x = (player_abs_x - 0.5f*m_player_dim.x*pixels_per_meter);
+            F32 y = (player_abs_y + 0.45f*m_player_dim.y*pixels_per_meter);
+            Vec2 min(x - 4.0f, y - 4.0f);
+            Vec2 max(x + 4.0f, y + 4.0f);
+            overlay->pushRect(RectangleStyle_Wireframe, min.x, min.y, max.x, max.y, debug_color);
+        }
+        
+        // Draw debug rect of player's top right point
+        {
+            F32 x = (player_abs_x + 0.5f*m_player_dim.x*pixels_per_meter);
+            F32 y = (player_abs_y + 0.45f*m_player_dim.y*pixels_per_meter);
+            Vec2 min(x - 4.0f, y - 4.0f);
+            Vec2 max(x + 4.0f, y + 4.0f);
+            overlay->pushRect(RectangleStyle_Wireframe, min.x, min.y, max.x, max.y, debug_color);
+        }
     }
     
-    // Draw debug rect for player's right point.
+    if(overlay->m_is_enabled && snapshot->debug_path_point_count)
     {
-        F32 x = player_abs_x + (0.5f*m_player_dim.x*m_world->m_pixels_per_meter); 
-        Vec2 min(x - 4.0f, player_abs_y - 4.0f);
-        Vec2 max(x + 4.0f, player_abs_y + 4.0f);
-        draw_rectangle(buffer, RectangleStyle_Wireframe, min.x, min.y, max.x, max.y, debug_color);
+        // Draw the path of the last pathfinding benchmark, a point per tile.
+        PackedColor color = m_palette.colors[PaletteColor_DebugPath];
+        TilePoint tile = snapshot->debug_path[0];
+        U32 point_index = 0;
+        for(;;)
+        {
+            F32 x = tile_origin_x + ((tile.x - camera_tile_x) + 0.5f)*tile_side_in_pixels;
+            F32 y = tile_origin_y + ((tile.y - camera_tile_y) + 0.5f)*tile_side_in_pixels;
+            overlay->pushRect(RectangleStyle_Filled, x - 6.0f, y - 6.0f, x + 6.0f, y + 6.0f, color);
+            
+            TilePoint to = snapshot->debug_path[point_index];
+            if((tile.x == to.x) && (tile.y == to.y))
+            {
+                if(++point_index == snapshot->debug_path_point_count)
+                {
+                    break;
+                }
+                
+                to = snapshot->debug_path[point_index];
+            }
+            
+            tile.x += (to.x > tile.x) - (to.x < tile.x);
+            tile.y += (to.y > tile.y) - (to.y < tile.y);
+        }
     }
     
-    // Draw debug rect of player's top left point
+    // NOTE(alexey): Debug layer goes on top of everything.
+    overlay->render(buffer);
+}
+
+// NOTE(alexey): Streams the world from data/world.twld (see world_builder.cpp),
+// and falls back to the hand-made world when there is no world file.
+// When the host gives a seed (Os::world_seed), the world is generated into the arena instead of either.
+function void init_game_world(GameState *state)
+{
+    MemoryArena *arena = &state->m_permanent_arena;
+    WorldStreamer *streamer = &state->m_world_streamer;
+    
+    GameWorld *world = push_struct(arena, GameWorld);
+    if(!os->world_seed && streamer->open(arena, "data/world.twld", GAME_WORLD_STREAMER_MODE, 64, 2))
+    {
+        *world = GameWorld(streamer->m_maps,
+                           streamer->m_header.tile_map_count_x, 
+                           streamer->m_header.tile_map_count_y,
+                           streamer->m_header.tile_count_x,
+                           streamer->m_header.tile_count_y,
+                           60.0f, 1.4f);
+        streamer->attach(world);
+    }
+    else
     {
-        F32 x = (player_abs_x - 0.5f*m_player_dim.x*m_world->m_pixels_per_meter);
-        F32 y = (player_abs_y + 0.45f*m_player_dim.y*m_world->m_pixels_per_meter);
-        Vec2 min(x - 4.0f, y - 4.0f);
-        Vec2 max(x + 4.0f, y + 4.0f);
-        draw_rectangle(buffer, RectangleStyle_Wireframe, min.x, min.y, max.x, max.y, debug_color);
+        // NOTE(alexey): The player starts at tile (2, 2) of the first tile map,
+        // the generator never puts a wall there (the inner walls are at least 3 tiles away from the border).
+        WorldGeneratorParams params = {};
+        params.seed = os->world_seed;
+        params.tile_map_count_x = os->world_seed ? GENERATED_WORLD_TILE_MAP_COUNT : DefaultTileMapCountX;
+        params.tile_map_count_y = os->world_seed ? GENERATED_WORLD_TILE_MAP_COUNT : DefaultTileMapCountY;
+        params.tile_count_x = TilesCountX;
+        params.tile_count_y = TilesCountY;
+        
+        I32 tile_map_count = params.tile_map_count_x*params.tile_map_count_y;
+        TileMap *maps = push_array(arena, tile_map_count, TileMap);
+        for(I32 map_index = 0; map_index < tile_map_count; ++map_index)
+        {
+            maps[map_index].tiles = push_array(arena, TilesCountX*TilesCountY, U32);
+            if(os->world_seed)
+            {
+                // NOTE(alexey): The maps go top-down, see getWorldTileMap.
+                I32 tile_map_x = map_index % params.tile_map_count_x;
+                I32 tile_map_y = params.tile_map_count_y - map_index / params.tile_map_count_x - 1;
+                generate_tile_map(&params, tile_map_x, tile_map_y, maps[map_index].tiles);
+            }
+            else
+            {
+                memcpy(maps[map_index].tiles, default_tile_maps[map_index], sizeof(default_tile_maps[map_index]));
+            }
+        }
+        
+        *world = GameWorld(maps, params.tile_map_count_x, params.tile_map_count_y, TilesCountX, TilesCountY, 60.0f, 1.4f);
     }
     
-    // Draw debug rect of player's top right point
+    state->m_world = world;
+}
+
+function void simulation_thread_work(WorkQueue *queue, void *data);
+
+// NOTE(alexey): Not while the platform asks the simulation thread to quit (see Os::quit_requested),
+// the simulation runs on the main thread then, and the thread is started again once the flag is cleared.
+function void start_simulation_thread(GameState *state)
+{
+    if(os->simulation_queue && !atomic_load_uint32(&os->quit_requested))
     {
-        F32 x = (player_abs_x + 0.5f*m_player_dim.x*m_world->m_pixels_per_meter);
-        F32 y = (player_abs_y + 0.45f*m_player_dim.y*m_world->m_pixels_per_meter);
-        Vec2 min(x - 4.0f, y - 4.0f);
-        Vec2 max(x + 4.0f, y + 4.0f);
-        draw_rectangle(buffer, RectangleStyle_Wireframe, min.x, min.y, max.x, max.y, debug_color);
+        state->m_last_simulation_qpc = os->get_qpc();
+        memcpy(state->m_simulation_keys_down, os->input.keys_down, sizeof(state->m_simulation_keys_down));
+        state->m_simulation_is_threaded = os->add_work_entry(os->simulation_queue, simulation_thread_work, state);
     }
 }
 
@@ -570,372 +827,395 @@ function void init_game_state(GameState *state)
         state->m_player_dim.y = 1.4f;
         state->m_player_speed_in_meters = 3.5f;
         
+        state->m_camera.m_pos = state->m_world_pos;
+        state->m_camera.m_follow_rate = 6.0f;
+        
+        state->m_prev_world_pos = state->m_world_pos;
+        state->m_prev_camera_pos = state->m_camera.m_pos;
+        
+        init_arena(&state->m_permanent_arena, 
+                   (uint8 *)os->permanent_memory + sizeof(GameState), 
+                   os->permanent_memory_size - sizeof(GameState),
+                   os->commit_memory);
+        
+        init_palette(&state->m_palette);
+        
+        init_game_world(state);
+        
+        // NOTE(alexey): A scratch for every compute thread and one for the main thread.
+        state->m_pathfinder.init(&state->m_permanent_arena, state->m_world, &state->m_world_streamer,
+                                 os->compute_thread_count + 1);
+        state->m_path_graph.init(&state->m_permanent_arena, &state->m_pathfinder, PATH_GRAPH_SLOT_COUNT);
+        state->m_flow_field.init(&state->m_permanent_arena, &state->m_path_graph, FLOW_FIELD_CHUNK_RADIUS);
+        state->m_lighting.init(&state->m_permanent_arena, state->m_world, &state->m_world_streamer);
+        
+        state->m_shadow_bitmap = make_shadow_bitmap(&state->m_permanent_arena, 64, 24, 0.5f);
+        state->m_player_bitmap = load_bmp(&state->m_permanent_arena, "data/player.bmp");
+        
+        // NOTE(alexey): The render resolution is never above the output's, so the scaled bitmaps never grow.
+        // They're scaled with the first frame (see begin_render_target).
+        state->m_render_buffer.bpp = sizeof(U32);
+        state->m_render_buffer.data = push_size(&state->m_permanent_arena, RENDER_MAX_WIDTH*RENDER_MAX_HEIGHT*sizeof(U32), 16);
+        state->m_scale_filter = ScaleFilter_Bilinear;
+        state->m_scaled_shadow_bitmap = allocate_bitmap(&state->m_permanent_arena, 
+                                                        state->m_shadow_bitmap.width, state->m_shadow_bitmap.height);
+        if(state->m_player_bitmap.memory)
+        {
+            state->m_scaled_player_bitmap = allocate_bitmap(&state->m_permanent_arena, 
+                                                            state->m_player_bitmap.width, state->m_player_bitmap.height);
+        }
+        
+        // NOTE(alexey): Room for the tiles the camera sees at the biggest output (a partial tile on both sides) 
+        // and a tile of the camera's movement between the two steps.
+        I32 snapshot_tile_count_x = (I32)(RENDER_MAX_WIDTH / state->m_world->m_tile_side_in_pixels) + 3;
+        I32 snapshot_tile_count_y = (I32)(RENDER_MAX_HEIGHT / state->m_world->m_tile_side_in_pixels) + 3;
+        state->m_max_snapshot_tile_count = snapshot_tile_count_x*snapshot_tile_count_y;
+        for(U32 slot_index = 0; slot_index < ArrayCount(state->m_snapshots); ++slot_index)
+        {
+            RenderSnapshot *snapshot = &state->m_snapshots[slot_index];
+            snapshot->tile_values = push_array(&state->m_permanent_arena, state->m_max_snapshot_tile_count, U32);
+            snapshot->light_levels = push_array(&state->m_permanent_arena, state->m_max_snapshot_tile_count, U8);
+            snapshot->debug_path = push_array(&state->m_permanent_arena, DEBUG_PATH_MAX_POINT_COUNT, TilePoint);
+        }
+        state->m_snapshot_buffer.init();
+        state->m_input_buffer.init();
+        
+        state->m_last_simulation_qpc = os->get_qpc();
+        state->m_simulation_stats.start_qpc = state->m_last_simulation_qpc;
+        state->m_simulation_stats.start_heap_allocation_count = heap_allocation_counter.allocation_count;
+        
         state->m_is_initialized = true;
+        
+        // NOTE(alexey): The simulation thread starts with the next frame's input, the first frames show nothing
+        // until it publishes the first snapshot.
+        start_simulation_thread(state);
     }
 }
 
-extern "C" __declspec(dllexport) GAME_UPDATE_AND_RENDER(game_update_and_render)
+// NOTE(alexey): Whatever has to happen before the simulation or the rendering of a frame.
+function GameState *begin_game_frame()
 {
-    os = os_;
-    
     assert(sizeof(GameState) <= os->permanent_memory_size);
     GameState *game_state = (GameState *)os->permanent_memory;
     
-    // subtract the size of GameState from permanent storage size.
-    os->permanent_memory_size -= sizeof(GameState);
+    // NOTE(alexey): Nothing is committed before the first frame, the game state is the first thing there.
+    // It's committed already in every other frame, so that's only a check.
+    bool32 game_state_is_committed = os->commit_memory(game_state, sizeof(GameState));
+    assert(game_state_is_committed);
     
     init_game_state(game_state);
     
+    // NOTE(alexey): Frame memory doesn't survive the frame.
+    // The first half is the render's, the second half is the simulation's (see run_simulation_batch).
+    init_arena(&game_state->m_frame_arena, os->frame_memory, os->frame_memory_size / 2, os->commit_memory);
+    
     // Process events from the platform layer.
     handleOsEvents();
     
-    // NOTE(alexey): Currently we mem-copying tile maps into memory every frame,
-    // but we have to do it only once.
-    uint8 *at = (uint8 *)os->permanent_memory + sizeof(GameState);
-    U32 *tiles = (U32 *)((uint8 *)os->permanent_memory + sizeof(GameState));
-    
-    U32 tile_map00[TilesCountY][TilesCountX] =
-    {
-        {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 2},
-        {1, 0, 0, 1, 0, 0, 0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 1},
-        {1, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1},
-        {1, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1},
-        {1, 0, 0, 1, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 0, 1},
-        {1, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1},
-        {1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
-    };
+    return game_state;
+}
 
-/*     
-    size_t tile_map_size = sizeof(tile_map00);
-    if(tile_map_size <= os->permanent_memory_size)
+// NOTE(alexey): Catches the simulation up with dt seconds of real time in fixed steps, 
+// and publishes the snapshot of the result for the renderer.
+function void run_simulation_batch(GameState *game_state, InputSample *sample, F32 dt)
+{
+    init_arena(&game_state->m_simulation_arena, 
+               (U8 *)os->frame_memory + os->frame_memory_size / 2, 
+               os->frame_memory_size - os->frame_memory_size / 2,
+               os->commit_memory);
+    
+    game_state->m_world_streamer.update(game_state->m_world_pos);
+    
+#if INTERNAL_BUILD
+    if(game_state->m_world_streamer.m_is_open &&
+       (game_state->m_world_streamer.m_frame_index % 300) == 0)
     {
-        memcpy(at, tile_map00, tile_map_size);
-        at += tile_map_size;
-        os->permanent_memory_size -= tile_map_size;
+        game_state->m_world_streamer.printStats();
     }
-     */
-
-    U32 tile_map01[TilesCountY][TilesCountX] = 
-    {
-        {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
-        {2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
-        {1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1},
-        {1, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1},
-        {1, 0, 0, 1, 0, 0, 0, 0, 1, 1, 1, 1, 1, 0, 0, 0, 1},
-        {1, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1, 0, 1},
-        {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1},
-    };
-
-/*     
-    if(tile_map_size <= os->permanent_memory_size)
+#endif
+    
+    // NOTE(alexey): A frame that took too long doesn't get more than SIMULATION_MAX_STEPS_PER_FRAME steps.
+    F32 max_batch_seconds = SIMULATION_MAX_STEPS_PER_FRAME*SIMULATION_SECONDS_PER_STEP;
+    game_state->m_simulation_accumulator += Minimum(dt, max_batch_seconds);
+    
+    while(game_state->m_simulation_accumulator >= SIMULATION_SECONDS_PER_STEP)
     {
-        memcpy(at, tile_map01, tile_map_size);
-        at += tile_map_size;
-        os->permanent_memory_size -= tile_map_size;
+        sample->input.dt_for_frame = SIMULATION_SECONDS_PER_STEP;
+        game_state->update(&sample->input);
+        ++game_state->m_simulation_step_count;
+        
+        game_state->m_simulation_accumulator -= SIMULATION_SECONDS_PER_STEP;
     }
-     */
-
-    U32 tile_map10[TilesCountY][TilesCountX] = 
-    {
-        {1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1},
-        {1, 0, 0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1},
-        {1, 0, 0, 1, 1, 1, 1, 0, 1, 1, 1, 1, 1, 0, 0, 0, 1},
-        {1, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 2},
-        {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
-    };
+    
+#if GAME_BENCHMARKS
+    handle_benchmark_keys(game_state, &sample->input);
+#endif
+    
+    TripleBuffer *snapshot_buffer = &game_state->m_snapshot_buffer;
+    game_state->captureSnapshot(&game_state->m_snapshots[snapshot_buffer->m_write_slot], sample);
+    snapshot_buffer->publish();
+}
 
-/*     
-    if(tile_map_size <= os->permanent_memory_size)
+// NOTE(alexey): Runs on the simulation queue's thread until the platform sets os->quit_requested.
+// Takes the latest input the main thread published, simulates the real time that passed since the last batch,
+// and sleeps until the next step is due.
+// The simulation goes back to the main thread once it returns, the platform waits for that before it calls the game again.
+function void simulation_thread_work(WorkQueue *queue, void *data)
+{
+    GameState *game_state = (GameState *)data;
+    TripleBuffer *input_buffer = &game_state->m_input_buffer;
+    F32 seconds_per_count = 1.0f / (F32)os->frequency;
+    
+    while(!atomic_load_uint32(&os->quit_requested))
     {
-        memcpy(at, tile_map10, tile_map_size);
-        at += tile_map_size;
-        os->permanent_memory_size -= tile_map_size;
+        input_buffer->acquireLatest();
+        InputSample *sample = &game_state->m_input_samples[input_buffer->m_read_slot];
+        
+        // NOTE(alexey): A batch can take the same sample again, or skip the ones published in between,
+        // so the keys changed since the last batch, not since the main thread's last frame.
+        Input *input = &sample->input;
+        for(U32 word_index = 0; word_index < ArrayCount(input->keys_down); ++word_index)
+        {
+            input->keys_changed[word_index] = input->keys_down[word_index] ^ game_state->m_simulation_keys_down[word_index];
+            game_state->m_simulation_keys_down[word_index] = input->keys_down[word_index];
+        }
+        
+        U64 qpc = os->get_qpc();
+        F32 dt = (qpc - game_state->m_last_simulation_qpc)*seconds_per_count;
+        game_state->m_last_simulation_qpc = qpc;
+        
+        run_simulation_batch(game_state, sample, dt);
+        
+        F32 seconds_to_next_step = SIMULATION_SECONDS_PER_STEP - game_state->m_simulation_accumulator;
+        os->sleep((U32)(seconds_to_next_step*1000.0f));
     }
-     */
+    
+    game_state->m_simulation_is_threaded = false;
+}
 
-    U32 tile_map11[TilesCountY][TilesCountX] = 
-    {
-        {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1},
-        {1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1},
-        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1},
-        {1, 0, 1, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 1},
-        {1, 0, 1, 0, 0, 1, 0, 0, 0, 0, 1, 0, 1, 1, 0, 0, 1},
-        {1, 0, 1, 0, 1, 1, 1, 0, 0, 0, 0, 1, 1, 0, 0, 0, 1},
-        {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1},
-        {2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1},
-        {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
-    };
+#if INTERNAL_BUILD
+function void print_simulation_stats(GameState *game_state, RenderSnapshot *snapshot)
+{
+    SimulationStats *stats = &game_state->m_simulation_stats;
+    F64 seconds_per_count = 1.0 / (F64)os->frequency;
+    F64 seconds = (os->get_qpc() - stats->start_qpc)*seconds_per_count;
+    
+    // NOTE(alexey): Both threads, the game should be at 0 once nothing new is loaded.
+    U64 heap_allocation_count = heap_allocation_counter.allocation_count - stats->start_heap_allocation_count;
+    
+    DebugOut("Simulation (%s): %.1f steps/s, %.1f frames/s, %.1f new snapshots/s, render %.3f ms/frame, "
+             "input latency %.2f ms (%.2f ms max), %.2f heap allocations/frame, "
+             "game memory %.1f MB committed of %.1f MB reserved\n",
+             game_state->m_simulation_is_threaded ? "threaded" : "serial",
+             (snapshot->step_index - stats->start_step_index) / seconds,
+             stats->frame_count / seconds,
+             stats->new_snapshot_count / seconds,
+             stats->render_counts*seconds_per_count*1000.0 / stats->frame_count,
+             stats->new_snapshot_count ? stats->latency_counts*seconds_per_count*1000.0 / stats->new_snapshot_count : 0.0,
+             stats->max_latency_counts*seconds_per_count*1000.0,
+             (F64)heap_allocation_count / stats->frame_count,
+             atomic_load_uint64(&os->committed_memory_size) / (1024.0*1024.0),
+             os->reserved_memory_size / (1024.0*1024.0));
+    
+    *stats = {};
+    stats->start_qpc = os->get_qpc();
+    stats->start_step_index = snapshot->step_index;
+    stats->start_heap_allocation_count = heap_allocation_counter.allocation_count;
+}
+#endif
 
-    /*     
-    if(tile_map_size <= os->permanent_memory_size)
+// NOTE(alexey): Fractions of the output resolution the scene can be rendered at.
+static F32 render_scales[] = {1.0f, 0.75f, 0.5f, 0.25f};
+
+// NOTE(alexey): How much the output is cut down to fit RENDER_MAX_WIDTH x RENDER_MAX_HEIGHT (keeping its aspect),
+// 1 when it fits already.
+function F32 get_output_fit(I32 output_width, I32 output_height)
+{
+    F32 result = 1.0f;
+    if((output_width > 0) && (output_height > 0))
     {
-        memcpy(at, tile_map11, tile_map_size);
-        at += tile_map_size;
-        os->permanent_memory_size -= tile_map_size;
+        result = Minimum(result, (F32)RENDER_MAX_WIDTH / output_width);
+        result = Minimum(result, (F32)RENDER_MAX_HEIGHT / output_height);
     }
-    */
+    return result;
+}
 
-    TileMap map00;
-    map00.tiles = (U32 *)tile_map00;
-    
-    TileMap map10;
-    map10.tiles = (U32 *)tile_map10;
-    
-    TileMap map01;
-    map01.tiles = (U32 *)tile_map01;
-    
-    TileMap map11;
-    map11.tiles = (U32 *)tile_map11;
-    
-    TileMap maps[2][2];
-    
-    maps[0][0] = map00;
-    maps[1][0] = map10;
-    maps[0][1] = map01;
-    maps[1][1] = map11;
+// NOTE(alexey): What the camera sees at the output's size, in meters.
+function Vec2 get_view_dim(GameWorld *world, I32 output_width, I32 output_height)
+{
+    F32 fit = get_output_fit(output_width, output_height);
+    Vec2 result(Maximum(output_width, 0)*fit / world->m_pixels_per_meter,
+                Maximum(output_height, 0)*fit / world->m_pixels_per_meter);
+    return result;
+}
 
-    GameWorld game_world((TileMap *)maps, 2, 2, TilesCountX, TilesCountY, 50, 30, 60, 60.0f, 1.4f);
-    
-    game_state->m_world = &game_world;
-    
-#if 0
-    game_state->update(&os->input);
-    game_state->render(&os->buffer);
-#else 
-    F32 dt_player_x = 0.0f;
-    F32 dt_player_y = 0.0f;
-    
-    Input *input = &os->input;
-    if(input->onKeyPressed(Key_W) ||
-       input->onKeyPressed(Key_Up))
+// NOTE(alexey): F7 cycles through the render scales, F8 through the scale filters.
+function void handle_render_keys(GameState *state, Input *input)
+{
+    Bool32 render_scale_key_is_down = input->onKeyPressed(Key_F7);
+    if(render_scale_key_is_down && !state->m_render_scale_key_was_down)
     {
-        dt_player_y += 1.0f;
+        state->m_render_scale_index = (state->m_render_scale_index + 1) % ArrayCount(render_scales);
     }
+    state->m_render_scale_key_was_down = render_scale_key_is_down;
     
-    if(input->onKeyPressed(Key_A) ||
-       input->onKeyPressed(Key_Left))
+    Bool32 scale_filter_key_is_down = input->onKeyPressed(Key_F8);
+    if(scale_filter_key_is_down && !state->m_scale_filter_key_was_down)
     {
-        dt_player_x -= 1.0f;
+        state->m_scale_filter = (ScaleFilter)((state->m_scale_filter + 1) % ScaleFilter_Count);
     }
+    state->m_scale_filter_key_was_down = scale_filter_key_is_down;
+}
+
+// NOTE(alexey): The buffer the scene is drawn into, the output itself when it's drawn at its resolution.
+// Scales the bitmaps with the resolution when it changed.
+function OffscreenBuffer *begin_render_target(GameState *state, OffscreenBuffer *output)
+{
+    F32 scale = get_output_fit(output->width, output->height)*render_scales[state->m_render_scale_index];
     
-    if(input->onKeyPressed(Key_S) ||
-       input->onKeyPressed(Key_Down))
+    OffscreenBuffer *result = output;
+    if(scale < 1.0f)
     {
-        dt_player_y -= 1.0f;
+        result = &state->m_render_buffer;
+        result->width = Maximum(round_real32_to_int32(output->width*scale), 1);
+        result->height = Maximum(round_real32_to_int32(output->height*scale), 1);
+        result->pitch = result->width*result->bpp;
     }
     
-    if(input->onKeyPressed(Key_D) || 
-       input->onKeyPressed(Key_Right))
+    if(scale != state->m_bitmap_scale)
     {
-        dt_player_x += 1.0f;
+        Bitmap *shadow = &state->m_shadow_bitmap;
+        Bitmap *player = &state->m_player_bitmap;
+        scale_bitmap(&state->m_scaled_shadow_bitmap, shadow, 
+                     Maximum(round_real32_to_int32(shadow->width*scale), 1), 
+                     Maximum(round_real32_to_int32(shadow->height*scale), 1), &state->m_frame_arena);
+        scale_bitmap(&state->m_scaled_player_bitmap, player, 
+                     Maximum(round_real32_to_int32(player->width*scale), 1), 
+                     Maximum(round_real32_to_int32(player->height*scale), 1), &state->m_frame_arena);
+        state->m_bitmap_scale = scale;
     }
     
-    // Going from pixels to meters
-    dt_player_x *= game_state->m_player_speed_in_meters;
-    dt_player_y *= game_state->m_player_speed_in_meters;
-    
-    // NOTE(alexey): To make player's movement frame independent.
-    // So it moves the same amount of pixels regardless of frame rate.
-    // For example: 100 pixels/second when it's 60/30fps.
-    WorldPos new_world_pos = game_state->m_world_pos;
-    new_world_pos.tile_center_rel_x += (dt_player_x * os->dt_for_frame);
-    new_world_pos.tile_center_rel_y += (dt_player_y * os->dt_for_frame);
-    new_world_pos = game_world.recomputeWorldPos(new_world_pos);
-    
-    /*
-      Player's rectangle: 
-      |______|
-      * <- left canonical pos.
-    */
-    WorldPos left_world_pos = game_state->m_world_pos;
-    left_world_pos.tile_center_rel_x += (dt_player_x*os->dt_for_frame) - (0.5f * game_state->m_player_dim.x);
-    left_world_pos.tile_center_rel_y += (dt_player_y * os->dt_for_frame);
-    left_world_pos = game_world.recomputeWorldPos(left_world_pos);
+    return result;
+}
+
+GAME_EXPORT GAME_UPDATE_AND_RENDER(game_update_and_render)
+{
+    os = os_;
     
-    /*
-      Player's rectangle:
-      |______|
-             * <- right canonical pos.
-    */
-    WorldPos right_world_pos = game_state->m_world_pos;
-    right_world_pos.tile_center_rel_x += (dt_player_x*os->dt_for_frame) + (0.5f*game_state->m_player_dim.x);
-    right_world_pos.tile_center_rel_y += (dt_player_y * os->dt_for_frame);
-    right_world_pos = game_world.recomputeWorldPos(right_world_pos);
+    BEGIN_TIMED_BLOCK(GameUpdateAndRender);
     
-    /*
-      Player's rectangle:
-     *______ 
-     |      |
-    */
-    WorldPos left_top_world_pos = left_world_pos;
-    left_top_world_pos.tile_center_rel_y += 0.45f*game_state->m_player_dim.y;
-    left_top_world_pos = game_world.recomputeWorldPos(left_top_world_pos);
+    GameState *game_state = begin_game_frame();
+    handle_render_keys(game_state, &os->input);
     
-    /*
-      Player's rectangle:
-      ______*
-     |      |
-    */
-    WorldPos right_top_world_pos = right_world_pos;
-    right_top_world_pos.tile_center_rel_y += 0.45f*game_state->m_player_dim.y;
-    right_top_world_pos = game_world.recomputeWorldPos(right_top_world_pos);
-
-    if(game_world.isTileMapPointEmpty(new_world_pos) &&
-       game_world.isTileMapPointEmpty(left_world_pos) &&
-       game_world.isTileMapPointEmpty(right_world_pos) &&
-       game_world.isTileMapPointEmpty(left_top_world_pos) &&
-       game_world.isTileMapPointEmpty(right_top_world_pos))
-    {
-        game_state->m_world_pos = new_world_pos;
-    }
-    
-    // flush background.
-    draw_rectangle(&os->buffer, RectangleStyle_Filled, 
-                   0.0f, 0.0f, (F32)os->buffer.width, (F32)os->buffer.height, Vec4(236, 213, 160));
-    // Draw tile map.
-    TileMap *map = game_world.getWorldTileMap(Cast(I32, game_state->m_world_pos.tile_map_x),
-                                              Cast(I32, game_state->m_world_pos.tile_map_y));
-    for(I32 tile_y = 0;
-        tile_y < game_world.m_tile_count_y;
-        ++tile_y)
+    if(!game_state->m_simulation_is_threaded)
     {
-        for(I32 tile_x = 0;
-            tile_x < game_world.m_tile_count_x;
-            ++tile_x)
-        {
-            /*
-              +------------+ (maxy, maxy) (world->tile_dim, world->tile_dim).
-              |            |
-              |            |
-              |            |
-              |            |
-              |            |
-              +------------+
-             (minx, miny), (0, 0)
-            */
-            F32 minx = (tile_x * game_world.m_tile_dim) + game_world.m_offset_x;
-            F32 miny = (tile_y * game_world.m_tile_dim) + game_world.m_offset_y;
-            F32 maxx = minx + game_world.m_tile_dim;
-            F32 maxy = miny + game_world.m_tile_dim;
-            
-            if(game_state->m_world_pos.tile_x == tile_x &&
-               game_state->m_world_pos.tile_y == tile_y)
-            {
-                Vec4 color(0.8f, 0.7f, 0.54f);
-                draw_rectangle(&os->buffer, RectangleStyle_Filled, minx, miny, maxx, maxy, color);
-            }
-            else if(!game_world.isTileEmpty(map, tile_x, tile_y))
-            {
-                U32 tile_value = game_world.getTileValue(map, tile_x, tile_y);
-                Vec4 color = (tile_value == 2) ? Vec4(0.25f, 0.5f, 0.5f) : Vec4(0.25f);
-                draw_rectangle(&os->buffer, RectangleStyle_Filled, minx, miny, maxx, maxy, color);
-            }
-            
-            // draw debug points.
-            Vec4 color(1.0f, 1.0f, 0.0f);
-            
-            Rect2 r0(Vec2(minx - 3, miny - 3), Vec2(minx + 3, miny + 3));
-            draw_rectangle(&os->buffer, RectangleStyle_Filled, r0.min.x, r0.min.y, r0.max.x, r0.max.y, color);
-            
-            Rect2 r1(Vec2(maxx - 3, miny - 3), Vec2(maxx + 3, miny + 3));
-            draw_rectangle(&os->buffer, RectangleStyle_Filled, r1.min.x, r1.min.y, r1.max.x, r1.max.y, color);
-            
-            Rect2 r2(Vec2(minx - 3, maxy - 3), Vec2(minx + 3, maxy + 3));
-            draw_rectangle(&os->buffer, RectangleStyle_Filled, r2.min.x, r2.min.y, r2.max.x, r2.max.y, color);
-            
-            Rect2 r3(Vec2(maxx - 3, maxy - 3), Vec2(maxx + 3, maxy + 3));
-            draw_rectangle(&os->buffer, RectangleStyle_Filled, r3.min.x, r3.min.y, r3.max.x, r3.max.y, color);
-
-            // Draw fram for each tile.
-            Vec4 frame_color(0.8f, 0.788f, 0.65f);
-            draw_rectangle(&os->buffer, RectangleStyle_Wireframe, minx, miny, maxx, maxy, frame_color);
-        }
+        start_simulation_thread(game_state);
     }
     
-    // If we have meters, we would have to multiply meters * world->pixels_per_meter.
-    // In order to convert to pixels.
-    // compute player's absolute position
-    F32 player_abs_x = 
-    (game_state->m_world_pos.tile_x*game_world.m_tile_dim) + game_world.m_offset_x +  
-    (game_state->m_world_pos.tile_center_rel_x*game_world.m_pixels_per_meter) + game_world.m_tile_half_dim; 
-    
-    F32 player_abs_y = 
-    (game_state->m_world_pos.tile_y * game_world.m_tile_dim) + game_world.m_offset_y +
-    (game_state->m_world_pos.tile_center_rel_y*game_world.m_pixels_per_meter) + game_world.m_tile_half_dim;
-    
-    F32 player_minx = player_abs_x - (0.5f*game_state->m_player_dim.x*game_world.m_pixels_per_meter);
-    F32 player_miny = player_abs_y;
-    
-    F32 player_maxx = player_minx + game_state->m_player_dim.x*game_world.m_pixels_per_meter;
-    F32 player_maxy = player_miny + game_state->m_player_dim.y*game_world.m_pixels_per_meter;
-
-#if 0    
-        DebugOut("PlayerAbsolute: (%.2f, %.2f)\nPlayerMin: (%.2f, %.2f)\nPlayerMax(%.2f, %.2f)\n\n", 
-                 player_abs_x, 
-                 player_abs_y,
-                 player_minx, 
-                 player_miny, 
-                 player_maxx, 
-                 player_maxy);
-#endif
-    
-    // draw player
-    Vec4 player_color(0.80f, 1.0f, 0.44f);
-    draw_rectangle(&os->buffer, RectangleStyle_Filled, player_minx, player_miny, 
-                   player_maxx, player_maxy, player_color);
+    // NOTE(alexey): os->dt_for_frame is the real time the last frame took.
+    // With a simulation thread the input is only handed over, the thread measures the time itself.
+    U64 input_qpc = os->get_qpc();
+    Vec2 view_dim = get_view_dim(game_state->m_world, os->buffer.width, os->buffer.height);
+    if(game_state->m_simulation_is_threaded)
+    {
+        InputSample *sample = &game_state->m_input_samples[game_state->m_input_buffer.m_write_slot];
+        sample->input = os->input;
+        sample->qpc = input_qpc;
+        sample->view_dim = view_dim;
+        game_state->m_input_buffer.publish();
+    }
+    else
+    {
+        InputSample *sample = &game_state->m_input_samples[0];
+        sample->input = os->input;
+        sample->qpc = input_qpc;
+        sample->view_dim = view_dim;
+        run_simulation_batch(game_state, sample, os->dt_for_frame);
+    }
     
-    // Draw player's collision box.
-    F32 maxy = player_abs_y + 0.45f*game_state->m_player_dim.y*game_world.m_pixels_per_meter;
-    draw_rectangle(&os->buffer, RectangleStyle_Wireframe, player_minx, player_miny,
-                       player_maxx, maxy, Vec4(0.95f, 0.21f, 1.0f));
+    Bool32 snapshot_is_new = game_state->m_snapshot_buffer.acquireLatest();
+    RenderSnapshot *snapshot = &game_state->m_snapshots[game_state->m_snapshot_buffer.m_read_slot];
     
-    Vec4 debug_color(1.0f, 0.0f, 0.47f);
-    // Draw debug rect for player's gravity center.
+    // NOTE(alexey): The simulation thread might have published a while ago, the time since then is interpolated too.
+    F32 alpha_seconds = snapshot->accumulator;
+    if(game_state->m_simulation_is_threaded)
     {
-        Vec2 min(player_abs_x - 4.0f, player_abs_y - 4.0f);
-        Vec2 max(player_abs_x + 4.0f, player_abs_y + 4.0f);
-        draw_rectangle(&os->buffer, RectangleStyle_Wireframe, min.x, min.y, max.x, max.y, debug_color);
+        alpha_seconds += (os->get_qpc() - snapshot->publish_qpc) / (F32)os->frequency;
     }
-
-    // Draw debug rect for player's left point.
+    F32 alpha = Clamp(alpha_seconds / SIMULATION_SECONDS_PER_STEP, 0.0f, 1.0f);
+    
+    U64 render_start_qpc = os->get_qpc();
+    OffscreenBuffer *render_target = begin_render_target(game_state, &os->buffer);
+    game_state->render(render_target, view_dim, snapshot, alpha);
+    if(render_target != &os->buffer)
     {
-        Vec2 min(player_minx - 4.0f, player_abs_y - 4.0f);
-        Vec2 max(player_minx + 4.0f, player_abs_y + 4.0f);
-        draw_rectangle(&os->buffer,RectangleStyle_Wireframe,  min.x, min.y, max.x, max.y, debug_color);
+        scale_buffer(&os->buffer, render_target, game_state->m_scale_filter, &game_state->m_frame_arena);
     }
-
-    // Draw debug rect for player's right point.
+    U64 render_end_qpc = os->get_qpc();
+    
+    SimulationStats *stats = &game_state->m_simulation_stats;
+    ++stats->frame_count;
+    stats->render_counts += render_end_qpc - render_start_qpc;
+    if(snapshot_is_new && snapshot->step_index)
     {
-        F32 x = player_abs_x + (0.5f*game_state->m_player_dim.x*game_world.m_pixels_per_meter); 
-        Vec2 min(x - 4.0f, player_abs_y - 4.0f);
-        Vec2 max(x + 4.0f, player_abs_y + 4.0f);
-        draw_rectangle(&os->buffer, RectangleStyle_Wireframe, min.x, min.y, max.x, max.y, debug_color);
+        U64 latency = render_end_qpc - snapshot->input_qpc;
+        ++stats->new_snapshot_count;
+        stats->latency_counts += latency;
+        stats->max_latency_counts = Maximum(stats->max_latency_counts, latency);
     }
     
-    // Draw debug rect of player's top left point
+#if INTERNAL_BUILD
+    if(stats->frame_count == SIMULATION_STATS_FRAME_COUNT)
     {
-        F32 x = (player_abs_x - 0.5f*game_state->m_player_dim.x*game_world.m_pixels_per_meter);
-        F32 y = (player_abs_y + 0.45f*game_state->m_player_dim.y*game_world.m_pixels_per_meter);
-        Vec2 min(x - 4.0f, y - 4.0f);
-        Vec2 max(x + 4.0f, y + 4.0f);
-        draw_rectangle(&os->buffer, RectangleStyle_Wireframe, min.x, min.y, max.x, max.y, debug_color);
+        print_simulation_stats(game_state, snapshot);
     }
+#endif
     
-    // Draw debug rect of player's top right point
+    END_TIMED_BLOCK(GameUpdateAndRender);
+}
+
+// NOTE(alexey): For the hosts without a window, steps the simulation step_count times and doesn't render anything.
+// Every step is a frame of its own for the platform events and the world streaming.
+// Only for the serial simulation, the platform stops the simulation thread first (see Os::quit_requested).
+GAME_EXPORT GAME_SIMULATE(game_simulate)
+{
+    os = os_;
+    
+    for(U32 step_index = 0; step_index < step_count; ++step_index)
     {
-        F32 x = (player_abs_x + 0.5f*game_state->m_player_dim.x*game_world.m_pixels_per_meter);
-        F32 y = (player_abs_y + 0.45f*game_state->m_player_dim.y*game_world.m_pixels_per_meter);
-        Vec2 min(x - 4.0f, y - 4.0f);
-        Vec2 max(x + 4.0f, y + 4.0f);
-        draw_rectangle(&os->buffer, RectangleStyle_Wireframe, min.x, min.y, max.x, max.y, debug_color);
+        GameState *game_state = begin_game_frame();
+        assert(!game_state->m_simulation_is_threaded);
+        
+        InputSample *sample = &game_state->m_input_samples[0];
+        sample->input = os->input;
+        sample->qpc = os->get_qpc();
+        sample->view_dim = get_view_dim(game_state->m_world, os->buffer.width, os->buffer.height);
+        run_simulation_batch(game_state, sample, SIMULATION_SECONDS_PER_STEP);
     }
-#endif
-}
\ No newline at end of file
+}
+
+// NOTE(alexey): For the hosts without a window, writes the last frame (os->buffer) to a file, 
+// a .ppm one if the name ends with .ppm, a .png one otherwise (see game_image.h).
+// The image is made in the render half of the frame memory (the other one is the simulation's, see run_simulation_batch), 
+// so it's only called in between the frames.
+GAME_EXPORT GAME_WRITE_FRAME(game_write_frame)
+{
+    os = os_;
+    
+    MemoryArena arena;
+    init_arena(&arena, os->frame_memory, os->frame_memory_size / 2, os->commit_memory);
+    
+    OffscreenBuffer *buffer = &os->buffer;
+    I32 pitch = buffer->width*4;
+    U8 *rgba = push_array(&arena, pitch*buffer->height, U8, 16);
+    convert_buffer_to_rgba(buffer, rgba, pitch);
+    
+    size_t name_length = strlen(file_name);
+    Bool32 is_ppm = (name_length >= 4) && (strcmp(file_name + name_length - 4, ".ppm") == 0);
+    ImageFile image = is_ppm ? 
+        encode_ppm(&arena, rgba, buffer->width, buffer->height, pitch) :
+        encode_png(&arena, rgba, buffer->width, buffer->height, pitch);
+    
+    Bool32 result = os->write_entire_file(file_name, image.data, image.size);
+    return result;
+}
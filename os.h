@@ -5,12 +5,24 @@
 #include <assert.h>
 #include <math.h>
 #include <limits.h>
+#include <float.h>
+#include <string.h>
 
 #define Int32Max INT_MAX
 #define Uint32Max UINT_MAX
+#define Uint64Max ULLONG_MAX
+#define F32Max FLT_MAX
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
 
 #define function static
 #include "game_dynamic_array.h"
+#include "game_memory_arena.h"
+#include "game_hash_map.h"
 
 typedef int64_t int64;
 typedef int32_t int32;
@@ -21,6 +33,7 @@ typedef uint32_t uint32;
 typedef uint64_t uint64;
 typedef int32 bool32;
 typedef float real32;
+typedef double real64;
 
 typedef int32 I32;
 typedef uint8 U8;
@@ -28,6 +41,7 @@ typedef uint16 U16;
 typedef uint32 U32;
 typedef uint64 U64;
 typedef real32 F32;
+typedef real64 F64;
 typedef bool32 Bool32;
 
 #define Gb(n) (uint64)(Mb(n) * (1024ull))
@@ -35,6 +49,90 @@ typedef bool32 Bool32;
 #define Kb(n) (uint64)((n) * (1024ull))
 
 #define Cast(type, value) (type)(value)
+#define ArrayCount(array) (sizeof(array) / sizeof((array)[0]))
+#define Minimum(a, b) (((a) < (b)) ? (a) : (b))
+#define Maximum(a, b) (((a) > (b)) ? (a) : (b))
+#define Clamp(value, min, max) Minimum(Maximum((value), (min)), (max))
+
+// NOTE(alexey): Atomics shared between the game and the platform worker threads.
+// Loads have acquire and stores have release semantics.
+#ifdef _MSC_VER
+inline uint32 atomic_load_uint32(uint32 volatile *value) { uint32 result = *value; _ReadWriteBarrier(); return result; }
+inline void atomic_store_uint32(uint32 volatile *value, uint32 new_value) { _ReadWriteBarrier(); *value = new_value; }
+inline uint32 atomic_add_uint32(uint32 volatile *value, uint32 addend) { return (uint32)_InterlockedExchangeAdd((long volatile *)value, (long)addend); }
+inline uint64 atomic_add_uint64(uint64 volatile *value, uint64 addend) { return (uint64)_InterlockedExchangeAdd64((__int64 volatile *)value, (__int64)addend); }
+inline uint32 atomic_exchange_uint32(uint32 volatile *value, uint32 new_value) { return (uint32)_InterlockedExchange((long volatile *)value, (long)new_value); }
+inline uint64 atomic_load_uint64(uint64 volatile *value) { uint64 result = *value; _ReadWriteBarrier(); return result; }
+inline uint64 atomic_exchange_uint64(uint64 volatile *value, uint64 new_value) { return (uint64)_InterlockedExchange64((__int64 volatile *)value, (__int64)new_value); }
+inline uint64 atomic_or_uint64(uint64 volatile *value, uint64 mask) { return (uint64)_InterlockedOr64((__int64 volatile *)value, (__int64)mask); }
+inline uint32 atomic_compare_exchange_uint32(uint32 volatile *value, uint32 new_value, uint32 expected)
+{
+    return (uint32)_InterlockedCompareExchange((long volatile *)value, (long)new_value, (long)expected);
+}
+#else
+inline uint32 atomic_load_uint32(uint32 volatile *value) { return __atomic_load_n(value, __ATOMIC_ACQUIRE); }
+inline void atomic_store_uint32(uint32 volatile *value, uint32 new_value) { __atomic_store_n(value, new_value, __ATOMIC_RELEASE); }
+inline uint32 atomic_add_uint32(uint32 volatile *value, uint32 addend) { return __atomic_fetch_add(value, addend, __ATOMIC_SEQ_CST); }
+inline uint64 atomic_add_uint64(uint64 volatile *value, uint64 addend) { return __atomic_fetch_add(value, addend, __ATOMIC_SEQ_CST); }
+inline uint32 atomic_exchange_uint32(uint32 volatile *value, uint32 new_value) { return __atomic_exchange_n(value, new_value, __ATOMIC_SEQ_CST); }
+inline uint64 atomic_load_uint64(uint64 volatile *value) { return __atomic_load_n(value, __ATOMIC_ACQUIRE); }
+inline uint64 atomic_exchange_uint64(uint64 volatile *value, uint64 new_value) { return __atomic_exchange_n(value, new_value, __ATOMIC_SEQ_CST); }
+inline uint64 atomic_or_uint64(uint64 volatile *value, uint64 mask) { return __atomic_fetch_or(value, mask, __ATOMIC_SEQ_CST); }
+inline uint32 atomic_compare_exchange_uint32(uint32 volatile *value, uint32 new_value, uint32 expected)
+{
+    return __sync_val_compare_and_swap(value, expected, new_value);
+}
+#endif
+
+// NOTE(alexey): Hands the latest of something over from one thread to another, neither of them ever waits.
+// The writer always has a slot of its own to write into, the reader has the one it reads, 
+// and the third one is the latest published. Publishing and taking the latest are a single exchange each.
+// Only the slot indices, the slots themselves are an array of 3 of whatever is buffered.
+// The bit is set in m_latest while the reader didn't take the published slot yet.
+#define TRIPLE_BUFFER_SLOT_MASK 0x3
+#define TRIPLE_BUFFER_NEW_BIT 0x4
+
+struct TripleBuffer
+{
+    void init();
+    
+    // NOTE(alexey): Writer side, the slot to write into changes with every publish.
+    void publish();
+    
+    // NOTE(alexey): Reader side, returns true when m_read_slot changed to a newly published slot.
+    bool32 acquireLatest();
+    
+    uint32 m_write_slot;
+    uint32 m_read_slot;
+    uint32 volatile m_latest;
+};
+
+inline void TripleBuffer::init()
+{
+    m_write_slot = 0;
+    m_latest = 1;
+    m_read_slot = 2;
+}
+
+inline void TripleBuffer::publish()
+{
+    // NOTE(alexey): The exchange makes the slot's contents visible before the reader can see the new bit.
+    uint32 old_latest = atomic_exchange_uint32(&m_latest, m_write_slot | TRIPLE_BUFFER_NEW_BIT);
+    m_write_slot = old_latest & TRIPLE_BUFFER_SLOT_MASK;
+}
+
+inline bool32 TripleBuffer::acquireLatest()
+{
+    bool32 result = false;
+    if(atomic_load_uint32(&m_latest) & TRIPLE_BUFFER_NEW_BIT)
+    {
+        uint32 old_latest = atomic_exchange_uint32(&m_latest, m_read_slot);
+        m_read_slot = old_latest & TRIPLE_BUFFER_SLOT_MASK;
+        result = true;
+    }
+    
+    return result;
+}
 
 function int32 floor_real32_to_int32(real32 value)
 {
@@ -43,6 +141,18 @@ function int32 floor_real32_to_int32(real32 value)
     return result;
 }
 
+// NOTE(alexey): Rounds towards negative infinity, unlike the / operator. divisor has to be positive.
+function int32 floor_div_int32(int32 value, int32 divisor)
+{
+    assert(divisor > 0);
+    int32 result = value / divisor;
+    if((value % divisor) < 0)
+    {
+        --result;
+    }
+    return result;
+}
+
 function int32 round_real32_to_int32(real32 value)
 {
     int32 result = (int32)(value + 0.5f);
@@ -118,17 +228,15 @@ union Vec3
     real32 e[3];
 };
 
-union Rect2
+// NOTE(alexey): Not a union with Vec2 e[2] like the others, members with constructors 
+// can't be in an anonymous struct on gcc and clang.
+struct Rect2
 {
     Rect2(Vec2 min_=Vec2(), Vec2 max_=Vec2())
         : min(min_), max(max_){}
     
-    struct 
-    {
-        Vec2 min;
-        Vec2 max;
-    };
-    Vec2 e[2];
+    Vec2 min;
+    Vec2 max;
 };
 
 enum EventType
@@ -162,11 +270,38 @@ enum Key
     Key_F9,
     Key_F10,
     Key_F11,
+    Key_F12,
     Key_Alt, 
     Key_Ctrl, 
     Key_Shift,
+    
+    Key_Count, // what the platform codes that aren't mapped translate to.
+};
+
+// NOTE(alexey): Platform key codes (virtual keys on windows) to Key, a single lookup per key message.
+// The platform maps the codes it knows once at startup, everything else stays Key_Count and isn't sent to the game.
+struct KeyTable
+{
+    uint8 keys[256];
 };
 
+inline void init_key_table(KeyTable *table)
+{
+    memset(table->keys, Key_Count, sizeof(table->keys));
+}
+
+inline void map_key(KeyTable *table, uint32 code, Key key)
+{
+    assert(code < 256);
+    table->keys[code] = (uint8)key;
+}
+
+inline Key translate_key(KeyTable *table, uint64 code)
+{
+    Key result = (code < 256) ? (Key)table->keys[code] : Key_Count;
+    return result;
+}
+
 enum MouseButton
 {
     MouseButton_Left,
@@ -194,6 +329,7 @@ struct Event
     
     // mouse
     Vec2 cursor;
+    Vec2 cursor_delta; // motion since the previous move, of all the moves that were coalesced into this one.
     int32 button;
     
     // TODO(alexey): Can we hit multiple buttons simultaneously?
@@ -205,23 +341,152 @@ bool32 event_equal(const Event& event, EventType type)
     return (event.type == type);
 }
 
+enum ControllerButton
+{
+    ControllerButton_A,
+    ControllerButton_B,
+    ControllerButton_X,
+    ControllerButton_Y,
+    ControllerButton_LeftShoulder,
+    ControllerButton_RightShoulder,
+    ControllerButton_Back,
+    ControllerButton_Start,
+    ControllerButton_DPadUp,
+    ControllerButton_DPadDown,
+    ControllerButton_DPadLeft,
+    ControllerButton_DPadRight,
+    
+    ControllerButton_Count,
+};
+
+// NOTE(alexey): Radial deadzone for the sticks (the magnitude of the stick, not each axis on its own, 
+// so the directions close to the axes don't snap to them), linear for the triggers.
+// Past the deadzone the magnitude is rescaled to [0, 1] and raised to CONTROLLER_RESPONSE_EXPONENT,
+// for finer control of the small movements. The deadzones are the ones XInput recommends.
+#define CONTROLLER_STICK_DEADZONE (7849.0f / 32767.0f)
+#define CONTROLLER_TRIGGER_DEADZONE (30.0f / 255.0f)
+#define CONTROLLER_RESPONSE_EXPONENT 1.5f
+
+// NOTE(alexey): How often the platform's thread polls the controller.
+#define CONTROLLER_POLL_RATE 1000
+
+// NOTE(alexey): Sticks are in [-1, 1] and triggers in [0, 1], with the deadzones and the response curve applied.
+struct Controller
+{
+    bool32 is_connected;
+    Vec2 left_stick;
+    Vec2 right_stick;
+    real32 left_trigger;
+    real32 right_trigger;
+    uint32 buttons; // a bit per ControllerButton.
+    uint64 sample_qpc; // when the platform read the state from the device.
+    
+    bool32 isButtonDown(ControllerButton button) { return (buttons >> button) & 1; }
+};
+
+// NOTE(alexey): raw_x and raw_y are the stick's axes normalized to [-1, 1].
+inline Vec2 process_stick(real32 raw_x, real32 raw_y, real32 deadzone, real32 exponent)
+{
+    Vec2 result(0.0f);
+    real32 magnitude = sqrtf(raw_x*raw_x + raw_y*raw_y);
+    if(magnitude > deadzone)
+    {
+        real32 scaled = (Minimum(magnitude, 1.0f) - deadzone) / (1.0f - deadzone);
+        real32 curved = powf(scaled, exponent);
+        result.x = raw_x*(curved / magnitude);
+        result.y = raw_y*(curved / magnitude);
+    }
+    return result;
+}
+
+inline real32 process_trigger(real32 raw, real32 deadzone)
+{
+    real32 result = 0.0f;
+    if(raw > deadzone)
+    {
+        result = (Minimum(raw, 1.0f) - deadzone) / (1.0f - deadzone);
+    }
+    return result;
+}
+
+// NOTE(alexey): The polling thread publishes every state it reads, the main thread takes the latest once a frame.
+struct ControllerMailbox
+{
+    TripleBuffer buffer;
+    Controller slots[3];
+};
+
+inline void publish_controller(ControllerMailbox *mailbox, Controller *controller)
+{
+    mailbox->slots[mailbox->buffer.m_write_slot] = *controller;
+    mailbox->buffer.publish();
+}
+
+// NOTE(alexey): Leaves dest as it is if nothing new was published.
+inline bool32 take_latest_controller(ControllerMailbox *mailbox, Controller *dest)
+{
+    bool32 result = mailbox->buffer.acquireLatest();
+    if(result)
+    {
+        *dest = mailbox->slots[mailbox->buffer.m_read_slot];
+    }
+    return result;
+}
+
 struct Input
 {
     F32 dt_for_frame;
     
-    int32 keys[256];
+    // NOTE(alexey): Bitsets indexed by Key, the keys that are down, 
+    // and the ones that went down or up during the frame (see process_events).
+    uint64 keys_down[4];
+    uint64 keys_changed[4];
     int32 mouse_buttons[5];
     
+    // NOTE(alexey): Where the cursor was at the last mouse move, and how much it moved during the frame.
+    Vec2 cursor;
+    Vec2 cursor_delta;
+    
+    Controller controller;
+    
+    // NOTE(alexey): onKeyPressed is true for as long as the key is down, 
+    // onKeyWentDown and onKeyReleased only in the frame the key went down or up.
     bool32 onKeyPressed(Key key);
-    bool32 onKeyReleased(Key key); // not implemented yet!
+    bool32 onKeyWentDown(Key key);
+    bool32 onKeyReleased(Key key);
+    void setKey(Key key, bool32 is_down);
     
     bool32 onMouseButtonPressed(MouseButton button);
 };
 
 inline bool32 Input::onKeyPressed(Key key)
 { 
-    assert(key >= 0 && key < 256); 
-    return keys[key];
+    assert(key >= 0 && key < Key_Count); 
+    return (keys_down[key >> 6] >> (key & 63)) & 1;
+}
+
+inline bool32 Input::onKeyWentDown(Key key)
+{ 
+    assert(key >= 0 && key < Key_Count); 
+    return ((keys_down[key >> 6] & keys_changed[key >> 6]) >> (key & 63)) & 1;
+}
+
+inline bool32 Input::onKeyReleased(Key key)
+{ 
+    assert(key >= 0 && key < Key_Count); 
+    return ((~keys_down[key >> 6] & keys_changed[key >> 6]) >> (key & 63)) & 1;
+}
+
+// NOTE(alexey): The key repeats of a key that is down already don't count as a change.
+inline void Input::setKey(Key key, bool32 is_down)
+{
+    assert(key >= 0 && key < Key_Count); 
+    uint64 bit = 1ull << (key & 63);
+    if(((keys_down[key >> 6] & bit) != 0) != (is_down != 0))
+    {
+        keys_down[key >> 6] ^= bit;
+        keys_changed[key >> 6] |= bit;
+    }
 }
 
 inline bool32 Input::onMouseButtonPressed(MouseButton button) 
@@ -230,18 +495,161 @@ inline bool32 Input::onMouseButtonPressed(MouseButton button)
     return mouse_buttons[button];
 }
 
+struct FileContents
+{
+    void *data;
+    uint64 size;
+};
+
+// NOTE(alexey): File that stays open, read_file_at() doesn't touch the file pointer,
+// so it can be called from multiple threads at the same time.
+struct PlatformFile
+{
+    void *handle;
+    uint64 size;
+};
+
+// NOTE(alexey): Read-only view of a whole file. Nothing is read up front,
+// the pages are faulted in by the OS when they are touched for the first time.
+struct PlatformFileMapping
+{
+    void *file_handle;
+    void *mapping_handle;
+    void *memory;
+    uint64 size;
+};
+
+enum PlatformMemoryAdvice
+{
+    PlatformMemoryAdvice_WillNeed, // start reading the pages in the background.
+    PlatformMemoryAdvice_DontNeed, // the pages can be dropped, touching them again faults them back in.
+};
+
+// NOTE(alexey): Work queue is defined by the platform layer.
+// Every queue has a single producer thread, the only one that adds entries and calls complete_all_work,
+// the entries are executed on the queue's worker threads. The main thread adds to simulation_queue,
+// compute_queue and loader_queue get theirs from the thread the simulation runs on
+// (the simulation thread while it's running, the main thread otherwise, never both at once).
+struct WorkQueue;
+typedef void (*WorkQueueCallbackPtr)(WorkQueue *queue, void *data);
+
+// NOTE(alexey): Cycle counters for the hot paths, the platform layer prints and resets them every so often
+// (every WIN32_DEBUG_CYCLE_COUNTER_FRAME_COUNT frames on win32, once at the end of the run on POSIX).
+// For the counters where hit_count is the amount of pixels, cycles/hits give us cycles per pixel.
+enum DebugCycleCounterType
+{
+    DebugCycleCounter_GameUpdateAndRender,
+    DebugCycleCounter_DrawRectangle,
+    DebugCycleCounter_DrawRectangleCall,
+    DebugCycleCounter_DrawBitmap,
+    DebugCycleCounter_DebugOverlay,
+    DebugCycleCounter_FindPaths,
+    DebugCycleCounter_BuildChunkGraph,
+    DebugCycleCounter_BuildFlowField,
+    DebugCycleCounter_UpdateLighting,
+    DebugCycleCounter_ClearBuffer,
+    DebugCycleCounter_ConvertBuffer,
+    DebugCycleCounter_ScaleBuffer,
+    
+    DebugCycleCounter_Count,
+};
+
+static const char *debug_cycle_counter_names[DebugCycleCounter_Count] =
+{
+    "GameUpdateAndRender",
+    "DrawRectangle",
+    "DrawRectangleCall",
+    "DrawBitmap",
+    "DebugOverlay",
+    "FindPaths",
+    "BuildChunkGraph",
+    "BuildFlowField",
+    "UpdateLighting",
+    "ClearBuffer",
+    "ConvertBuffer",
+    "ScaleBuffer",
+};
+
+// NOTE(alexey): The main, the simulation and the compute threads all add to the counters,
+// so they're added to atomically, and the platform takes them with an exchange when it prints and resets them.
+struct DebugCycleCounter
+{
+    uint64 volatile cycle_count;
+    uint64 volatile hit_count;
+};
+
+#define OS_INLINE_EVENT_COUNT 64
+
+typedef SmallArray<Event, OS_INLINE_EVENT_COUNT> EventQueue;
+
+// NOTE(alexey): A mouse move right after another one replaces it, the cursor is the latest one 
+// and the deltas add up, so a high polling rate mouse is a single event per frame while it only moves.
+// Key and button events in between keep the order, the moves before and after them stay separate.
+inline void push_mouse_move(EventQueue *events, Vec2 cursor, Vec2 cursor_delta)
+{
+    if(!events->empty() && (events->back().type == EventType_MouseMoved))
+    {
+        Event& last = events->back();
+        last.cursor = cursor;
+        last.cursor_delta += cursor_delta;
+    }
+    else
+    {
+        Event event = {};
+        event.type = EventType_MouseMoved;
+        event.cursor = cursor;
+        event.cursor_delta = cursor_delta;
+        events->push_back(event);
+    }
+}
+
+// NOTE(alexey): Which chunks of the reserved game memory the platform has committed, a bit per OS_COMMIT_CHUNK_SIZE.
+// The arenas of both threads commit through it, a chunk's bit is set by whoever committed it first,
+// so a chunk is counted once however many times it's asked for.
+#define OS_COMMIT_CHUNK_SIZE Mb(16)
+#define OS_MAX_COMMIT_CHUNK_COUNT 1024
+
+struct CommitMap
+{
+    uint8 *base;
+    uint64 size;
+    uint64 volatile chunks[OS_MAX_COMMIT_CHUNK_COUNT / 64];
+};
+
+inline void init_commit_map(CommitMap *map, void *base, uint64 size, bool32 is_committed)
+{
+    assert(size <= OS_MAX_COMMIT_CHUNK_COUNT*OS_COMMIT_CHUNK_SIZE);
+    map->base = (uint8 *)base;
+    map->size = size;
+    memset((void *)map->chunks, is_committed ? 0xFF : 0, sizeof(map->chunks));
+}
+
+inline bool32 is_chunk_committed(CommitMap *map, uint32 chunk_index)
+{
+    return (atomic_load_uint64(&map->chunks[chunk_index >> 6]) >> (chunk_index & 63)) & 1;
+}
+
+// NOTE(alexey): Returns true for the one that set the bit.
+inline bool32 mark_chunk_committed(CommitMap *map, uint32 chunk_index)
+{
+    uint64 bit = 1ull << (chunk_index & 63);
+    return !(atomic_or_uint64(&map->chunks[chunk_index >> 6], bit) & bit);
+}
+
 struct Os
 {
-    // NOTE(alexey): This is uses it's own memory allocated via malloc.
-    // Think how can we make it be a part of game memory.
-    Array<Event> events;
+    // NOTE(alexey): The events of a frame, the first OS_INLINE_EVENT_COUNT are stored inline,
+    // so the platform doesn't allocate in a frame unless a lot happened at once.
+    EventQueue events;
     Input input;
     
+    // NOTE(alexey): The real time the last frame took, the simulation runs in fixed steps of its own.
     real32 dt_for_frame;
     
     // timing
     uint64  frequency;
     uint64 (*get_qpc)();
+    void (*sleep)(uint32 milliseconds);
     
     // memory
     void *(*alloc_memory)(size_t);
@@ -251,18 +659,92 @@ struct Os
     void *frame_memory;
     uint64 frame_memory_size;
     
+    // NOTE(alexey): The permanent and the frame memory are a single reservation of address space, 
+    // nothing is committed until the game asks for it (see init_arena), which is what startup and the commit charge pay for.
+    // commit_memory can be asked for a range that is committed already, it's cheap then.
+    // With large pages everything is committed up front, they can't be committed a part at a time.
+    // committed_memory_size is what's committed so far, for the telemetry.
+    bool32 (*commit_memory)(void *memory, uint64 size);
+    uint64 reserved_memory_size;
+    uint64 volatile committed_memory_size;
+    
+    // NOTE(alexey): Non-zero to play a world generated from this seed (see game_world_generator.h)
+    // instead of data/world.twld, the hosts without the data can still run a world of a decent size.
+    uint64 world_seed;
+    
+    // files
+    FileContents (*read_entire_file)(const char *file_name);
+    void (*free_file_memory)(void *);
+    bool32 (*write_entire_file)(const char *file_name, void *data, uint64 size);
+    
+    // NOTE(alexey): open_file returns a file with handle set to NULL on failure.
+    PlatformFile (*open_file)(const char *file_name);
+    bool32 (*read_file_at)(PlatformFile *file, uint64 offset, uint64 size, void *dest);
+    void (*close_file)(PlatformFile *file);
+    
+    // NOTE(alexey): map_file returns a mapping with memory set to NULL on failure.
+    // advise_memory is only a hint, the range doesn't have to be page aligned.
+    PlatformFileMapping (*map_file)(const char *file_name);
+    void (*unmap_file)(PlatformFileMapping *mapping);
+    void (*advise_memory)(void *memory, uint64 size, PlatformMemoryAdvice advice);
+    
+    // threads
+    // NOTE(alexey): loader_queue has a single thread and is meant for blocking I/O.
+    // compute_queue has a thread per core (except the main one) and is meant for batches of work 
+    // that the main thread waits for with complete_all_work, the main thread picks up entries as well while it waits.
+    // add_work_entry returns false when the queue is full.
+    // simulation_queue has a single thread that the game keeps for the simulation until quit_requested is set,
+    // the simulation runs on the main thread, in between the frames, when it's NULL.
+    // The platform sets quit_requested before it unloads the game, exits or touches the game's memory itself,
+    // and waits for the simulation thread to return with complete_all_work(simulation_queue).
+    WorkQueue *loader_queue;
+    WorkQueue *compute_queue;
+    WorkQueue *simulation_queue;
+    uint32 volatile quit_requested;
+    uint32 compute_thread_count;
+    bool32 (*add_work_entry)(WorkQueue *queue, WorkQueueCallbackPtr callback, void *data);
+    void (*complete_all_work)(WorkQueue *queue);
+    
     OffscreenBuffer buffer;
     
     // window metrics
     real32 width;
     real32 height;
+    
+    DebugCycleCounter counters[DebugCycleCounter_Count];
 };
 
 static Os *os;
 
+#if INTERNAL_BUILD
+#define BEGIN_TIMED_BLOCK(id) uint64 start_cycle_count_##id = __rdtsc();
+#define END_TIMED_BLOCK_COUNTED(id, count)\
+atomic_add_uint64(&os->counters[DebugCycleCounter_##id].cycle_count, __rdtsc() - start_cycle_count_##id);\
+atomic_add_uint64(&os->counters[DebugCycleCounter_##id].hit_count, (count));
+#else
+#define BEGIN_TIMED_BLOCK(id)
+#define END_TIMED_BLOCK_COUNTED(id, count)
+#endif
+#define END_TIMED_BLOCK(id) END_TIMED_BLOCK_COUNTED(id, 1)
+
+// NOTE(alexey): The game is a library the platform loads, these are the functions it looks up by name.
+#ifdef _MSC_VER
+#define GAME_EXPORT extern "C" __declspec(dllexport)
+#else
+#define GAME_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
 #define GAME_UPDATE_AND_RENDER(name) void name(Os *os_)
 GAME_UPDATE_AND_RENDER(game_update_and_render_stub) {} 
 typedef void (*GameUpdateAndRenderPtr)(Os *);
 
+#define GAME_SIMULATE(name) void name(Os *os_, uint32 step_count)
+GAME_SIMULATE(game_simulate_stub) {}
+typedef void (*GameSimulatePtr)(Os *, uint32);
+
+#define GAME_WRITE_FRAME(name) bool32 name(Os *os_, const char *file_name)
+GAME_WRITE_FRAME(game_write_frame_stub) { return false; }
+typedef bool32 (*GameWriteFramePtr)(Os *, const char *);
+
 #define OS_H
 #endif //OS_H
@@ -0,0 +1,888 @@
+/*
+  The POSIX platform layer, a host without a window: it loads the game library (libgame.so, built from os.cpp
+  the same way game.dll is), fills in Os and runs the frames headless, for the servers, the CI boxes and profiling on linux.
+  Everything the game sees goes through Os, so the game code doesn't know which of the two hosts it runs in.
+
+  The input is a script of keys (--keys), a character per frame, and a gamepad (--gamepad /dev/input/eventN) on linux.
+  The last frame can be written to a .png or a .ppm file (--out), which is how the output of the two hosts is compared.
+  --benchmarks loads libgame_bench.so instead, the game with the benchmarks (see game_benchmarks.h),
+  they run when their F-key goes down in the script.
+  --seed N plays a world generated from the seed (see game_world_generator.h) instead of data/world.twld.
+
+  The permanent and the frame memory are backed by huge pages when the system has them:
+  MAP_HUGETLB from the reserved pool (vm.nr_hugepages) first, transparent huge pages (madvise) otherwise.
+  The memory is reserved up front and committed by the game's arenas as they grow (see Os::commit_memory),
+  --commit-everything commits all of it at startup instead.
+  The startup time, the page mode, the committed memory and the page faults up to the end of the first frame
+  are printed once it's done.
+
+  Usage: game [--frames N] [--simulate N] [--size WxH] [--keys wasd.0-=] [--out frame.png] [--seed N]
+              [--threaded] [--commit-everything] [--benchmarks] [--gamepad path] [--gamepad-benchmark path]
+*/
+
+#include "os.h"
+
+#ifdef function
+#undef function
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+#define DebugOut(format, ...) fprintf(stderr, format, ## __VA_ARGS__)
+
+#define function static
+
+#include "posix_game.h"
+
+#ifdef __linux__
+#include "linux_gamepad.cpp"
+#endif
+
+#define POSIX_HUGE_PAGE_SIZE Mb(2)
+
+static PosixVariables posix_variables;
+static KeyTable posix_key_table;
+static Os os_instance;
+static WorkQueue posix_loader_queue;
+static WorkQueue posix_compute_queue;
+static WorkQueue posix_simulation_queue;
+static ControllerMailbox posix_controller_mailbox;
+static CommitMap posix_commit_map;
+
+function void *posix_alloc_memory(size_t size)
+{
+    void *result = calloc(1, size);
+    return result;
+}
+
+function void posix_free_memory(void *memory)
+{
+    free(memory);
+}
+
+// NOTE(alexey): Reserves the permanent and the frame memory, see the top of the file.
+// With MAP_HUGETLB the pages come from the pool at mmap, so it's committed right away (the commit map says so).
+// Otherwise it's PROT_NONE address space, which isn't in the commit charge (Committed_AS) until
+// posix_commit_memory makes a chunk of it writable, that's when the kernel charges it.
+// Transparent huge pages are only used for the 2 MB aligned parts of a range, so the range is aligned
+// by mapping a huge page more than asked for and unmapping what's in front of and past the aligned part.
+function void *posix_reserve_game_memory(uint64 size, PosixPageMode *page_mode)
+{
+    void *result = 0;
+    *page_mode = PosixPageMode_Normal;
+    
+    uint64 huge_size = (size + POSIX_HUGE_PAGE_SIZE - 1) & ~(POSIX_HUGE_PAGE_SIZE - 1);
+    
+#ifdef MAP_HUGETLB
+    // NOTE(alexey): Fails right away when the pool doesn't have enough pages, the pages are reserved at mmap.
+    result = mmap(0, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(result != MAP_FAILED)
+    {
+        *page_mode = PosixPageMode_HugeTLB;
+        init_commit_map(&posix_commit_map, result, size, true);
+        return result;
+    }
+#endif
+    
+    uint8 *memory = (uint8 *)mmap(0, huge_size + POSIX_HUGE_PAGE_SIZE, PROT_NONE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(memory == MAP_FAILED)
+    {
+        return 0;
+    }
+    
+    uint8 *aligned = (uint8 *)(((uintptr_t)memory + POSIX_HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(POSIX_HUGE_PAGE_SIZE - 1));
+    if(aligned > memory)
+    {
+        munmap(memory, aligned - memory);
+    }
+    uint64 tail_size = (memory + huge_size + POSIX_HUGE_PAGE_SIZE) - (aligned + huge_size);
+    if(tail_size)
+    {
+        munmap(aligned + huge_size, tail_size);
+    }
+    result = aligned;
+    
+#ifdef MADV_HUGEPAGE
+    // NOTE(alexey): Succeeds even when THP is "never", the mode only says whether it's asked for.
+    // The advice stays with the range when the chunks are made writable.
+    if(madvise(result, huge_size, MADV_HUGEPAGE) == 0)
+    {
+        *page_mode = PosixPageMode_Transparent;
+    }
+#endif
+    
+    init_commit_map(&posix_commit_map, result, size, false);
+    return result;
+}
+
+// NOTE(alexey): Commits the OS_COMMIT_CHUNK_SIZE chunks the range touches, the ones that aren't committed yet.
+// Called from the arenas of both the main and the simulation thread.
+function bool32 posix_commit_memory(void *memory, uint64 size)
+{
+    CommitMap *map = &posix_commit_map;
+    if(!size)
+    {
+        return true;
+    }
+    
+    assert(((uint8 *)memory >= map->base) && ((uint8 *)memory + size <= map->base + map->size));
+    uint32 first_chunk_index = (uint32)(((uint8 *)memory - map->base) / OS_COMMIT_CHUNK_SIZE);
+    uint32 last_chunk_index = (uint32)(((uint8 *)memory + size - 1 - map->base) / OS_COMMIT_CHUNK_SIZE);
+    for(uint32 chunk_index = first_chunk_index; chunk_index <= last_chunk_index; ++chunk_index)
+    {
+        if(!is_chunk_committed(map, chunk_index))
+        {
+            uint8 *chunk = map->base + (uint64)chunk_index*OS_COMMIT_CHUNK_SIZE;
+            uint64 chunk_size = Minimum(OS_COMMIT_CHUNK_SIZE, map->size - (uint64)chunk_index*OS_COMMIT_CHUNK_SIZE);
+            if(mprotect(chunk, chunk_size, PROT_READ | PROT_WRITE) != 0)
+            {
+                return false;
+            }
+            
+            if(mark_chunk_committed(map, chunk_index))
+            {
+                atomic_add_uint64(&os_instance.committed_memory_size, chunk_size);
+            }
+        }
+    }
+    
+    return true;
+}
+
+function const char *posix_get_page_mode_name(PosixPageMode page_mode)
+{
+    switch(page_mode)
+    {
+        case PosixPageMode_HugeTLB: return "huge (hugetlb)";
+        case PosixPageMode_Transparent: return "huge (transparent)";
+        default: return "normal";
+    }
+}
+
+// NOTE(alexey): How much of the process's anonymous memory is on transparent huge pages, in kB, 0 when it's unknown.
+function uint64 posix_get_anon_huge_page_kb()
+{
+    uint64 result = 0;
+    
+#ifdef __linux__
+    FILE *file = fopen("/proc/self/smaps_rollup", "r");
+    if(file)
+    {
+        char line[256];
+        while(fgets(line, sizeof(line), file))
+        {
+            unsigned long long kb;
+            if(sscanf(line, "AnonHugePages: %llu kB", &kb) == 1)
+            {
+                result = kb;
+                break;
+            }
+        }
+        fclose(file);
+    }
+#endif
+    
+    return result;
+}
+
+function void posix_free_file_memory(void *memory)
+{
+    free(memory);
+}
+
+// NOTE(alexey): Returns FileContents with data set to NULL if the file couldn't be read.
+// Memory has to be released with posix_free_file_memory.
+function FileContents posix_read_entire_file(const char *file_name)
+{
+    FileContents result = {};
+    
+    int file = open(file_name, O_RDONLY);
+    if(file >= 0)
+    {
+        struct stat file_stat;
+        if((fstat(file, &file_stat) == 0) && (file_stat.st_size > 0) && ((uint64)file_stat.st_size <= Uint32Max))
+        {
+            uint64 size = (uint64)file_stat.st_size;
+            result.data = malloc(size);
+            if(result.data)
+            {
+                uint8 *at = (uint8 *)result.data;
+                uint64 bytes_left = size;
+                while(bytes_left)
+                {
+                    ssize_t bytes_read = read(file, at, bytes_left);
+                    if(bytes_read <= 0)
+                    {
+                        break;
+                    }
+                    at += bytes_read;
+                    bytes_left -= bytes_read;
+                }
+                
+                if(!bytes_left)
+                {
+                    result.size = size;
+                }
+                else
+                {
+                    posix_free_file_memory(result.data);
+                    result.data = 0;
+                }
+            }
+        }
+        
+        close(file);
+    }
+    
+    return result;
+}
+
+function bool32 posix_write_entire_file(const char *file_name, void *data, uint64 size)
+{
+    bool32 result = false;
+    
+    int file = open(file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(file >= 0)
+    {
+        result = true;
+        uint8 *at = (uint8 *)data;
+        while(result && size)
+        {
+            ssize_t bytes_written = write(file, at, size);
+            result = (bytes_written > 0);
+            if(result)
+            {
+                at += bytes_written;
+                size -= bytes_written;
+            }
+        }
+        
+        close(file);
+    }
+    
+    return result;
+}
+
+// NOTE(alexey): The descriptor is stored plus one, so a NULL handle is still the failed open.
+function PlatformFile posix_open_file(const char *file_name)
+{
+    PlatformFile result = {};
+    
+    int file = open(file_name, O_RDONLY);
+    if(file >= 0)
+    {
+        struct stat file_stat;
+        if(fstat(file, &file_stat) == 0)
+        {
+            result.handle = (void *)(intptr_t)(file + 1);
+            result.size = (uint64)file_stat.st_size;
+        }
+        else
+        {
+            close(file);
+        }
+    }
+    
+    return result;
+}
+
+// NOTE(alexey): pread doesn't touch the file offset, so the reads can be issued from multiple threads.
+function bool32 posix_read_file_at(PlatformFile *file, uint64 offset, uint64 size, void *dest)
+{
+    bool32 result = true;
+    
+    int fd = (int)(intptr_t)file->handle - 1;
+    uint8 *at = (uint8 *)dest;
+    while(result && size)
+    {
+        ssize_t bytes_read = pread(fd, at, size, (off_t)offset);
+        result = (bytes_read > 0);
+        if(result)
+        {
+            at += bytes_read;
+            offset += bytes_read;
+            size -= bytes_read;
+        }
+    }
+    
+    return result;
+}
+
+function void posix_close_file(PlatformFile *file)
+{
+    if(file->handle)
+    {
+        close((int)(intptr_t)file->handle - 1);
+        file->handle = 0;
+        file->size = 0;
+    }
+}
+
+// NOTE(alexey): The descriptor can be closed right after mmap, the mapping keeps the file.
+function PlatformFileMapping posix_map_file(const char *file_name)
+{
+    PlatformFileMapping result = {};
+    
+    int file = open(file_name, O_RDONLY);
+    if(file >= 0)
+    {
+        struct stat file_stat;
+        if((fstat(file, &file_stat) == 0) && (file_stat.st_size > 0))
+        {
+            void *memory = mmap(0, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+            if(memory != MAP_FAILED)
+            {
+                result.memory = memory;
+                result.size = (uint64)file_stat.st_size;
+            }
+        }
+        
+        close(file);
+    }
+    
+    return result;
+}
+
+function void posix_unmap_file(PlatformFileMapping *mapping)
+{
+    if(mapping->memory)
+    {
+        munmap(mapping->memory, mapping->size);
+        *mapping = {};
+    }
+}
+
+// NOTE(alexey): madvise wants a page aligned start, the range is widened to the pages it touches.
+function void posix_advise_memory(void *memory, uint64 size, PlatformMemoryAdvice advice)
+{
+    if(!memory || !size)
+    {
+        return;
+    }
+    
+    uintptr_t page_size = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)memory & ~(page_size - 1);
+    uintptr_t end = ((uintptr_t)memory + size + page_size - 1) & ~(page_size - 1);
+    switch(advice)
+    {
+        case PlatformMemoryAdvice_WillNeed:
+        {
+            madvise((void *)start, end - start, MADV_WILLNEED);
+        }break;
+        
+        case PlatformMemoryAdvice_DontNeed:
+        {
+            madvise((void *)start, end - start, MADV_DONTNEED);
+        }break;
+    }
+}
+
+function bool32 posix_add_work_entry(WorkQueue *queue, WorkQueueCallbackPtr callback, void *data)
+{
+    bool32 result = false;
+    
+    uint32 new_next_entry_to_write = (queue->next_entry_to_write + 1) % ArrayCount(queue->entries);
+    if(new_next_entry_to_write != atomic_load_uint32(&queue->next_entry_to_read))
+    {
+        PosixWorkQueueEntry *entry = &queue->entries[queue->next_entry_to_write];
+        entry->callback = callback;
+        entry->data = data;
+        ++queue->completion_goal;
+        
+        // NOTE(alexey): The entry has to be visible before the workers see the new write index.
+        atomic_store_uint32(&queue->next_entry_to_write, new_next_entry_to_write);
+        sem_post(&queue->semaphore);
+        
+        result = true;
+    }
+    
+    return result;
+}
+
+// NOTE(alexey): Returns true when there was nothing to do.
+function bool32 posix_do_next_work_entry(WorkQueue *queue)
+{
+    bool32 should_sleep = false;
+    
+    uint32 original_next_entry_to_read = atomic_load_uint32(&queue->next_entry_to_read);
+    uint32 new_next_entry_to_read = (original_next_entry_to_read + 1) % ArrayCount(queue->entries);
+    if(original_next_entry_to_read != atomic_load_uint32(&queue->next_entry_to_write))
+    {
+        uint32 index = atomic_compare_exchange_uint32(&queue->next_entry_to_read,
+                                                      new_next_entry_to_read,
+                                                      original_next_entry_to_read);
+        if(index == original_next_entry_to_read)
+        {
+            PosixWorkQueueEntry entry = queue->entries[index];
+            entry.callback(queue, entry.data);
+            atomic_add_uint32(&queue->completion_count, 1);
+        }
+    }
+    else
+    {
+        should_sleep = true;
+    }
+    
+    return should_sleep;
+}
+
+// NOTE(alexey): The main thread helps with the work until the queue is drained.
+function void posix_complete_all_work(WorkQueue *queue)
+{
+    while(queue->completion_goal != atomic_load_uint32(&queue->completion_count))
+    {
+        posix_do_next_work_entry(queue);
+    }
+    
+    queue->completion_goal = 0;
+    queue->completion_count = 0;
+}
+
+function void *posix_work_queue_thread_proc(void *parameter)
+{
+    WorkQueue *queue = (WorkQueue *)parameter;
+    
+    for(;;)
+    {
+        if(posix_do_next_work_entry(queue))
+        {
+            sem_wait(&queue->semaphore);
+        }
+    }
+    
+    return 0;
+}
+
+function void posix_make_work_queue(WorkQueue *queue, uint32 thread_count)
+{
+    queue->completion_goal = 0;
+    queue->completion_count = 0;
+    queue->next_entry_to_write = 0;
+    queue->next_entry_to_read = 0;
+    sem_init(&queue->semaphore, 0, 0);
+    
+    for(uint32 thread_index = 0; thread_index < thread_count; ++thread_index)
+    {
+        pthread_t thread;
+        if(pthread_create(&thread, 0, posix_work_queue_thread_proc, queue) == 0)
+        {
+            pthread_detach(thread);
+        }
+    }
+}
+
+// NOTE(alexey): Unlike the win32 host, which prints and resets the counters every WIN32_DEBUG_CYCLE_COUNTER_FRAME_COUNT frames,
+// the counters add up over the whole run and are printed per frame at the end.
+function void posix_print_debug_cycle_counters(Os *os_, uint32 frame_count)
+{
+#if INTERNAL_BUILD
+    if(!frame_count)
+    {
+        return;
+    }
+    
+    DebugOut("DEBUG CYCLE COUNTS (per frame, %u frames):\n", frame_count);
+    for(int32 counter_index = 0; counter_index < DebugCycleCounter_Count; ++counter_index)
+    {
+        DebugCycleCounter *counter = &os_->counters[counter_index];
+        uint64 cycle_count = atomic_load_uint64(&counter->cycle_count);
+        uint64 hit_count = atomic_load_uint64(&counter->hit_count);
+        if(hit_count)
+        {
+            DebugOut("  %s: %llucy %lluh %llucy/h\n",
+                     debug_cycle_counter_names[counter_index],
+                     (unsigned long long)(cycle_count / frame_count),
+                     (unsigned long long)(hit_count / frame_count),
+                     (unsigned long long)(cycle_count / hit_count));
+        }
+    }
+#endif
+}
+
+// NOTE(alexey): The counts are in nanoseconds, so the frequency is 1e9.
+function uint64 posix_qpc()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64 result = (uint64)now.tv_sec*1000000000ull + (uint64)now.tv_nsec;
+    return result;
+}
+
+function void posix_sleep(uint32 milliseconds)
+{
+    struct timespec duration = {(time_t)(milliseconds / 1000), (long)(milliseconds % 1000)*1000000};
+    nanosleep(&duration, 0);
+}
+
+function real32 posix_elapsed_seconds(uint64 start_counts, uint64 end_counts)
+{
+    real32 result = (real32)((end_counts - start_counts) / 1000000000.0);
+    return result;
+}
+
+function void posix_get_exe_full_path(PosixVariables *variables, const char *argv0)
+{
+    ssize_t length = -1;
+#ifdef __linux__
+    length = readlink("/proc/self/exe", variables->exe_file_path, sizeof(variables->exe_file_path) - 1);
+#endif
+    if(length < 0)
+    {
+        length = (ssize_t)strlen(argv0);
+        if(length > (ssize_t)sizeof(variables->exe_file_path) - 1)
+        {
+            length = sizeof(variables->exe_file_path) - 1;
+        }
+        memcpy(variables->exe_file_path, argv0, length);
+    }
+    variables->exe_file_path[length] = 0;
+    
+    char *one_past_slash = variables->exe_file_path;
+    for(char *at = variables->exe_file_path; *at; ++at)
+    {
+        if(*at == '/')
+        {
+            one_past_slash = at + 1;
+        }
+    }
+    
+    size_t directory_length = one_past_slash - variables->exe_file_path;
+    memcpy(variables->one_past_slash, variables->exe_file_path, directory_length);
+    variables->one_past_slash[directory_length] = 0;
+}
+
+// NOTE(alexey): A path that doesn't fit is left empty rather than cut short, the library just doesn't load then.
+function void posix_build_game_library_path(PosixVariables *variables, const char *game_library_name)
+{
+    int length = snprintf(variables->game_library_full_path, sizeof(variables->game_library_full_path), "%s%s",
+                          variables->one_past_slash, game_library_name);
+    if((length < 0) || (length >= (int)sizeof(variables->game_library_full_path)))
+    {
+        DebugOut("the game library path is too long: %s%s\n", variables->one_past_slash, game_library_name);
+        variables->game_library_full_path[0] = 0;
+    }
+}
+
+function PosixGameCode posix_load_game_code(PosixVariables *variables)
+{
+    PosixGameCode result = {};
+    result.library = dlopen(variables->game_library_full_path, RTLD_NOW | RTLD_LOCAL);
+    
+    if(result.library)
+    {
+        result.update_and_render = (GameUpdateAndRenderPtr)dlsym(result.library, "game_update_and_render");
+        result.simulate = (GameSimulatePtr)dlsym(result.library, "game_simulate");
+        result.write_frame = (GameWriteFramePtr)dlsym(result.library, "game_write_frame");
+        if(result.update_and_render && result.simulate && result.write_frame)
+        {
+            result.is_valid = true;
+        }
+    }
+    else
+    {
+        DebugOut("couldn't load %s: %s\n", variables->game_library_full_path, dlerror());
+    }
+    
+    if(!result.is_valid)
+    {
+        result.update_and_render = game_update_and_render_stub;
+        result.simulate = game_simulate_stub;
+        result.write_frame = game_write_frame_stub;
+    }
+    
+    return result;
+}
+
+// NOTE(alexey): The key script's characters are the platform key codes of this host.
+// A digit is an F key (1 is F1, 0 is F10), '-' is F11, '=' is F12, anything that isn't mapped ('.') holds no key.
+function void posix_init_key_table(KeyTable *table)
+{
+    init_key_table(table);
+    
+    map_key(table, 'w', Key_W);
+    map_key(table, 'a', Key_A);
+    map_key(table, 's', Key_S);
+    map_key(table, 'd', Key_D);
+    map_key(table, '1', Key_F1);
+    map_key(table, '2', Key_F2);
+    map_key(table, '3', Key_F3);
+    map_key(table, '4', Key_F4);
+    map_key(table, '5', Key_F5);
+    map_key(table, '6', Key_F6);
+    map_key(table, '7', Key_F7);
+    map_key(table, '8', Key_F8);
+    map_key(table, '9', Key_F9);
+    map_key(table, '0', Key_F10);
+    map_key(table, '-', Key_F11);
+    map_key(table, '=', Key_F12);
+}
+
+// NOTE(alexey): The script's character of a frame is the key held in the frame, the last one is held to the end.
+// A key goes up in the frame the script moves on to a different one.
+function void posix_push_script_keys(EventQueue *events, const char *keys, uint32 frame_index, Key *held_key)
+{
+    size_t key_count = strlen(keys);
+    if(!key_count)
+    {
+        return;
+    }
+    
+    uint8 code = (uint8)keys[(frame_index < key_count) ? frame_index : (key_count - 1)];
+    Key key = translate_key(&posix_key_table, code);
+    if(key != *held_key)
+    {
+        if(*held_key != Key_Count)
+        {
+            Event event = {};
+            event.type = EventType_KeyReleased;
+            event.key = *held_key;
+            events->push_back(event);
+        }
+        if(key != Key_Count)
+        {
+            Event event = {};
+            event.type = EventType_KeyPressed;
+            event.key = key;
+            events->push_back(event);
+        }
+        *held_key = key;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint64 startup_counts = posix_qpc();
+    
+    uint32 frame_count = 120;
+    uint32 simulate_step_count = 0;
+    int32 buffer_width = 1080;
+    int32 buffer_height = 720;
+    const char *keys = "d";
+    const char *out_file_name = 0;
+    const char *gamepad_path = 0;
+    bool32 is_threaded = false;
+    bool32 commit_everything = false;
+    bool32 with_benchmarks = false;
+    uint64 world_seed = 0;
+    for(int arg_index = 1; arg_index < argc; ++arg_index)
+    {
+        const char *arg = argv[arg_index];
+        const char *value = (arg_index + 1 < argc) ? argv[arg_index + 1] : 0;
+        if(!strcmp(arg, "--threaded"))
+        {
+            is_threaded = true;
+            continue;
+        }
+        if(!strcmp(arg, "--commit-everything"))
+        {
+            commit_everything = true;
+            continue;
+        }
+        if(!strcmp(arg, "--benchmarks"))
+        {
+            with_benchmarks = true;
+            continue;
+        }
+        if(!value)
+        {
+            DebugOut("%s needs a value\n", arg);
+            return 1;
+        }
+        
+        if(!strcmp(arg, "--frames")) frame_count = (uint32)atoi(value);
+        else if(!strcmp(arg, "--simulate")) simulate_step_count = (uint32)atoi(value);
+        else if(!strcmp(arg, "--size")) sscanf(value, "%dx%d", &buffer_width, &buffer_height);
+        else if(!strcmp(arg, "--keys")) keys = value;
+        else if(!strcmp(arg, "--out")) out_file_name = value;
+        else if(!strcmp(arg, "--gamepad")) gamepad_path = value;
+        else if(!strcmp(arg, "--seed")) world_seed = strtoull(value, 0, 10);
+        else if(!strcmp(arg, "--gamepad-benchmark"))
+        {
+#ifdef __linux__
+            linux_run_gamepad_benchmark(value);
+#endif
+            return 0;
+        }
+        else
+        {
+            DebugOut("unknown option %s\n", arg);
+            return 1;
+        }
+        ++arg_index;
+    }
+    
+    os_instance.frequency = 1000000000ull;
+    os_instance.get_qpc = posix_qpc;
+    os_instance.sleep = posix_sleep;
+    os_instance.dt_for_frame = 1.0f / 60.0f;
+    os_instance.world_seed = world_seed;
+    
+    os_instance.alloc_memory = posix_alloc_memory;
+    os_instance.free_memory = posix_free_memory;
+    
+    os_instance.read_entire_file = posix_read_entire_file;
+    os_instance.free_file_memory = posix_free_file_memory;
+    os_instance.write_entire_file = posix_write_entire_file;
+    os_instance.open_file = posix_open_file;
+    os_instance.read_file_at = posix_read_file_at;
+    os_instance.close_file = posix_close_file;
+    os_instance.map_file = posix_map_file;
+    os_instance.unmap_file = posix_unmap_file;
+    os_instance.advise_memory = posix_advise_memory;
+    
+    // NOTE(alexey): The same queues as on win32, the simulation has a thread of its own only when it's asked for,
+    // the serial one gives the same frames on every run.
+    long processor_count = sysconf(_SC_NPROCESSORS_ONLN);
+    os_instance.compute_thread_count = (processor_count > 1) ? (uint32)(processor_count - 1) : 1;
+    posix_make_work_queue(&posix_loader_queue, 1);
+    posix_make_work_queue(&posix_compute_queue, os_instance.compute_thread_count);
+    os_instance.loader_queue = &posix_loader_queue;
+    os_instance.compute_queue = &posix_compute_queue;
+    if(is_threaded)
+    {
+        posix_make_work_queue(&posix_simulation_queue, 1);
+        os_instance.simulation_queue = &posix_simulation_queue;
+    }
+    os_instance.add_work_entry = posix_add_work_entry;
+    os_instance.complete_all_work = posix_complete_all_work;
+    
+    posix_init_key_table(&posix_key_table);
+    
+#ifdef __linux__
+    LinuxGamepad gamepad = {};
+    gamepad.fd = -1;
+    if(gamepad_path)
+    {
+        if(!linux_open_gamepad(&gamepad, gamepad_path, &posix_controller_mailbox) ||
+           !linux_start_gamepad_thread(&gamepad))
+        {
+            DebugOut("couldn't open the gamepad %s\n", gamepad_path);
+        }
+    }
+#endif
+    
+    posix_get_exe_full_path(&posix_variables, argv[0]);
+#ifdef __APPLE__
+    posix_build_game_library_path(&posix_variables, with_benchmarks ? "libgame_bench.dylib" : "libgame.dylib");
+#else
+    posix_build_game_library_path(&posix_variables, with_benchmarks ? "libgame_bench.so" : "libgame.so");
+#endif
+    PosixGameCode game_code = posix_load_game_code(&posix_variables);
+    if(!game_code.is_valid)
+    {
+        return 1;
+    }
+    
+    os_instance.permanent_memory_size = Gb(2);
+    os_instance.frame_memory_size = Gb(2);
+    
+    uint64 alloc_size = (os_instance.permanent_memory_size + os_instance.frame_memory_size);
+    PosixPageMode page_mode;
+    os_instance.permanent_memory = posix_reserve_game_memory(alloc_size, &page_mode);
+    if(!os_instance.permanent_memory)
+    {
+        DebugOut("couldn't reserve %llu bytes of game memory\n", (unsigned long long)alloc_size);
+        return 1;
+    }
+    os_instance.frame_memory = (void *)((char *)os_instance.permanent_memory + os_instance.permanent_memory_size);
+    os_instance.commit_memory = posix_commit_memory;
+    os_instance.reserved_memory_size = alloc_size;
+    os_instance.committed_memory_size = (page_mode == PosixPageMode_HugeTLB) ? alloc_size : 0;
+    if(commit_everything)
+    {
+        // NOTE(alexey): The way it was before the lazy commit, for the comparison.
+        posix_commit_memory(os_instance.permanent_memory, alloc_size);
+    }
+    
+    os_instance.width = (real32)buffer_width;
+    os_instance.height = (real32)buffer_height;
+    os_instance.buffer.width = buffer_width;
+    os_instance.buffer.height = buffer_height;
+    os_instance.buffer.bpp = 4;
+    os_instance.buffer.pitch = buffer_width*4;
+    os_instance.buffer.data = posix_alloc_memory((size_t)os_instance.buffer.pitch*buffer_height);
+    
+    posix_variables.is_running = true;
+    Key held_key = Key_Count;
+    uint32 frame_index = 0;
+    uint64 start_counts = posix_qpc();
+    for(; posix_variables.is_running && (frame_index < frame_count); ++frame_index)
+    {
+        posix_push_script_keys(&os_instance.events, keys, frame_index, &held_key);
+#ifdef __linux__
+        if(gamepad.is_running)
+        {
+            take_latest_controller(&posix_controller_mailbox, &os_instance.input.controller);
+        }
+#endif
+        
+        game_code.update_and_render(&os_instance);
+        
+        if(frame_index == 0)
+        {
+            // NOTE(alexey): Everything the first frame touched was faulted in by now.
+            struct rusage usage;
+            getrusage(RUSAGE_SELF, &usage);
+            DebugOut("startup: %.2fms, %s pages (%llu kB on transparent huge pages), "
+                     "%llu of %llu MB committed, %ld minor and %ld major page faults, rss %ld kB\n",
+                     posix_elapsed_seconds(startup_counts, posix_qpc())*1000.0f,
+                     posix_get_page_mode_name(page_mode),
+                     (unsigned long long)posix_get_anon_huge_page_kb(),
+                     (unsigned long long)(os_instance.committed_memory_size / Mb(1)),
+                     (unsigned long long)(os_instance.reserved_memory_size / Mb(1)),
+                     usage.ru_minflt, usage.ru_majflt, usage.ru_maxrss);
+        }
+    }
+    uint64 end_counts = posix_qpc();
+    
+    // NOTE(alexey): The simulation thread writes to the game's memory, it's stopped before anything else touches it.
+    if(os_instance.simulation_queue)
+    {
+        atomic_store_uint32(&os_instance.quit_requested, true);
+        posix_complete_all_work(os_instance.simulation_queue);
+    }
+    
+    if(frame_index)
+    {
+        DebugOut("frames: %u, %.3f ms/frame\n", frame_index,
+                 posix_elapsed_seconds(start_counts, end_counts)*1000.0f / frame_index);
+    }
+    posix_print_debug_cycle_counters(&os_instance, frame_index);
+    
+    if(simulate_step_count)
+    {
+        uint64 simulate_start_counts = posix_qpc();
+        game_code.simulate(&os_instance, simulate_step_count);
+        DebugOut("simulate: %u steps, %.3f us/step\n", simulate_step_count,
+                 posix_elapsed_seconds(simulate_start_counts, posix_qpc())*1000000.0f / simulate_step_count);
+    }
+    
+    if(out_file_name && !game_code.write_frame(&os_instance, out_file_name))
+    {
+        DebugOut("couldn't write %s\n", out_file_name);
+    }
+    
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    DebugOut("page faults: %ld minor, %ld major, peak rss %ld kB, %llu of %llu MB committed\n", 
+             usage.ru_minflt, usage.ru_majflt, usage.ru_maxrss,
+             (unsigned long long)(atomic_load_uint64(&os_instance.committed_memory_size) / Mb(1)),
+             (unsigned long long)(os_instance.reserved_memory_size / Mb(1)));
+    
+#ifdef __linux__
+    linux_close_gamepad(&gamepad);
+#endif
+    
+    return 0;
+}
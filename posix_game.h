@@ -0,0 +1,53 @@
+/* date = October 18th 2026 2:30 pm */
+#ifndef POSIX_GAME_H
+
+struct PosixVariables
+{
+    bool32 is_running;
+    
+    char exe_file_path[256];
+    char one_past_slash[256];
+    
+    char game_library_full_path[256];
+};
+
+struct PosixGameCode
+{
+    void *library;
+    GameUpdateAndRenderPtr update_and_render;
+    GameSimulatePtr simulate;
+    GameWriteFramePtr write_frame;
+    bool32 is_valid;
+};
+
+// NOTE(alexey): How the game memory is backed, see posix_alloc_game_memory.
+enum PosixPageMode
+{
+    PosixPageMode_Normal,
+    PosixPageMode_Transparent, // madvise(MADV_HUGEPAGE), the kernel backs what it can with huge pages.
+    PosixPageMode_HugeTLB, // MAP_HUGETLB, from the reserved huge page pool.
+};
+
+struct PosixWorkQueueEntry
+{
+    WorkQueueCallbackPtr callback;
+    void *data;
+};
+
+// NOTE(alexey): The same circular buffer as the win32 one, written by the queue's single producer thread
+// (see WorkQueue in os.h), worker threads race for next_entry_to_read with a compare exchange.
+struct WorkQueue
+{
+    uint32 volatile completion_goal;
+    uint32 volatile completion_count;
+    
+    uint32 volatile next_entry_to_write;
+    uint32 volatile next_entry_to_read;
+    
+    sem_t semaphore;
+    
+    PosixWorkQueueEntry entries[256];
+};
+
+#define POSIX_GAME_H
+#endif //POSIX_GAME_H
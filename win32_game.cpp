@@ -6,10 +6,8 @@
 //     Could we use four uint32 to represent that data?
 // [ ] Put tile maps into the memory.
 // 
-// [ ] Make a wrapper for the platform layer so it can be reused.
+// [x] Make a wrapper for the platform layer so it can be reused (posix_game.cpp is the other host).
 // 
-// [ ] Implement gamepad input.
-//
 // [ ] Start looking into arenas!
 
 #include "os.h"
@@ -19,6 +17,8 @@
 #endif
 
 #include <windows.h>
+#include <psapi.h>
+#include <xinput.h>
 #include <gl/gl.h>
 
 #define DebugOut(format, ...)\
@@ -33,9 +33,18 @@ OutputDebugStringA(buf);\
 #include "win32_game.h"
 
 #define HARDWARE_RENDERER 1
+#define WIN32_DEBUG_CYCLE_COUNTER_FRAME_COUNT 300
 
 static Win32Variables win32_variables;
+static KeyTable win32_key_table;
 static Os os_instance;
+static WorkQueue win32_loader_queue;
+static WorkQueue win32_compute_queue;
+static WorkQueue win32_simulation_queue;
+static Win32PrefetchVirtualMemoryPtr *win32_prefetch_virtual_memory;
+static Win32XInputGetStatePtr *win32_xinput_get_state;
+static ControllerMailbox win32_controller_mailbox;
+static CommitMap win32_commit_map;
 
 function void *win32_alloc_memory(size_t size)
 {
@@ -47,6 +56,111 @@ function void *win32_alloc_memory(size_t size)
     return result;
 }
 
+// NOTE(alexey): Large pages need the "Lock pages in memory" privilege (SeLockMemoryPrivilege) 
+// granted to the user in the local security policy, it only has to be enabled for the process here.
+function bool32 win32_enable_large_pages()
+{
+    bool32 result = false;
+    
+    HANDLE token;
+    if(OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+    {
+        TOKEN_PRIVILEGES privileges = {};
+        privileges.PrivilegeCount = 1;
+        privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+        if(LookupPrivilegeValueA(0, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid))
+        {
+            // NOTE(alexey): Succeeds when the privilege isn't granted as well, only GetLastError tells.
+            AdjustTokenPrivileges(token, FALSE, &privileges, 0, 0, 0);
+            result = (GetLastError() == ERROR_SUCCESS);
+        }
+        CloseHandle(token);
+    }
+    
+    return result;
+}
+
+// NOTE(alexey): The permanent and the frame memory, on large pages (2 MB) when the user has the privilege 
+// and the system has enough contiguous physical memory, on the normal ones otherwise.
+// Large pages are committed and locked right away, they're never paged out, and can't be committed a part at a time.
+// The normal ones are only reserved, win32_commit_memory commits them as the game's arenas grow.
+function void *win32_reserve_game_memory(uint64 size, bool32 *has_large_pages)
+{
+    void *result = 0;
+    *has_large_pages = false;
+    
+    SIZE_T large_page_size = GetLargePageMinimum();
+    if(large_page_size && win32_enable_large_pages())
+    {
+        uint64 large_size = (size + large_page_size - 1) & ~((uint64)large_page_size - 1);
+        result = VirtualAlloc(0, large_size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        *has_large_pages = (result != 0);
+    }
+    
+    if(!result)
+    {
+        result = VirtualAlloc(0, size, MEM_RESERVE, PAGE_NOACCESS);
+    }
+    
+    if(result)
+    {
+        init_commit_map(&win32_commit_map, result, size, *has_large_pages);
+    }
+    
+    return result;
+}
+
+// NOTE(alexey): Commits the OS_COMMIT_CHUNK_SIZE chunks the range touches, the ones that aren't committed yet.
+// Called from the arenas of both the main and the simulation thread, 
+// committing a chunk twice when they race for it is fine, MEM_COMMIT of committed pages does nothing.
+function bool32 win32_commit_memory(void *memory, uint64 size)
+{
+    CommitMap *map = &win32_commit_map;
+    if(!size)
+    {
+        return true;
+    }
+    
+    assert(((uint8 *)memory >= map->base) && ((uint8 *)memory + size <= map->base + map->size));
+    uint32 first_chunk_index = (uint32)(((uint8 *)memory - map->base) / OS_COMMIT_CHUNK_SIZE);
+    uint32 last_chunk_index = (uint32)(((uint8 *)memory + size - 1 - map->base) / OS_COMMIT_CHUNK_SIZE);
+    for(uint32 chunk_index = first_chunk_index; chunk_index <= last_chunk_index; ++chunk_index)
+    {
+        if(!is_chunk_committed(map, chunk_index))
+        {
+            uint8 *chunk = map->base + (uint64)chunk_index*OS_COMMIT_CHUNK_SIZE;
+            uint64 chunk_size = Minimum(OS_COMMIT_CHUNK_SIZE, map->size - (uint64)chunk_index*OS_COMMIT_CHUNK_SIZE);
+            if(!VirtualAlloc(chunk, (SIZE_T)chunk_size, MEM_COMMIT, PAGE_READWRITE))
+            {
+                return false;
+            }
+            
+            if(mark_chunk_committed(map, chunk_index))
+            {
+                atomic_add_uint64(&os_instance.committed_memory_size, chunk_size);
+            }
+        }
+    }
+    
+    return true;
+}
+
+function uint32 win32_get_page_fault_count()
+{
+    PROCESS_MEMORY_COUNTERS counters = {};
+    counters.cb = sizeof(counters);
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PageFaultCount;
+}
+
+function uint64 win32_get_peak_working_set_size()
+{
+    PROCESS_MEMORY_COUNTERS counters = {};
+    counters.cb = sizeof(counters);
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize;
+}
+
 function void win32_free_memory(void *memory)
 {
     if(memory)
@@ -55,6 +169,326 @@ function void win32_free_memory(void *memory)
     }
 }
 
+function void win32_free_file_memory(void *memory)
+{
+    if(memory)
+    {
+        VirtualFree(memory, 0, MEM_RELEASE);
+    }
+}
+
+// NOTE(alexey): Returns FileContents with data set to NULL if the file couldn't be read.
+// Memory has to be released with win32_free_file_memory.
+function FileContents win32_read_entire_file(const char *file_name)
+{
+    FileContents result = {};
+    
+    HANDLE file = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+    if(file != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER file_size;
+        if(GetFileSizeEx(file, &file_size) && (file_size.QuadPart > 0) && (file_size.QuadPart <= Uint32Max))
+        {
+            DWORD size = (DWORD)file_size.QuadPart;
+            result.data = VirtualAlloc(0, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+            if(result.data)
+            {
+                DWORD bytes_read = 0;
+                if(ReadFile(file, result.data, size, &bytes_read, 0) && (bytes_read == size))
+                {
+                    result.size = size;
+                }
+                else
+                {
+                    win32_free_file_memory(result.data);
+                    result.data = 0;
+                }
+            }
+        }
+        
+        CloseHandle(file);
+    }
+    
+    return result;
+}
+
+function bool32 win32_write_entire_file(const char *file_name, void *data, uint64 size)
+{
+    bool32 result = false;
+    
+    HANDLE file = CreateFileA(file_name, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+    if(file != INVALID_HANDLE_VALUE)
+    {
+        result = true;
+        uint8 *at = (uint8 *)data;
+        while(result && size)
+        {
+            DWORD bytes_to_write = (size > Gb(1)) ? (DWORD)Gb(1) : (DWORD)size;
+            DWORD bytes_written = 0;
+            result = (WriteFile(file, at, bytes_to_write, &bytes_written, 0) && (bytes_written == bytes_to_write));
+            at += bytes_to_write;
+            size -= bytes_to_write;
+        }
+        
+        CloseHandle(file);
+    }
+    
+    return result;
+}
+
+function PlatformFile win32_open_file(const char *file_name)
+{
+    PlatformFile result = {};
+    
+    HANDLE file = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if(file != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER file_size;
+        if(GetFileSizeEx(file, &file_size))
+        {
+            result.handle = (void *)file;
+            result.size = (uint64)file_size.QuadPart;
+        }
+        else
+        {
+            CloseHandle(file);
+        }
+    }
+    
+    return result;
+}
+
+// NOTE(alexey): The offset goes through OVERLAPPED, so the reads don't depend on the file pointer
+// and can be issued from multiple threads.
+function bool32 win32_read_file_at(PlatformFile *file, uint64 offset, uint64 size, void *dest)
+{
+    bool32 result = true;
+    
+    uint8 *at = (uint8 *)dest;
+    while(result && size)
+    {
+        DWORD bytes_to_read = (size > Gb(1)) ? (DWORD)Gb(1) : (DWORD)size;
+        
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = (DWORD)(offset & 0xFFFFFFFF);
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+        
+        DWORD bytes_read = 0;
+        result = (ReadFile((HANDLE)file->handle, at, bytes_to_read, &bytes_read, &overlapped) &&
+                  (bytes_read == bytes_to_read));
+        
+        at += bytes_to_read;
+        offset += bytes_to_read;
+        size -= bytes_to_read;
+    }
+    
+    return result;
+}
+
+function void win32_close_file(PlatformFile *file)
+{
+    if(file->handle)
+    {
+        CloseHandle((HANDLE)file->handle);
+        file->handle = 0;
+        file->size = 0;
+    }
+}
+
+function PlatformFileMapping win32_map_file(const char *file_name)
+{
+    PlatformFileMapping result = {};
+    
+    HANDLE file = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if(file != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER file_size;
+        if(GetFileSizeEx(file, &file_size) && (file_size.QuadPart > 0))
+        {
+            HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+            if(mapping)
+            {
+                void *memory = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                if(memory)
+                {
+                    result.file_handle = (void *)file;
+                    result.mapping_handle = (void *)mapping;
+                    result.memory = memory;
+                    result.size = (uint64)file_size.QuadPart;
+                    return result;
+                }
+                
+                CloseHandle(mapping);
+            }
+        }
+        
+        CloseHandle(file);
+    }
+    
+    return result;
+}
+
+function void win32_unmap_file(PlatformFileMapping *mapping)
+{
+    if(mapping->memory)
+    {
+        UnmapViewOfFile(mapping->memory);
+        CloseHandle((HANDLE)mapping->mapping_handle);
+        CloseHandle((HANDLE)mapping->file_handle);
+        *mapping = {};
+    }
+}
+
+// NOTE(alexey): There is no madvise on Windows. 
+// WillNeed goes to PrefetchVirtualMemory when it's available.
+// VirtualUnlock on pages that aren't locked fails, but removes them from the working set,
+// which is what DontNeed asks for.
+function void win32_advise_memory(void *memory, uint64 size, PlatformMemoryAdvice advice)
+{
+    if(!memory || !size)
+    {
+        return;
+    }
+    
+    switch(advice)
+    {
+        case PlatformMemoryAdvice_WillNeed:
+        {
+            if(win32_prefetch_virtual_memory)
+            {
+                Win32MemoryRangeEntry range = {memory, (SIZE_T)size};
+                win32_prefetch_virtual_memory(GetCurrentProcess(), 1, &range, 0);
+            }
+        }break;
+        
+        case PlatformMemoryAdvice_DontNeed:
+        {
+            VirtualUnlock(memory, (SIZE_T)size);
+        }break;
+    }
+}
+
+function bool32 win32_add_work_entry(WorkQueue *queue, WorkQueueCallbackPtr callback, void *data)
+{
+    bool32 result = false;
+    
+    uint32 new_next_entry_to_write = (queue->next_entry_to_write + 1) % ArrayCount(queue->entries);
+    if(new_next_entry_to_write != atomic_load_uint32(&queue->next_entry_to_read))
+    {
+        Win32WorkQueueEntry *entry = &queue->entries[queue->next_entry_to_write];
+        entry->callback = callback;
+        entry->data = data;
+        ++queue->completion_goal;
+        
+        // NOTE(alexey): The entry has to be visible before the workers see the new write index.
+        atomic_store_uint32(&queue->next_entry_to_write, new_next_entry_to_write);
+        ReleaseSemaphore(queue->semaphore, 1, 0);
+        
+        result = true;
+    }
+    
+    return result;
+}
+
+// NOTE(alexey): Returns true when there was nothing to do.
+function bool32 win32_do_next_work_entry(WorkQueue *queue)
+{
+    bool32 should_sleep = false;
+    
+    uint32 original_next_entry_to_read = atomic_load_uint32(&queue->next_entry_to_read);
+    uint32 new_next_entry_to_read = (original_next_entry_to_read + 1) % ArrayCount(queue->entries);
+    if(original_next_entry_to_read != atomic_load_uint32(&queue->next_entry_to_write))
+    {
+        uint32 index = atomic_compare_exchange_uint32(&queue->next_entry_to_read, 
+                                                      new_next_entry_to_read, 
+                                                      original_next_entry_to_read);
+        if(index == original_next_entry_to_read)
+        {
+            Win32WorkQueueEntry entry = queue->entries[index];
+            entry.callback(queue, entry.data);
+            atomic_add_uint32(&queue->completion_count, 1);
+        }
+    }
+    else
+    {
+        should_sleep = true;
+    }
+    
+    return should_sleep;
+}
+
+// NOTE(alexey): The main thread helps with the work until the queue is drained.
+function void win32_complete_all_work(WorkQueue *queue)
+{
+    while(queue->completion_goal != atomic_load_uint32(&queue->completion_count))
+    {
+        win32_do_next_work_entry(queue);
+    }
+    
+    queue->completion_goal = 0;
+    queue->completion_count = 0;
+}
+
+DWORD WINAPI win32_work_queue_thread_proc(LPVOID parameter)
+{
+    WorkQueue *queue = (WorkQueue *)parameter;
+    
+    for(;;)
+    {
+        if(win32_do_next_work_entry(queue))
+        {
+            WaitForSingleObjectEx(queue->semaphore, INFINITE, FALSE);
+        }
+    }
+}
+
+function void win32_make_work_queue(WorkQueue *queue, uint32 thread_count)
+{
+    queue->completion_goal = 0;
+    queue->completion_count = 0;
+    queue->next_entry_to_write = 0;
+    queue->next_entry_to_read = 0;
+    queue->semaphore = CreateSemaphoreExA(0, 0, ArrayCount(queue->entries), 0, 0, SEMAPHORE_ALL_ACCESS);
+    
+    for(uint32 thread_index = 0; thread_index < thread_count; ++thread_index)
+    {
+        DWORD thread_id;
+        HANDLE thread = CreateThread(0, 0, win32_work_queue_thread_proc, queue, 0, &thread_id);
+        CloseHandle(thread);
+    }
+}
+
+// NOTE(alexey): The counters add up over WIN32_DEBUG_CYCLE_COUNTER_FRAME_COUNT frames 
+// and are printed per frame then, the debugger output can't keep up with a print every frame.
+function void win32_handle_debug_cycle_counters(Os *os_, Win32Variables *variables)
+{
+#if INTERNAL_BUILD
+    if(++variables->debug_cycle_counter_frame_count < WIN32_DEBUG_CYCLE_COUNTER_FRAME_COUNT)
+    {
+        return;
+    }
+    
+    uint32 frame_count = variables->debug_cycle_counter_frame_count;
+    DebugOut("DEBUG CYCLE COUNTS (per frame, %u frames):\n", frame_count);
+    for(int32 counter_index = 0; counter_index < DebugCycleCounter_Count; ++counter_index)
+    {
+        // NOTE(alexey): The other threads keep adding while it's printed, what they add after the exchange is in the next print.
+        DebugCycleCounter *counter = &os_->counters[counter_index];
+        uint64 cycle_count = atomic_exchange_uint64(&counter->cycle_count, 0);
+        uint64 hit_count = atomic_exchange_uint64(&counter->hit_count, 0);
+        if(hit_count)
+        {
+            DebugOut("  %s: %llucy %lluh %llucy/h\n", 
+                     debug_cycle_counter_names[counter_index],
+                     cycle_count / frame_count,
+                     hit_count / frame_count,
+                     cycle_count / hit_count);
+        }
+    }
+    variables->debug_cycle_counter_frame_count = 0;
+#endif
+}
+
 function uint64 win32_frequency()
 {
     uint64 result = 0;
@@ -69,6 +503,99 @@ function uint64 win32_qpc()
     return result;
 }
 
+function void win32_sleep(uint32 milliseconds)
+{
+    Sleep(milliseconds);
+}
+
+// NOTE(alexey): XInput is loaded at runtime, without it there's simply no controller.
+function void win32_load_xinput()
+{
+    HMODULE library = LoadLibraryA("xinput1_4.dll");
+    if(!library)
+    {
+        library = LoadLibraryA("xinput9_1_0.dll");
+    }
+    if(!library)
+    {
+        library = LoadLibraryA("xinput1_3.dll");
+    }
+    if(library)
+    {
+        win32_xinput_get_state = (Win32XInputGetStatePtr *)GetProcAddress(library, "XInputGetState");
+    }
+}
+
+inline real32 win32_normalize_stick_axis(SHORT value)
+{
+    real32 result = (value < 0) ? (value / 32768.0f) : (value / 32767.0f);
+    return result;
+}
+
+function Controller win32_process_xinput_state(XINPUT_STATE *state)
+{
+    XINPUT_GAMEPAD *pad = &state->Gamepad;
+    
+    Controller result = {};
+    result.is_connected = true;
+    result.left_stick = process_stick(win32_normalize_stick_axis(pad->sThumbLX), 
+                                      win32_normalize_stick_axis(pad->sThumbLY),
+                                      CONTROLLER_STICK_DEADZONE, CONTROLLER_RESPONSE_EXPONENT);
+    result.right_stick = process_stick(win32_normalize_stick_axis(pad->sThumbRX), 
+                                       win32_normalize_stick_axis(pad->sThumbRY),
+                                       CONTROLLER_STICK_DEADZONE, CONTROLLER_RESPONSE_EXPONENT);
+    result.left_trigger = process_trigger(pad->bLeftTrigger / 255.0f, CONTROLLER_TRIGGER_DEADZONE);
+    result.right_trigger = process_trigger(pad->bRightTrigger / 255.0f, CONTROLLER_TRIGGER_DEADZONE);
+    
+    static const WORD button_masks[ControllerButton_Count] = 
+    {
+        XINPUT_GAMEPAD_A, XINPUT_GAMEPAD_B, XINPUT_GAMEPAD_X, XINPUT_GAMEPAD_Y,
+        XINPUT_GAMEPAD_LEFT_SHOULDER, XINPUT_GAMEPAD_RIGHT_SHOULDER, XINPUT_GAMEPAD_BACK, XINPUT_GAMEPAD_START,
+        XINPUT_GAMEPAD_DPAD_UP, XINPUT_GAMEPAD_DPAD_DOWN, XINPUT_GAMEPAD_DPAD_LEFT, XINPUT_GAMEPAD_DPAD_RIGHT,
+    };
+    for(uint32 button_index = 0; button_index < ControllerButton_Count; ++button_index)
+    {
+        if(pad->wButtons & button_masks[button_index])
+        {
+            result.buttons |= (1 << button_index);
+        }
+    }
+    
+    return result;
+}
+
+// NOTE(alexey): Polls the first controller CONTROLLER_POLL_RATE times a second and publishes the state 
+// whenever it changed. XInputGetState is slow for a controller that isn't connected, 
+// so without one it's only checked once a second.
+DWORD WINAPI win32_controller_thread_proc(LPVOID parameter)
+{
+    ControllerMailbox *mailbox = (ControllerMailbox *)parameter;
+    DWORD last_packet_number = 0;
+    bool32 was_connected = false;
+    
+    for(;;)
+    {
+        XINPUT_STATE state;
+        bool32 is_connected = (win32_xinput_get_state(0, &state) == ERROR_SUCCESS);
+        if(is_connected && (!was_connected || (state.dwPacketNumber != last_packet_number)))
+        {
+            Controller controller = win32_process_xinput_state(&state);
+            controller.sample_qpc = win32_qpc();
+            publish_controller(mailbox, &controller);
+            last_packet_number = state.dwPacketNumber;
+        }
+        else if(!is_connected && was_connected)
+        {
+            Controller controller = {};
+            controller.sample_qpc = win32_qpc();
+            publish_controller(mailbox, &controller);
+        }
+        was_connected = is_connected;
+        
+        Sleep(is_connected ? (1000 / CONTROLLER_POLL_RATE) : 1000);
+    }
+}
+
 function real32 win32_elapsed_seconds(uint64 start_counts,
                                       uint64 frequency)
 {
@@ -104,6 +631,32 @@ static Win32GameCode win32_load_game_code(Win32Variables *variables)
     return result;
 }
 
+// NOTE(alexey): The work queues' threads run the game's code, the simulation thread for as long as the game does,
+// so it's asked to quit and every queue is drained before the library goes away.
+static void win32_unload_game_code(Win32GameCode *game_code)
+{
+    if(os_instance.simulation_queue)
+    {
+        atomic_store_uint32(&os_instance.quit_requested, true);
+        win32_complete_all_work(os_instance.simulation_queue);
+    }
+    if(os_instance.compute_queue)
+    {
+        win32_complete_all_work(os_instance.compute_queue);
+    }
+    if(os_instance.loader_queue)
+    {
+        win32_complete_all_work(os_instance.loader_queue);
+    }
+    
+    if(game_code->dll)
+    {
+        FreeLibrary(game_code->dll);
+    }
+    *game_code = {};
+    game_code->update_and_render = game_update_and_render_stub;
+}
+
 static void win32_init_opengl(HDC window_dc)
 {
     PIXELFORMATDESCRIPTOR pfd = {};
@@ -203,15 +756,60 @@ static void win32_resize_dib_section(Win32OffscreenBuffer *buffer, int32 width,
     }
 }
 
+// NOTE(alexey): The buffer follows the window's size (see win32_update_offscreen_buffer), so it's a 1:1 copy, 
+// the game does the scaling from its render resolution itself. 
+// The buffer is only stretched for the frame when the window was resized after the game rendered it.
 static void win32_display_offscreen_buffer_in_window(HDC device_context, Win32OffscreenBuffer *buffer, int32 window_width, int32 window_height)
 {
-     StretchDIBits(device_context, 
-                  0, 0, buffer->width, buffer->height, 
+    if((window_width <= 0) || (window_height <= 0))
+    {
+        return;
+    }
+    
+    StretchDIBits(device_context, 
+                  0, 0, window_width, window_height, 
                   0, 0, buffer->width, buffer->height,
-                   buffer->data,
-                   &buffer->info,
-                   DIB_RGB_COLORS,
-                   SRCCOPY);
+                  buffer->data,
+                  &buffer->info,
+                  DIB_RGB_COLORS,
+                  SRCCOPY);
+}
+
+// NOTE(alexey): Resizes the buffer to the window's client area, a minimized window keeps the old one.
+static void win32_update_offscreen_buffer(Win32OffscreenBuffer *buffer, OffscreenBuffer *os_buffer, 
+                                          int32 window_width, int32 window_height)
+{
+    if((window_width > 0) && (window_height > 0) &&
+       ((window_width != buffer->width) || (window_height != buffer->height)))
+    {
+        win32_resize_dib_section(buffer, window_width, window_height);
+    }
+    
+    os_buffer->width = buffer->width;
+    os_buffer->height = buffer->height;
+    os_buffer->pitch = buffer->pitch;
+    os_buffer->data = buffer->data;
+    os_buffer->bpp = buffer->bpp;
+}
+
+function void win32_init_key_table(KeyTable *table)
+{
+    init_key_table(table);
+    map_key(table, 'W', Key_W);
+    map_key(table, 'A', Key_A);
+    map_key(table, 'S', Key_S);
+    map_key(table, 'D', Key_D);
+    map_key(table, VK_LEFT, Key_Left);
+    map_key(table, VK_UP, Key_Up);
+    map_key(table, VK_RIGHT, Key_Right);
+    map_key(table, VK_DOWN, Key_Down);
+    for(uint32 f_index = 0; f_index <= (Key_F12 - Key_F1); ++f_index)
+    {
+        map_key(table, VK_F1 + f_index, (Key)(Key_F1 + f_index));
+    }
+    map_key(table, VK_MENU, Key_Alt);
+    map_key(table, VK_CONTROL, Key_Ctrl);
+    map_key(table, VK_SHIFT, Key_Shift);
 }
 
 LRESULT win32_main_window_proc(HWND window, UINT msg, WPARAM wparam, LPARAM lparam)
@@ -241,6 +839,12 @@ LRESULT win32_main_window_proc(HWND window, UINT msg, WPARAM wparam, LPARAM lpar
             }
 #endif
             
+            Key key = translate_key(&win32_key_table, vk_code);
+            if(key == Key_Count)
+            {
+                break;
+            }
+            
             Event event = {};
             
             // NOTE(alexey): Can we have multiple key modifiers?
@@ -267,105 +871,20 @@ LRESULT win32_main_window_proc(HWND window, UINT msg, WPARAM wparam, LPARAM lpar
             }
 #endif
 
-            if(vk_code == 'W')
-            {
-                event.key = Key_W;
-            }
-            else if(vk_code == 'A')
-            {
-                event.key = Key_A;
-            }
-            else if(vk_code == 'S')
-            {
-                event.key = Key_S;
-            }
-            else if(vk_code == 'D')
-            {
-                event.key = Key_D;
-            }
-            else if(vk_code == VK_LEFT)
-            {
-                event.key = Key_Left;
-            }
-            else if(vk_code == VK_UP)
-            {
-                event.key = Key_Up;
-            }
-            else if(vk_code == VK_RIGHT)
-            {
-                event.key = Key_Right;
-            }
-            else if(vk_code == VK_DOWN)
-            {
-                event.key = Key_Down;
-            }
-            else if(vk_code == VK_F1)
-            {
-                event.key = Key_F1;
-            }
-            else if(vk_code == VK_F2)
-            {
-                event.key = Key_F2;
-            }
-            else if(vk_code == VK_F3)
-            {
-                event.key = Key_F3;
-            }
-            else if(vk_code == VK_F4)
-            {
-                event.key = Key_F4;
-            }
-            else if(vk_code == VK_F5)
-            {
-                event.key = Key_F5;
-            }
-            else if(vk_code == VK_F6)
-            {
-                event.key = Key_F6;
-            }
-            else if(vk_code == VK_F7)
-            {
-                event.key = Key_F7;
-            }
-            else if(vk_code == VK_F8)
-            {
-                event.key = Key_F8;
-            }
-            else if(vk_code == VK_F9)
-            {
-                event.key = Key_F9;
-            }
-            else if(vk_code == VK_F10)
-            {
-                event.key = Key_F10;
-            }
-            else if(vk_code == VK_F11)
+            event.key = key;
+            
+            // NOTE(alexey): The modifier keys themselves aren't modifiers of their own events.
+            if(key == Key_Alt)
             {
-                event.key = Key_F11;
+                event.key_modifiers &= ~KeyModifier_Alt;
             }
-            else if(vk_code == VK_MENU)
+            else if(key == Key_Ctrl)
             {
-                if(event.key_modifiers & KeyModifier_Alt)
-                {
-                    event.key_modifiers ^= KeyModifier_Alt;
-                }
-                event.key = Key_Alt; 
+                event.key_modifiers &= ~KeyModifier_Ctrl;
             }
-            else if(vk_code == VK_CONTROL)
+            else if(key == Key_Shift)
             {
-                if(event.key_modifiers & KeyModifier_Ctrl)
-                {
-                    event.key_modifiers ^= KeyModifier_Ctrl;
-                }   
-                event.key = Key_Ctrl; 
-            }
-            else if(vk_code == VK_SHIFT)
-            {
-                if(event.key_modifiers & KeyModifier_Shift)
-                {
-                    event.key_modifiers ^= KeyModifier_Shift;
-                }
-                event.key = Key_Shift; 
+                event.key_modifiers &= ~KeyModifier_Shift;
             }
             
             if(is_down)
@@ -389,12 +908,16 @@ LRESULT win32_main_window_proc(HWND window, UINT msg, WPARAM wparam, LPARAM lpar
         {
             Vec2 cursor_pos = win32_get_cursor_pos(window);
             
-            Event event = {};
-            event.type = EventType_MouseMoved;
-            event.cursor.x = cursor_pos.x;
-            event.cursor.y = cursor_pos.y;
+            Vec2 cursor_delta(0.0f);
+            if(win32_variables.cursor_pos_is_valid)
+            {
+                cursor_delta.x = cursor_pos.x - win32_variables.last_cursor_pos.x;
+                cursor_delta.y = cursor_pos.y - win32_variables.last_cursor_pos.y;
+            }
+            win32_variables.last_cursor_pos = cursor_pos;
+            win32_variables.cursor_pos_is_valid = true;
             
-            os_instance.events.push_back(event);
+            push_mouse_move(&os_instance.events, cursor_pos, cursor_delta);
         }break;
         
         // NOTE(alexey): We have code duplication, probably it would be better to use GetKeyState?
@@ -460,6 +983,7 @@ p0{
     uint64 frequency = win32_frequency();
     os_instance.frequency = frequency;
     
+    uint64 startup_counts = win32_qpc();
     uint64 start_counts, end_counts;
     
     win32_get_exe_full_path(&win32_variables);
@@ -479,12 +1003,56 @@ p0{
 //    window_class.lpszMenuName;
     window_class.lpszClassName = "GameWindowClass";
     
+    // NOTE(alexey): Only the display rate, the game simulates at its own fixed rate 
+    // and gets the real time every frame took in dt_for_frame.
     real32 seconds_per_frame = 1.0f/60.0f;
     
+    win32_init_key_table(&win32_key_table);
+    
     os_instance.dt_for_frame = seconds_per_frame;
     os_instance.get_qpc = win32_qpc;
+    os_instance.sleep = win32_sleep;
     os_instance.alloc_memory = win32_alloc_memory;
     os_instance.free_memory = win32_free_memory;
+    os_instance.read_entire_file = win32_read_entire_file;
+    os_instance.free_file_memory = win32_free_file_memory;
+    os_instance.write_entire_file = win32_write_entire_file;
+    os_instance.open_file = win32_open_file;
+    os_instance.read_file_at = win32_read_file_at;
+    os_instance.close_file = win32_close_file;
+    os_instance.map_file = win32_map_file;
+    os_instance.unmap_file = win32_unmap_file;
+    os_instance.advise_memory = win32_advise_memory;
+    
+    win32_prefetch_virtual_memory = 
+        (Win32PrefetchVirtualMemoryPtr *)GetProcAddress(GetModuleHandleA("kernel32.dll"), "PrefetchVirtualMemory");
+    
+    // NOTE(alexey): A single thread for blocking I/O (world streaming).
+    win32_make_work_queue(&win32_loader_queue, 1);
+    os_instance.loader_queue = &win32_loader_queue;
+    
+    // NOTE(alexey): The main thread works on the compute queue too, while it waits for the batch.
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    uint32 compute_thread_count = (system_info.dwNumberOfProcessors > 1) ? (system_info.dwNumberOfProcessors - 1) : 1;
+    win32_make_work_queue(&win32_compute_queue, compute_thread_count);
+    os_instance.compute_queue = &win32_compute_queue;
+    
+    // NOTE(alexey): The game keeps the simulation running on this thread, the main thread only renders.
+    win32_make_work_queue(&win32_simulation_queue, 1);
+    os_instance.simulation_queue = &win32_simulation_queue;
+    os_instance.compute_thread_count = compute_thread_count;
+    os_instance.add_work_entry = win32_add_work_entry;
+    os_instance.complete_all_work = win32_complete_all_work;
+    
+    win32_load_xinput();
+    if(win32_xinput_get_state)
+    {
+        win32_controller_mailbox.buffer.init();
+        DWORD thread_id;
+        HANDLE thread = CreateThread(0, 0, win32_controller_thread_proc, &win32_controller_mailbox, 0, &thread_id);
+        CloseHandle(thread);
+    }
         
     bool32 sleep_is_accurate = false;
     
@@ -512,7 +1080,6 @@ p0{
                                            0);
         if(main_window)
         {
-            win32_resize_dib_section(&win32_variables.buffer, 1080, 720);
             Win32DeviceContextScoped device_context(main_window);
             win32_init_opengl(device_context.dc);
             
@@ -520,14 +1087,14 @@ p0{
             os_instance.frame_memory_size = Gb(2);
             
             uint64 alloc_size = (os_instance.permanent_memory_size + os_instance.frame_memory_size);
-            os_instance.permanent_memory = win32_alloc_memory(alloc_size);
+            bool32 has_large_pages;
+            os_instance.permanent_memory = win32_reserve_game_memory(alloc_size, &has_large_pages);
+            assert(os_instance.permanent_memory);
             os_instance.frame_memory = (void *)((char *)os_instance.permanent_memory + os_instance.permanent_memory_size);
-            
-            os_instance.buffer.width = win32_variables.buffer.width;
-            os_instance.buffer.height = win32_variables.buffer.height;
-            os_instance.buffer.pitch = win32_variables.buffer.pitch;
-            os_instance.buffer.data = win32_variables.buffer.data;
-            os_instance.buffer.bpp = win32_variables.buffer.bpp;
+            os_instance.commit_memory = win32_commit_memory;
+            os_instance.reserved_memory_size = alloc_size;
+            os_instance.committed_memory_size = has_large_pages ? alloc_size : 0;
+            bool32 startup_is_reported = false;
             
             ShowWindow(main_window, SW_SHOW);
             win32_variables.is_running = true;
@@ -542,11 +1109,31 @@ p0{
                     DispatchMessageA(&msg);
                 }
                 
+                take_latest_controller(&win32_controller_mailbox, &os_instance.input.controller);
+                
                 Vec2 window_size = win32_get_window_size(main_window);
                 os_instance.width = window_size.x;
                 os_instance.height = window_size.y;
+                win32_update_offscreen_buffer(&win32_variables.buffer, &os_instance.buffer, 
+                                              (int32)window_size.x, (int32)window_size.y);
                 
                 game_code.update_and_render(&os_instance);
+                win32_handle_debug_cycle_counters(&os_instance, &win32_variables);
+                
+                if(!startup_is_reported)
+                {
+                    // NOTE(alexey): Everything the first frame touched was faulted in by now.
+                    char text_buffer[256];
+                    sprintf_s(text_buffer, sizeof(text_buffer), 
+                              "startup: %.2fms, %s pages, %llu of %llu MB committed, %u page faults, "
+                              "peak working set %llu kB\n", 
+                              win32_elapsed_seconds(startup_counts, frequency)*1000.0f, 
+                              has_large_pages ? "large" : "normal", 
+                              os_instance.committed_memory_size / Mb(1), os_instance.reserved_memory_size / Mb(1),
+                              win32_get_page_fault_count(), win32_get_peak_working_set_size() / Kb(1));
+                    OutputDebugStringA(text_buffer);
+                    startup_is_reported = true;
+                }
                 
                 // TODO(alexey): Do I have to include time spend to displaying the buffer
                 // into the frame's time?
@@ -578,12 +1165,16 @@ p0{
                 real32 elapsed_seconds = ((real32)elapsed_counts * (1.0f / (real32)frequency));
                 real32 elapsed_milliseconds = elapsed_seconds * 1000.0f;
                 real32 fps = (1.0f / (real32)(elapsed_counts)) * (real32)frequency;
+                
+                os_instance.dt_for_frame = elapsed_seconds;
                     
 #if 0
                 DebugOut("ElapsedMl: %f\nFps: %f\n\n", elapsed_milliseconds, fps);
 #endif
                 start_counts = end_counts;
             }
+            
+            win32_unload_game_code(&game_code);
         }
         else
         {
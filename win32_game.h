@@ -17,6 +17,13 @@ struct Win32Variables
     bool32 is_running;
     Win32OffscreenBuffer buffer;
     
+    // NOTE(alexey): For the motion of the next mouse move.
+    Vec2 last_cursor_pos;
+    bool32 cursor_pos_is_valid;
+    
+    // NOTE(alexey): Frames since the cycle counters were printed last.
+    uint32 debug_cycle_counter_frame_count;
+    
     char exe_file_path[256];
     char one_past_slash[256];
     
@@ -30,6 +37,40 @@ struct Win32GameCode
     bool32 is_valid;
 };
 
+// NOTE(alexey): PrefetchVirtualMemory is Windows 8+, so it's loaded at runtime.
+struct Win32MemoryRangeEntry
+{
+    void *virtual_address;
+    SIZE_T number_of_bytes;
+};
+
+typedef BOOL WINAPI Win32PrefetchVirtualMemoryPtr(HANDLE process, ULONG_PTR entry_count, 
+                                                  Win32MemoryRangeEntry *entries, ULONG flags);
+
+// NOTE(alexey): XInput is loaded at runtime as well, see win32_load_xinput.
+typedef DWORD WINAPI Win32XInputGetStatePtr(DWORD user_index, XINPUT_STATE *state);
+
+struct Win32WorkQueueEntry
+{
+    WorkQueueCallbackPtr callback;
+    void *data;
+};
+
+// NOTE(alexey): Circular buffer of entries, written by the queue's single producer thread (see WorkQueue in os.h),
+// worker threads race for next_entry_to_read with a compare exchange.
+struct WorkQueue
+{
+    uint32 volatile completion_goal;
+    uint32 volatile completion_count;
+    
+    uint32 volatile next_entry_to_write;
+    uint32 volatile next_entry_to_read;
+    
+    HANDLE semaphore;
+    
+    Win32WorkQueueEntry entries[256];
+};
+
 struct Win32DeviceContextScoped
 {
     Win32DeviceContextScoped(HWND window_) : window(window_), dc(GetDC(window)){}
@@ -0,0 +1,308 @@
+/*
+  Builds a world file for the game (see game_world_file.h).
+
+  usage: world_builder [-raw] [-seed <seed>] <output file> [tile_map_count_x tile_map_count_y]
+
+  Without the counts the hand-made 2x2 world is written.
+  With the counts, the hand-made tile maps are repeated over the whole world,
+  which is what we use to produce huge worlds for the streaming tests,
+  e.g. "world_builder -raw data\world.twld 2700 2700" writes ~4.5GB.
+  With -seed the tile maps are generated instead (see game_world_generator.h),
+  the same seed and counts always give the same world.
+
+  Chunks are run-length encoded unless -raw is passed (or the encoding doesn't make them smaller).
+  Every encoded chunk is decoded back and compared against the source tiles before it's written,
+  one that doesn't match is reported and written raw.
+
+  Chunks are built on all the cores, a band of tile map rows at a time,
+  and written in order by the main thread.
+*/
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <thread>
+#include <chrono>
+
+#include "os.h"
+#include "game.h"
+#include "game_default_world.h"
+#include "game_world_generator.h"
+
+#define BUILDER_BAND_ROW_COUNT 64
+
+struct WorldBuilder
+{
+    bool32 compress;
+    bool32 generate;
+    WorldGeneratorParams params;
+
+    U32 tile_count;
+    U32 chunk_size;
+
+    // NOTE(alexey): Per band, every chunk gets chunk_size bytes in data, whether it's encoded or not.
+    U8 *data;
+    U32 *sizes;
+    U32 *flags;
+    U32 *tiles;
+};
+
+// NOTE(alexey): Tile maps in the world file go bottom-up, default_tile_maps go top-down.
+function U32 *get_default_tile_map(I32 tile_map_x, I32 tile_map_y)
+{
+    I32 default_x = tile_map_x % DefaultTileMapCountX;
+    I32 default_y = tile_map_y % DefaultTileMapCountY;
+    I32 index = (DefaultTileMapCountY - default_y - 1)*DefaultTileMapCountX + default_x;
+
+    U32 *result = (U32 *)default_tile_maps[index];
+    return result;
+}
+
+// NOTE(alexey): Runs on the worker threads, every thread gets its own range of chunks in the band,
+// so nothing is shared apart from the read-only builder settings.
+function void build_chunks(WorldBuilder *builder, I32 first_tile_map_y, U64 first_chunk, U64 one_past_last_chunk)
+{
+    I32 tile_map_count_x = builder->params.tile_map_count_x;
+    for(U64 chunk = first_chunk; chunk < one_past_last_chunk; ++chunk)
+    {
+        I32 tile_map_x = (I32)(chunk % tile_map_count_x);
+        I32 tile_map_y = first_tile_map_y + (I32)(chunk / tile_map_count_x);
+
+        U32 *tiles = builder->tiles + chunk*builder->tile_count;
+        if(builder->generate)
+        {
+            generate_tile_map(&builder->params, tile_map_x, tile_map_y, tiles);
+        }
+        else
+        {
+            memcpy(tiles, get_default_tile_map(tile_map_x, tile_map_y), builder->chunk_size);
+        }
+
+        U8 *data = builder->data + chunk*builder->chunk_size;
+        builder->sizes[chunk] = builder->chunk_size;
+        builder->flags[chunk] = 0;
+
+        U32 encoded_size = 0;
+        if(builder->compress)
+        {
+            // NOTE(alexey): Only keep the encoding if it's smaller than the raw chunk.
+            encoded_size = rle_encode_tiles(tiles, builder->tile_count, (U32 *)data, builder->chunk_size - sizeof(U32));
+        }
+
+        if(encoded_size)
+        {
+            // NOTE(alexey): Checked in every build, a chunk that doesn't decode back is written raw instead.
+            U32 decoded_tiles[TilesCountX*TilesCountY];
+            bool32 round_trips = (rle_decode_tiles((U32 *)data, encoded_size, decoded_tiles, builder->tile_count) &&
+                                  (memcmp(decoded_tiles, tiles, builder->chunk_size) == 0));
+            if(!round_trips)
+            {
+                fprintf(stderr, "chunk %d, %d doesn't decode back to its tiles, it's written raw.\n", tile_map_x, tile_map_y);
+                encoded_size = 0;
+            }
+        }
+
+        if(encoded_size)
+        {
+            builder->sizes[chunk] = encoded_size;
+            builder->flags[chunk] = WorldFileChunkFlag_RLE;
+        }
+        else
+        {
+            memcpy(data, tiles, builder->chunk_size);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *program_name = argv[0];
+
+    WorldBuilder builder = {};
+    builder.compress = true;
+
+    ++argv;
+    --argc;
+    while(argc && (argv[0][0] == '-'))
+    {
+        if(strcmp(argv[0], "-raw") == 0)
+        {
+            builder.compress = false;
+        }
+        else if((strcmp(argv[0], "-seed") == 0) && (argc > 1))
+        {
+            builder.generate = true;
+            builder.params.seed = strtoull(argv[1], 0, 0);
+            ++argv;
+            --argc;
+        }
+        else
+        {
+            break;
+        }
+
+        ++argv;
+        --argc;
+    }
+
+    if((argc != 1) && (argc != 3))
+    {
+        fprintf(stderr, "usage: %s [-raw] [-seed <seed>] <output file> [tile_map_count_x tile_map_count_y]\n",
+                program_name);
+        return 1;
+    }
+
+    const char *file_name = argv[0];
+
+    I32 tile_map_count_x = DefaultTileMapCountX;
+    I32 tile_map_count_y = DefaultTileMapCountY;
+    if(argc == 3)
+    {
+        tile_map_count_x = atoi(argv[1]);
+        tile_map_count_y = atoi(argv[2]);
+        if((tile_map_count_x <= 0) || (tile_map_count_y <= 0))
+        {
+            fprintf(stderr, "tile map counts have to be positive.\n");
+            return 1;
+        }
+    }
+
+    builder.params.tile_map_count_x = tile_map_count_x;
+    builder.params.tile_map_count_y = tile_map_count_y;
+    builder.params.tile_count_x = TilesCountX;
+    builder.params.tile_count_y = TilesCountY;
+    builder.tile_count = TilesCountX*TilesCountY;
+    builder.chunk_size = builder.tile_count*sizeof(U32);
+
+    FILE *file = fopen(file_name, "wb");
+    if(!file)
+    {
+        fprintf(stderr, "failed to open %s for writing.\n", file_name);
+        return 1;
+    }
+
+    WorldFileHeader header = {};
+    header.magic = WORLD_FILE_MAGIC;
+    header.version = WORLD_FILE_VERSION;
+    header.tile_map_count_x = tile_map_count_x;
+    header.tile_map_count_y = tile_map_count_y;
+    header.tile_count_x = TilesCountX;
+    header.tile_count_y = TilesCountY;
+
+    // NOTE(alexey): The header is written once more at the end, when we know where the index is.
+    fwrite(&header, sizeof(header), 1, file);
+
+    U64 chunk_count = (U64)tile_map_count_x*tile_map_count_y;
+    WorldFileChunkEntry *chunk_index = (WorldFileChunkEntry *)calloc(chunk_count, sizeof(WorldFileChunkEntry));
+    assert(chunk_index);
+
+    U64 band_chunk_count = (U64)BUILDER_BAND_ROW_COUNT*tile_map_count_x;
+    builder.data = (U8 *)malloc(band_chunk_count*builder.chunk_size);
+    builder.tiles = (U32 *)malloc(band_chunk_count*builder.chunk_size);
+    builder.sizes = (U32 *)malloc(band_chunk_count*sizeof(U32));
+    builder.flags = (U32 *)malloc(band_chunk_count*sizeof(U32));
+    assert(builder.data && builder.tiles && builder.sizes && builder.flags);
+
+    U32 thread_count = std::thread::hardware_concurrency();
+    if(!thread_count)
+    {
+        thread_count = 1;
+    }
+
+    std::thread *threads = new std::thread[thread_count];
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::duration build_duration = {};
+    Clock::time_point start_time = Clock::now();
+
+    U64 encoded_chunk_count = 0;
+    U64 offset = sizeof(header);
+    for(I32 first_tile_map_y = 0; first_tile_map_y < tile_map_count_y; first_tile_map_y += BUILDER_BAND_ROW_COUNT)
+    {
+        I32 row_count = tile_map_count_y - first_tile_map_y;
+        if(row_count > BUILDER_BAND_ROW_COUNT)
+        {
+            row_count = BUILDER_BAND_ROW_COUNT;
+        }
+
+        Clock::time_point build_start_time = Clock::now();
+
+        U64 chunk_count_in_band = (U64)row_count*tile_map_count_x;
+        for(U32 thread_index = 0; thread_index < thread_count; ++thread_index)
+        {
+            U64 first_chunk = (chunk_count_in_band*thread_index) / thread_count;
+            U64 one_past_last_chunk = (chunk_count_in_band*(thread_index + 1)) / thread_count;
+            threads[thread_index] = std::thread(build_chunks, &builder, first_tile_map_y, first_chunk, one_past_last_chunk);
+        }
+
+        for(U32 thread_index = 0; thread_index < thread_count; ++thread_index)
+        {
+            threads[thread_index].join();
+        }
+
+        build_duration += (Clock::now() - build_start_time);
+
+        for(U64 chunk = 0; chunk < chunk_count_in_band; ++chunk)
+        {
+            WorldFileChunkEntry *entry = &chunk_index[(U64)first_tile_map_y*tile_map_count_x + chunk];
+            entry->offset = offset;
+            entry->size = builder.sizes[chunk];
+            entry->flags = builder.flags[chunk];
+
+            fwrite(builder.data + chunk*builder.chunk_size, entry->size, 1, file);
+            offset += entry->size;
+
+            if(entry->flags & WorldFileChunkFlag_RLE)
+            {
+                ++encoded_chunk_count;
+            }
+        }
+
+        printf("%llu/%llu chunks\n", (unsigned long long)(first_tile_map_y + row_count)*tile_map_count_x, (unsigned long long)chunk_count);
+    }
+
+    header.chunk_index_offset = offset;
+    fwrite(chunk_index, sizeof(WorldFileChunkEntry), chunk_count, file);
+    offset += chunk_count*sizeof(WorldFileChunkEntry);
+
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+
+    bool32 failed = ferror(file);
+    fclose(file);
+
+    F64 total_seconds = std::chrono::duration<F64>(Clock::now() - start_time).count();
+    F64 build_seconds = std::chrono::duration<F64>(build_duration).count();
+
+    delete[] threads;
+    free(builder.flags);
+    free(builder.sizes);
+    free(builder.tiles);
+    free(builder.data);
+    free(chunk_index);
+
+    if(failed)
+    {
+        fprintf(stderr, "failed to write %s.\n", file_name);
+        return 1;
+    }
+
+    // NOTE(alexey): In the mapped mode this is what stays resident, the chunks are decoded on demand.
+    U64 chunk_data_size = header.chunk_index_offset - sizeof(header);
+    printf("%s: %llu chunks (%llu encoded), %llu bytes.\n", file_name, (unsigned long long)chunk_count, (unsigned long long)encoded_chunk_count, (unsigned long long)offset);
+    printf("chunk data: %llu bytes, raw %llu bytes (%.2fx), %.2f MB per million chunks.\n",
+           (unsigned long long)chunk_data_size,
+           (unsigned long long)(chunk_count*builder.chunk_size),
+           (F64)(chunk_count*builder.chunk_size) / (F64)chunk_data_size,
+           ((F64)chunk_data_size / (F64)chunk_count)*1000000.0 / (1024.0*1024.0));
+    printf("%s %llu chunks on %u threads in %.3f s (%.0f chunks/s), %.3f s in total (%.0f chunks/s).\n",
+           builder.generate ? "generated" : "copied",
+           (unsigned long long)chunk_count,
+           thread_count,
+           build_seconds,
+           (F64)chunk_count / build_seconds,
+           total_seconds,
+           (F64)chunk_count / total_seconds);
+    return 0;
+}